@@ -0,0 +1,64 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include "PerfCounters.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Handed to a benchmark, which runs its operation iterations() times
+ *
+ * Setup that has to be repeated inside the loop, such as replacing a reader
+ * that accumulated results, goes between pause() and resume().  Given perf
+ * counters, the events while running are counted as well.
+ */
+class bench_state
+{
+public:
+  explicit bench_state(uint64_t iterations, const PerfCounters *counters = nullptr);
+
+  uint64_t iterations() const { return count; }
+  void pause();
+  void resume();
+  std::chrono::nanoseconds elapsed() const;
+  perf_sample counted() const;
+
+private:
+  using clock = std::chrono::steady_clock;
+  uint64_t count;
+  const PerfCounters *counters;
+  perf_sample events;
+  perf_sample marked;// counter reading at the last resume
+  clock::duration total;
+  clock::time_point started;
+  bool running;
+};
+
+struct benchmark
+{
+  std::string name;// group/what/variant, results are sorted by it
+  uint64_t bytes;// input bytes per iteration, 0 when throughput means nothing
+  std::function<void(bench_state &)> run;
+};
+
+/**
+ * @brief Keep a value the optimizer would otherwise throw away
+ */
+template<typename T>
+inline void keep(const T &value)
+{
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/**
+ * @brief Benchmarks of the decoders, and of whole parses of files
+ *
+ * @param files parsed end to end in addition to the generated ones
+ * @param large symbol count of the large generated file
+ */
+std::vector<benchmark> elf_benchmarks(const std::vector<std::string> &files, size_t large);
+
+#endif /* BENCH_HPP */
@@ -0,0 +1,304 @@
+#include "bench.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+
+bench_state::bench_state(uint64_t iterations, const PerfCounters *counters)
+  : count(iterations), counters(counters), events{}, marked(counters != nullptr ? counters->read() : perf_sample{}), total(0), started(clock::now()), running(true)
+{
+}
+
+void bench_state::pause()
+{
+  if (!running) return;
+  total += clock::now() - started;
+  if (counters != nullptr) events.add(counters->read().since(marked));
+  running = false;
+}
+
+void bench_state::resume()
+{
+  if (running) return;
+  if (counters != nullptr) marked = counters->read();
+  started = clock::now();
+  running = true;
+}
+
+std::chrono::nanoseconds bench_state::elapsed() const
+{
+  auto result = total;
+  if (running) result += clock::now() - started;
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(result);
+}
+
+perf_sample bench_state::counted() const
+{
+  auto result = events;
+  if (running && counters != nullptr) result.add(counters->read().since(marked));
+  return result;
+}
+
+namespace {
+
+struct bench_result
+{
+  std::string name;
+  uint64_t iterations;// per repetition
+  double ns_per_op;// median of the repetitions
+  double min_ns_per_op;
+  double spread;// (slowest - fastest) / median, how far to trust ns_per_op
+  uint64_t bytes_per_op;
+  perf_sample counters;// of one more run of iterations, with --perf
+};
+
+std::chrono::nanoseconds time_once(const benchmark &bench, uint64_t iterations)
+{
+  bench_state state(iterations);
+  bench.run(state);
+  return state.elapsed();
+}
+
+/**
+ * @brief Find an iteration count that runs for min_time, then take the median
+ *        of the repetitions
+ *
+ * The perf counters are read in a run of their own, reading them costs
+ * microseconds and would show in the times.
+ */
+bench_result measure(const benchmark &bench, std::chrono::nanoseconds min_time, size_t repetitions, const PerfCounters *perf)
+{
+  uint64_t iterations = 1;
+  for (;;) {
+    auto elapsed = time_once(bench, iterations);
+    if (elapsed >= min_time || iterations >= (uint64_t{ 1 } << 40)) break;
+    // aim a little past min_time, at most 10x more per round
+    double factor = elapsed.count() > 0 ? 1.2 * static_cast<double>(min_time.count()) / static_cast<double>(elapsed.count()) : 10.0;
+    uint64_t next = static_cast<uint64_t>(static_cast<double>(iterations) * std::clamp(factor, 1.5, 10.0));
+    iterations = std::max(next, iterations + 1);
+  }
+  std::vector<double> per_op;
+  for (size_t ii = 0; ii < repetitions; ii++) {
+    per_op.push_back(static_cast<double>(time_once(bench, iterations).count()) / static_cast<double>(iterations));
+  }
+  std::sort(per_op.begin(), per_op.end());
+  double median = per_op[per_op.size() / 2];
+  double spread = median > 0 ? (per_op.back() - per_op.front()) / median : 0;
+  perf_sample counters{};
+  if (perf != nullptr) {
+    bench_state state(iterations, perf);
+    bench.run(state);
+    counters = state.counted();
+  }
+  return { bench.name, iterations, median, per_op.front(), spread, bench.bytes, counters };
+}
+
+double per_op(const bench_result &r, perf_counter counter)
+{
+  return r.iterations == 0 ? 0 : static_cast<double>(r.counters.values[counter]) / static_cast<double>(r.iterations);
+}
+
+/**
+ * @brief "IPC 1.23", empty without both counters
+ */
+std::string ipc(const bench_result &r)
+{
+  if (!r.counters.has(PC_CYCLES) || !r.counters.has(PC_INSTRUCTIONS) || r.counters.values[PC_CYCLES] == 0) return "";
+  char text[32];
+  std::snprintf(text, sizeof(text), "%.2f", static_cast<double>(r.counters.values[PC_INSTRUCTIONS]) / static_cast<double>(r.counters.values[PC_CYCLES]));
+  return text;
+}
+
+/**
+ * @brief One benchmark per line and fixed precision, so runs diff cleanly
+ *
+ * With --perf each available counter is added as <name>_per_op, and ipc.
+ */
+void write_json(std::ostream &out, const std::vector<bench_result> &results)
+{
+  static const char *const FIELDS[PC_COUNT] = { "cycles", "instructions", "cache_misses", "branch_misses", "page_faults" };
+  char line[512];
+  out << "{\n  \"format\": \"elf_bench 1\",\n  \"benchmarks\": [\n";
+  for (size_t ii = 0; ii < results.size(); ii++) {
+    auto &r = results[ii];
+    double mb_per_s = r.bytes_per_op != 0 && r.ns_per_op > 0 ? static_cast<double>(r.bytes_per_op) * 1e3 / r.ns_per_op : 0;
+    std::snprintf(line, sizeof(line), "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.3f, \"min_ns_per_op\": %.3f, \"spread\": %.3f, \"bytes_per_op\": %llu, \"mb_per_s\": %.1f", r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.min_ns_per_op, r.spread, static_cast<unsigned long long>(r.bytes_per_op), mb_per_s);
+    out << line;
+    for (size_t cc = 0; cc < PC_COUNT; cc++) {
+      if (!r.counters.has(static_cast<perf_counter>(cc))) continue;
+      std::snprintf(line, sizeof(line), ", \"%s_per_op\": %.3f", FIELDS[cc], per_op(r, static_cast<perf_counter>(cc)));
+      out << line;
+    }
+    if (!ipc(r).empty()) out << ", \"ipc\": " << ipc(r);
+    out << "}" << (ii + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+/**
+ * @brief name to ns_per_op, from a file written by write_json
+ */
+std::map<std::string, double> read_json(const std::string &path)
+{
+  std::map<std::string, double> results;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    auto name = line.find("\"name\": \"");
+    auto ns = line.find("\"ns_per_op\": ");
+    if (name == std::string::npos || ns == std::string::npos) continue;
+    name += 9;
+    auto end = line.find('"', name);
+    if (end == std::string::npos) continue;
+    results[line.substr(name, end - name)] = std::strtod(line.c_str() + ns + 13, nullptr);
+  }
+  return results;
+}
+
+/**
+ * @brief Print old against new, true if nothing got slower by more than
+ *        threshold percent
+ *
+ * Baseline entries outside the filter were not run and are left out.
+ */
+bool compare(const std::map<std::string, double> &baseline, const std::vector<bench_result> &results, double threshold, const std::string &filter)
+{
+  char line[512];
+  size_t regressions = 0;
+  std::snprintf(line, sizeof(line), "%-44s %14s %14s %9s\n", "benchmark", "baseline ns", "current ns", "change");
+  std::cout << line;
+  for (auto &r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end()) {
+      std::snprintf(line, sizeof(line), "%-44s %14s %14.3f %9s\n", r.name.c_str(), "-", r.ns_per_op, "new");
+      std::cout << line;
+      continue;
+    }
+    double change = it->second > 0 ? (r.ns_per_op - it->second) * 100 / it->second : 0;
+    bool slower = change > threshold;
+    regressions += slower;
+    std::snprintf(line, sizeof(line), "%-44s %14.3f %14.3f %+8.1f%%%s\n", r.name.c_str(), it->second, r.ns_per_op, change, slower ? "  REGRESSION" : "");
+    std::cout << line;
+  }
+  for (auto &b : baseline) {
+    bool present = std::any_of(results.begin(), results.end(), [&](const bench_result &r) { return r.name == b.first; });
+    if (present || b.first.find(filter) == std::string::npos) continue;
+    std::snprintf(line, sizeof(line), "%-44s %14.3f %14s %9s\n", b.first.c_str(), b.second, "-", "gone");
+    std::cout << line;
+  }
+  std::cout << regressions << " regressions over " << threshold << "%" << std::endl;
+  return regressions == 0;
+}
+
+bool option(const std::string &arg, const char *name, std::string &value)
+{
+  size_t length = std::strlen(name);
+  if (arg.compare(0, length, name) != 0) return false;
+  value = arg.substr(length);
+  return true;
+}
+
+}// namespace
+
+
+/**
+ * @brief elf_bench [options] [<file>...]
+ *
+ * Runs every benchmark whose name contains --filter and writes the results as
+ * JSON, to stdout or --json=<file>.  Files on the command line are parsed end
+ * to end as well.  --compare=<baseline.json> then prints the change against an
+ * earlier run and fails when something is more than --threshold percent
+ * slower; --input=<results.json> compares two saved runs without running
+ * anything.  --perf adds the perf counters per operation to the results.
+ */
+int main(int argc, char *argv[])
+{
+  std::string filter;
+  std::string json;
+  std::string baseline;
+  std::string input;
+  double threshold = 10;
+  double min_time_ms = 200;
+  size_t repetitions = 5;
+  size_t large = 200000;
+  bool list = false;
+  bool perf = false;
+  std::vector<std::string> files;
+  for (int ii = 1; ii < argc; ii++) {
+    std::string arg = argv[ii];
+    std::string value;
+    if (option(arg, "--filter=", filter) || option(arg, "--json=", json) || option(arg, "--compare=", baseline) || option(arg, "--input=", input)) {
+      continue;
+    } else if (option(arg, "--threshold=", value)) {
+      threshold = std::strtod(value.c_str(), nullptr);
+    } else if (option(arg, "--min-time=", value)) {
+      min_time_ms = std::strtod(value.c_str(), nullptr);
+    } else if (option(arg, "--repetitions=", value)) {
+      repetitions = std::max<size_t>(1, std::strtoull(value.c_str(), nullptr, 10));
+    } else if (option(arg, "--large=", value)) {
+      large = std::strtoull(value.c_str(), nullptr, 10);
+    } else if (arg == "--list") {
+      list = true;
+    } else if (arg == "--perf") {
+      perf = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      std::cerr << "unknown option " << arg << std::endl;
+      return 2;
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  std::vector<bench_result> results;
+  if (!input.empty()) {
+    for (auto &r : read_json(input)) {
+      if (r.first.find(filter) == std::string::npos) continue;
+      results.push_back({ r.first, 0, r.second, r.second, 0, 0, perf_sample{} });
+    }
+  } else {
+    auto benchmarks = elf_benchmarks(files, large);
+    std::sort(benchmarks.begin(), benchmarks.end(), [](const benchmark &a, const benchmark &b) { return a.name < b.name; });
+    auto min_time = std::chrono::nanoseconds(static_cast<int64_t>(min_time_ms * 1e6));
+    std::unique_ptr<PerfCounters> counters;
+    if (perf && !list) {
+      counters = std::make_unique<PerfCounters>();
+      // carry on with what there is, times only if nothing could be opened
+      if (!counters->get_error().empty()) std::cerr << "perf counters unavailable, " << counters->get_error() << std::endl;
+      if (!counters->is_open()) counters.reset();
+    }
+    for (auto &bench : benchmarks) {
+      if (bench.name.find(filter) == std::string::npos) continue;
+      if (list) {
+        std::cout << bench.name << '\n';
+        continue;
+      }
+      results.push_back(measure(bench, min_time, repetitions, counters.get()));
+      auto &r = results.back();
+      auto rate = ipc(r);
+      std::fprintf(stderr, "%-44s %14.3f ns/op  +-%.1f%%%s%s\n", r.name.c_str(), r.ns_per_op, r.spread * 50, rate.empty() ? "" : "  IPC ", rate.c_str());
+    }
+    if (list) return 0;
+    if (!json.empty()) {
+      std::ofstream out(json);
+      write_json(out, results);
+      if (!out) {
+        std::cerr << "unable to write " << json << std::endl;
+        return 2;
+      }
+    } else if (baseline.empty()) {
+      write_json(std::cout, results);
+    }
+  }
+
+  if (baseline.empty()) return 0;
+  auto old = read_json(baseline);
+  if (old.empty()) {
+    std::cerr << "no results in " << baseline << std::endl;
+    return 2;
+  }
+  return compare(old, results, threshold, filter) ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+#include "bench.hpp"
+#include "ElfGenerator.hpp"
+#include "ElfReader.hpp"
+#include "ElfValidator.hpp"
+#include "section_types.hpp"
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+
+namespace {
+
+generator_options synthetic(bool is64, bool msb, size_t symbols)
+{
+  generator_options options;
+  options.is64 = is64;
+  options.msb = msb;
+  options.symbols = symbols;
+  return options;
+}
+
+/**
+ * @brief A generated file on disk for the end to end runs, removed with the
+ *        last benchmark holding it
+ */
+class temp_file
+{
+public:
+  explicit temp_file(const generator_options &options)
+  {
+    char name[] = "/tmp/elf_bench_XXXXXX";
+    int fd = ::mkstemp(name);
+    if (fd >= 0) ::close(fd);
+    path = name;
+    write_generated_elf(path, options);
+  }
+  ~temp_file() { ::unlink(path.c_str()); }
+  temp_file(const temp_file &) = delete;
+  temp_file &operator=(const temp_file &) = delete;
+
+  std::string path;
+};
+
+ParseOptions quiet()
+{
+  ParseOptions options;
+  options.verbose = false;
+  options.dynamic_symbols = true;
+  return options;
+}
+
+/**
+ * @brief Only the ELF header and the section headers, for the benchmarks
+ *        that call the table decoders themselves
+ */
+ParseOptions headers_only()
+{
+  ParseOptions options = quiet();
+  options.symbol_tables = false;
+  options.dynamic_symbols = false;
+  options.string_tables = false;
+  options.program_headers = false;
+  options.notes = false;
+  return options;
+}
+
+struct variant
+{
+  const char *name;
+  bool is64;
+  bool msb;
+};
+
+constexpr variant VARIANTS[] = { { "elf32-lsb", false, false }, { "elf32-msb", false, true }, { "elf64-lsb", true, false }, { "elf64-msb", true, true } };
+
+const Elf_Shdr &find_section(const ElfReader &elf, uint32_t type)
+{
+  for (auto &sh : elf.section_headers) {
+    if (sh.sh_type == type) return sh;
+  }
+  return elf.section_headers[0];
+}
+
+/**
+ * @brief Run a table decoder on a reader that is replaced every batch, the
+ *        decoders append their result to it
+ */
+template<typename Decode>
+void decode_batches(bench_state &state, std::vector<byte> &file, Decode decode)
+{
+  constexpr uint64_t BATCH = 64;
+  for (uint64_t done = 0; done < state.iterations();) {
+    state.pause();
+    auto elf = std::make_unique<ElfReader>(file, headers_only());
+    state.resume();
+    for (uint64_t ii = 0; ii < BATCH && done < state.iterations(); ii++, done++) {
+      decode(*elf);
+    }
+    state.pause();
+    elf.reset();
+    state.resume();
+  }
+}
+
+void add_micro(std::vector<benchmark> &list)
+{
+  // the byte readers over the start of a file, one value per iteration
+  auto file = std::make_shared<std::vector<byte>>(generate_elf(synthetic(true, false, 4096)));
+  auto reader = std::make_shared<const ElfReader>(*file, headers_only());
+  for (size_t width : { 2, 4, 8 }) {
+    for (bool msb : { false, true }) {
+      std::string name = std::string("decode/") + (msb ? "read_msb64/" : "read_lsb64/") + std::to_string(width);
+      list.push_back({ name, width, [reader, width, msb](bench_state &state) {
+                        size_t limit = reader->filesize - 8;
+                        size_t index = 0;
+                        uint64_t sum = 0;
+                        for (uint64_t ii = 0; ii < state.iterations(); ii++) {
+                          sum += static_cast<uint64_t>(msb ? reader->read_msb64(index, width) : reader->read_lsb64(index, width));
+                          if (index >= limit) index = 0;
+                        }
+                        keep(sum);
+                      } });
+    }
+  }
+
+  for (auto &v : VARIANTS) {
+    auto bytes = std::make_shared<std::vector<byte>>(generate_elf(synthetic(v.is64, v.msb, 4096)));
+    auto elf = std::make_shared<ElfReader>(*bytes, headers_only());
+    list.push_back({ std::string("decode/elf_header/") + v.name, v.is64 ? 64u : 52u, [elf](bench_state &state) {
+                      for (uint64_t ii = 0; ii < state.iterations(); ii++) {
+                        elf->read_elf_header();
+                        keep(elf->header);
+                      }
+                    } });
+    list.push_back({ std::string("decode/validate/") + v.name, 0, [bytes](bench_state &state) {
+                      for (uint64_t ii = 0; ii < state.iterations(); ii++) {
+                        keep(validate_elf(bytes->data(), bytes->size()));
+                      }
+                    } });
+    auto strtab = find_section(*elf, SHT_STRTAB);
+    list.push_back({ std::string("decode/string_table/") + v.name, strtab.sh_size, [bytes, strtab](bench_state &state) {
+                      decode_batches(state, *bytes, [&](ElfReader &reader) { reader.read_string_table(strtab); });
+                    } });
+    auto symtab = find_section(*elf, SHT_SYMTAB);
+    list.push_back({ std::string("decode/symbols/") + v.name, symtab.sh_size, [bytes, symtab](bench_state &state) {
+                      decode_batches(state, *bytes, [&](ElfReader &reader) { reader.read_symbol_table(symtab); });
+                    } });
+  }
+}
+
+void add_parse(std::vector<benchmark> &list, const std::string &name, const std::string &path, std::shared_ptr<temp_file> owner)
+{
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  list.push_back({ "parse/" + name, ec ? 0 : size, [path, owner](bench_state &state) {
+                    for (uint64_t ii = 0; ii < state.iterations(); ii++) {
+                      ElfReader elf(path, quiet());
+                      keep(elf.section_headers.data());
+                    }
+                  } });
+}
+
+}// namespace
+
+
+std::vector<benchmark> elf_benchmarks(const std::vector<std::string> &files, size_t large)
+{
+  std::vector<benchmark> list;
+  add_micro(list);
+  for (auto &path : files) {
+    add_parse(list, std::filesystem::path(path).filename().string(), path, nullptr);
+  }
+  for (auto &v : VARIANTS) {
+    auto file = std::make_shared<temp_file>(synthetic(v.is64, v.msb, 10000));
+    add_parse(list, std::string("synthetic-10k/") + v.name, file->path, file);
+  }
+  if (large > 0) {
+    auto file = std::make_shared<temp_file>(synthetic(true, false, large));
+    add_parse(list, "synthetic-large/elf64-lsb", file->path, file);
+  }
+  // past SHN_LORESERVE, the counts are in section 0
+  generator_options extended;
+  extended.sections = 70000;
+  extended.symbols = 10000;
+  auto file = std::make_shared<temp_file>(extended);
+  add_parse(list, "synthetic-sections/elf64-lsb", file->path, file);
+  return list;
+}
@@ -0,0 +1,159 @@
+#include "ElfValidator.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+/**
+ * @brief splitmix64, deterministic for a given --seed
+ */
+class Random
+{
+public:
+  explicit Random(uint64_t seed) : state(seed) {}
+
+  uint64_t next()
+  {
+    uint64_t z = (state += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  size_t below(size_t limit)
+  {
+    return limit == 0 ? 0 : next() % limit;
+  }
+
+private:
+  uint64_t state;
+};
+
+std::vector<uint8_t> read_file(const std::string &path)
+{
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief A few random edits, biased to the headers where the offsets live
+ */
+void mutate(std::vector<uint8_t> &input, Random &random)
+{
+  static const uint64_t interesting[] = { 0, 1, 0x7f, 0x80, 0xff, 0xffff, 0x7fffffff, 0xffffffff, 0xffffffffffffffff, 0x8000000000000000 };
+  size_t edits = 1 + random.below(4);
+  for (size_t ii = 0; ii < edits && !input.empty(); ii++) {
+    // half the edits land in the first 256 bytes, the ELF header and usually a table
+    size_t position = random.below(2) == 0 ? random.below(std::min<size_t>(input.size(), 256)) : random.below(input.size());
+    switch (random.below(5)) {
+    case 0:
+      input[position] ^= static_cast<uint8_t>(1u << random.below(8));
+      break;
+    case 1:
+      input[position] = static_cast<uint8_t>(random.next());
+      break;
+    case 2: {
+      size_t width = size_t{ 1 } << random.below(4);
+      uint64_t value = interesting[random.below(sizeof(interesting) / sizeof(interesting[0]))];
+      for (size_t jj = 0; jj < width && position + jj < input.size(); jj++)
+        input[position + jj] = static_cast<uint8_t>(value >> (8 * jj));
+      break;
+    }
+    case 3:
+      input.resize(position);
+      break;
+    default: {
+      // copy a block over another, moves whole table entries around
+      size_t length = random.below(64);
+      size_t from = random.below(input.size());
+      for (size_t jj = 0; jj < length && from + jj < input.size() && position + jj < input.size(); jj++)
+        input[position + jj] = input[from + jj];
+      break;
+    }
+    }
+  }
+}
+
+}// namespace
+
+
+/**
+ * @brief fuzz_elf [--runs=N] [--seed=N] <file|dir>...
+ *
+ * Without --runs every file is run once, which is what AFL needs:
+ * afl-fuzz -i seeds -o findings -- fuzz_elf @@.  With --runs the files are a
+ * corpus that is mutated N times, and the validator and the full parse are
+ * timed separately.
+ */
+int main(int argc, char *argv[])
+{
+  namespace fs = std::filesystem;
+  uint64_t runs = 0;
+  uint64_t seed = 1;
+  std::vector<std::vector<uint8_t>> corpus;
+  for (int ii = 1; ii < argc; ii++) {
+    std::string arg = argv[ii];
+    if (arg.compare(0, 7, "--runs=") == 0) {
+      runs = std::strtoull(arg.c_str() + 7, nullptr, 10);
+    } else if (arg.compare(0, 7, "--seed=") == 0) {
+      seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+    } else if (fs::is_directory(arg)) {
+      for (auto &entry : fs::recursive_directory_iterator(arg, fs::directory_options::skip_permission_denied)) {
+        if (entry.is_regular_file()) corpus.push_back(read_file(entry.path().string()));
+      }
+    } else {
+      corpus.push_back(read_file(arg));
+    }
+  }
+  if (corpus.empty()) {
+    std::cout << "fuzz_elf requires input files" << std::endl;
+    return 2;
+  }
+  if (runs == 0) {
+    for (auto &input : corpus) {
+      LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    return 0;
+  }
+
+  using clock = std::chrono::steady_clock;
+  Random random(seed);
+  clock::duration validate_time{};
+  clock::duration parse_time{};
+  uint64_t bytes = 0;
+  uint64_t errors[EE_SEGMENT_TABLE_OUTSIDE + 1] = {};
+  auto start = clock::now();
+  for (uint64_t run = 0; run < runs; run++) {
+    auto input = corpus[random.below(corpus.size())];
+    mutate(input, random);
+    bytes += input.size();
+    auto before = clock::now();
+    auto result = validate_elf(input.data(), input.size());
+    auto middle = clock::now();
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+    auto after = clock::now();
+    validate_time += middle - before;
+    parse_time += after - middle;
+    errors[result.error]++;
+  }
+  double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  double validate_seconds = std::chrono::duration<double>(validate_time).count();
+  double parse_seconds = std::chrono::duration<double>(parse_time).count();
+  std::cout << runs << " runs in " << elapsed << "s, " << static_cast<uint64_t>(runs / elapsed) << " runs/s" << std::endl;
+  std::cout << "validate " << validate_seconds * 1e9 / runs << " ns/run, " << bytes / validate_seconds / 1e9 << " GB/s of input" << std::endl;
+  std::cout << "parse and decode " << parse_seconds * 1e9 / runs << " ns/run" << std::endl;
+  for (size_t ii = 0; ii <= EE_SEGMENT_TABLE_OUTSIDE; ii++) {
+    if (errors[ii] != 0) std::cout << "  " << errors[ii] << " " << elf_error_to_string(static_cast<elf_error>(ii)) << std::endl;
+  }
+  return 0;
+}
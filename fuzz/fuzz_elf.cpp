@@ -0,0 +1,46 @@
+#include "CoreFile.hpp"
+#include "ElfQuery.hpp"
+#include "ElfReader.hpp"
+#include "IdenticalCode.hpp"
+#include "OutputBuffer.hpp"
+#include "SizeReport.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ * @brief Parse one input with every phase on and run the decoders over it
+ *
+ * Anything validate_elf() lets through has to decode without reading outside
+ * the input, the sanitizers turn a bad read into a crash.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  std::vector<byte> bytes(data, data + size);
+  ParseOptions options;
+  options.verbose = false;
+  options.dynamic_symbols = true;
+  ElfReader elf(bytes, options);
+  if (!elf.is_valid()) return 0;
+
+  std::ostream discard(nullptr);
+  OutputBuffer out(discard);
+  write_text(out, elf);
+  ElfIndex index(elf);
+  for (size_t ii = 0; ii < index.symbol_count(); ii += 1 + index.symbol_count() / 16) {
+    auto sym = index.symbol(ii);
+    index.find_symbol(sym.name);
+    index.symbol_for_address(sym.value);
+    index.section_for_address(sym.value);
+    index.segment_for_address(sym.value);
+  }
+  for (auto source : { size_source::sections, size_source::segments, size_source::symbols, size_source::compile_units }) {
+    write_text(out, SizeReport(elf, source));
+  }
+  write_text(out, IdenticalCode(elf));
+  if (elf.header.e_type == ET_CORE) {
+    discard << CoreFile(elf);
+  }
+  return 0;
+}
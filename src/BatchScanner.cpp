@@ -0,0 +1,98 @@
+#include "BatchScanner.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+
+BatchScanner::BatchScanner(const std::vector<std::string> &paths, size_t threads, ParseOptions options) : threads(threads), options(options), next(0), skipped(0)
+{
+  namespace fs = std::filesystem;
+  for (auto &path : paths) {
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+      std::vector<std::string> found;
+      for (auto it = fs::recursive_directory_iterator(path, fs::directory_options::skip_permission_denied, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (ec) break;
+        if (it->is_regular_file(ec) && !it->is_symlink(ec)) {
+          found.push_back(it->path().string());
+        }
+      }
+      // directory order is not stable between runs, file ids should be
+      std::sort(found.begin(), found.end());
+      files.insert(files.end(), found.begin(), found.end());
+    } else {
+      files.push_back(path);
+    }
+  }
+  if (this->threads == 0) this->threads = 1;
+}
+
+void BatchScanner::run(const visitor &visit)
+{
+  next = 0;
+  skipped = 0;
+  size_t count = std::min(threads, files.size());
+  worker_stats.assign(std::max<size_t>(count, 1), parse_stats{});
+  worker_profiles.assign(std::max<size_t>(count, 1), {});
+  if (count <= 1) {
+    work(0, visit);
+    return;
+  }
+  std::vector<std::thread> pool;
+  for (size_t ii = 0; ii < count; ii++) {
+    pool.emplace_back(&BatchScanner::work, this, ii, std::cref(visit));
+  }
+  for (auto &t : pool) {
+    t.join();
+  }
+}
+
+void BatchScanner::work(size_t worker, const visitor &visit)
+{
+  auto perf = PerfCounters::for_thread();
+  for (size_t index = next++; index < files.size(); index = next++) {
+    auto before = perf != nullptr ? perf->read() : perf_sample{};
+    auto elf = ElfReader::open(files[index], options, &worker_stats[worker]);
+    if (!elf) {
+      skipped++;
+      continue;
+    }
+    if (perf != nullptr) worker_profiles[worker].push_back({ index, perf->read().since(before) });
+    worker_stats[worker].add(elf->get_stats());
+    visit(worker, index, files[index], *elf);
+  }
+}
+
+const std::vector<std::string> &BatchScanner::get_files() const
+{
+  return files;
+}
+
+size_t BatchScanner::get_thread_count() const
+{
+  return threads;
+}
+
+size_t BatchScanner::get_skipped_count() const
+{
+  return skipped;
+}
+
+parse_stats BatchScanner::get_stats() const
+{
+  parse_stats total;
+  for (auto &s : worker_stats) {
+    total.add(s);
+  }
+  return total;
+}
+
+std::vector<file_profile> BatchScanner::get_profiles() const
+{
+  std::vector<file_profile> profiles;
+  for (auto &w : worker_profiles) {
+    profiles.insert(profiles.end(), w.begin(), w.end());
+  }
+  std::sort(profiles.begin(), profiles.end(), [](const file_profile &a, const file_profile &b) { return a.file_id < b.file_id; });
+  return profiles;
+}
@@ -0,0 +1,72 @@
+#ifndef BATCHSCANNER_HPP
+#define BATCHSCANNER_HPP
+
+#include "ElfReader.hpp"
+#include "PerfCounters.hpp"
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The perf counters of opening and parsing one file
+ */
+struct file_profile
+{
+  size_t file_id;
+  perf_sample counters;
+};
+
+/**
+ * @brief Parse many files on a pool of threads.
+ *
+ * Directories are expanded recursively up front and every file gets a stable
+ * id (its position in the sorted list) so output from different threads can
+ * be joined back together.  Files that are not ELF or fail validate_elf()
+ * are skipped.
+ */
+class BatchScanner
+{
+public:
+  using visitor = std::function<void(size_t worker, size_t file_id, const std::string &path, const ElfReader &elf)>;
+
+  BatchScanner(const std::vector<std::string> &paths, size_t threads, ParseOptions options = ParseOptions{});
+
+  /**
+   * @brief Parse every file, calling visit on the worker thread that parsed it
+   *
+   * The visitor is called concurrently from all the threads, worker is the
+   * index of the calling thread (below get_thread_count()) so callers can keep
+   * per thread state without locking.
+   */
+  void run(const visitor &visit);
+
+  const std::vector<std::string> &get_files() const;
+  size_t get_thread_count() const;
+  size_t get_skipped_count() const;
+
+  /**
+   * @brief The parse_stats of every file the last run() opened, skipped
+   *        ones included
+   */
+  parse_stats get_stats() const;
+
+  /**
+   * @brief After PerfCounters::enable(), what each file the last run()
+   *        parsed cost, in file id order
+   */
+  std::vector<file_profile> get_profiles() const;
+
+private:
+  std::vector<std::string> files;
+  size_t threads;
+  ParseOptions options;
+  std::atomic<size_t> next;
+  std::atomic<size_t> skipped;
+  std::vector<parse_stats> worker_stats;
+  std::vector<std::vector<file_profile>> worker_profiles;
+
+  void work(size_t worker, const visitor &visit);
+};
+
+#endif /* BATCHSCANNER_HPP */
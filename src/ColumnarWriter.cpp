@@ -0,0 +1,267 @@
+#include "ColumnarWriter.hpp"
+#include "SymbolTable.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+size_t column_width(column_type type)
+{
+  switch (type) {
+  case column_type::u8:
+    return 1;
+  case column_type::u32:
+    return 4;
+  case column_type::u64:
+    return 8;
+  default:
+    return 4;// dictionary codes
+  }
+}
+
+// column numbers of the tables written by ColumnarExport
+enum file_columns { FC_FILE_ID, FC_PATH };
+enum section_columns { SC_FILE_ID, SC_INDEX, SC_NAME, SC_TYPE, SC_FLAGS, SC_ADDR, SC_OFFSET, SC_SIZE, SC_LINK, SC_INFO, SC_ADDRALIGN, SC_ENTSIZE };
+enum symbol_columns { YC_FILE_ID, YC_TABLE, YC_INDEX, YC_NAME, YC_VALUE, YC_SIZE, YC_INFO, YC_OTHER, YC_SHNDX };
+enum segment_columns { GC_FILE_ID, GC_INDEX, GC_TYPE, GC_FLAGS, GC_OFFSET, GC_VADDR, GC_PADDR, GC_FILESZ, GC_MEMSZ, GC_ALIGN };
+
+}// namespace
+
+
+ColumnTable::ColumnTable(const std::string &filename, std::vector<column_definition> definitions, size_t row_group_size) : row_group_size(row_group_size), rows(0), total_rows(0), row_groups(0)
+{
+  fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return;
+  out = std::make_unique<OutputBuffer>(fd);
+  for (auto &d : definitions) {
+    column c;
+    c.definition = d;
+    c.entry_bytes = 0;
+    c.values.reserve(row_group_size);
+    columns.push_back(std::move(c));
+  }
+  out->put("ECOL");
+  put_le(1, 4);
+  put_le(columns.size(), 4);
+  for (auto &c : columns) {
+    put_le(static_cast<uint8_t>(c.definition.type), 1);
+    put_le(c.definition.name.size(), 2);
+    out->put(c.definition.name);
+  }
+}
+
+ColumnTable::~ColumnTable()
+{
+  close();
+}
+
+bool ColumnTable::is_open() const
+{
+  return fd >= 0;
+}
+
+void ColumnTable::set(size_t index, uint64_t value)
+{
+  columns[index].values.push_back(value);
+}
+
+void ColumnTable::set(size_t index, std::string_view value)
+{
+  auto &c = columns[index];
+  // a C++17 unordered_map cannot be searched by string_view
+  thread_local std::string key;
+  key.assign(value.data(), value.size());
+  auto it = c.codes.find(key);
+  if (it == c.codes.end()) {
+    it = c.codes.emplace(key, static_cast<uint32_t>(c.entries.size())).first;
+    c.entries.push_back(it->first);
+    c.entry_bytes += value.size();
+  }
+  c.values.push_back(it->second);
+}
+
+void ColumnTable::end_row()
+{
+  rows++;
+  if (rows >= row_group_size) {
+    write_row_group();
+  }
+}
+
+void ColumnTable::close()
+{
+  if (fd < 0) return;
+  write_row_group();
+  out->put("ECND");
+  put_le(total_rows, 8);
+  put_le(row_groups, 4);
+  out->flush();
+  out.reset();
+  ::close(fd);
+  fd = -1;
+}
+
+void ColumnTable::write_row_group()
+{
+  if (rows == 0) return;
+  out->put("RGRP");
+  put_le(rows, 8);
+  for (auto &c : columns) {
+    size_t width = column_width(c.definition.type);
+    if (c.definition.type == column_type::dictionary) {
+      size_t n = c.entries.size();
+      put_le(4 + 4 * (n + 1) + c.entry_bytes + width * rows, 8);
+      put_le(n, 4);
+      uint64_t offset = 0;
+      put_le(offset, 4);
+      for (auto &e : c.entries) {
+        offset += e.size();
+        put_le(offset, 4);
+      }
+      for (auto &e : c.entries) {
+        out->put(e);
+      }
+    } else {
+      put_le(width * rows, 8);
+    }
+    for (auto v : c.values) {
+      put_le(v, width);
+    }
+    // dictionaries are per row group so memory stays flat
+    c.values.clear();
+    c.entries.clear();
+    c.codes.clear();
+    c.entry_bytes = 0;
+  }
+  total_rows += rows;
+  row_groups++;
+  rows = 0;
+}
+
+void ColumnTable::put_le(uint64_t value, size_t width)
+{
+  out->le(value, width);
+}
+
+
+ColumnarExport::ColumnarExport(const std::string &directory, size_t row_group_size)
+{
+  files = std::make_unique<ColumnTable>(directory + "/files.ecol", std::vector<column_definition>{
+    { "file_id", column_type::u32 },
+    { "path", column_type::dictionary },
+  }, row_group_size);
+  sections = std::make_unique<ColumnTable>(directory + "/sections.ecol", std::vector<column_definition>{
+    { "file_id", column_type::u32 },
+    { "index", column_type::u32 },
+    { "name", column_type::dictionary },
+    { "type", column_type::u32 },
+    { "flags", column_type::u64 },
+    { "addr", column_type::u64 },
+    { "offset", column_type::u64 },
+    { "size", column_type::u64 },
+    { "link", column_type::u32 },
+    { "info", column_type::u32 },
+    { "addralign", column_type::u64 },
+    { "entsize", column_type::u64 },
+  }, row_group_size);
+  symbols = std::make_unique<ColumnTable>(directory + "/symbols.ecol", std::vector<column_definition>{
+    { "file_id", column_type::u32 },
+    { "table", column_type::u32 },
+    { "index", column_type::u32 },
+    { "name", column_type::dictionary },
+    { "value", column_type::u64 },
+    { "size", column_type::u64 },
+    { "info", column_type::u8 },
+    { "other", column_type::u8 },
+    { "shndx", column_type::u32 },
+  }, row_group_size);
+  segments = std::make_unique<ColumnTable>(directory + "/segments.ecol", std::vector<column_definition>{
+    { "file_id", column_type::u32 },
+    { "index", column_type::u32 },
+    { "type", column_type::u32 },
+    { "flags", column_type::u32 },
+    { "offset", column_type::u64 },
+    { "vaddr", column_type::u64 },
+    { "paddr", column_type::u64 },
+    { "filesz", column_type::u64 },
+    { "memsz", column_type::u64 },
+    { "align", column_type::u64 },
+  }, row_group_size);
+}
+
+bool ColumnarExport::is_open() const
+{
+  return files->is_open() && sections->is_open() && symbols->is_open() && segments->is_open();
+}
+
+void ColumnarExport::add(size_t file_id, const std::string &path, const ElfReader &elf)
+{
+  {
+    std::lock_guard<std::mutex> guard(files_lock);
+    files->set(FC_FILE_ID, file_id);
+    files->set(FC_PATH, path);
+    files->end_row();
+  }
+  {
+    std::lock_guard<std::mutex> guard(sections_lock);
+    for (auto &sh : elf.section_headers) {
+      sections->set(SC_FILE_ID, file_id);
+      sections->set(SC_INDEX, sh.index);
+      sections->set(SC_NAME, sh.name);
+      sections->set(SC_TYPE, sh.sh_type);
+      sections->set(SC_FLAGS, sh.sh_flags);
+      sections->set(SC_ADDR, sh.sh_addr);
+      sections->set(SC_OFFSET, sh.sh_offset);
+      sections->set(SC_SIZE, sh.sh_size);
+      sections->set(SC_LINK, sh.sh_link);
+      sections->set(SC_INFO, sh.sh_info);
+      sections->set(SC_ADDRALIGN, sh.sh_addralign);
+      sections->set(SC_ENTSIZE, sh.sh_entsize);
+      sections->end_row();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(symbols_lock);
+    for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+      auto table = elf.get_symbol_table(ii);
+      if (table == nullptr) continue;
+      for (auto &sym : table->entries) {
+        symbols->set(YC_FILE_ID, file_id);
+        symbols->set(YC_TABLE, ii);
+        symbols->set(YC_INDEX, sym.index);
+        symbols->set(YC_NAME, sym.name);
+        symbols->set(YC_VALUE, sym.st_value);
+        symbols->set(YC_SIZE, sym.st_size);
+        symbols->set(YC_INFO, sym.st_info);
+        symbols->set(YC_OTHER, sym.st_other);
+        symbols->set(YC_SHNDX, sym.st_shndx);
+        symbols->end_row();
+      }
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(segments_lock);
+    size_t index = 0;
+    for (auto &p : elf.program_headers) {
+      segments->set(GC_FILE_ID, file_id);
+      segments->set(GC_INDEX, index++);
+      segments->set(GC_TYPE, p.p_type);
+      segments->set(GC_FLAGS, p.p_flags);
+      segments->set(GC_OFFSET, p.p_offset);
+      segments->set(GC_VADDR, p.p_vaddr);
+      segments->set(GC_PADDR, p.p_paddr);
+      segments->set(GC_FILESZ, p.p_filesz);
+      segments->set(GC_MEMSZ, p.p_memsz);
+      segments->set(GC_ALIGN, p.p_align);
+      segments->end_row();
+    }
+  }
+}
+
+void ColumnarExport::close()
+{
+  files->close();
+  sections->close();
+  symbols->close();
+  segments->close();
+}
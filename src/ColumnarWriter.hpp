@@ -0,0 +1,120 @@
+#ifndef COLUMNARWRITER_HPP
+#define COLUMNARWRITER_HPP
+
+#include "ElfReader.hpp"
+#include "OutputBuffer.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Physical type of a column in an .ecol file
+ */
+enum class column_type : uint8_t {
+  u8 = 1,
+  u32 = 2,
+  u64 = 3,
+  dictionary = 4,// strings, dictionary encoded per row group
+};
+
+struct column_definition
+{
+  std::string_view name;
+  column_type type;
+};
+
+/**
+ * @brief Writes one table as a simple columnar file (.ecol).
+ *
+ * All integers are little endian.
+ *
+ *   header     "ECOL", u32 version (1), u32 column count, then per column
+ *              u8 column_type, u16 name length, name bytes
+ *   row group  "RGRP", u64 row count, then per column a u64 byte length
+ *              followed by the column data:
+ *                u8/u32/u64   row count values of that width
+ *                dictionary   u32 entry count n, u32 offsets[n + 1] into the
+ *                             string bytes, the string bytes, then u32
+ *                             codes[row count] indexing the entries
+ *   footer     "ECND", u64 total rows, u32 row group count
+ *
+ * Rows are buffered until a row group is full and then written, so memory
+ * use does not depend on how many files are exported.
+ */
+class ColumnTable
+{
+public:
+  ColumnTable(const std::string &filename, std::vector<column_definition> columns, size_t row_group_size);
+  ~ColumnTable();
+  ColumnTable(const ColumnTable &) = delete;
+  ColumnTable &operator=(const ColumnTable &) = delete;
+
+  bool is_open() const;
+
+  /**
+   * @brief Append a value to a column, rows are complete once every column
+   *        had a value, then end_row() must be called
+   */
+  void set(size_t column, uint64_t value);
+  void set(size_t column, std::string_view value);
+  void end_row();
+
+  /**
+   * @brief Write out any partial row group and the footer
+   */
+  void close();
+
+private:
+  struct column
+  {
+    column_definition definition;
+    std::vector<uint64_t> values;// integers, or dictionary codes
+    std::unordered_map<std::string, uint32_t> codes;
+    std::vector<std::string_view> entries;// keys of codes, in code order
+    size_t entry_bytes;
+  };
+
+  int fd;
+  std::unique_ptr<OutputBuffer> out;
+  std::vector<column> columns;
+  size_t row_group_size;
+  size_t rows;
+  uint64_t total_rows;
+  uint32_t row_groups;
+
+  void write_row_group();
+  void put_le(uint64_t value, size_t width);
+};
+
+/**
+ * @brief Export of files, sections, symbols and segments for many files.
+ *
+ * Writes files.ecol, sections.ecol, symbols.ecol and segments.ecol into a
+ * directory.  Every row carries the file_id of the file it came from.  add()
+ * may be called from several threads, each file's rows are appended under
+ * the table's lock.
+ */
+class ColumnarExport
+{
+public:
+  ColumnarExport(const std::string &directory, size_t row_group_size = 65536);
+
+  bool is_open() const;
+  void add(size_t file_id, const std::string &path, const ElfReader &elf);
+  void close();
+
+private:
+  std::unique_ptr<ColumnTable> files;
+  std::unique_ptr<ColumnTable> sections;
+  std::unique_ptr<ColumnTable> symbols;
+  std::unique_ptr<ColumnTable> segments;
+  std::mutex files_lock;
+  std::mutex sections_lock;
+  std::mutex symbols_lock;
+  std::mutex segments_lock;
+};
+
+#endif /* COLUMNARWRITER_HPP */
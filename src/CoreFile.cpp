@@ -0,0 +1,200 @@
+#include "CoreFile.hpp"
+#include "elf.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+
+
+CoreFile::CoreFile(const ElfReader &elf) : pid(0), elf(elf)
+{
+  word_size = elf.is_64bit() ? sizeof(Elf64_Addr) : sizeof(Elf32_Addr);
+  for (auto &p : elf.program_headers) {
+    if (p.p_type == PT_LOAD) {
+      load_segments.push_back(p);
+    }
+  }
+  std::sort(load_segments.begin(), load_segments.end(), [](const Elf_Phdr &a, const Elf_Phdr &b) {
+    return a.p_vaddr < b.p_vaddr;
+  });
+  for (auto &note : elf.notes) {
+    if (!note.is_core()) continue;
+    switch (note.n_type) {
+    case NT_PRSTATUS:
+      read_prstatus(note);
+      break;
+    case NT_PRPSINFO:
+      read_prpsinfo(note);
+      break;
+    case NT_AUXV:
+      read_auxv(note);
+      break;
+    case NT_FILE:
+      read_file_mappings(note);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Linux struct elf_prstatus
+ *
+ * elf_siginfo (12 bytes), short pr_cursig, then two words of signal masks,
+ * four ints of pid/ppid/pgrp/sid and four timevals before the registers.  The
+ * registers are followed by the int pr_fpvalid padded to a word.
+ */
+void CoreFile::read_prstatus(const Elf_Note &note)
+{
+  ELF_ULONG pid_offset = 16 + 2 * word_size;
+  ELF_ULONG registers_offset = pid_offset + 16 + 8 * word_size;
+  if (note.n_descsz < registers_offset + word_size) return;
+  CoreThread thread;
+  thread.signal = elf.read_value(note.desc_offset + 12, sizeof(Elf32_Half));
+  thread.pid = elf.read_value(note.desc_offset + pid_offset, sizeof(Elf32_Word));
+  thread.registers_offset = note.desc_offset + registers_offset;
+  thread.registers_size = note.n_descsz - registers_offset - word_size;
+  threads.push_back(thread);
+}
+
+/**
+ * @brief Linux struct elf_prpsinfo
+ *
+ * On 32-bit targets uid and gid are 16-bit which moves everything after them.
+ */
+void CoreFile::read_prpsinfo(const Elf_Note &note)
+{
+  ELF_ULONG pid_offset = elf.is_64bit() ? 24 : 12;
+  ELF_ULONG name_offset = elf.is_64bit() ? 40 : 28;
+  if (note.n_descsz < name_offset + 16 + 80) return;
+  pid = elf.read_value(note.desc_offset + pid_offset, sizeof(Elf32_Word));
+  process_name = read_fixed_string(note.desc_offset + name_offset, 16);
+  process_arguments = read_fixed_string(note.desc_offset + name_offset + 16, 80);
+}
+
+void CoreFile::read_auxv(const Elf_Note &note)
+{
+  ELF_ULONG cursor = note.desc_offset;
+  ELF_ULONG end = note.desc_offset + note.n_descsz;
+  while (cursor + 2 * word_size <= end) {
+    CoreAuxvEntry entry;
+    entry.type = elf.read_value(cursor, word_size);
+    entry.value = elf.read_value(cursor + word_size, word_size);
+    cursor += 2 * word_size;
+    if (entry.type == AT_NULL) break;
+    auxv.push_back(entry);
+  }
+}
+
+/**
+ * @brief NT_FILE
+ *
+ * count and page size, then count (start, end, page offset) triples followed
+ * by count null terminated filenames.
+ */
+void CoreFile::read_file_mappings(const Elf_Note &note)
+{
+  ELF_ULONG end = note.desc_offset + note.n_descsz;
+  if (note.n_descsz < 2 * word_size) return;
+  ELF_ULONG count = elf.read_value(note.desc_offset, word_size);
+  ELF_ULONG page_size = elf.read_value(note.desc_offset + word_size, word_size);
+  ELF_ULONG cursor = note.desc_offset + 2 * word_size;
+  if (count > (end - cursor) / (3 * word_size)) return;
+  ELF_ULONG names = cursor + count * 3 * word_size;
+  const char *text = reinterpret_cast<const char *>(elf.get_bytes(names, end - names));
+  size_t text_size = end - names;
+  size_t text_cursor = 0;
+  for (ELF_ULONG ii = 0; ii < count; ii++) {
+    CoreMapping mapping;
+    mapping.start = elf.read_value(cursor, word_size);
+    mapping.end = elf.read_value(cursor + word_size, word_size);
+    mapping.file_offset = elf.read_value(cursor + 2 * word_size, word_size) * page_size;
+    cursor += 3 * word_size;
+    if (text != nullptr && text_cursor < text_size) {
+      size_t length = strnlen(text + text_cursor, text_size - text_cursor);
+      mapping.filename = std::string{ text + text_cursor, length };
+      text_cursor += length + 1;
+    }
+    mappings.push_back(mapping);
+  }
+}
+
+std::string CoreFile::read_fixed_string(ELF_ULONG offset, size_t size) const
+{
+  const char *text = reinterpret_cast<const char *>(elf.get_bytes(offset, size));
+  if (text == nullptr) return "";
+  return std::string{ text, strnlen(text, size) };
+}
+
+const Elf_Phdr *CoreFile::find_segment(ELF_ULONG address) const
+{
+  // first segment starting after the address, the one before may cover it
+  auto it = std::upper_bound(load_segments.begin(), load_segments.end(), address, [](ELF_ULONG a, const Elf_Phdr &p) {
+    return a < p.p_vaddr;
+  });
+  if (it == load_segments.begin()) return nullptr;
+  --it;
+  if (address - it->p_vaddr >= it->p_memsz) return nullptr;
+  return &(*it);
+}
+
+const CoreMapping *CoreFile::find_mapping(ELF_ULONG address) const
+{
+  for (auto &m : mappings) {
+    if (address >= m.start && address < m.end) return &m;
+  }
+  return nullptr;
+}
+
+size_t CoreFile::read_memory(ELF_ULONG address, byte *buffer, size_t size) const
+{
+  size_t done = 0;
+  while (done < size) {
+    const Elf_Phdr *segment = find_segment(address + done);
+    if (segment == nullptr) break;
+    ELF_ULONG relative = address + done - segment->p_vaddr;
+    size_t count = std::min<ELF_ULONG>(size - done, segment->p_memsz - relative);
+    size_t from_file = 0;
+    if (relative < segment->p_filesz) {
+      from_file = std::min<ELF_ULONG>(count, segment->p_filesz - relative);
+      const byte *source = elf.get_bytes(segment->p_offset + relative, from_file);
+      if (source == nullptr) break;// truncated core
+      memcpy(buffer + done, source, from_file);
+    }
+    memset(buffer + done + from_file, 0, count - from_file);
+    done += count;
+  }
+  return done;
+}
+
+
+std::ostream &operator<<(std::ostream &out, const CoreFile &core)
+{
+  out << "Core file for pid " << core.pid << " '" << core.process_name << "'\n";
+  out << "Arguments: " << core.process_arguments << "\n";
+  out << "Threads: " << core.threads.size() << "\n";
+  size_t counter = 0;
+  for (auto &t : core.threads) {
+    out << "  [" << counter << "] pid: " << t.pid << " signal: " << t.signal;
+    out << " registers:" << std::hex << "0x" << t.registers_offset << " size:0x" << t.registers_size << std::dec << "\n";
+    counter++;
+  }
+  out << "Auxiliary vector: " << core.auxv.size() << "\n";
+  for (auto &a : core.auxv) {
+    out << "  " << std::setw(16) << std::setfill(' ') << std::left << elf_auxv_type_to_string(a.type) << std::right;
+    out << std::hex << "0x" << a.value << std::dec << "\n";
+  }
+  out << "Mapped files: " << core.mappings.size() << "\n";
+  for (auto &m : core.mappings) {
+    out << "  " << std::hex << "0x" << m.start << "-0x" << m.end << " offset:0x" << m.file_offset << std::dec << " " << m.filename << "\n";
+  }
+  out << "Load segments: " << core.load_segments.size() << "\n";
+  counter = 0;
+  for (auto &p : core.load_segments) {
+    out << "  [" << counter << "] " << std::hex << "vaddr:0x" << p.p_vaddr << " memsz:0x" << p.p_memsz;
+    out << " offset:0x" << p.p_offset << " filesz:0x" << p.p_filesz << std::dec;
+    out << " " << elf_program_flag_to_string(p.p_flags) << "\n";
+    counter++;
+  }
+  return out;
+}
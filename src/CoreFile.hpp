@@ -0,0 +1,99 @@
+#ifndef COREFILE_HPP
+#define COREFILE_HPP
+
+#include "ElfReader.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Register state of one thread, from an NT_PRSTATUS note
+ *
+ * The register block is architecture specific so we only record where it is.
+ */
+struct CoreThread
+{
+  ELF_ULONG pid;
+  ELF_ULONG signal;
+  ELF_ULONG registers_offset;// file offset of pr_reg
+  ELF_ULONG registers_size;
+};
+
+struct CoreAuxvEntry
+{
+  ELF_ULONG type;
+  ELF_ULONG value;
+};
+
+/**
+ * @brief One file backed mapping of the crashed process, from the NT_FILE note
+ */
+struct CoreMapping
+{
+  ELF_ULONG start;
+  ELF_ULONG end;
+  ELF_ULONG file_offset;// offset into the mapped file in bytes
+  std::string filename;
+};
+
+/**
+ * @brief Triage view of an ET_CORE file.
+ *
+ * Only the notes are decoded, PT_LOAD segments are indexed by address but
+ * their contents are left on disk and served on demand by read_memory().  The
+ * ElfReader must have been opened by filename so the file is mapped rather
+ * than read in.
+ */
+class CoreFile
+{
+public:
+  explicit CoreFile(const ElfReader &elf);
+
+  ELF_ULONG pid;
+  std::string process_name;
+  std::string process_arguments;
+  std::vector<CoreThread> threads;
+  std::vector<CoreAuxvEntry> auxv;
+  std::vector<CoreMapping> mappings;
+  std::vector<Elf_Phdr> load_segments;// PT_LOAD sorted by p_vaddr
+
+  /**
+   * @brief Find the PT_LOAD segment covering a virtual address
+   *
+   * @return const Elf_Phdr* nullptr if the address was not mapped
+   */
+  const Elf_Phdr *find_segment(ELF_ULONG address) const;
+
+  /**
+   * @brief Find the NT_FILE mapping covering a virtual address
+   *
+   * @return const CoreMapping* nullptr if the address is not file backed
+   */
+  const CoreMapping *find_mapping(ELF_ULONG address) const;
+
+  /**
+   * @brief Copy process memory out of the core
+   *
+   * Reads may span adjacent segments.  Memory that was not dumped
+   * (p_memsz > p_filesz) reads as zeros.
+   *
+   * @return size_t bytes copied, short if the range runs into unmapped memory
+   */
+  size_t read_memory(ELF_ULONG address, byte *buffer, size_t size) const;
+
+  friend std::ostream &operator<<(std::ostream &out, const CoreFile &core);
+
+private:
+  const ElfReader &elf;
+  size_t word_size;
+
+  void read_prstatus(const Elf_Note &note);
+  void read_prpsinfo(const Elf_Note &note);
+  void read_auxv(const Elf_Note &note);
+  void read_file_mappings(const Elf_Note &note);
+  std::string read_fixed_string(ELF_ULONG offset, size_t size) const;
+};
+
+std::ostream &operator<<(std::ostream &out, const CoreFile &core);
+
+#endif /* COREFILE_HPP */
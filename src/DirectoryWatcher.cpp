@@ -0,0 +1,187 @@
+#include "DirectoryWatcher.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR | IN_EXCL_UNLINK;
+
+}// namespace
+
+
+DirectoryWatcher::DirectoryWatcher(const std::vector<std::string> &roots) : roots(roots), fd(-1), wake{ -1, -1 }, open(false), overflowed(false)
+{
+  fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0 || ::pipe2(wake, O_NONBLOCK | O_CLOEXEC) != 0) return;
+  for (auto &root : roots) {
+    if (!watch_tree(root, false)) return;
+  }
+  open = true;
+}
+
+DirectoryWatcher::~DirectoryWatcher()
+{
+  if (fd >= 0) ::close(fd);
+  if (wake[0] >= 0) ::close(wake[0]);
+  if (wake[1] >= 0) ::close(wake[1]);
+}
+
+bool DirectoryWatcher::is_open() const
+{
+  return open;
+}
+
+size_t DirectoryWatcher::get_watch_count() const
+{
+  return directories.size();
+}
+
+bool DirectoryWatcher::is_overflowed()
+{
+  bool result = overflowed;
+  overflowed = false;
+  return result;
+}
+
+size_t DirectoryWatcher::rescan()
+{
+  // inotify gives a directory that is already watched its descriptor again,
+  // with the path it has now
+  auto previous = std::move(directories);
+  directories.clear();
+  for (auto &root : roots) {
+    watch_tree(root, false);
+  }
+  size_t added = 0;
+  for (auto &directory : directories) {
+    if (previous.count(directory.first) == 0) added++;
+  }
+  for (auto &directory : previous) {
+    if (directories.count(directory.first) == 0) ::inotify_rm_watch(fd, directory.first);
+  }
+  return added;
+}
+
+void DirectoryWatcher::stop()
+{
+  // write() is async-signal-safe, a full pipe already wakes wait()
+  [[maybe_unused]] auto written = ::write(wake[1], "", 1);
+}
+
+/**
+ * @brief Watch root and every directory below it
+ *
+ * The watch goes on before the directory is listed, so a file written while
+ * the tree is walked is either listed or reported by inotify, or both.
+ *
+ * @param report record the files found as created, for a directory that
+ *        appeared after the watcher started
+ */
+bool DirectoryWatcher::watch_tree(const std::string &root, bool report)
+{
+  namespace fs = std::filesystem;
+  int wd = ::inotify_add_watch(fd, root.c_str(), WATCH_MASK);
+  if (wd < 0) return false;
+  directories[wd] = root;
+  std::error_code ec;
+  for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (ec) break;
+    if (it->is_symlink(ec)) continue;
+    auto path = it->path().string();
+    if (it->is_directory(ec)) {
+      wd = ::inotify_add_watch(fd, path.c_str(), WATCH_MASK);
+      if (wd >= 0) directories[wd] = path;
+    } else if (report && it->is_regular_file(ec)) {
+      record(path, false, false);
+    }
+  }
+  return true;
+}
+
+void DirectoryWatcher::record(const std::string &path, bool removed, bool directory)
+{
+  auto now = std::chrono::steady_clock::now();
+  if (pending.empty()) first_change = now;
+  last_change = now;
+  pending[path] = { path, removed, directory };
+}
+
+void DirectoryWatcher::read_events()
+{
+  alignas(inotify_event) char buffer[65536];
+  for (;;) {
+    auto count = ::read(fd, buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return;
+    for (ssize_t offset = 0; offset < count;) {
+      auto event = reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      if ((event->mask & IN_Q_OVERFLOW) != 0) {
+        overflowed = true;
+        continue;
+      }
+      if ((event->mask & IN_IGNORED) != 0) {
+        directories.erase(event->wd);
+        continue;
+      }
+      auto directory = directories.find(event->wd);
+      if (directory == directories.end() || event->len == 0) continue;
+      auto path = directory->second + "/" + event->name;
+      if ((event->mask & IN_ISDIR) == 0) {
+        if ((event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) != 0) record(path, false, false);
+        if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0) record(path, true, false);
+        continue;
+      }
+      if ((event->mask & (IN_CREATE | IN_MOVED_TO)) != 0) {
+        watch_tree(path, true);
+      } else if ((event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0) {
+        // a directory moved elsewhere keeps its watches, drop them so its
+        // events are not reported under the old path
+        auto prefix = path + "/";
+        for (auto it = directories.begin(); it != directories.end();) {
+          if (it->second == path || it->second.compare(0, prefix.size(), prefix) == 0) {
+            ::inotify_rm_watch(fd, it->first);
+            it = directories.erase(it);
+          } else {
+            ++it;
+          }
+        }
+        record(path, true, true);
+      }
+    }
+  }
+}
+
+std::vector<watch_event> DirectoryWatcher::wait(std::chrono::milliseconds debounce, size_t batch_limit)
+{
+  using namespace std::chrono;
+  for (;;) {
+    auto now = steady_clock::now();
+    if (overflowed || (!pending.empty() && (pending.size() >= batch_limit || now - last_change >= debounce || now - first_change >= 10 * debounce))) {
+      std::vector<watch_event> batch;
+      batch.reserve(pending.size());
+      for (auto &p : pending) {
+        batch.push_back(std::move(p.second));
+      }
+      pending.clear();
+      return batch;
+    }
+    int timeout = -1;
+    if (!pending.empty()) {
+      auto due = std::min(last_change + debounce, first_change + 10 * debounce);
+      timeout = static_cast<int>(ceil<milliseconds>(due - now).count());
+    }
+    pollfd fds[2] = { { fd, POLLIN, 0 }, { wake[0], POLLIN, 0 } };
+    if (::poll(fds, 2, timeout) < 0) {
+      if (errno == EINTR) continue;
+      return {};
+    }
+    if ((fds[1].revents & POLLIN) != 0) return {};
+    if ((fds[0].revents & POLLIN) != 0) read_events();
+  }
+}
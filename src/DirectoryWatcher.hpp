@@ -0,0 +1,96 @@
+#ifndef DIRECTORYWATCHER_HPP
+#define DIRECTORYWATCHER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A path that changed under a watched root
+ */
+struct watch_event
+{
+  std::string path;
+  bool removed;// deleted or moved away, otherwise written or moved in
+  bool directory;// a removed directory, everything below it is gone
+};
+
+/**
+ * @brief Collects changes below a set of directories with inotify(7).
+ *
+ * Every directory below the roots gets a watch, directories that appear
+ * later are watched as they are created or moved in and the files already in
+ * them are reported.  A file is reported once it is closed after writing or
+ * moved into place, so files are never picked up half written.
+ *
+ * Changes are collected into batches: a path that changes many times is
+ * reported once, with its last state.  wait() returns a batch once nothing
+ * has changed for the debounce time, when the batch is full, or when the
+ * oldest change has waited ten debounce times, so a tree that never goes
+ * quiet is still seen.
+ *
+ * If the kernel queue overflows, changes were lost and the caller has to
+ * compare the tree with what it knows, see is_overflowed(), and rescan() the
+ * directories that appeared meanwhile.
+ */
+class DirectoryWatcher
+{
+public:
+  explicit DirectoryWatcher(const std::vector<std::string> &roots);
+  ~DirectoryWatcher();
+  DirectoryWatcher(const DirectoryWatcher &) = delete;
+  DirectoryWatcher &operator=(const DirectoryWatcher &) = delete;
+
+  /**
+   * @brief false if inotify could not be set up or a root could not be watched
+   */
+  bool is_open() const;
+
+  /**
+   * @brief Wait for the next batch, empty after stop()
+   */
+  std::vector<watch_event> wait(std::chrono::milliseconds debounce, size_t batch_limit);
+
+  /**
+   * @brief Make wait() return, safe to call from a signal handler
+   */
+  void stop();
+
+  /**
+   * @brief true once, after the events were lost to an overflow
+   */
+  bool is_overflowed();
+
+  /**
+   * @brief Walk the roots again and watch the directories that have no watch
+   *
+   * For after an overflow, when the events of directories created or moved
+   * were lost.  The files in them are not reported.  Watches of directories
+   * that are no longer below a root are dropped.
+   *
+   * @return the directories that were not watched before
+   */
+  size_t rescan();
+
+  size_t get_watch_count() const;
+
+private:
+  std::vector<std::string> roots;
+  int fd;
+  int wake[2];// self pipe for stop()
+  bool open;
+  bool overflowed;
+  std::unordered_map<int, std::string> directories;// watch descriptor to path
+  std::map<std::string, watch_event> pending;
+  std::chrono::steady_clock::time_point first_change;
+  std::chrono::steady_clock::time_point last_change;
+
+  bool watch_tree(const std::string &root, bool report);
+  void read_events();
+  void record(const std::string &path, bool removed, bool directory);
+};
+
+#endif /* DIRECTORYWATCHER_HPP */
@@ -0,0 +1,261 @@
+#include "ElfDiff.hpp"
+#include "SymbolTable.hpp"
+#include "elf.hpp"
+#include <algorithm>
+#include <deque>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief Position of an item in its file, sorted by name and occurrence
+ */
+struct diff_key
+{
+  std::string_view name;
+  size_t occurrence;
+  size_t index;
+};
+
+bool operator<(const diff_key &a, const diff_key &b)
+{
+  if (a.name != b.name) return a.name < b.name;
+  return a.occurrence < b.occurrence;
+}
+
+/**
+ * @brief Sort the items by name, numbering repeated names in file order
+ */
+std::vector<diff_key> make_index(const std::vector<std::string_view> &names)
+{
+  std::vector<diff_key> keys;
+  keys.reserve(names.size());
+  for (size_t ii = 0; ii < names.size(); ii++) {
+    keys.push_back({ names[ii], 0, ii });
+  }
+  std::sort(keys.begin(), keys.end(), [](const diff_key &a, const diff_key &b) {
+    if (a.name != b.name) return a.name < b.name;
+    return a.index < b.index;
+  });
+  for (size_t ii = 1; ii < keys.size(); ii++) {
+    if (keys[ii].name == keys[ii - 1].name) {
+      keys[ii].occurrence = keys[ii - 1].occurrence + 1;
+    }
+  }
+  return keys;
+}
+
+/**
+ * @brief Walk both indexes in step, calling visit(before, after) with the
+ *        key on each side or nullptr where the item is missing
+ */
+template<typename Visit>
+void merge(const std::vector<diff_key> &before, const std::vector<diff_key> &after, Visit visit)
+{
+  size_t ii = 0;
+  size_t jj = 0;
+  while (ii < before.size() || jj < after.size()) {
+    if (jj == after.size() || (ii < before.size() && before[ii] < after[jj])) {
+      visit(&before[ii], nullptr);
+      ii++;
+    } else if (ii == before.size() || after[jj] < before[ii]) {
+      visit(nullptr, &after[jj]);
+      jj++;
+    } else {
+      visit(&before[ii], &after[jj]);
+      ii++;
+      jj++;
+    }
+  }
+}
+
+diff_values section_values(const Elf_Shdr &sh)
+{
+  return { sh.sh_size, 0, sh.sh_addr, sh.sh_flags, sh.sh_type };
+}
+
+diff_values symbol_values(const Elf_Sym &sym)
+{
+  ELF_ULONG flags = (static_cast<ELF_ULONG>(ELF64_ST_BIND(sym.st_info)) << 8) | sym.st_other;
+  return { sym.st_size, 0, sym.st_value, flags, static_cast<ELF_ULONG>(ELF64_ST_TYPE(sym.st_info)) };
+}
+
+diff_values segment_values(const Elf_Phdr &p)
+{
+  return { p.p_filesz, p.p_memsz, p.p_vaddr, p.p_flags, p.p_type };
+}
+
+}// namespace
+
+
+ElfDiff::ElfDiff(const ElfReader &before, const ElfReader &after, DiffOptions options) : options(options)
+{
+  compare_sections(before, after);
+  compare_symbols(before, after);
+  compare_segments(before, after);
+}
+
+size_t ElfDiff::count(diff_item item, diff_change change) const
+{
+  return std::count_if(entries.begin(), entries.end(), [item, change](const diff_entry &e) {
+    return e.item == item && e.change == change;
+  });
+}
+
+bool ElfDiff::empty() const
+{
+  return entries.empty();
+}
+
+uint32_t ElfDiff::changed_fields(const diff_values &before, const diff_values &after) const
+{
+  uint32_t fields = 0;
+  if (before.size != after.size) fields |= DF_SIZE;
+  if (before.memsz != after.memsz) fields |= DF_MEMSZ;
+  if (before.address != after.address && !options.ignore_addresses) fields |= DF_ADDRESS;
+  if (before.flags != after.flags) fields |= DF_FLAGS;
+  if (before.type != after.type) fields |= DF_TYPE;
+  return fields;
+}
+
+void ElfDiff::add_changes(diff_item item, const std::vector<std::string_view> &names_before, const std::vector<diff_values> &values_before, const std::vector<std::string_view> &names_after, const std::vector<diff_values> &values_after)
+{
+  auto index_before = make_index(names_before);
+  auto index_after = make_index(names_after);
+  merge(index_before, index_after, [&](const diff_key *b, const diff_key *a) {
+    diff_entry entry{ item, diff_change::changed, "", 0, 0, {}, {} };
+    if (b != nullptr) entry.before = values_before[b->index];
+    if (a != nullptr) entry.after = values_after[a->index];
+    if (a == nullptr) {
+      entry.change = diff_change::removed;
+    } else if (b == nullptr) {
+      entry.change = diff_change::added;
+    } else {
+      entry.fields = changed_fields(entry.before, entry.after);
+      if (entry.fields == 0) return;
+    }
+    const diff_key &key = (b != nullptr) ? *b : *a;
+    entry.name = std::string(key.name);
+    entry.occurrence = key.occurrence;
+    entries.push_back(std::move(entry));
+  });
+}
+
+void ElfDiff::compare_sections(const ElfReader &before, const ElfReader &after)
+{
+  std::vector<std::string_view> names[2];
+  std::vector<diff_values> values[2];
+  const ElfReader *side[2] = { &before, &after };
+  for (size_t ii = 0; ii < 2; ii++) {
+    for (auto &sh : side[ii]->section_headers) {
+      names[ii].push_back(sh.name);
+      values[ii].push_back(section_values(sh));
+    }
+  }
+  add_changes(diff_item::section, names[0], values[0], names[1], values[1]);
+}
+
+void ElfDiff::compare_symbols(const ElfReader &before, const ElfReader &after)
+{
+  std::vector<std::string_view> names[2];
+  std::vector<diff_values> values[2];
+  const ElfReader *side[2] = { &before, &after };
+  for (size_t ii = 0; ii < 2; ii++) {
+    for (size_t table_index = 0; table_index < side[ii]->section_headers.size(); table_index++) {
+      auto table = side[ii]->get_symbol_table(table_index);
+      if (table == nullptr) continue;
+      for (auto &sym : table->entries) {
+        // section symbols and the null symbol have no name to match on
+        if (sym.name.empty()) continue;
+        names[ii].push_back(sym.name);
+        values[ii].push_back(symbol_values(sym));
+      }
+    }
+  }
+  add_changes(diff_item::symbol, names[0], values[0], names[1], values[1]);
+}
+
+void ElfDiff::compare_segments(const ElfReader &before, const ElfReader &after)
+{
+  std::vector<std::string_view> names[2];
+  std::vector<diff_values> values[2];
+  std::deque<std::string> unnamed;// holds the names of types we have no name for
+  const ElfReader *side[2] = { &before, &after };
+  for (size_t ii = 0; ii < 2; ii++) {
+    for (auto &p : side[ii]->program_headers) {
+      auto name = elf_program_type_to_string(p.p_type);
+      if (name == "unknown") {
+        std::ostringstream hex;
+        hex << "0x" << std::hex << p.p_type;
+        name = unnamed.emplace_back(hex.str());
+      }
+      names[ii].push_back(name);
+      values[ii].push_back(segment_values(p));
+    }
+  }
+  add_changes(diff_item::segment, names[0], values[0], names[1], values[1]);
+}
+
+
+std::string_view diff_item_to_string(diff_item item)
+{
+  switch (item) {
+  case diff_item::section:
+    return "section";
+  case diff_item::symbol:
+    return "symbol";
+  case diff_item::segment:
+    return "segment";
+  default:
+    return "unknown";
+  }
+}
+
+void write_text(OutputBuffer &out, const ElfDiff &diff)
+{
+  auto value = [&out](std::string_view label, ELF_ULONG v) {
+    out.put(' ').put(label).put(" 0x").hex(v);
+  };
+  auto change = [&out](std::string_view label, ELF_ULONG before, ELF_ULONG after) {
+    out.put(' ').put(label).put(" 0x").hex(before).put(" -> 0x").hex(after);
+  };
+  for (auto &e : diff.entries) {
+    switch (e.change) {
+    case diff_change::added:
+      out.put("+ ");
+      break;
+    case diff_change::removed:
+      out.put("- ");
+      break;
+    default:
+      out.put("~ ");
+    }
+    out.put(diff_item_to_string(e.item)).put(' ').put(e.name);
+    if (e.occurrence > 0) out.put('#').dec(e.occurrence);
+    if (e.change != diff_change::changed) {
+      const auto &v = (e.change == diff_change::added) ? e.after : e.before;
+      value("size", v.size);
+      value("address", v.address);
+    } else {
+      if (e.fields & DF_SIZE) change("size", e.before.size, e.after.size);
+      if (e.fields & DF_MEMSZ) change("memsz", e.before.memsz, e.after.memsz);
+      if (e.fields & DF_ADDRESS) change("address", e.before.address, e.after.address);
+      if (e.fields & DF_FLAGS) change("flags", e.before.flags, e.after.flags);
+      if (e.fields & DF_TYPE) change("type", e.before.type, e.after.type);
+    }
+    out.put('\n');
+  }
+  for (auto item : { diff_item::section, diff_item::symbol, diff_item::segment }) {
+    out.put(diff_item_to_string(item)).put("s: ");
+    out.dec(diff.count(item, diff_change::added)).put(" added, ");
+    out.dec(diff.count(item, diff_change::removed)).put(" removed, ");
+    out.dec(diff.count(item, diff_change::changed)).put(" changed\n");
+  }
+}
+
+std::ostream &operator<<(std::ostream &out, const ElfDiff &diff)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, diff);
+  return out;
+}
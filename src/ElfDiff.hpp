@@ -0,0 +1,95 @@
+#ifndef ELFDIFF_HPP
+#define ELFDIFF_HPP
+
+#include "ElfReader.hpp"
+#include "OutputBuffer.hpp"
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class diff_item {
+  section,
+  symbol,
+  segment,
+};
+
+enum class diff_change {
+  added,
+  removed,
+  changed,
+};
+
+/**
+ * @brief Bits of diff_entry::fields, which values differ
+ */
+enum diff_field : uint32_t {
+  DF_SIZE = 1 << 0,// sh_size, st_size or p_filesz
+  DF_MEMSZ = 1 << 1,// p_memsz
+  DF_ADDRESS = 1 << 2,// sh_addr, st_value or p_vaddr
+  DF_FLAGS = 1 << 3,// sh_flags, p_flags or the symbol's binding and visibility
+  DF_TYPE = 1 << 4,// sh_type or the symbol type
+};
+
+/**
+ * @brief The values of an item that are compared
+ */
+struct diff_values
+{
+  ELF_ULONG size;
+  ELF_ULONG memsz;// segments only
+  ELF_ULONG address;
+  ELF_ULONG flags;
+  ELF_ULONG type;
+};
+
+struct diff_entry
+{
+  diff_item item;
+  diff_change change;
+  std::string name;
+  size_t occurrence;// items with the same name are matched in file order
+  uint32_t fields;// diff_field bits, changed entries only
+  diff_values before;// not set for added entries
+  diff_values after;// not set for removed entries
+};
+
+struct DiffOptions
+{
+  bool ignore_addresses = false;// an item that only moved is not a change
+};
+
+/**
+ * @brief Differences between the sections, symbols and segments of two files.
+ *
+ * Sections and symbols are matched by name, segments by type.  Names that
+ * appear more than once (local symbols, duplicate sections) are paired in the
+ * order they appear in the file.  Each side is indexed by sorting on the key
+ * and the indexes are then merged, O(n log n) in the number of items.
+ */
+class ElfDiff
+{
+public:
+  ElfDiff(const ElfReader &before, const ElfReader &after, DiffOptions options = DiffOptions{});
+
+  std::vector<diff_entry> entries;// ordered by item, then name
+
+  size_t count(diff_item item, diff_change change) const;
+  bool empty() const;
+
+private:
+  DiffOptions options;
+
+  void compare_sections(const ElfReader &before, const ElfReader &after);
+  void compare_symbols(const ElfReader &before, const ElfReader &after);
+  void compare_segments(const ElfReader &before, const ElfReader &after);
+  uint32_t changed_fields(const diff_values &before, const diff_values &after) const;
+  void add_changes(diff_item item, const std::vector<std::string_view> &names_before, const std::vector<diff_values> &values_before, const std::vector<std::string_view> &names_after, const std::vector<diff_values> &values_after);
+};
+
+std::string_view diff_item_to_string(diff_item item);
+
+std::ostream &operator<<(std::ostream &out, const ElfDiff &diff);
+void write_text(OutputBuffer &out, const ElfDiff &diff);
+
+#endif /* ELFDIFF_HPP */
@@ -0,0 +1,331 @@
+#include "ElfEditor.hpp"
+#include "Elf_Header_Fields.hpp"
+#include "elf.hpp"
+#include "section_types.hpp"
+#include <algorithm>
+#include <cstring>
+
+const char *header_field_to_string(header_field field)
+{
+  switch (field) {
+  case EH_TYPE:
+    return "e_type";
+  case EH_MACHINE:
+    return "e_machine";
+  case EH_VERSION:
+    return "e_version";
+  case EH_ENTRY:
+    return "e_entry";
+  case EH_PHOFF:
+    return "e_phoff";
+  case EH_SHOFF:
+    return "e_shoff";
+  case EH_FLAGS:
+    return "e_flags";
+  case EH_EHSIZE:
+    return "e_ehsize";
+  case EH_PHENTSIZE:
+    return "e_phentsize";
+  case EH_PHNUM:
+    return "e_phnum";
+  case EH_SHENTSIZE:
+    return "e_shentsize";
+  case EH_SHNUM:
+    return "e_shnum";
+  case EH_SHSTRNDX:
+    return "e_shstrndx";
+  case EH_COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+const char *section_field_to_string(section_field field)
+{
+  switch (field) {
+  case SH_NAME:
+    return "sh_name";
+  case SH_TYPE:
+    return "sh_type";
+  case SH_FLAGS:
+    return "sh_flags";
+  case SH_ADDR:
+    return "sh_addr";
+  case SH_OFFSET:
+    return "sh_offset";
+  case SH_SIZE:
+    return "sh_size";
+  case SH_LINK:
+    return "sh_link";
+  case SH_INFO:
+    return "sh_info";
+  case SH_ADDRALIGN:
+    return "sh_addralign";
+  case SH_ENTSIZE:
+    return "sh_entsize";
+  case SH_COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+const char *segment_field_to_string(segment_field field)
+{
+  switch (field) {
+  case PH_TYPE:
+    return "p_type";
+  case PH_FLAGS:
+    return "p_flags";
+  case PH_OFFSET:
+    return "p_offset";
+  case PH_VADDR:
+    return "p_vaddr";
+  case PH_PADDR:
+    return "p_paddr";
+  case PH_FILESZ:
+    return "p_filesz";
+  case PH_MEMSZ:
+    return "p_memsz";
+  case PH_ALIGN:
+    return "p_align";
+  case PH_COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+const char *symbol_field_to_string(symbol_field field)
+{
+  switch (field) {
+  case ST_NAME:
+    return "st_name";
+  case ST_VALUE:
+    return "st_value";
+  case ST_SIZE:
+    return "st_size";
+  case ST_INFO:
+    return "st_info";
+  case ST_OTHER:
+    return "st_other";
+  case ST_SHNDX:
+    return "st_shndx";
+  case ST_COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+namespace {
+
+template<typename T, T count>
+std::optional<T> field_from_string(std::string_view name, const char *(*to_string)(T))
+{
+  for (int ii = 0; ii < count; ii++) {
+    if (name == to_string(static_cast<T>(ii))) return static_cast<T>(ii);
+  }
+  return std::nullopt;
+}
+
+/**
+ * @brief Offset of a field in an entry, and its width, from a field table
+ *        and the order of the fields in it
+ */
+template<typename Table>
+std::pair<size_t, size_t> field_at(const Table &table, const size_t *order, size_t field, size_t cls)
+{
+  size_t offset = 0;
+  for (size_t ii = 0; ii < table.size(); ii++) {
+    size_t width = table[ii].sz[cls];
+    if ((order != nullptr ? order[ii] : ii) == field) return { offset, width };
+    offset += width;
+  }
+  return { offset, 0 };
+}
+
+}// namespace
+
+std::optional<header_field> header_field_from_string(std::string_view name)
+{
+  return field_from_string<header_field, EH_COUNT>(name, header_field_to_string);
+}
+
+std::optional<section_field> section_field_from_string(std::string_view name)
+{
+  return field_from_string<section_field, SH_COUNT>(name, section_field_to_string);
+}
+
+std::optional<segment_field> segment_field_from_string(std::string_view name)
+{
+  return field_from_string<segment_field, PH_COUNT>(name, segment_field_to_string);
+}
+
+std::optional<symbol_field> symbol_field_from_string(std::string_view name)
+{
+  return field_from_string<symbol_field, ST_COUNT>(name, symbol_field_to_string);
+}
+
+elf_expected<ElfEditor> ElfEditor::open(const std::string &filename)
+{
+  auto file = std::make_shared<MappedFile>(filename, true);
+  if (!file->is_open() || file->writable_data() == nullptr) return elf_validation{ EE_OPEN_FAILED, 0 };
+  // where the fields are, not what is in the tables
+  ParseOptions options;
+  options.verbose = false;
+  options.symbol_tables = false;
+  options.string_tables = false;
+  auto reader = ElfReader::open(file, options);
+  if (!reader) return reader.error();
+  return ElfEditor(std::move(file), std::move(*reader));
+}
+
+ElfEditor::ElfEditor(std::shared_ptr<MappedFile> file, ElfReader reader)
+  : file(std::move(file)), reader(std::move(reader)), fields(0), written(0)
+{
+  data = this->file->writable_data();
+  cls = this->reader.is_64bit() ? ELFCLASS64 : ELFCLASS32;
+  msb = this->reader.get_data_encoding() == ELFDATA2MSB;
+}
+
+const ElfReader &ElfEditor::get_reader() const
+{
+  return reader;
+}
+
+const std::string &ElfEditor::get_error() const
+{
+  return error;
+}
+
+uint64_t ElfEditor::get_field_count() const
+{
+  return fields;
+}
+
+uint64_t ElfEditor::get_written_bytes() const
+{
+  return written;
+}
+
+bool ElfEditor::store(uint64_t offset, uint64_t value, size_t width)
+{
+  if (width < 8 && (value >> (8 * width)) != 0) {
+    error = "the value does not fit in " + std::to_string(width) + " bytes";
+    return false;
+  }
+  if (reader.get_bytes(offset, width) == nullptr) {
+    error = "the field is outside the file";
+    return false;
+  }
+  byte bytes[8];
+  for (size_t ii = 0; ii < width; ii++) {
+    bytes[ii] = static_cast<byte>(value >> (8 * (msb ? width - ii - 1 : ii)));
+  }
+  return store(offset, bytes, width);
+}
+
+bool ElfEditor::store(uint64_t offset, const byte *bytes, size_t size)
+{
+  pending.emplace_back(offset, std::vector<byte>(bytes, bytes + size));
+  fields++;
+  written += size;
+  return true;
+}
+
+bool ElfEditor::refuse(const char *field)
+{
+  error = std::string(field) + " is about the layout of the file, it can't be edited in place";
+  return false;
+}
+
+bool ElfEditor::set_header(header_field field, uint64_t value)
+{
+  if (field != EH_TYPE && field != EH_MACHINE && field != EH_VERSION && field != EH_ENTRY && field != EH_FLAGS) return refuse(header_field_to_string(field));
+  auto at = field_at(elf_header_fields, nullptr, field, cls);
+  return store(EI_NIDENT + at.first, value, at.second);
+}
+
+bool ElfEditor::set_section(size_t index, section_field field, uint64_t value)
+{
+  if (field != SH_FLAGS && field != SH_ADDR && field != SH_ADDRALIGN) return refuse(section_field_to_string(field));
+  if (index == 0) {
+    error = "section 0 is the null section";
+    return false;
+  }
+  if (index >= reader.get_section_header_count()) {
+    error = "there is no section " + std::to_string(index);
+    return false;
+  }
+  auto at = field_at(elf_section_header_fields, nullptr, field, cls);
+  return store(reader.header.e_shoff + index * reader.header.e_shentsize + at.first, value, at.second);
+}
+
+bool ElfEditor::set_segment(size_t index, segment_field field, uint64_t value)
+{
+  if (field != PH_FLAGS && field != PH_VADDR && field != PH_PADDR && field != PH_MEMSZ && field != PH_ALIGN) return refuse(segment_field_to_string(field));
+  if (index >= reader.program_headers.size()) {
+    error = "there is no segment " + std::to_string(index);
+    return false;
+  }
+  auto at = field_at(elf_program_header_fields, elf_program_header_field_order[cls], field, cls);
+  return store(reader.header.e_phoff + index * reader.header.e_phentsize + at.first, value, at.second);
+}
+
+bool ElfEditor::set_symbol(std::string_view name, symbol_field field, uint64_t value)
+{
+  if (field != ST_VALUE && field != ST_SIZE && field != ST_INFO && field != ST_OTHER) return refuse(symbol_field_to_string(field));
+  auto at = field_at(elf_symbol_table_fields, elf_symbol_field_order[cls], field, cls);
+  auto name_width = elf_symbol_table_fields[0].sz[cls];
+  auto symbol_size = field_at(elf_symbol_table_fields, nullptr, ST_COUNT, cls).first;
+  size_t found = 0;
+  auto &sections = reader.section_headers;
+  for (auto &sh : sections) {
+    if ((sh.sh_type != SHT_SYMTAB && sh.sh_type != SHT_DYNSYM) || sh.sh_entsize < symbol_size || sh.sh_link >= sections.size()) continue;
+    auto &strings = sections[sh.sh_link];
+    const byte *names = reader.get_bytes(strings.sh_offset, strings.sh_size);
+    if (names == nullptr || reader.get_bytes(sh.sh_offset, sh.sh_size) == nullptr) continue;
+    // the names are compared where they are, nothing is decoded
+    for (uint64_t entry = sh.sh_offset; entry + sh.sh_entsize <= sh.sh_offset + sh.sh_size; entry += sh.sh_entsize) {
+      uint64_t offset = reader.read_value(entry, name_width);
+      if (offset == 0 || offset + name.size() >= strings.sh_size) continue;
+      if (names[offset + name.size()] != 0 || std::memcmp(names + offset, name.data(), name.size()) != 0) continue;
+      if (!store(entry + at.first, value, at.second)) return false;
+      found++;
+    }
+  }
+  if (found == 0) error = "there is no symbol " + std::string(name);
+  return found > 0;
+}
+
+bool ElfEditor::set_note(std::string_view name, uint64_t type, const byte *descriptor, size_t size)
+{
+  for (auto &note : reader.notes) {
+    if (note.name != name || note.n_type != type) continue;
+    if (note.n_descsz != size) {
+      error = "the " + note.name + " note has " + std::to_string(note.n_descsz) + " bytes, not " + std::to_string(size);
+      return false;
+    }
+    if (reader.get_bytes(note.desc_offset, size) == nullptr) {
+      error = "the " + note.name + " note is outside the file";
+      return false;
+    }
+    return store(note.desc_offset, descriptor, size);
+  }
+  error = "there is no " + std::string(name) + " note of type " + std::to_string(type);
+  return false;
+}
+
+bool ElfEditor::sync()
+{
+  if (pending.empty()) return true;
+  uint64_t start = UINT64_MAX;
+  uint64_t end = 0;
+  for (auto &p : pending) {
+    std::memcpy(data + p.first, p.second.data(), p.second.size());
+    start = std::min<uint64_t>(start, p.first);
+    end = std::max<uint64_t>(end, p.first + p.second.size());
+  }
+  pending.clear();
+  bool ok = file->sync(start, end - start);
+  if (!ok) error = "msync failed";
+  return ok;
+}
@@ -0,0 +1,175 @@
+#ifndef ELFEDITOR_HPP
+#define ELFEDITOR_HPP
+
+#include "ElfReader.hpp"
+#include "MappedFile.hpp"
+#include "elf_common.hpp"
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief ELF header fields, in the order of elf_header_fields
+ */
+enum header_field {
+  EH_TYPE,
+  EH_MACHINE,
+  EH_VERSION,
+  EH_ENTRY,
+  EH_PHOFF,
+  EH_SHOFF,
+  EH_FLAGS,
+  EH_EHSIZE,
+  EH_PHENTSIZE,
+  EH_PHNUM,
+  EH_SHENTSIZE,
+  EH_SHNUM,
+  EH_SHSTRNDX,
+  EH_COUNT
+};
+
+/**
+ * @brief Section header fields, in the order of elf_section_header_fields
+ */
+enum section_field {
+  SH_NAME,
+  SH_TYPE,
+  SH_FLAGS,
+  SH_ADDR,
+  SH_OFFSET,
+  SH_SIZE,
+  SH_LINK,
+  SH_INFO,
+  SH_ADDRALIGN,
+  SH_ENTSIZE,
+  SH_COUNT
+};
+
+/**
+ * @brief Program header fields, numbered as elf_program_header_field_order
+ */
+enum segment_field {
+  PH_TYPE,
+  PH_FLAGS,
+  PH_OFFSET,
+  PH_VADDR,
+  PH_PADDR,
+  PH_FILESZ,
+  PH_MEMSZ,
+  PH_ALIGN,
+  PH_COUNT
+};
+
+/**
+ * @brief Symbol fields, numbered as elf_symbol_field_order
+ */
+enum symbol_field {
+  ST_NAME,
+  ST_VALUE,
+  ST_SIZE,
+  ST_INFO,
+  ST_OTHER,
+  ST_SHNDX,
+  ST_COUNT
+};
+
+const char *header_field_to_string(header_field field);
+const char *section_field_to_string(section_field field);
+const char *segment_field_to_string(segment_field field);
+const char *symbol_field_to_string(symbol_field field);
+
+/**
+ * @brief The field named e.g. "e_flags", "sh_addr", "p_flags" or "st_value"
+ */
+std::optional<header_field> header_field_from_string(std::string_view name);
+std::optional<section_field> section_field_from_string(std::string_view name);
+std::optional<segment_field> segment_field_from_string(std::string_view name);
+std::optional<symbol_field> symbol_field_from_string(std::string_view name);
+
+/**
+ * @brief Patches fixed size fields of a file where they are.
+ *
+ * The file is mapped MAP_SHARED and each field is stored in the file's byte
+ * order at the offset the field tables give it, so an edit costs the bytes
+ * it changes and the pages they are on, whatever the size of the file.
+ *
+ * Only fields that say nothing about where things are in the file can be
+ * set: offsets, sizes, counts, entry sizes, types and links are refused,
+ * ElfWriter lays out files where those change.  Note descriptors can be
+ * replaced by ones of the same size.
+ *
+ * The set functions check an edit and keep its bytes, sync() stores them
+ * all, so a list of edits that fails part way leaves the file as it was.
+ * The reader shares the mapping, so after sync() it reads edited bytes, but
+ * what it decoded when the file was opened is not updated.
+ */
+class ElfEditor
+{
+public:
+  /**
+   * @return elf_expected<ElfEditor> the editor, or EE_OPEN_FAILED if the
+   *         file can't be opened for writing, or the validation error
+   */
+  static elf_expected<ElfEditor> open(const std::string &filename);
+
+  const ElfReader &get_reader() const;
+  const std::string &get_error() const;
+
+  bool set_header(header_field field, uint64_t value);
+
+  /**
+   * @brief Set a field of a section header, not of the null section 0
+   */
+  bool set_section(size_t index, section_field field, uint64_t value);
+  bool set_segment(size_t index, segment_field field, uint64_t value);
+
+  /**
+   * @brief Set a field of every symbol of that name, in .symtab and .dynsym
+   *
+   * @return false if there is none
+   */
+  bool set_symbol(std::string_view name, symbol_field field, uint64_t value);
+
+  /**
+   * @brief Replace the descriptor of the first note of that name and type,
+   *        e.g. "GNU" and NT_GNU_BUILD_ID
+   */
+  bool set_note(std::string_view name, uint64_t type, const byte *descriptor, size_t size);
+
+  /**
+   * @brief Store the edits set since the last sync(), in the order they were
+   *        set, and msync() the pages they are on
+   */
+  bool sync();
+
+  /**
+   * @brief Fields and bytes set so far
+   */
+  uint64_t get_field_count() const;
+  uint64_t get_written_bytes() const;
+
+private:
+  std::shared_ptr<MappedFile> file;
+  ElfReader reader;
+  byte *data;
+  size_t cls;// ELFCLASS32 or ELFCLASS64, to index the field tables
+  bool msb;
+  std::string error;
+  uint64_t fields;
+  uint64_t written;
+  std::vector<std::pair<uint64_t, std::vector<byte>>> pending;// offset and bytes, stored by sync()
+
+  ElfEditor(std::shared_ptr<MappedFile> file, ElfReader reader);
+
+  /**
+   * @brief Keep value for width bytes at offset in the file's byte order
+   */
+  bool store(uint64_t offset, uint64_t value, size_t width);
+  bool store(uint64_t offset, const byte *bytes, size_t size);
+  bool refuse(const char *field);
+};
+
+#endif /* ELFEDITOR_HPP */
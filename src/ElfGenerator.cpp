@@ -0,0 +1,467 @@
+#include "ElfGenerator.hpp"
+#include "elf32.hpp"
+#include "machines.hpp"
+#include "section_attribute_flags.hpp"
+#include "section_types.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <functional>
+#include <string_view>
+#include <unistd.h>
+
+namespace {
+
+enum random_stream
+{
+  RS_SECTION = 1,
+  RS_SYMBOL,
+  RS_RELOCATION,
+};
+
+/**
+ * @brief splitmix64 of the seed, the stream and an index, so anything can be
+ *        regenerated on its own
+ */
+uint64_t mix(uint64_t seed, random_stream stream, uint64_t index)
+{
+  uint64_t z = seed * 0xd1b54a32d192ed03 + static_cast<uint64_t>(stream) * 0xabc98388fb8fac03 + index;
+  z += 0x9e3779b97f4a7c15;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+enum payload_kind
+{
+  PK_TEXT,
+  PK_DATA,
+  PK_RODATA,
+};
+
+constexpr std::string_view PAYLOAD_PREFIX[] = { ".text.s", ".data.s", ".rodata.s" };
+constexpr uint64_t PAYLOAD_ALIGN = 16;
+constexpr uint64_t PAGE = 0x1000;
+
+uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+uint64_t decimal_digits(uint64_t value)
+{
+  uint64_t digits = 1;
+  while (value >= 10) {
+    value /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+/**
+ * @brief Offsets of everything, worked out before a byte is written
+ */
+struct plan
+{
+  generator_options options;
+  uint64_t word;
+  uint64_t ehsize;
+  uint64_t phentsize;
+  uint64_t shentsize;
+  uint64_t symentsize;
+  uint64_t relentsize;
+  uint64_t base;// virtual address of offset 0 for ET_EXEC
+  uint64_t segment_count;
+  std::vector<uint64_t> payload_offsets;
+  uint64_t symtab_offset;
+  uint64_t strtab_offset;
+  uint64_t strtab_size;
+  uint64_t shndx_offset;
+  uint64_t relocation_offset;
+  uint64_t shstrtab_offset;
+  uint64_t shstrtab_size;
+  uint64_t shoff;
+  uint64_t symtab_index;
+  uint64_t shndx_index;// 0 when there is no SHT_SYMTAB_SHNDX
+  uint64_t relocation_index;// 0 when there are no relocations
+  uint64_t shstrtab_index;
+  generated_layout layout;
+
+  payload_kind kind(uint64_t section) const { return static_cast<payload_kind>(mix(options.seed, RS_SECTION, section) % 3); }
+  uint64_t size(uint64_t section) const { return 16 + (mix(options.seed, RS_SECTION, section) >> 8) % 241; }
+  uint64_t offset(uint64_t section) const { return payload_offsets[section - 1]; }
+  uint64_t address(uint64_t section) const { return segment_count > 0 ? base + offset(section) : 0; }
+  uint64_t symtab_size() const { return (options.symbols + 1) * symentsize; }
+  uint64_t local_count() const { return options.symbols / 10; }
+};
+
+/**
+ * @brief Name of symbol index, averaging options.name_length characters
+ */
+void symbol_name(const generator_options &options, uint64_t index, std::string &name)
+{
+  static constexpr std::string_view prefixes[] = { "_ZN4core", "_ZNSt6vector", "_ZN3elf6Reader", "_ZNK3app7Session", "fn_", "g_" };
+  uint64_t r = mix(options.seed, RS_SYMBOL, index);
+  name = prefixes[r % 6];
+  name += std::to_string(index);
+  uint64_t target = options.name_length / 2 + (r >> 8) % (options.name_length + 1);
+  if (name.size() < target) name.append(target - name.size(), static_cast<char>('a' + (r >> 16) % 26));
+}
+
+plan make_plan(const generator_options &options)
+{
+  plan p{};
+  p.options = options;
+  p.word = options.is64 ? 8 : 4;
+  p.ehsize = options.is64 ? 64 : 52;
+  p.phentsize = options.is64 ? 56 : 32;
+  p.shentsize = options.is64 ? 64 : 40;
+  p.symentsize = options.is64 ? 24 : 16;
+  p.relentsize = options.is64 ? 24 : 8;
+  p.base = options.is64 ? 0x400000 : 0x8048000;
+  p.segment_count = std::min(options.segments, options.sections);
+  if (options.sections == 0) p.options.relocations = 0;
+
+  // section 0, the payload, .symtab, .strtab, the relocations and .shstrtab
+  uint64_t count = 1 + options.sections + 2 + (p.options.relocations > 0 ? 1 : 0) + 1;
+  bool extended = count >= SHN_LORESERVE;
+  if (extended) count++;// .symtab_shndx
+  p.symtab_index = options.sections + 1;
+  uint64_t next = p.symtab_index + 2;
+  if (extended) p.shndx_index = next++;
+  if (p.options.relocations > 0) p.relocation_index = next++;
+  p.shstrtab_index = next;
+
+  uint64_t offset = p.ehsize + p.segment_count * p.phentsize;
+  p.payload_offsets.reserve(options.sections);
+  uint64_t shstrtab_size = 1;
+  for (uint64_t ii = 1; ii <= options.sections; ii++) {
+    offset = align_up(offset, PAYLOAD_ALIGN);
+    p.payload_offsets.push_back(offset);
+    offset += p.size(ii);
+    shstrtab_size += PAYLOAD_PREFIX[p.kind(ii)].size() + decimal_digits(ii) + 1;
+  }
+  p.symtab_offset = align_up(offset, p.word);
+  p.strtab_offset = p.symtab_offset + p.symtab_size();
+  p.strtab_size = 1;
+  std::string name;
+  for (uint64_t ii = 1; ii <= options.symbols; ii++) {
+    symbol_name(options, ii, name);
+    p.strtab_size += name.size() + 1;
+  }
+  offset = p.strtab_offset + p.strtab_size;
+  if (p.shndx_index != 0) {
+    p.shndx_offset = align_up(offset, 4);
+    offset = p.shndx_offset + (options.symbols + 1) * 4;
+  }
+  if (p.relocation_index != 0) {
+    p.relocation_offset = align_up(offset, p.word);
+    offset = p.relocation_offset + p.options.relocations * p.relentsize;
+  }
+  p.shstrtab_offset = offset;
+  shstrtab_size += sizeof(".symtab") + sizeof(".strtab") + sizeof(".shstrtab");
+  if (p.shndx_index != 0) shstrtab_size += sizeof(".symtab_shndx");
+  if (p.relocation_index != 0) shstrtab_size += options.is64 ? sizeof(".rela.text") : sizeof(".rel.text");
+  p.shstrtab_size = shstrtab_size;
+  p.shoff = align_up(p.shstrtab_offset + p.shstrtab_size, p.word);
+  p.layout = { p.shoff + count * p.shentsize, count, p.strtab_size, extended };
+  return p;
+}
+
+/**
+ * @brief Buffers fields in the byte order of the file and hands them on a
+ *        megabyte at a time
+ */
+class chunk_writer
+{
+public:
+  chunk_writer(std::function<bool(const byte *, size_t)> sink, bool msb) : sink(std::move(sink)), msb(msb), written(0), failed(false)
+  {
+    buffer.reserve(CHUNK + 64);
+  }
+
+  void put(uint64_t value, size_t width)
+  {
+    for (size_t ii = 0; ii < width; ii++) {
+      buffer.push_back(static_cast<byte>(value >> (8 * (msb ? width - ii - 1 : ii))));
+    }
+    if (buffer.size() >= CHUNK) flush();
+  }
+
+  void text(std::string_view value)
+  {
+    buffer.insert(buffer.end(), value.begin(), value.end());
+    buffer.push_back(0);
+    if (buffer.size() >= CHUNK) flush();
+  }
+
+  void pad_to(uint64_t offset)
+  {
+    while (position() < offset) {
+      buffer.push_back(0);
+      if (buffer.size() >= CHUNK) flush();
+    }
+  }
+
+  uint64_t position() const { return written + buffer.size(); }
+
+  bool flush()
+  {
+    if (!buffer.empty() && !failed) failed = !sink(buffer.data(), buffer.size());
+    written += buffer.size();
+    buffer.clear();
+    return !failed;
+  }
+
+private:
+  static constexpr size_t CHUNK = 1 << 20;
+  std::function<bool(const byte *, size_t)> sink;
+  std::vector<byte> buffer;
+  bool msb;
+  uint64_t written;
+  bool failed;
+};
+
+void write_header(chunk_writer &w, const plan &p)
+{
+  auto &o = p.options;
+  for (byte b : { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3 }) {
+    w.put(b, 1);
+  }
+  w.put(o.is64 ? ELFCLASS64 : ELFCLASS32, 1);
+  w.put(o.msb ? ELFDATA2MSB : ELFDATA2LSB, 1);
+  w.put(EV_CURRENT, 1);
+  w.pad_to(EI_NIDENT);
+  w.put(p.segment_count > 0 ? ET_EXEC : ET_REL, 2);
+  w.put(o.is64 ? (o.msb ? EM_PPC64 : EM_X86_64) : (o.msb ? EM_PPC : EM_386), 2);
+  w.put(EV_CURRENT, 4);
+  w.put(p.segment_count > 0 ? p.address(1) : 0, p.word);
+  w.put(p.segment_count > 0 ? p.ehsize : 0, p.word);
+  w.put(p.shoff, p.word);
+  w.put(0, 4);
+  w.put(p.ehsize, 2);
+  w.put(p.phentsize, 2);
+  w.put(std::min<uint64_t>(p.segment_count, PN_XNUM), 2);
+  w.put(p.shentsize, 2);
+  w.put(p.layout.extended ? 0 : p.layout.section_count, 2);
+  w.put(p.shstrtab_index >= SHN_LORESERVE ? SHN_XINDEX : p.shstrtab_index, 2);
+}
+
+void write_segments(chunk_writer &w, const plan &p)
+{
+  uint64_t sections = p.options.sections;
+  for (uint64_t ii = 0; ii < p.segment_count; ii++) {
+    uint64_t first = 1 + ii * sections / p.segment_count;
+    uint64_t last = (ii + 1) * sections / p.segment_count;
+    uint64_t flags = PF_R;
+    for (uint64_t jj = first; jj <= last; jj++) {
+      flags |= p.kind(jj) == PK_TEXT ? PF_X : p.kind(jj) == PK_DATA ? PF_W : 0;
+    }
+    // the first segment maps the headers too, as in a linked executable
+    uint64_t offset = ii == 0 ? 0 : p.offset(first);
+    uint64_t size = p.offset(last) + p.size(last) - offset;
+    w.put(PT_LOAD, 4);
+    if (p.options.is64) w.put(flags, 4);
+    w.put(offset, p.word);
+    w.put(p.base + offset, p.word);
+    w.put(p.base + offset, p.word);
+    w.put(size, p.word);
+    w.put(size, p.word);
+    if (!p.options.is64) w.put(flags, 4);
+    w.put(PAGE, p.word);
+  }
+}
+
+void write_payload(chunk_writer &w, const plan &p)
+{
+  for (uint64_t ii = 1; ii <= p.options.sections; ii++) {
+    w.pad_to(p.offset(ii));
+    uint64_t size = p.size(ii);
+    for (uint64_t jj = 0; jj < size; jj++) {
+      w.put((ii + jj) & 0xff, 1);
+    }
+  }
+}
+
+/**
+ * @brief Section of symbol index, its fields are derived from it
+ */
+uint64_t symbol_section(const plan &p, uint64_t index)
+{
+  if (p.options.sections == 0) return SHN_ABS;
+  return 1 + mix(p.options.seed, RS_SYMBOL, index) % p.options.sections;
+}
+
+void write_symbols(chunk_writer &w, const plan &p)
+{
+  w.pad_to(p.symtab_offset + p.symentsize);
+  uint64_t name = 1;
+  std::string text;
+  for (uint64_t ii = 1; ii <= p.options.symbols; ii++) {
+    uint64_t r = mix(p.options.seed, RS_SYMBOL, ii);
+    uint64_t section = symbol_section(p, ii);
+    bool defined = section != SHN_ABS;
+    byte binding = ii <= p.local_count() ? STB_LOCAL : STB_GLOBAL;
+    byte type = defined && p.kind(section) == PK_TEXT ? STT_FUNC : STT_OBJECT;
+    byte info = static_cast<byte>((binding << 4) | type);
+    uint64_t value = defined ? p.address(section) + (r >> 20) % p.size(section) : r >> 20;
+    uint64_t size = (r >> 40) % 64;
+    uint64_t shndx = section >= SHN_LORESERVE && section != SHN_ABS ? SHN_XINDEX : section;
+    if (p.options.is64) {
+      w.put(name, 4);
+      w.put(info, 1);
+      w.put(0, 1);
+      w.put(shndx, 2);
+      w.put(value, 8);
+      w.put(size, 8);
+    } else {
+      w.put(name, 4);
+      w.put(value, 4);
+      w.put(size, 4);
+      w.put(info, 1);
+      w.put(0, 1);
+      w.put(shndx, 2);
+    }
+    symbol_name(p.options, ii, text);
+    name += text.size() + 1;
+  }
+
+  w.put(0, 1);
+  for (uint64_t ii = 1; ii <= p.options.symbols; ii++) {
+    symbol_name(p.options, ii, text);
+    w.text(text);
+  }
+
+  if (p.shndx_index == 0) return;
+  w.pad_to(p.shndx_offset);
+  w.put(0, 4);
+  for (uint64_t ii = 1; ii <= p.options.symbols; ii++) {
+    uint64_t section = symbol_section(p, ii);
+    w.put(section >= SHN_LORESERVE && section != SHN_ABS ? section : 0, 4);
+  }
+}
+
+void write_relocations(chunk_writer &w, const plan &p)
+{
+  if (p.relocation_index == 0) return;
+  w.pad_to(p.relocation_offset);
+  uint64_t symbols = p.options.symbols;
+  if (!p.options.is64) symbols = std::min<uint64_t>(symbols, 0xffffff);
+  for (uint64_t ii = 0; ii < p.options.relocations; ii++) {
+    uint64_t r = mix(p.options.seed, RS_RELOCATION, ii);
+    uint64_t offset = p.address(1) + r % p.size(1);
+    uint64_t symbol = symbols > 0 ? 1 + (r >> 16) % symbols : 0;
+    uint64_t type = 1 + (r >> 8) % 2;
+    if (p.options.is64) {
+      w.put(offset, 8);
+      w.put(symbol << 32 | type, 8);
+      w.put(static_cast<uint64_t>(static_cast<int64_t>(r >> 48) - 0x8000), 8);
+    } else {
+      w.put(offset, 4);
+      w.put(symbol << 8 | type, 4);
+    }
+  }
+}
+
+void write_section_headers(chunk_writer &w, const plan &p)
+{
+  auto &o = p.options;
+  w.pad_to(p.shstrtab_offset);
+  w.put(0, 1);
+  for (uint64_t ii = 1; ii <= o.sections; ii++) {
+    w.text(std::string(PAYLOAD_PREFIX[p.kind(ii)]) + std::to_string(ii));
+  }
+  // the names are written in section order, sh_name follows the same order
+  w.text(".symtab");
+  w.text(".strtab");
+  if (p.shndx_index != 0) w.text(".symtab_shndx");
+  if (p.relocation_index != 0) w.text(o.is64 ? ".rela.text" : ".rel.text");
+  w.text(".shstrtab");
+
+  w.pad_to(p.shoff);
+  auto section = [&](uint64_t name, uint64_t type, uint64_t flags, uint64_t address, uint64_t offset, uint64_t size, uint64_t link, uint64_t info, uint64_t align, uint64_t entsize) {
+    w.put(name, 4);
+    w.put(type, 4);
+    w.put(flags, p.word);
+    w.put(address, p.word);
+    w.put(offset, p.word);
+    w.put(size, p.word);
+    w.put(link, 4);
+    w.put(info, 4);
+    w.put(align, p.word);
+    w.put(entsize, p.word);
+  };
+  uint64_t phnum = p.segment_count >= PN_XNUM ? p.segment_count : 0;
+  section(0, SHT_NULL, 0, 0, 0, p.layout.extended ? p.layout.section_count : 0, p.shstrtab_index >= SHN_LORESERVE ? uint64_t{ p.shstrtab_index } : uint64_t{ 0 }, phnum, 0, 0);
+  uint64_t name = 1;
+  for (uint64_t ii = 1; ii <= o.sections; ii++) {
+    auto kind = p.kind(ii);
+    uint64_t flags = kind == PK_TEXT ? uint64_t{ SHF_EXECINSTR } : kind == PK_DATA ? uint64_t{ SHF_WRITE } : uint64_t{ 0 };
+    if (p.segment_count > 0) flags |= SHF_ALLOC;
+    section(name, SHT_PROGBITS, flags, p.address(ii), p.offset(ii), p.size(ii), 0, 0, PAYLOAD_ALIGN, 0);
+    name += PAYLOAD_PREFIX[kind].size() + decimal_digits(ii) + 1;
+  }
+  uint64_t strtab_index = p.symtab_index + 1;
+  section(name, SHT_SYMTAB, 0, 0, p.symtab_offset, p.symtab_size(), strtab_index, p.local_count() + 1, p.word, p.symentsize);
+  name += sizeof(".symtab");
+  section(name, SHT_STRTAB, 0, 0, p.strtab_offset, p.strtab_size, 0, 0, 1, 0);
+  name += sizeof(".strtab");
+  if (p.shndx_index != 0) {
+    section(name, SHT_SYMTAB_SHNDX, 0, 0, p.shndx_offset, (o.symbols + 1) * 4, p.symtab_index, 0, 4, 4);
+    name += sizeof(".symtab_shndx");
+  }
+  if (p.relocation_index != 0) {
+    section(name, o.is64 ? SHT_RELA : SHT_REL, SHF_INFO_LINK, 0, p.relocation_offset, o.relocations * p.relentsize, p.symtab_index, 1, p.word, p.relentsize);
+    name += o.is64 ? sizeof(".rela.text") : sizeof(".rel.text");
+  }
+  section(name, SHT_STRTAB, 0, 0, p.shstrtab_offset, p.shstrtab_size, 0, 0, 1, 0);
+}
+
+bool generate(const generator_options &options, std::function<bool(const byte *, size_t)> sink)
+{
+  auto p = make_plan(options);
+  chunk_writer w(std::move(sink), options.msb);
+  write_header(w, p);
+  write_segments(w, p);
+  write_payload(w, p);
+  write_symbols(w, p);
+  write_relocations(w, p);
+  write_section_headers(w, p);
+  return w.flush();
+}
+
+}// namespace
+
+
+generated_layout plan_elf(const generator_options &options)
+{
+  return make_plan(options).layout;
+}
+
+bool write_generated_elf(const std::string &filename, const generator_options &options)
+{
+  int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  bool written = generate(options, [fd](const byte *data, size_t size) {
+    while (size > 0) {
+      auto count = ::write(fd, data, size);
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return false;
+      data += count;
+      size -= static_cast<size_t>(count);
+    }
+    return true;
+  });
+  return ::close(fd) == 0 && written;
+}
+
+std::vector<byte> generate_elf(const generator_options &options)
+{
+  std::vector<byte> out;
+  out.reserve(plan_elf(options).file_size);
+  generate(options, [&out](const byte *data, size_t size) {
+    out.insert(out.end(), data, data + size);
+    return true;
+  });
+  return out;
+}
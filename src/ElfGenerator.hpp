@@ -0,0 +1,53 @@
+#ifndef ELFGENERATOR_HPP
+#define ELFGENERATOR_HPP
+
+#include "elf_common.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief What generate_elf() puts in a file
+ */
+struct generator_options
+{
+  bool is64 = true;
+  bool msb = false;
+  uint64_t sections = 16;// .text/.data/.rodata payload sections, 65280 or more need extended numbering
+  uint64_t symbols = 1000;// not counting the null symbol
+  uint64_t relocations = 0;// against the first payload section, SHT_RELA for ELF64 and SHT_REL for ELF32
+  uint64_t segments = 0;// PT_LOAD segments over the payload, the file is then ET_EXEC rather than ET_REL
+  uint64_t name_length = 24;// average symbol name length, sizes the string table
+  uint64_t seed = 1;
+};
+
+/**
+ * @brief Sizes of the file generate_elf() writes for a set of options
+ */
+struct generated_layout
+{
+  uint64_t file_size;
+  uint64_t section_count;// including section 0 and the tables
+  uint64_t string_table_size;
+  bool extended;// e_shnum and e_shstrndx are in section 0
+};
+
+/**
+ * @brief Write a valid ELF file of any size in either class and byte order.
+ *
+ * The file is the same for the same options on every machine.  Names, sizes
+ * and values come from splitmix64 seeded with the index of what they belong
+ * to, so nothing is kept in memory: the string table is sized by generating
+ * the names once, and written by generating them again.  Files with millions
+ * of symbols or sections are written at the speed of the disk.
+ *
+ * Sections are numbered: 0, the payload, .symtab, .strtab, .symtab_shndx
+ * when there are SHN_LORESERVE sections or more, .rela.text or .rel.text
+ * with relocations, and .shstrtab last, so with extended numbering both
+ * e_shnum and e_shstrndx are in section 0.
+ */
+generated_layout plan_elf(const generator_options &options);
+bool write_generated_elf(const std::string &filename, const generator_options &options);
+std::vector<byte> generate_elf(const generator_options &options);
+
+#endif /* ELFGENERATOR_HPP */
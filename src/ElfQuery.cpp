@@ -0,0 +1,247 @@
+#include "ElfQuery.hpp"
+#include "SymbolTable.hpp"
+#include <algorithm>
+
+
+std::vector<symbol_view> ElfQuery::find_symbol(std::string_view name) const
+{
+  size_t low = 0;
+  size_t high = name_order_count();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (symbol(name_order(middle)).name < name) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  std::vector<symbol_view> found;
+  for (; low < name_order_count(); low++) {
+    auto sym = symbol(name_order(low));
+    if (sym.name != name) break;
+    found.push_back(sym);
+  }
+  return found;
+}
+
+std::optional<symbol_view> ElfQuery::symbol_for_address(ELF_ULONG address) const
+{
+  // the address order has no overlaps, only the last start at or below the
+  // address can hold it
+  size_t low = 0;
+  size_t high = address_order_count();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (symbol(address_order(middle)).value <= address) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) return std::nullopt;
+  auto sym = symbol(address_order(low - 1));
+  if (address - sym.value >= sym.size) return std::nullopt;
+  return sym;
+}
+
+std::optional<section_view> ElfQuery::section_for_address(ELF_ULONG address) const
+{
+  size_t low = 0;
+  size_t high = section_order_count();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (section(section_order(middle)).address <= address) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) return std::nullopt;
+  auto sh = section(section_order(low - 1));
+  if (address - sh.address >= sh.size) return std::nullopt;
+  return sh;
+}
+
+std::optional<Elf_Phdr> ElfQuery::segment_for_address(ELF_ULONG address) const
+{
+  size_t low = 0;
+  size_t high = segment_order_count();
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (segment(segment_order(middle)).p_vaddr <= address) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == 0) return std::nullopt;
+  auto p = segment(segment_order(low - 1));
+  if (address - p.p_vaddr >= p.p_memsz) return std::nullopt;
+  return p;
+}
+
+
+symbol_entries collect_symbols(const ElfReader &elf)
+{
+  symbol_entries symbols;
+  for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+    auto table = elf.get_symbol_table(ii);
+    if (table == nullptr) continue;
+    for (auto &sym : table->entries) {
+      symbols.emplace_back(ii, &sym);
+    }
+  }
+  return symbols;
+}
+
+std::vector<uint32_t> build_name_order(const symbol_entries &symbols)
+{
+  std::vector<uint32_t> by_name;
+  for (uint32_t ii = 0; ii < symbols.size(); ii++) {
+    if (!symbols[ii].second->name.empty()) by_name.push_back(ii);
+  }
+  std::stable_sort(by_name.begin(), by_name.end(), [&symbols](uint32_t a, uint32_t b) { return symbols[a].second->name < symbols[b].second->name; });
+  return by_name;
+}
+
+std::vector<uint32_t> build_address_order(const ElfReader &elf, const symbol_entries &symbols)
+{
+  std::vector<uint32_t> by_address;
+  if (elf.header.e_type == ET_REL) return by_address;
+  std::vector<uint32_t> candidates;
+  for (uint32_t ii = 0; ii < symbols.size(); ii++) {
+    auto &sym = *symbols[ii].second;
+    auto type = ELF64_ST_TYPE(sym.st_info);
+    if (sym.st_size == 0 || sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE) continue;
+    if (type == STT_SECTION || type == STT_FILE || type == STT_TLS) continue;
+    candidates.push_back(ii);
+  }
+  // largest first at the same start, and globals before the local aliases
+  std::stable_sort(candidates.begin(), candidates.end(), [&symbols](uint32_t a, uint32_t b) {
+    auto &x = *symbols[a].second;
+    auto &y = *symbols[b].second;
+    if (x.st_value != y.st_value) return x.st_value < y.st_value;
+    if (x.st_size != y.st_size) return x.st_size > y.st_size;
+    return (ELF64_ST_BIND(x.st_info) == STB_LOCAL) < (ELF64_ST_BIND(y.st_info) == STB_LOCAL);
+  });
+  ELF_ULONG end = 0;
+  for (auto ii : candidates) {
+    auto &sym = *symbols[ii].second;
+    if (!by_address.empty() && sym.st_value < end) continue;
+    by_address.push_back(ii);
+    end = sym.st_value + sym.st_size;
+  }
+  return by_address;
+}
+
+std::vector<uint32_t> build_section_order(const ElfReader &elf)
+{
+  std::vector<uint32_t> sections_by_address;
+  if (elf.header.e_type == ET_REL) return sections_by_address;
+  for (uint32_t ii = 0; ii < elf.section_headers.size(); ii++) {
+    auto &sh = elf.section_headers[ii];
+    if ((sh.sh_flags & SHF_ALLOC) == 0 || (sh.sh_flags & SHF_TLS) != 0 || sh.sh_size == 0) continue;
+    sections_by_address.push_back(ii);
+  }
+  std::stable_sort(sections_by_address.begin(), sections_by_address.end(), [&elf](uint32_t a, uint32_t b) { return elf.section_headers[a].sh_addr < elf.section_headers[b].sh_addr; });
+  return sections_by_address;
+}
+
+std::vector<uint32_t> build_segment_order(const ElfReader &elf)
+{
+  std::vector<uint32_t> segments_by_address;
+  if (elf.header.e_type == ET_REL) return segments_by_address;
+  for (uint32_t ii = 0; ii < elf.program_headers.size(); ii++) {
+    auto &p = elf.program_headers[ii];
+    if (p.p_type == PT_LOAD && p.p_memsz != 0) segments_by_address.push_back(ii);
+  }
+  std::stable_sort(segments_by_address.begin(), segments_by_address.end(), [&elf](uint32_t a, uint32_t b) { return elf.program_headers[a].p_vaddr < elf.program_headers[b].p_vaddr; });
+  return segments_by_address;
+}
+
+
+ElfIndex::ElfIndex(const ElfReader &elf) : elf(elf), symbols(collect_symbols(elf)), by_name(build_name_order(symbols)), by_address(build_address_order(elf, symbols)), sections_by_address(build_section_order(elf)), segments_by_address(build_segment_order(elf))
+{
+}
+
+uint64_t ElfIndex::get_file_size() const
+{
+  return elf.filesize;
+}
+
+const Elf_Ehdr &ElfIndex::get_header() const
+{
+  return elf.header;
+}
+
+size_t ElfIndex::section_count() const
+{
+  return elf.section_headers.size();
+}
+
+section_view ElfIndex::section(size_t index) const
+{
+  auto &sh = elf.section_headers[index];
+  return { index, sh.name, sh.sh_type, sh.sh_flags, sh.sh_addr, sh.sh_offset, sh.sh_size, sh.sh_link, sh.sh_info, sh.sh_addralign, sh.sh_entsize };
+}
+
+size_t ElfIndex::segment_count() const
+{
+  return elf.program_headers.size();
+}
+
+Elf_Phdr ElfIndex::segment(size_t index) const
+{
+  return elf.program_headers[index];
+}
+
+size_t ElfIndex::symbol_count() const
+{
+  return symbols.size();
+}
+
+symbol_view ElfIndex::symbol(size_t index) const
+{
+  auto &sym = *symbols[index].second;
+  return { index, symbols[index].first, sym.name, sym.st_value, sym.st_size, sym.st_info, sym.st_other, sym.st_shndx };
+}
+
+size_t ElfIndex::name_order_count() const
+{
+  return by_name.size();
+}
+
+size_t ElfIndex::name_order(size_t position) const
+{
+  return by_name[position];
+}
+
+size_t ElfIndex::address_order_count() const
+{
+  return by_address.size();
+}
+
+size_t ElfIndex::address_order(size_t position) const
+{
+  return by_address[position];
+}
+
+size_t ElfIndex::section_order_count() const
+{
+  return sections_by_address.size();
+}
+
+size_t ElfIndex::section_order(size_t position) const
+{
+  return sections_by_address[position];
+}
+
+size_t ElfIndex::segment_order_count() const
+{
+  return segments_by_address.size();
+}
+
+size_t ElfIndex::segment_order(size_t position) const
+{
+  return segments_by_address[position];
+}
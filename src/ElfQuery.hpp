@@ -0,0 +1,143 @@
+#ifndef ELFQUERY_HPP
+#define ELFQUERY_HPP
+
+#include "ElfReader.hpp"
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+struct section_view
+{
+  size_t index;
+  std::string_view name;
+  ELF_ULONG type;
+  ELF_ULONG flags;
+  ELF_ULONG address;
+  ELF_ULONG offset;
+  ELF_ULONG size;
+  ELF_ULONG link;
+  ELF_ULONG info;
+  ELF_ULONG addralign;
+  ELF_ULONG entsize;
+};
+
+struct symbol_view
+{
+  size_t index;// position in symbol order, all tables one after another
+  size_t table;// section index of the symbol table
+  std::string_view name;
+  ELF_ULONG value;
+  ELF_ULONG size;
+  uint8_t info;
+  uint8_t other;
+  ELF_ULONG shndx;
+};
+
+/**
+ * @brief Lookups by name and by address over a parsed file.
+ *
+ * The searches are written once here against a handful of accessors, ElfIndex
+ * answers them from a live ElfReader and ElfSnapshot from a mapped snapshot,
+ * so both give the same answers.
+ *
+ * Four orders are kept: every named symbol by name, and for linked files the
+ * defined symbols, the SHF_ALLOC sections and the PT_LOAD segments by address.
+ * A symbol that lies inside an earlier one (a local label in a function) is
+ * left out of the address order, a lookup finds the enclosing symbol.
+ * Relocatable files have no addresses and their address orders are empty.
+ */
+class ElfQuery
+{
+public:
+  virtual ~ElfQuery() = default;
+
+  virtual uint64_t get_file_size() const = 0;
+  virtual const Elf_Ehdr &get_header() const = 0;
+  virtual size_t section_count() const = 0;
+  virtual section_view section(size_t index) const = 0;
+  virtual size_t segment_count() const = 0;
+  virtual Elf_Phdr segment(size_t index) const = 0;
+  virtual size_t symbol_count() const = 0;
+  virtual symbol_view symbol(size_t index) const = 0;
+
+  /**
+   * @brief Every symbol with exactly this name, in symbol order
+   */
+  std::vector<symbol_view> find_symbol(std::string_view name) const;
+
+  /**
+   * @brief The defined symbol whose [st_value, st_value + st_size) holds address
+   */
+  std::optional<symbol_view> symbol_for_address(ELF_ULONG address) const;
+  std::optional<section_view> section_for_address(ELF_ULONG address) const;
+  std::optional<Elf_Phdr> segment_for_address(ELF_ULONG address) const;
+
+  friend bool write_snapshot(const ElfQuery &query, const std::string &filename);
+
+protected:
+  // positions in the four orders, as symbol, section or segment indexes
+  virtual size_t name_order_count() const = 0;
+  virtual size_t name_order(size_t position) const = 0;
+  virtual size_t address_order_count() const = 0;
+  virtual size_t address_order(size_t position) const = 0;
+  virtual size_t section_order_count() const = 0;
+  virtual size_t section_order(size_t position) const = 0;
+  virtual size_t segment_order_count() const = 0;
+  virtual size_t segment_order(size_t position) const = 0;
+};
+
+/**
+ * @brief Every entry of the parsed symbol tables, as section index of the
+ *        table and entry, in symbol order
+ */
+using symbol_entries = std::vector<std::pair<size_t, const Elf_Sym *>>;
+
+symbol_entries collect_symbols(const ElfReader &elf);
+
+// the four orders of ElfQuery over a parsed file
+std::vector<uint32_t> build_name_order(const symbol_entries &symbols);
+std::vector<uint32_t> build_address_order(const ElfReader &elf, const symbol_entries &symbols);
+std::vector<uint32_t> build_section_order(const ElfReader &elf);
+std::vector<uint32_t> build_segment_order(const ElfReader &elf);
+
+/**
+ * @brief ElfQuery over a live ElfReader, the orders are built on construction
+ *
+ * The reader must outlive the index.  Only the tables the reader parsed are
+ * indexed.
+ */
+class ElfIndex : public ElfQuery
+{
+public:
+  explicit ElfIndex(const ElfReader &elf);
+
+  uint64_t get_file_size() const override;
+  const Elf_Ehdr &get_header() const override;
+  size_t section_count() const override;
+  section_view section(size_t index) const override;
+  size_t segment_count() const override;
+  Elf_Phdr segment(size_t index) const override;
+  size_t symbol_count() const override;
+  symbol_view symbol(size_t index) const override;
+
+protected:
+  size_t name_order_count() const override;
+  size_t name_order(size_t position) const override;
+  size_t address_order_count() const override;
+  size_t address_order(size_t position) const override;
+  size_t section_order_count() const override;
+  size_t section_order(size_t position) const override;
+  size_t segment_order_count() const override;
+  size_t segment_order(size_t position) const override;
+
+private:
+  const ElfReader &elf;
+  symbol_entries symbols;
+  std::vector<uint32_t> by_name;
+  std::vector<uint32_t> by_address;
+  std::vector<uint32_t> sections_by_address;
+  std::vector<uint32_t> segments_by_address;
+};
+
+#endif /* ELFQUERY_HPP */
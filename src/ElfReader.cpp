@@ -3,6 +3,8 @@
 #include "Elf_Program_Header_Fields.hpp"
 #include "Elf_Section_Header_Fields.hpp"
 #include "Elf_Sym.hpp"
+#include "ElfValidator.hpp"
+#include "ParseCache.hpp"
 #include "StringTable.hpp"
 #include "SymbolTable.hpp"
 #include "elf.hpp"
@@ -10,36 +12,77 @@
 #include "osabi.hpp"
 #include "section_attribute_flags.hpp"
 #include "section_types.hpp"
+#include <algorithm>
 
 
-ElfReader::ElfReader(container_ref bytes) : bytes(bytes) { init(); };
-ElfReader::ElfReader(const std::string filename)
+ElfReader::ElfReader(container_ref bytes, ParseOptions options) : bytes(bytes), options(options)
 {
-  std::ifstream elf_file(filename, std::ios::in | std::ios::binary);
-  try {
-    if (elf_file.is_open()) {
-      // this is required otherwise when we read it in we do not get the
-      // newline characters and our array comes up short.
-      elf_file.unsetf(std::ios::skipws);
-
-      // get the filesize by moving to the end of the file and back again
-      elf_file.seekg(0, std::ios::end);
-      filesize = elf_file.tellg();
-      elf_file.seekg(0, std::ios::beg);
+  data = this->bytes.data();
+  data_size = this->bytes.size();
+  filesize = data_size;
+  PhaseTimer validating(stats, PP_VALIDATE);
+  validation = validate_elf(data, data_size);
+  validating.stop();
+  init();
+};
+ElfReader::ElfReader(const std::string filename, ParseOptions options)
+  : ElfReader(std::make_shared<MappedFile>(filename), options, false)
+{
+}
 
-      // set our vector size accordingly and read in
-      bytes.reserve(filesize);
-      bytes.insert(bytes.begin(), std::istream_iterator<uint8_t>(elf_file), std::istream_iterator<uint8_t>());
-    }
-    elf_file.close();
-  } catch (const std::exception &ex) {
-    std::cout << ex.what() << std::endl;
-    elf_file.close();
-    return;
+ElfReader::ElfReader(std::shared_ptr<MappedFile> file, ParseOptions options, bool validated) : mapping(std::move(file)), options(options)
+{
+  // map rather than read the file, only the pages we decode are ever touched
+  // which keeps multi-GB core files cheap to open
+  data = mapping->data();
+  data_size = mapping->size();
+  filesize = data_size;
+  // open() only gets this far with a file that passed
+  if (validated) {
+    validation = elf_validation{ EE_NONE, 0 };
+  } else {
+    PhaseTimer validating(stats, PP_VALIDATE);
+    validation = validate_elf(data, data_size);
   }
   init();
 }
 
+elf_expected<ElfReader> ElfReader::open(const std::string &filename, ParseOptions options, parse_stats *rejected)
+{
+  // nothing is allocated until the file is known to be worth decoding
+  parse_stats opening;
+  PhaseTimer mapping_timer(opening, PP_OPEN);
+  MappedFile file(filename);
+  mapping_timer.stop();
+  if (!file.is_open()) {
+    if (rejected != nullptr) rejected->add(opening);
+    return elf_validation{ EE_OPEN_FAILED, 0 };
+  }
+  PhaseTimer validating(opening, PP_VALIDATE);
+  auto validation = validate_elf(file.data(), file.size());
+  validating.stop();
+  if (validation.error != EE_NONE) {
+    if (rejected != nullptr) rejected->add(opening);
+    return validation;
+  }
+  ElfReader elf(std::make_shared<MappedFile>(std::move(file)), options, true);
+  elf.stats.add(opening);
+  return elf;
+}
+
+elf_expected<ElfReader> ElfReader::open(std::shared_ptr<MappedFile> file, ParseOptions options)
+{
+  if (file == nullptr || !file->is_open()) return elf_validation{ EE_OPEN_FAILED, 0 };
+  parse_stats opening;
+  PhaseTimer validating(opening, PP_VALIDATE);
+  auto validation = validate_elf(file->data(), file->size());
+  validating.stop();
+  if (validation.error != EE_NONE) return validation;
+  ElfReader elf(std::move(file), options, true);
+  elf.stats.add(opening);
+  return elf;
+}
+
 bool ElfReader::is_32bit() const noexcept
 {
   return byte_size == ELFCLASS32;
@@ -50,9 +93,20 @@ bool ElfReader::is_64bit() const noexcept
   return byte_size == ELFCLASS64;
 }
 
+bool ElfReader::is_valid() const noexcept
+{
+  return validation.error == EE_NONE;
+}
+
+elf_validation ElfReader::get_validation() const noexcept
+{
+  return validation;
+}
+
 bool ElfReader::is_elf() const noexcept
 {
-  return bytes[EI_MAG0] == ELFMAG0 && bytes[EI_MAG1] == ELFMAG1 && bytes[EI_MAG2] == ELFMAG2 && bytes[EI_MAG3] == ELFMAG3;
+  if (data_size < EI_NIDENT) return false;
+  return data[EI_MAG0] == ELFMAG0 && data[EI_MAG1] == ELFMAG1 && data[EI_MAG2] == ELFMAG2 && data[EI_MAG3] == ELFMAG3;
 }
 
 /**
@@ -65,6 +119,47 @@ size_t ElfReader::get_section_count() const
   return section_headers.size();
 }
 
+const byte *ElfReader::get_bytes(ELF_ULONG offset, ELF_ULONG size) const
+{
+  if (offset > data_size || size > data_size - offset) return nullptr;
+  return data + offset;
+}
+
+const SectionTableInfo &ElfReader::get_section_table_info(size_t index) const
+{
+  static const SectionTableInfo empty;
+  if (index >= section_table_info.size()) return empty;
+  return *section_table_info[index];
+}
+
+const SymbolTable *ElfReader::get_symbol_table(size_t index) const
+{
+  if (index >= section_table_info.size()) return nullptr;
+  return dynamic_cast<const SymbolTable *>(section_table_info[index].get());
+}
+
+std::string ElfReader::get_build_id() const
+{
+  static constexpr char hex_digits[] = "0123456789abcdef";
+  for (auto &note : notes) {
+    if (note.n_type != NT_GNU_BUILD_ID || !note.is_gnu()) continue;
+    auto desc = get_bytes(note.desc_offset, note.n_descsz);
+    if (desc == nullptr) continue;
+    std::string id;
+    for (ELF_ULONG ii = 0; ii < note.n_descsz; ii++) {
+      id += hex_digits[desc[ii] >> 4];
+      id += hex_digits[desc[ii] & 0xf];
+    }
+    return id;
+  }
+  return {};
+}
+
+ELF_ULONG ElfReader::read_value(size_t offset, size_t count) const
+{
+  return read_bytes(offset, count);
+}
+
 /**
    * @brief Get the base address object
    * 
@@ -108,81 +203,115 @@ ELF_ULONG ElfReader::get_start_address() const
      */
 void ElfReader::init()
 {
+  section_count = 0;
+  names_index = SHN_UNDEF;
+  // everything below indexes the file unchecked, the validator makes that safe
+  if (validation.error == EE_NOT_ELF || validation.error == EE_BAD_CLASS || validation.error == EE_BAD_ENCODING || validation.error == EE_HEADER_TRUNCATED) {
+    byte_size = ELFCLASSNONE;
+    data_encoding = ELFDATANONE;
+    return;
+  }
   data_encoding = static_cast<uint32_t>(get_data_encoding());
   byte_size = static_cast<uint32_t>(get_class());
-  if (is_32bit()) {
-    if (data_encoding == ELFDATA2LSB) {
-      read_bytes = std::bind(&ElfReader::read_lsb64, this, std::placeholders::_1, std::placeholders::_2);
-    } else if (data_encoding == ELFDATA2MSB) {
-      read_bytes = std::bind(&ElfReader::read_msb64, this, std::placeholders::_1, std::placeholders::_2);
-    } else {
-      throw new std::runtime_error("no valid data encoding found");
+  read_elf_header();
+  // the header is fine but the tables are not, decode nothing else
+  if (!is_valid()) return;
+  section_count = header.e_shnum;
+  names_index = header.e_shstrndx;
+  if (header.e_shoff != 0) {
+    // extended numbering, values too large for the ELF header are in section 0
+    if (section_count == 0) section_count = read_section_zero(5);
+    if (names_index == SHN_XINDEX) names_index = read_section_zero(6);
+  }
+  bool cached = options.cache != nullptr && mapping != nullptr;
+  if (cached) {
+    // the notes give the build-id to look up, they are cheap to read first
+    read_program_headers();
+    read_notes();
+    PhaseTimer loading(stats, PP_CACHE);
+    if (options.cache->load(*this)) return;
+  }
+  // core files usually have no section header table at all
+  if (options.section_headers && header.e_shoff != 0 && section_count > 0) {
+    PhaseTimer decoding(stats, PP_SECTION_HEADERS);
+    std::vector<size_t> offsets;
+    offsets.reserve(section_count);
+    section_headers.reserve(section_count);
+    offsets.push_back(header.e_shoff);
+    for (size_t ii = 1; ii < section_count; ii++) {
+      offsets.push_back(header.e_shoff + (header.e_shentsize * ii));
     }
-  } else if (is_64bit()) {
-    if (data_encoding == ELFDATA2LSB) {
-      read_bytes = std::bind(&ElfReader::read_lsb64, this, std::placeholders::_1, std::placeholders::_2);
-    } else if (data_encoding == ELFDATA2MSB) {
-      read_bytes = std::bind(&ElfReader::read_msb64, this, std::placeholders::_1, std::placeholders::_2);
-    } else {
-      throw new std::runtime_error("no valid data encoding found");
+    for (auto offset : offsets) {
+      read_section_header(offset);
+    }
+    decoding.stop();
+    read_section_names();
+    if (options.symbol_tables || options.dynamic_symbols || options.string_tables) {
+      read_section_tables();
     }
-  } else {
-    // no class specified
-    return;
   }
-  read_elf_header();
-  std::vector<size_t> offsets;
-  size_t section_name_string_table_index;
-  offsets.push_back(header.e_shoff);
-  for (int ii = 1; ii < header.e_shnum; ii++) {
-    offsets.push_back(header.e_shoff + (header.e_shentsize * ii));
+  if (options.program_headers && !cached) {
+    read_program_headers();
   }
-  section_name_string_table_index = header.e_shstrndx;
-  for (auto offset : offsets) {
-    read_section_header(offset);
+  // relocatable files only have note sections, those need the section headers
+  if (options.notes && (!cached || notes.empty())) {
+    read_notes();
+  }
+  if (cached) {
+    PhaseTimer storing(stats, PP_CACHE);
+    options.cache->store(*this);
+    if (!options.program_headers) program_headers.clear();
+    if (!options.notes) notes.clear();
   }
-  assert(section_name_string_table_index < get_section_count());
-  read_section_names();
-  read_section_tables();
-  read_program_headers();
 }
 
 byte ElfReader::get_class() const
 {
-  return bytes[EI_CLASS];
+  return data[EI_CLASS];
 }
 
 byte ElfReader::get_data_encoding() const
 {
-  return bytes[EI_DATA];
+  return data[EI_DATA];
 }
 
 byte ElfReader::get_version() const
 {
-  return bytes[EI_VERSION];
+  return data[EI_VERSION];
 }
 
 byte ElfReader::get_osabi() const
 {
-  return bytes[EI_OSABI];
+  return data[EI_OSABI];
 }
 
 byte ElfReader::get_abiversion() const
 {
-  return bytes[EI_ABIVERSION];
+  return data[EI_ABIVERSION];
 }
 
 void ElfReader::read_symbol_table(Elf_Shdr section)
 {
-  std::cout << "Reading symbol table '" << section.name << "'\n";
+  if (options.verbose) std::cout << "Reading symbol table '" << section.name << "'\n";
   auto sti = std::make_unique<SymbolTable>();
   std::vector<Elf_Sym> entries;
+  // a filter keeps few of them
+  if (options.symbol_filter.empty()) entries.reserve(section.sh_size / section.sh_entsize);
   size_t start = section.sh_offset;
   size_t end = section.sh_offset + section.sh_size;
   size_t cursor = start;
   size_t fixed_cursor = cursor;
+  // with extended numbering a st_shndx of SHN_XINDEX means the index is in
+  // the SHT_SYMTAB_SHNDX section linked to this table
+  const Elf_Shdr *extended = nullptr;
+  for (auto &sh : section_headers) {
+    if (sh.sh_type != SHT_SYMTAB_SHNDX || sh.sh_link >= section_headers.size()) continue;
+    auto &linked = section_headers[sh.sh_link];
+    if (linked.sh_offset == section.sh_offset && linked.sh_type == section.sh_type) extended = &sh;
+  }
   while (cursor < end) {
     auto entry = Elf_Sym{};
+    size_t number = (fixed_cursor - start) / section.sh_entsize;
     cursor = fixed_cursor;
     if (is_64bit()) {
       entry.st_name = read_bytes(cursor, elf_symbol_table_fields[0].sz[byte_size] / SZ_UCHAR);
@@ -199,29 +328,42 @@ void ElfReader::read_symbol_table(Elf_Shdr section)
       entry.st_other = read_bytes(cursor, elf_symbol_table_fields[4].sz[byte_size] / SZ_UCHAR);
       entry.st_shndx = read_bytes(cursor, elf_symbol_table_fields[5].sz[byte_size] / SZ_UCHAR);
     }
+    if (entry.st_shndx == SHN_XINDEX && extended != nullptr && number < extended->sh_size / 4) {
+      size_t at = extended->sh_offset + number * 4;
+      entry.st_shndx = read_bytes(at, 4);
+    }
+    entry.index = number;
     entry.file_type = header.e_type;
-    if (section.get_associated_string_table() != 0) {
-      size_t ptr = section_headers[section.get_associated_string_table()].sh_offset + entry.st_name;
+    fixed_cursor += section.sh_entsize;
+    auto &strings = section_headers[section.get_associated_string_table()];
+    // the one field the validator can't check up front, a name outside the
+    // table is left empty
+    if (section.get_associated_string_table() != 0 && entry.st_name < strings.sh_size) {
+      size_t ptr = strings.sh_offset + entry.st_name;
       entry.name = read_from_string_table(ptr);
+      if (!options.symbol_filter.empty() && entry.name.find(options.symbol_filter) == std::string_view::npos) continue;
+    } else if (!options.symbol_filter.empty()) {
+      continue;
     }
-    entries.push_back(entry);
-    fixed_cursor += section.sh_entsize;
+    entries.push_back(std::move(entry));
   }
-  sti->entries = entries;
+  stats.count(PP_SECTION_TABLES, section.sh_size, entries.size());
+  sti->count = (end - start + section.sh_entsize - 1) / section.sh_entsize;
+  sti->entries = std::move(entries);
   section_table_info.push_back(std::move(sti));
 }
 
 void ElfReader::read_string_table(Elf_Shdr section)
 {
-  std::cout << "Reading string table '" << section.name << "'\n";
+  if (options.verbose) std::cout << "Reading string table '" << section.name << "'\n";
   auto sti = std::make_unique<StringTable>();
-  std::vector<std::string> entries;
+  std::vector<std::string_view> entries;
   size_t start = section.sh_offset;
   size_t end = section.sh_offset + section.sh_size;
   size_t cursor = start;
   while (cursor < end) {
     // skip through null pointers
-    while (bytes[cursor] == '\0') {
+    while (data[cursor] == '\0') {
       cursor++;
       if (cursor >= end) break;
     }
@@ -229,29 +371,28 @@ void ElfReader::read_string_table(Elf_Shdr section)
     // save start of new name
     auto start_cursor = cursor;
     // skip through everything but null to end of name
-    while (bytes[cursor] != '\0') {
+    while (data[cursor] != '\0') {
       cursor++;
       if (cursor >= end) break;
     }
     // save name
-    auto entry = std::string{ begin(bytes) + start_cursor, begin(bytes) + cursor };
-    entries.push_back(entry);
+    entries.emplace_back(reinterpret_cast<const char *>(data) + start_cursor, cursor - start_cursor);
   }
-  sti->entries = entries;
+  stats.count(PP_SECTION_TABLES, section.sh_size, entries.size());
+  sti->entries = std::move(entries);
   section_table_info.push_back(std::move(sti));
 }
 
 void ElfReader::read_section_tables()
 {
+  PhaseTimer timer(stats, PP_SECTION_TABLES);
   for (auto sh : section_headers) {
-    switch (sh.sh_type) {
-    case SHT_SYMTAB:
+    // skipped tables still get an entry so the indexes line up
+    if ((sh.sh_type == SHT_SYMTAB && options.symbol_tables) || (sh.sh_type == SHT_DYNSYM && options.dynamic_symbols)) {
       read_symbol_table(sh);
-      break;
-    case SHT_STRTAB:
+    } else if (sh.sh_type == SHT_STRTAB && options.string_tables) {
       read_string_table(sh);
-      break;
-    default:
+    } else {
       section_table_info.push_back(std::make_unique<SectionTableInfo>());
     }
   }
@@ -259,27 +400,29 @@ void ElfReader::read_section_tables()
 
 void ElfReader::read_section_names()
 {
-  auto string_section_header = section_headers[header.e_shstrndx];
-  size_t start = string_section_header.sh_offset;
-  size_t end = string_section_header.sh_offset + string_section_header.sh_size;
+  if (names_index == SHN_UNDEF) return;
+  PhaseTimer timer(stats, PP_SECTION_NAMES);
+  // validated: inside the file, terminated, and every sh_name is inside it
+  size_t start = section_headers[names_index].sh_offset;
+  size_t bytes = 0;
   for (auto &sh : section_headers) {
-    Elf64_Word ptr = sh.sh_name;
-    assert(start + ptr < end);
-    sh.name = read_from_string_table(start + ptr);
+    sh.name = read_from_string_table(start + sh.sh_name);
+    bytes += sh.name.size() + 1;
   }
+  stats.count(PP_SECTION_NAMES, bytes, section_headers.size());
 }
 
-std::string ElfReader::read_from_string_table(size_t ptr)
+std::string_view ElfReader::read_from_string_table(size_t ptr)
 {
   size_t start = ptr;
-  while (bytes[ptr] != '\0')
+  while (data[ptr] != '\0')
     ptr++;
-  auto name = std::string{ bytes.begin() + start, bytes.begin() + ptr };
-  return name;
+  return std::string_view(reinterpret_cast<const char *>(data) + start, ptr - start);
 }
 
 void ElfReader::read_elf_header()
 {
+  PhaseTimer timer(stats, PP_ELF_HEADER);
   size_t cursor = EI_NIDENT;
   header.e_type = read_bytes(cursor, elf_header_fields[0].sz[byte_size] / SZ_UCHAR);
   header.e_machine = read_bytes(cursor, elf_header_fields[1].sz[byte_size] / SZ_UCHAR);
@@ -294,6 +437,7 @@ void ElfReader::read_elf_header()
   header.e_shentsize = read_bytes(cursor, elf_header_fields[10].sz[byte_size] / SZ_UCHAR);
   header.e_shnum = read_bytes(cursor, elf_header_fields[11].sz[byte_size] / SZ_UCHAR);
   header.e_shstrndx = read_bytes(cursor, elf_header_fields[12].sz[byte_size] / SZ_UCHAR);
+  stats.count(PP_ELF_HEADER, cursor, 1);
 }
 
 void ElfReader::read_section_header(size_t offset)
@@ -311,13 +455,20 @@ void ElfReader::read_section_header(size_t offset)
   section_header.sh_entsize = read_bytes(offset, elf_section_header_fields[9].sz[byte_size] / SZ_UCHAR);
   section_header.index = section_headers.size();
   section_headers.push_back(section_header);
+  stats.count(PP_SECTION_HEADERS, header.e_shentsize, 1);
 }
 
 void ElfReader::read_program_headers()
 {
   if (header.e_phoff == 0) return;
+  PhaseTimer timer(stats, PP_PROGRAM_HEADERS);
   size_t offset = header.e_phoff;
-  for (int ii = 0; ii < header.e_phnum; ii++) {
+  ELF_ULONG count = header.e_phnum;
+  if (count == PN_XNUM) {
+    // too many segments for e_phnum, happens with large core files
+    count = read_extended_segment_count();
+  }
+  for (ELF_ULONG ii = 0; ii < count; ii++) {
     size_t start = offset;
     Elf_Phdr program_header;
     program_header.p_type = read_bytes(offset, elf_program_header_fields[0].sz[byte_size] / SZ_UCHAR);
@@ -340,14 +491,120 @@ void ElfReader::read_program_headers()
     program_headers.push_back(program_header);
     offset = start + header.e_phentsize;
   }
+  stats.count(PP_PROGRAM_HEADERS, count * header.e_phentsize, count);
 }
 
-int64_t ElfReader::read_lsb64(size_t &index, size_t count)
+/**
+ * @brief The real segment count, kept in sh_info of section header 0 when
+ *        e_phnum is PN_XNUM
+ */
+ELF_ULONG ElfReader::read_extended_segment_count()
+{
+  if (section_headers.size() > 0) return section_headers[0].sh_info;
+  // section headers were not asked for, read just the one field
+  return read_section_zero(7);
+}
+
+/**
+ * @brief Read one field of section header 0, where extended numbering keeps
+ *        the counts that do not fit in the ELF header
+ *
+ * @param field index into elf_section_header_fields
+ * @return ELF_ULONG 0 if there is no section header table
+ */
+ELF_ULONG ElfReader::read_section_zero(size_t field)
+{
+  if (header.e_shoff == 0) return 0;
+  size_t offset = header.e_shoff;
+  for (size_t ii = 0; ii < field; ii++) {
+    offset += elf_section_header_fields[ii].sz[byte_size] / SZ_UCHAR;
+  }
+  size_t width = elf_section_header_fields[field].sz[byte_size] / SZ_UCHAR;
+  if (get_bytes(offset, width) == nullptr) return 0;
+  return read_bytes(offset, width);
+}
+
+ELF_ULONG ElfReader::get_section_header_count() const
+{
+  return section_count;
+}
+
+ELF_ULONG ElfReader::get_section_names_index() const
+{
+  return names_index;
+}
+
+const parse_stats &ElfReader::get_stats() const
+{
+  return stats;
+}
+
+const MappedFile *ElfReader::get_mapped_file() const
+{
+  return mapping.get();
+}
+
+void ElfReader::read_notes()
+{
+  PhaseTimer timer(stats, PP_NOTES);
+  for (auto &p : program_headers) {
+    if (p.p_type == PT_NOTE) {
+      read_note_entries(p.p_offset, p.p_filesz, p.p_align);
+    }
+  }
+  if (notes.empty()) {
+    // relocatable files have no segments, only note sections
+    for (auto &sh : section_headers) {
+      if (sh.sh_type == SHT_NOTE) {
+        read_note_entries(sh.sh_offset, sh.sh_size, sh.sh_addralign);
+      }
+    }
+  }
+}
+
+void ElfReader::read_note_entries(ELF_ULONG offset, ELF_ULONG size, ELF_ULONG alignment)
+{
+  // name and descriptor are padded to 4 bytes unless the note asks for 8
+  ELF_ULONG align = alignment == 8 ? 8 : 4;
+  auto padded = [offset, align](size_t cursor) {
+    return offset + (((cursor - offset) + align - 1) / align) * align;
+  };
+  if (offset >= data_size) return;
+  size_t end = (size > data_size - offset) ? data_size : offset + size;
+  size_t cursor = offset;
+  size_t found = notes.size();
+  size_t word = sizeof(Elf32_Word);// same for 32 and 64-bit notes
+  while (cursor + 3 * word <= end) {
+    Elf_Note note;
+    note.n_namesz = read_bytes(cursor, word);
+    note.n_descsz = read_bytes(cursor, word);
+    note.n_type = read_bytes(cursor, word);
+    if (note.n_namesz > end - cursor) break;
+    // the name size includes the terminating null
+    size_t length = note.n_namesz;
+    while (length > 0 && data[cursor + length - 1] == '\0')
+      length--;
+    note.name = std::string{ reinterpret_cast<const char *>(data) + cursor, length };
+    cursor = padded(cursor + note.n_namesz);
+    if (cursor > end || note.n_descsz > end - cursor) break;
+    note.desc_offset = cursor;
+    cursor = padded(cursor + note.n_descsz);
+    notes.push_back(note);
+  }
+  stats.count(PP_NOTES, std::min(cursor, end) - offset, notes.size() - found);
+}
+
+ELF_SLONG ElfReader::read_bytes(size_t &index, size_t count) const
+{
+  return data_encoding == ELFDATA2MSB ? read_msb64(index, count) : read_lsb64(index, count);
+}
+
+int64_t ElfReader::read_lsb64(size_t &index, size_t count) const
 {
   assert(count == 1 || count == 2 || count == 4 || count == 8);
   int64_t result = 0LL;
   for (size_t ii = 0; ii < count; ii++) {
-    int64_t p = bytes[index++];// convert byte to larger integer size
+    int64_t p = data[index++];// convert byte to larger integer size
     int64_t q = p;
     if (ii > 0) {
       q = p << (8 * (ii));// shift the value up
@@ -358,12 +615,12 @@ int64_t ElfReader::read_lsb64(size_t &index, size_t count)
   return result;
 }
 
-int64_t ElfReader::read_msb64(size_t &index, size_t count)
+int64_t ElfReader::read_msb64(size_t &index, size_t count) const
 {
   assert(count == 1 || count == 2 || count == 4 || count == 8);
   int64_t result = 0LL;
   for (size_t ii = 0; ii < count; ii++) {
-    int64_t p = bytes[index++];// convert byte to larger integer size
+    int64_t p = data[index++];// convert byte to larger integer size
     int64_t q = p;
     if (count - ii - 1 > 0) {
       q = p << (8 * (count - ii - 1));// shift the value up
@@ -375,70 +632,96 @@ int64_t ElfReader::read_msb64(size_t &index, size_t count)
 }
 
 
-/**
- * @brief Print the details about the ELF file
- * 
- * @param out 
- * @param elf 
- * @return std::ostream& 
- */
-std::ostream &operator<<(std::ostream &out, const ElfReader &elf)
+void write_text_header(OutputBuffer &out, const ElfReader &elf)
 {
-  out << "[INFO] filesize: " << elf.filesize << " in: " << elf.bytes.size() << " capacity: " << elf.bytes.capacity() << " bytes\n";
-  out << (elf.byte_size == ELFCLASS32 ? "32" : "64") << "-bit ELF Header" << std::endl;
-  out << "-----------------" << std::endl;
+  out.put("[INFO] filesize: ").dec(elf.filesize).put(" in: ").dec(elf.data_size).put(" capacity: ").dec(elf.data_size).put(" bytes\n");
+  out.put(elf.byte_size == ELFCLASS32 ? "32" : "64").put("-bit ELF Header\n");
+  out.put("-----------------\n");
   size_t count = EI_NIDENT;
-  out << "[MAGIC] ";
+  out.put("[MAGIC] ");
   for (size_t ii = 0; ii < count; ii++) {
-    out << std::hex << std::setw(2) << std::setfill('0') << static_cast<uint64_t>(elf.bytes[ii]) << " ";
+    out.hex(elf.data[ii], 2).put(' ');
   }
-  out << std::dec << "\n";
-  out << "Class: " << std::hex << std::setw(2) << std::setfill('0') << "0x" << static_cast<uint64_t>(elf.get_class()) << std::dec << std::endl;
-  out << "Data Encoding: " << std::hex << std::setw(2) << std::setfill('0') << "0x" << static_cast<uint64_t>(elf.get_data_encoding()) << std::dec << std::endl;
-  out << "Version: " << std::hex << std::setw(2) << std::setfill('0') << "0x" << static_cast<uint64_t>(elf.get_version()) << std::dec << std::endl;
-  out << "OS ABI: " << std::hex << std::setw(2) << std::setfill('0') << "0x" << static_cast<uint64_t>(elf.get_osabi()) << std::dec << std::endl;
-  out << "ABI Version: " << std::hex << std::setw(2) << std::setfill('0') << "0x" << static_cast<uint64_t>(elf.get_abiversion()) << std::dec << std::endl;
+  out.put('\n');
+  out.put("Class: 0x").hex(elf.get_class()).put('\n');
+  out.put("Data Encoding: 0x").hex(elf.get_data_encoding()).put('\n');
+  out.put("Version: 0x").hex(elf.get_version()).put('\n');
+  out.put("OS ABI: 0x").hex(elf.get_osabi()).put('\n');
+  out.put("ABI Version: 0x").hex(elf.get_abiversion()).put('\n');
+  // header fields are printed as signed 64-bit values
+  auto field = [&out](std::string_view label, int64_t result) {
+    out.put(label).dec_signed(result).put(" 0x").hex(static_cast<uint64_t>(result)).put('\n');
+  };
   int64_t result = elf.header.e_type;
-  out << "Type: " << e_type_to_string(result) << " (Dec: " << result << " " << std::hex << "0x" << result << std::dec << ")" << std::endl;
+  out.put("Type: ").put(e_type_to_string(result)).put(" (Dec: ").dec_signed(result).put(" 0x").hex(static_cast<uint64_t>(result)).put(")\n");
   result = elf.header.e_machine;
-  out << "Machine: " << e_machines_to_string(result) << " (Dec: " << result << " Hex: " << std::hex << "0x" << result << std::dec << ")" << std::endl;
-  result = elf.header.e_version;
-  out << "Version: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_entry;
-  out << "Entry Address: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_phoff;
-  out << "Program header offset: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_shoff;
-  out << "Section header offset: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_flags;
-  out << "Flags: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_ehsize;
-  out << "Elf header size: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_phentsize;
-  out << "Program header entry size: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_phnum;
-  out << "Program header entry count: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_shentsize;
-  out << "Section header entry size: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_shnum;
-  out << "Section header entry count: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
-  result = elf.header.e_shstrndx;
-  out << "Index of string table with section names in: " << result << " " << std::hex << "0x" << result << std::dec << std::endl;
+  out.put("Machine: ").put(e_machines_to_string(result)).put(" (Dec: ").dec_signed(result).put(" Hex: 0x").hex(static_cast<uint64_t>(result)).put(")\n");
+  field("Version: ", elf.header.e_version);
+  field("Entry Address: ", elf.header.e_entry);
+  field("Program header offset: ", elf.header.e_phoff);
+  field("Section header offset: ", elf.header.e_shoff);
+  field("Flags: ", elf.header.e_flags);
+  field("Elf header size: ", elf.header.e_ehsize);
+  field("Program header entry size: ", elf.header.e_phentsize);
+  field("Program header entry count: ", elf.header.e_phnum);
+  field("Section header entry size: ", elf.header.e_shentsize);
+  field("Section header entry count: ", elf.header.e_shnum);
+  if (elf.get_section_header_count() != elf.header.e_shnum) field("Section header entry count in section 0: ", elf.get_section_header_count());
+  field("Index of string table with section names in: ", elf.header.e_shstrndx);
+  if (elf.get_section_names_index() != elf.header.e_shstrndx) field("Index of string table with section names in section 0: ", elf.get_section_names_index());
+}
 
+void write_text_sections(OutputBuffer &out, const ElfReader &elf)
+{
   size_t counter = 0;
-  for (auto sh : elf.section_headers) {
-    out << sh << std::endl;
-    out << *(elf.section_table_info[counter]) << std::endl;
+  for (auto &sh : elf.section_headers) {
+    write_text(out, sh);
+    out.put('\n');
+    elf.get_section_table_info(counter).write(out);
+    out.put('\n');
     counter++;
   }
+}
+
+void write_text_symbols(OutputBuffer &out, const ElfReader &elf)
+{
+  for (auto &sh : elf.section_headers) {
+    auto table = elf.get_symbol_table(sh.index);
+    if (table == nullptr) continue;
+    write_text(out, sh);
+    table->write(out);
+    out.put('\n');
+  }
+}
 
-  out << "Start address: "
-      << "0x" << std::hex << std::setw(8) << std::setfill('0') << elf.get_start_address() << std::dec << std::endl;
-  counter = 0;
-  for (auto p : elf.program_headers) {
-    out << "[" << counter << "] Program Header" << std::endl;
-    out << p << std::endl;
+void write_text_segments(OutputBuffer &out, const ElfReader &elf)
+{
+  out.put("Start address: 0x").hex(elf.get_start_address(), 8).put('\n');
+  size_t counter = 0;
+  for (auto &p : elf.program_headers) {
+    out.put('[').dec(counter).put("] Program Header\n");
+    write_text(out, p);
+    out.put('\n');
     counter++;
   }
+}
+
+/**
+ * @brief Print the details about the ELF file
+ * 
+ * @param out 
+ * @param elf 
+ */
+void write_text(OutputBuffer &out, const ElfReader &elf)
+{
+  write_text_header(out, elf);
+  write_text_sections(out, elf);
+  write_text_segments(out, elf);
+}
+
+std::ostream &operator<<(std::ostream &out, const ElfReader &elf)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, elf);
   return out;
 }
@@ -1,24 +1,50 @@
 #ifndef ELFREADER_HPP
 #define ELFREADER_HPP
 
+#include "Elf_Note.hpp"
 #include "Elf_Phdr.hpp"
 #include "Elf_Shdr.hpp"
+#include "MappedFile.hpp"
 #include "SectionTableInfo.hpp"
 #include "elf_common.hpp"
 #include "Elf_Ehdr.hpp"
+#include "ElfValidator.hpp"
+#include "ParseStats.hpp"
 
 #include <cassert>
 #include <fstream>
-#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 #include <unistd.h>
 #include <vector>
 
+class ParseCache;
+class SymbolTable;
+
+/**
+ * @brief Controls what the constructor does beyond decoding the file
+ */
+struct ParseOptions
+{
+  bool verbose = true;// report each table on std::cout as it is read
+
+  // Phases of the parse, the ELF header is always read.  Anything switched
+  // off is left empty, so only ask for what is going to be used.
+  bool section_headers = true;// section headers and their names
+  bool symbol_tables = true;// SHT_SYMTAB entries, needs section_headers
+  bool dynamic_symbols = false;// SHT_DYNSYM entries, needs section_headers
+  bool string_tables = true;// SHT_STRTAB entries, needs section_headers
+  bool program_headers = true;
+  bool notes = true;// from PT_NOTE segments, or SHT_NOTE sections without them
+  std::string symbol_filter;// keep only symbols whose name contains this
+  ParseCache *cache = nullptr;// reuse an earlier parse of the same file, files opened by name only
+};
+
 class ElfReader
 {
 public:
@@ -28,21 +54,89 @@ public:
   Elf_Ehdr header;
   std::vector<Elf_Shdr> section_headers;
   std::vector<Elf_Phdr> program_headers;
+  std::vector<Elf_Note> notes;
 
 private:
   std::vector<byte> bytes;
-  std::function<ELF_SLONG(size_t &index, size_t count)> read_bytes;
+  std::shared_ptr<MappedFile> mapping;
+  std::shared_ptr<MappedFile> cache_entry;// the ParseCache entry symbol names point into after a hit
+  const byte *data;// either bytes.data() or the mapped file
+  size_t data_size;
+  ParseOptions options;
+  elf_validation validation;
+  ELF_ULONG section_count;// e_shnum, or sh_size of section 0 with extended numbering
+  ELF_ULONG names_index;// e_shstrndx, or sh_link of section 0 when it is SHN_XINDEX
   std::vector<std::unique_ptr<SectionTableInfo>> section_table_info;
+  parse_stats stats;
+
+  ElfReader(std::shared_ptr<MappedFile> file, ParseOptions options, bool validated);
+  ELF_SLONG read_bytes(size_t &index, size_t count) const;
 
 public:
-  explicit ElfReader(container_ref bytes);
-  explicit ElfReader(const std::string filename);
+  /**
+   * @brief Decode a file, a file that fails validation gives a reader with
+   *        only what could be decoded safely, see is_valid()
+   */
+  explicit ElfReader(container_ref bytes, ParseOptions options = ParseOptions{});
+  explicit ElfReader(const std::string filename, ParseOptions options = ParseOptions{});
+
+  /**
+   * @brief Decode a file only if it can be opened and passes validate_elf()
+   *
+   * Nothing is allocated or printed for a file that is rejected, which is
+   * what a scan over mostly non-ELF files wants.  The reader is movable, the
+   * decoded tables refer to the mapping rather than to the reader.
+   *
+   * The time spent opening and validating is in the reader's get_stats(),
+   * or added to rejected when the file is rejected.
+   *
+   * @return elf_expected<ElfReader> the reader, or EE_OPEN_FAILED or the
+   *         first problem validate_elf() found
+   */
+  static elf_expected<ElfReader> open(const std::string &filename, ParseOptions options = ParseOptions{}, parse_stats *rejected = nullptr);
+
+  /**
+   * @brief The same for a file that is already mapped, e.g. writable by an
+   *        ElfEditor, the reader then sees stores into the mapping
+   */
+  static elf_expected<ElfReader> open(std::shared_ptr<MappedFile> file, ParseOptions options = ParseOptions{});
   bool is_32bit() const noexcept;
 
   bool is_64bit() const noexcept;
 
   bool is_elf() const noexcept;
 
+  /**
+   * @brief The file passed validate_elf(), only then is anything past the
+   *        ELF header decoded
+   */
+  bool is_valid() const noexcept;
+  elf_validation get_validation() const noexcept;
+
+  /**
+   * @brief Number of section headers in the file, with extended numbering
+   *        resolved, whether or not they were read
+   */
+  ELF_ULONG get_section_header_count() const;
+
+  /**
+   * @brief Index of the section name table, with SHN_XINDEX resolved
+   */
+  ELF_ULONG get_section_names_index() const;
+
+  /**
+   * @brief Time, bytes, entries and allocations of each phase of the parse,
+   *        all zero unless built with ELF_ENABLE_STATS
+   */
+  const parse_stats &get_stats() const;
+
+  /**
+   * @brief The file the reader maps, for callers that want its descriptor
+   *
+   * @return const MappedFile* nullptr for a reader of bytes
+   */
+  const MappedFile *get_mapped_file() const;
+
   /**
      * @brief Get the section count object, 0 before sections are read in
      * 
@@ -50,7 +144,53 @@ public:
      */
   size_t get_section_count() const;
 
+  /**
+   * @brief Get a pointer to a range of the file
+   * 
+   * Nothing is read in for files opened by name, the pages are faulted in when
+   * the returned pointer is dereferenced.
+   * 
+   * @return const byte* nullptr if the range is not inside the file
+   */
+  const byte *get_bytes(ELF_ULONG offset, ELF_ULONG size) const;
+
+  /**
+   * @brief Decode an integer of count bytes at offset using the file's byte order
+   * 
+   * The caller is responsible for the range being inside the file.
+   * 
+   * @return ELF_ULONG 
+   */
+  ELF_ULONG read_value(size_t offset, size_t count) const;
+
+  /**
+   * @brief The NT_GNU_BUILD_ID note in hex, empty if there is none or notes
+   *        were not read
+   */
+  std::string get_build_id() const;
+
+  friend class ParseCache;
   friend std::ostream &operator<<(std::ostream &out, const ElfReader &elf);
+  friend void write_text(OutputBuffer &out, const ElfReader &elf);
+  friend void write_text_header(OutputBuffer &out, const ElfReader &elf);
+
+  /**
+   * @brief Decoded contents of a section, SymbolTable or StringTable for the
+   *        tables we understand, an empty SectionTableInfo otherwise or when
+   *        the table was not parsed
+   * 
+   * @param index section header index
+   * @return const SectionTableInfo& 
+   */
+  const SectionTableInfo &get_section_table_info(size_t index) const;
+
+  /**
+   * @brief Get the decoded symbol table for a section
+   * 
+   * @param index section header index
+   * @return const SymbolTable* nullptr if the section is not a symbol table
+   */
+  const SymbolTable *get_symbol_table(size_t index) const;
 
   /**
    * @brief Get the base address object
@@ -70,12 +210,16 @@ public:
   void read_string_table(Elf_Shdr section);
   void read_section_tables();
   void read_section_names();
-  std::string read_from_string_table(size_t ptr);
+  std::string_view read_from_string_table(size_t ptr);
   void read_elf_header();
   void read_section_header(size_t offset);
   void read_program_headers();
-  int64_t read_lsb64(size_t &index, size_t count);
-  int64_t read_msb64(size_t &index, size_t count);
+  ELF_ULONG read_extended_segment_count();
+  ELF_ULONG read_section_zero(size_t field);
+  void read_notes();
+  void read_note_entries(ELF_ULONG offset, ELF_ULONG size, ELF_ULONG alignment);
+  int64_t read_lsb64(size_t &index, size_t count) const;
+  int64_t read_msb64(size_t &index, size_t count) const;
 };
 
 /**
@@ -86,5 +230,18 @@ public:
  * @return std::ostream& 
  */
 std::ostream &operator<<(std::ostream &out, const ElfReader &elf);
+void write_text(OutputBuffer &out, const ElfReader &elf);
+
+/**
+ * @brief The parts write_text is made of, for printing a selection
+ */
+void write_text_header(OutputBuffer &out, const ElfReader &elf);
+void write_text_sections(OutputBuffer &out, const ElfReader &elf);
+void write_text_segments(OutputBuffer &out, const ElfReader &elf);
+
+/**
+ * @brief Symbol tables only, each after its section header
+ */
+void write_text_symbols(OutputBuffer &out, const ElfReader &elf);
 
 #endif /* ELFREADER_HPP */
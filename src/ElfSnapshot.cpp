@@ -0,0 +1,261 @@
+#include "ElfSnapshot.hpp"
+#include "OutputBuffer.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+uint64_t aligned(uint64_t offset)
+{
+  return (offset + 7) & ~uint64_t{ 7 };
+}
+
+template<typename T>
+void put_record(OutputBuffer &out, const T &record)
+{
+  out.put(std::string_view(reinterpret_cast<const char *>(&record), sizeof(record)));
+}
+
+}// namespace
+
+
+bool write_snapshot(const ElfQuery &query, const std::string &filename)
+{
+  snapshot_header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, "ESNP", 4);
+  header.version = SNAPSHOT_VERSION;
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.header_size = sizeof(header);
+  header.elf_header = query.get_header();
+  header.file_size = query.get_file_size();
+
+  uint64_t cursor = sizeof(header);
+  auto place = [&cursor](snapshot_table &table, uint64_t count, size_t width) {
+    table.offset = cursor;
+    table.count = count;
+    cursor = aligned(cursor + count * width);
+  };
+  place(header.sections, query.section_count(), sizeof(snapshot_section));
+  place(header.segments, query.segment_count(), sizeof(Elf_Phdr));
+  place(header.symbols, query.symbol_count(), sizeof(snapshot_symbol));
+  place(header.by_name, query.name_order_count(), sizeof(uint32_t));
+  place(header.by_address, query.address_order_count(), sizeof(uint32_t));
+  place(header.sections_by_address, query.section_order_count(), sizeof(uint32_t));
+  place(header.segments_by_address, query.segment_order_count(), sizeof(uint32_t));
+  uint64_t strings_size = 0;
+  for (size_t ii = 0; ii < query.section_count(); ii++)
+    strings_size += query.section(ii).name.size();
+  for (size_t ii = 0; ii < query.symbol_count(); ii++)
+    strings_size += query.symbol(ii).name.size();
+  place(header.strings, strings_size, 1);
+
+  auto temporary = filename + ".tmp";
+  int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return false;
+  {
+    OutputBuffer out(fd);
+    uint64_t written = sizeof(header);
+    auto pad = [&out, &written]() {
+      while (written % 8 != 0) {
+        out.put('\0');
+        written++;
+      }
+    };
+    put_record(out, header);
+    uint64_t string_cursor = 0;
+    for (size_t ii = 0; ii < query.section_count(); ii++) {
+      auto sh = query.section(ii);
+      snapshot_section record{};
+      record.name_offset = string_cursor;
+      record.name_length = sh.name.size();
+      record.type = sh.type;
+      record.flags = sh.flags;
+      record.address = sh.address;
+      record.offset = sh.offset;
+      record.size = sh.size;
+      record.link = sh.link;
+      record.info = sh.info;
+      record.addralign = sh.addralign;
+      record.entsize = sh.entsize;
+      put_record(out, record);
+      string_cursor += sh.name.size();
+    }
+    written += sizeof(snapshot_section) * query.section_count();
+    for (size_t ii = 0; ii < query.segment_count(); ii++) {
+      put_record(out, query.segment(ii));
+    }
+    written += sizeof(Elf_Phdr) * query.segment_count();
+    for (size_t ii = 0; ii < query.symbol_count(); ii++) {
+      auto sym = query.symbol(ii);
+      snapshot_symbol record{};
+      record.name_offset = string_cursor;
+      record.name_length = static_cast<uint32_t>(sym.name.size());
+      record.table = static_cast<uint32_t>(sym.table);
+      record.value = sym.value;
+      record.size = sym.size;
+      record.shndx = static_cast<uint32_t>(sym.shndx);
+      record.info = sym.info;
+      record.other = sym.other;
+      put_record(out, record);
+      string_cursor += sym.name.size();
+    }
+    written += sizeof(snapshot_symbol) * query.symbol_count();
+    auto order = [&](size_t count, auto at) {
+      for (size_t ii = 0; ii < count; ii++) {
+        put_record(out, static_cast<uint32_t>(at(ii)));
+      }
+      written += sizeof(uint32_t) * count;
+      pad();
+    };
+    order(query.name_order_count(), [&query](size_t ii) { return query.name_order(ii); });
+    order(query.address_order_count(), [&query](size_t ii) { return query.address_order(ii); });
+    order(query.section_order_count(), [&query](size_t ii) { return query.section_order(ii); });
+    order(query.segment_order_count(), [&query](size_t ii) { return query.segment_order(ii); });
+    for (size_t ii = 0; ii < query.section_count(); ii++)
+      out.put(query.section(ii).name);
+    for (size_t ii = 0; ii < query.symbol_count(); ii++)
+      out.put(query.symbol(ii).name);
+    written += strings_size;
+    pad();
+  }
+  if (::close(fd) != 0 || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return false;
+  }
+  return true;
+}
+
+
+ElfSnapshot::ElfSnapshot(const std::string &filename) : mapping(filename), header(nullptr), sections(nullptr), segments(nullptr), symbols(nullptr), by_name(nullptr), by_address(nullptr), sections_by_address(nullptr), segments_by_address(nullptr), strings(nullptr)
+{
+  if (!mapping.is_open() || mapping.size() < sizeof(snapshot_header)) return;
+  auto h = reinterpret_cast<const snapshot_header *>(mapping.data());
+  if (std::memcmp(h->magic, "ESNP", 4) != 0 || h->version != SNAPSHOT_VERSION || h->byte_order != SNAPSHOT_BYTE_ORDER || h->header_size != sizeof(snapshot_header)) return;
+  header = h;
+  if (!check(h->sections, sizeof(snapshot_section)) || !check(h->segments, sizeof(Elf_Phdr)) || !check(h->symbols, sizeof(snapshot_symbol))) {
+    header = nullptr;
+    return;
+  }
+  if (!check(h->by_name, 4) || !check(h->by_address, 4) || !check(h->sections_by_address, 4) || !check(h->segments_by_address, 4) || !check(h->strings, 1)) {
+    header = nullptr;
+    return;
+  }
+  auto base = mapping.data();
+  sections = reinterpret_cast<const snapshot_section *>(base + h->sections.offset);
+  segments = reinterpret_cast<const Elf_Phdr *>(base + h->segments.offset);
+  symbols = reinterpret_cast<const snapshot_symbol *>(base + h->symbols.offset);
+  by_name = reinterpret_cast<const uint32_t *>(base + h->by_name.offset);
+  by_address = reinterpret_cast<const uint32_t *>(base + h->by_address.offset);
+  sections_by_address = reinterpret_cast<const uint32_t *>(base + h->sections_by_address.offset);
+  segments_by_address = reinterpret_cast<const uint32_t *>(base + h->segments_by_address.offset);
+  strings = reinterpret_cast<const char *>(base + h->strings.offset);
+}
+
+/**
+ * @brief The array is aligned and inside the mapping
+ */
+bool ElfSnapshot::check(const snapshot_table &table, size_t width) const
+{
+  uint64_t size = mapping.size();
+  return table.offset % 8 == 0 && table.offset <= size && table.count <= (size - table.offset) / width;
+}
+
+std::string_view ElfSnapshot::string(uint64_t offset, uint64_t length) const
+{
+  if (offset > header->strings.count || length > header->strings.count - offset) return {};
+  return std::string_view(strings + offset, length);
+}
+
+bool ElfSnapshot::is_open() const
+{
+  return header != nullptr;
+}
+
+uint64_t ElfSnapshot::get_file_size() const
+{
+  return header == nullptr ? 0 : header->file_size;
+}
+
+const Elf_Ehdr &ElfSnapshot::get_header() const
+{
+  static const Elf_Ehdr empty{};
+  return header == nullptr ? empty : header->elf_header;
+}
+
+size_t ElfSnapshot::section_count() const
+{
+  return header == nullptr ? 0 : header->sections.count;
+}
+
+section_view ElfSnapshot::section(size_t index) const
+{
+  if (index >= section_count()) return section_view{ index, {}, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+  auto &sh = sections[index];
+  return { index, string(sh.name_offset, sh.name_length), sh.type, sh.flags, sh.address, sh.offset, sh.size, sh.link, sh.info, sh.addralign, sh.entsize };
+}
+
+size_t ElfSnapshot::segment_count() const
+{
+  return header == nullptr ? 0 : header->segments.count;
+}
+
+Elf_Phdr ElfSnapshot::segment(size_t index) const
+{
+  if (index >= segment_count()) return Elf_Phdr{};
+  return segments[index];
+}
+
+size_t ElfSnapshot::symbol_count() const
+{
+  return header == nullptr ? 0 : header->symbols.count;
+}
+
+symbol_view ElfSnapshot::symbol(size_t index) const
+{
+  if (index >= symbol_count()) return { index, 0, {}, 0, 0, 0, 0, 0 };
+  auto &sym = symbols[index];
+  return { index, sym.table, string(sym.name_offset, sym.name_length), sym.value, sym.size, sym.info, sym.other, sym.shndx };
+}
+
+size_t ElfSnapshot::name_order_count() const
+{
+  return header == nullptr ? 0 : header->by_name.count;
+}
+
+size_t ElfSnapshot::name_order(size_t position) const
+{
+  return by_name[position];
+}
+
+size_t ElfSnapshot::address_order_count() const
+{
+  return header == nullptr ? 0 : header->by_address.count;
+}
+
+size_t ElfSnapshot::address_order(size_t position) const
+{
+  return by_address[position];
+}
+
+size_t ElfSnapshot::section_order_count() const
+{
+  return header == nullptr ? 0 : header->sections_by_address.count;
+}
+
+size_t ElfSnapshot::section_order(size_t position) const
+{
+  return sections_by_address[position];
+}
+
+size_t ElfSnapshot::segment_order_count() const
+{
+  return header == nullptr ? 0 : header->segments_by_address.count;
+}
+
+size_t ElfSnapshot::segment_order(size_t position) const
+{
+  return segments_by_address[position];
+}
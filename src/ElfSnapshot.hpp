@@ -0,0 +1,155 @@
+#ifndef ELFSNAPSHOT_HPP
+#define ELFSNAPSHOT_HPP
+
+#include "ElfQuery.hpp"
+#include "MappedFile.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+ * @brief Where one array of a snapshot is, offset from the start of the file
+ */
+struct snapshot_table
+{
+  uint64_t offset;
+  uint64_t count;
+};
+
+/**
+ * @brief The start of a snapshot file
+ *
+ * A snapshot is the header followed by flat arrays, every one 8 byte aligned
+ * and found through a snapshot_table.  There are no pointers, only offsets
+ * and indexes, so the file is used straight from the mapping wherever it is
+ * mapped.  Integers are in the byte order of the machine that wrote the
+ * snapshot, byte_order tells a reader with the other order to give up.
+ *
+ *   sections             snapshot_section
+ *   segments             Elf_Phdr
+ *   symbols              snapshot_symbol, all symbol tables in section order
+ *   by_name              u32 symbol indexes, sorted by name
+ *   by_address           u32 symbol indexes, sorted by address
+ *   sections_by_address  u32 section indexes
+ *   segments_by_address  u32 segment indexes
+ *   strings              names, not terminated
+ *
+ * The orders are those of ElfQuery.
+ */
+struct snapshot_header
+{
+  char magic[4];// "ESNP"
+  uint32_t version;
+  uint32_t byte_order;// SNAPSHOT_BYTE_ORDER as written
+  uint32_t header_size;// sizeof(snapshot_header)
+  Elf_Ehdr elf_header;
+  uint64_t file_size;
+  snapshot_table sections;
+  snapshot_table segments;
+  snapshot_table symbols;
+  snapshot_table by_name;
+  snapshot_table by_address;
+  snapshot_table sections_by_address;
+  snapshot_table segments_by_address;
+  snapshot_table strings;// count is in bytes
+};
+
+struct snapshot_section
+{
+  uint64_t name_offset;// into strings
+  uint64_t name_length;
+  uint64_t type;
+  uint64_t flags;
+  uint64_t address;
+  uint64_t offset;
+  uint64_t size;
+  uint64_t link;
+  uint64_t info;
+  uint64_t addralign;
+  uint64_t entsize;
+};
+
+struct snapshot_symbol
+{
+  uint64_t name_offset;// into strings
+  uint32_t name_length;
+  uint32_t table;// section index of the symbol table
+  uint64_t value;
+  uint64_t size;
+  uint32_t shndx;
+  uint8_t info;
+  uint8_t other;
+  uint16_t unused;
+};
+
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+static_assert(sizeof(Elf_Ehdr) == 120, "Elf_Ehdr is stored as is");
+static_assert(sizeof(Elf_Phdr) == 64, "Elf_Phdr is stored as is");
+static_assert(sizeof(snapshot_header) == 272, "snapshot_header has no padding");
+static_assert(sizeof(snapshot_section) == 88, "snapshot_section has no padding");
+static_assert(sizeof(snapshot_symbol) == 40, "snapshot_symbol has no padding");
+
+/**
+ * @brief Write a snapshot of everything query can answer
+ *
+ * Written to a temporary file and renamed into place.
+ *
+ * @return false if the file could not be written
+ */
+bool write_snapshot(const ElfQuery &query, const std::string &filename);
+
+/**
+ * @brief ElfQuery over a snapshot file.
+ *
+ * Opening maps the file and checks that the header and the arrays are inside
+ * it, nothing is read into memory.  Indexes and names that point outside the
+ * file come back as empty entries.
+ */
+class ElfSnapshot : public ElfQuery
+{
+public:
+  explicit ElfSnapshot(const std::string &filename);
+
+  /**
+   * @brief false if the file is not a snapshot this reader understands
+   */
+  bool is_open() const;
+
+  uint64_t get_file_size() const override;
+  const Elf_Ehdr &get_header() const override;
+  size_t section_count() const override;
+  section_view section(size_t index) const override;
+  size_t segment_count() const override;
+  Elf_Phdr segment(size_t index) const override;
+  size_t symbol_count() const override;
+  symbol_view symbol(size_t index) const override;
+
+protected:
+  size_t name_order_count() const override;
+  size_t name_order(size_t position) const override;
+  size_t address_order_count() const override;
+  size_t address_order(size_t position) const override;
+  size_t section_order_count() const override;
+  size_t section_order(size_t position) const override;
+  size_t segment_order_count() const override;
+  size_t segment_order(size_t position) const override;
+
+private:
+  MappedFile mapping;
+  const snapshot_header *header;
+  const snapshot_section *sections;
+  const Elf_Phdr *segments;
+  const snapshot_symbol *symbols;
+  const uint32_t *by_name;
+  const uint32_t *by_address;
+  const uint32_t *sections_by_address;
+  const uint32_t *segments_by_address;
+  const char *strings;
+
+  bool check(const snapshot_table &table, size_t width) const;
+  std::string_view string(uint64_t offset, uint64_t length) const;
+};
+
+#endif /* ELFSNAPSHOT_HPP */
@@ -0,0 +1,175 @@
+#include "ElfValidator.hpp"
+
+namespace {
+
+/**
+ * @brief Field offsets and sizes that differ between the two classes
+ */
+struct class_layout
+{
+  size_t header_size;
+  size_t phoff;
+  size_t shoff;
+  size_t address;// width of an address or offset field
+  size_t phentsize;// offset of e_phentsize, e_phnum, e_shentsize, e_shnum and e_shstrndx follow
+  size_t section_size;
+  size_t sh_offset;
+  size_t sh_size;
+  size_t sh_link;
+  size_t sh_info;
+  size_t sh_entsize;
+  size_t segment_size;
+  size_t symbol_size;
+};
+
+constexpr class_layout LAYOUT_32 = { 52, 28, 32, 4, 42, 40, 16, 20, 24, 28, 36, 32, 16 };
+constexpr class_layout LAYOUT_64 = { 64, 32, 40, 8, 54, 64, 24, 32, 40, 44, 56, 56, 24 };
+
+class field_reader
+{
+public:
+  field_reader(const byte *data, bool msb) : data(data), msb(msb) {}
+
+  uint64_t operator()(size_t offset, size_t width) const
+  {
+    uint64_t value = 0;
+    for (size_t ii = 0; ii < width; ii++) {
+      uint64_t b = data[offset + ii];
+      value |= msb ? b << (8 * (width - ii - 1)) : b << (8 * ii);
+    }
+    return value;
+  }
+
+private:
+  const byte *data;
+  bool msb;
+};
+
+bool inside(uint64_t offset, uint64_t length, uint64_t size)
+{
+  return offset <= size && length <= size - offset;
+}
+
+/**
+ * @brief count entries of width bytes from offset are inside the file
+ */
+bool table_inside(uint64_t offset, uint64_t count, uint64_t width, uint64_t size)
+{
+  return offset <= size && (width == 0 || count <= (size - offset) / width);
+}
+
+}// namespace
+
+
+std::string_view elf_error_to_string(elf_error error)
+{
+  switch (error) {
+  case EE_NONE:
+    return "valid";
+  case EE_OPEN_FAILED:
+    return "unable to open";
+  case EE_NOT_ELF:
+    return "not an ELF file";
+  case EE_BAD_CLASS:
+    return "unknown ELF class";
+  case EE_BAD_ENCODING:
+    return "unknown data encoding";
+  case EE_HEADER_TRUNCATED:
+    return "ELF header truncated";
+  case EE_SECTION_ENTRY_SIZE:
+    return "section header entry size too small";
+  case EE_SECTION_TABLE_OUTSIDE:
+    return "section header table past the end of the file";
+  case EE_SECTION_NAMES_INDEX:
+    return "section name table index out of range";
+  case EE_SECTION_NAMES_TABLE:
+    return "section name table outside the file or not terminated";
+  case EE_SECTION_NAME_OFFSET:
+    return "section name past the end of the name table";
+  case EE_SECTION_OUTSIDE:
+    return "section past the end of the file";
+  case EE_SYMBOL_ENTRY_SIZE:
+    return "bad symbol table entry size";
+  case EE_SYMBOL_STRINGS:
+    return "bad symbol string table";
+  case EE_SEGMENT_ENTRY_SIZE:
+    return "program header entry size too small";
+  case EE_SEGMENT_TABLE_OUTSIDE:
+    return "program header table past the end of the file";
+  default:
+    return "unknown";
+  }
+}
+
+elf_validation validate_elf(const byte *data, size_t size)
+{
+  if (size < EI_NIDENT || data[EI_MAG0] != ELFMAG0 || data[EI_MAG1] != ELFMAG1 || data[EI_MAG2] != ELFMAG2 || data[EI_MAG3] != ELFMAG3) return { EE_NOT_ELF, 0 };
+  if (data[EI_CLASS] != ELFCLASS32 && data[EI_CLASS] != ELFCLASS64) return { EE_BAD_CLASS, 0 };
+  if (data[EI_DATA] != ELFDATA2LSB && data[EI_DATA] != ELFDATA2MSB) return { EE_BAD_ENCODING, 0 };
+  auto &layout = data[EI_CLASS] == ELFCLASS32 ? LAYOUT_32 : LAYOUT_64;
+  if (size < layout.header_size) return { EE_HEADER_TRUNCATED, 0 };
+  field_reader read(data, data[EI_DATA] == ELFDATA2MSB);
+
+  uint64_t phoff = read(layout.phoff, layout.address);
+  uint64_t shoff = read(layout.shoff, layout.address);
+  uint64_t phentsize = read(layout.phentsize, 2);
+  uint64_t phnum = read(layout.phentsize + 2, 2);
+  uint64_t shentsize = read(layout.phentsize + 4, 2);
+  uint64_t shnum = read(layout.phentsize + 6, 2);
+  uint64_t shstrndx = read(layout.phentsize + 8, 2);
+
+  if (shoff != 0 && (shnum == 0 || shstrndx == SHN_XINDEX)) {
+    // extended numbering, the values that do not fit are in section 0
+    if (shentsize < layout.section_size) return { EE_SECTION_ENTRY_SIZE, 0 };
+    if (!table_inside(shoff, 1, shentsize, size)) return { EE_SECTION_TABLE_OUTSIDE, 0 };
+    if (shnum == 0) shnum = read(shoff + layout.sh_size, layout.address);
+    if (shstrndx == SHN_XINDEX) shstrndx = read(shoff + layout.sh_link, 4);
+  }
+
+  // the same conditions ElfReader reads the section headers under
+  bool sections = shoff != 0 && shnum > 0;
+  if (sections) {
+    if (shentsize < layout.section_size) return { EE_SECTION_ENTRY_SIZE, 0 };
+    if (!table_inside(shoff, shnum, shentsize, size)) return { EE_SECTION_TABLE_OUTSIDE, 0 };
+    if (shstrndx >= shnum) return { EE_SECTION_NAMES_INDEX, 0 };
+
+    auto section = [&](uint64_t index) { return shoff + index * shentsize; };
+    auto offset_of = [&](uint64_t index) { return read(section(index) + layout.sh_offset, layout.address); };
+    auto size_of = [&](uint64_t index) { return read(section(index) + layout.sh_size, layout.address); };
+    // a table that is decoded byte by byte up to a terminating null
+    auto terminated = [&](uint64_t index) {
+      uint64_t offset = offset_of(index);
+      uint64_t length = size_of(index);
+      return inside(offset, length, size) && (length == 0 || data[offset + length - 1] == '\0');
+    };
+
+    // SHN_UNDEF is a file without section names
+    bool names = shstrndx != SHN_UNDEF;
+    uint64_t names_size = size_of(shstrndx);
+    if (names && (names_size == 0 || !terminated(shstrndx))) return { EE_SECTION_NAMES_TABLE, shstrndx };
+    for (uint64_t ii = 0; ii < shnum; ii++) {
+      if (names && read(section(ii), 4) >= names_size) return { EE_SECTION_NAME_OFFSET, ii };
+      uint64_t type = read(section(ii) + 4, 4);
+      if (type != SHT_SYMTAB && type != SHT_DYNSYM && type != SHT_STRTAB && type != SHT_NOTE && type != SHT_SYMTAB_SHNDX) continue;
+      if (!inside(offset_of(ii), size_of(ii), size)) return { EE_SECTION_OUTSIDE, ii };
+      if (type == SHT_SYMTAB || type == SHT_DYNSYM) {
+        uint64_t entsize = read(section(ii) + layout.sh_entsize, layout.address);
+        if (entsize < layout.symbol_size || size_of(ii) % entsize != 0) return { EE_SYMBOL_ENTRY_SIZE, ii };
+        uint64_t link = read(section(ii) + layout.sh_link, 4);
+        // no link means no names
+        if (link != 0 && (link >= shnum || !terminated(link))) return { EE_SYMBOL_STRINGS, ii };
+      }
+    }
+  }
+
+  if (phoff != 0) {
+    uint64_t count = phnum;
+    if (count == PN_XNUM) {
+      // the real count is in sh_info of section 0, as ElfReader finds it
+      count = shoff != 0 && inside(shoff, layout.section_size, size) ? read(shoff + layout.sh_info, 4) : 0;
+    }
+    if (count > 0 && phentsize < layout.segment_size) return { EE_SEGMENT_ENTRY_SIZE, 0 };
+    if (!table_inside(phoff, count, phentsize, size)) return { EE_SEGMENT_TABLE_OUTSIDE, 0 };
+  }
+  return { EE_NONE, 0 };
+}
@@ -0,0 +1,95 @@
+#ifndef ELFVALIDATOR_HPP
+#define ELFVALIDATOR_HPP
+
+#include "elf_common.hpp"
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+/**
+ * @brief Why a file was rejected, the first problem found
+ */
+enum elf_error
+{
+  EE_NONE,
+  EE_OPEN_FAILED,// missing, unreadable, not a regular file or could not be mapped
+  EE_NOT_ELF,// shorter than e_ident or no magic
+  EE_BAD_CLASS,// EI_CLASS is neither ELFCLASS32 nor ELFCLASS64
+  EE_BAD_ENCODING,// EI_DATA is neither ELFDATA2LSB nor ELFDATA2MSB
+  EE_HEADER_TRUNCATED,
+  EE_SECTION_ENTRY_SIZE,// e_shentsize smaller than a section header
+  EE_SECTION_TABLE_OUTSIDE,// the section header table is not inside the file
+  EE_SECTION_NAMES_INDEX,// e_shstrndx is not a section
+  EE_SECTION_NAMES_TABLE,// the section name table is outside the file or not terminated
+  EE_SECTION_NAME_OFFSET,// an sh_name is past the end of the name table
+  EE_SECTION_OUTSIDE,// a section that is decoded is not inside the file
+  EE_SYMBOL_ENTRY_SIZE,// sh_entsize too small for a symbol, or not dividing sh_size
+  EE_SYMBOL_STRINGS,// sh_link of a symbol table is not a string table inside the file
+  EE_SEGMENT_ENTRY_SIZE,// e_phentsize smaller than a program header
+  EE_SEGMENT_TABLE_OUTSIDE,// the program header table is not inside the file
+};
+
+std::string_view elf_error_to_string(elf_error error);
+
+/**
+ * @brief The first problem found, and the section or segment it is in
+ */
+struct elf_validation
+{
+  elf_error error;
+  size_t index;// section or segment index, 0 for the header and whole tables
+};
+
+/**
+ * @brief Check everything ElfReader decodes is inside the file.
+ *
+ * Reads the ELF header, the section header table and the program header
+ * table, and nothing else, so the cost is O(sections + segments) whatever
+ * the size of the file.  With extended numbering (e_shnum of 0, e_shstrndx
+ * of SHN_XINDEX) the real values are taken from section 0.  When it passes:
+ *
+ *   - both header tables are inside the file with entries large enough
+ *   - e_shstrndx is a section, the name table is inside the file, ends in a
+ *     null byte and holds every sh_name
+ *   - every symbol, string, note and SHT_SYMTAB_SHNDX table is inside the file
+ *   - every symbol table has whole entries and its sh_link is a string table
+ *     inside the file that ends in a null byte
+ *
+ * so the decoders can index the file without checking every read.  The one
+ * thing left to them is st_name, which can only be checked symbol by symbol:
+ * it is compared against the size of the string table, and thanks to the
+ * final null byte the name is then terminated inside the table.
+ */
+elf_validation validate_elf(const byte *data, size_t size);
+
+/**
+ * @brief A T or the reason there is none, in the manner of std::expected
+ *
+ * The error is two words kept inline, failing allocates nothing.
+ */
+template<typename T>
+class elf_expected
+{
+public:
+  elf_expected(T &&value) : value(std::move(value)), failure{ EE_NONE, 0 } {}
+  elf_expected(elf_validation failure) : failure(failure) {}
+
+  bool has_value() const noexcept { return value.has_value(); }
+  explicit operator bool() const noexcept { return value.has_value(); }
+  T &operator*() { return *value; }
+  const T &operator*() const { return *value; }
+  T *operator->() { return &*value; }
+  const T *operator->() const { return &*value; }
+
+  /**
+   * @brief Why there is no value, EE_NONE when there is one
+   */
+  elf_validation error() const noexcept { return failure; }
+
+private:
+  std::optional<T> value;
+  elf_validation failure;
+};
+
+#endif /* ELFVALIDATOR_HPP */
@@ -0,0 +1,1225 @@
+#include "ElfWriter.hpp"
+#include "Elf_Header_Fields.hpp"
+#include "elf.hpp"
+#include "section_attribute_flags.hpp"
+#include "section_types.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <fcntl.h>
+#include <map>
+#include <string_view>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+
+constexpr uint64_t SHT_RELR = 19;
+constexpr uint64_t SHT_GNU_HASH = 0x6ffffff6;
+constexpr uint64_t SHT_GNU_VERDEF = 0x6ffffffd;
+constexpr uint64_t SHT_GNU_VERNEED = 0x6ffffffe;
+constexpr uint64_t SHT_GNU_VERSYM = 0x6fffffff;
+
+// dynamic tags whose values are sizes of tables that change with the class
+constexpr int64_t DT_PLTRELSZ = 2;
+constexpr int64_t DT_RELASZ = 8;
+constexpr int64_t DT_RELAENT = 9;
+constexpr int64_t DT_SYMENT = 11;
+constexpr int64_t DT_RELSZ = 18;
+constexpr int64_t DT_RELENT = 19;
+constexpr int64_t DT_RELRSZ = 35;
+constexpr int64_t DT_RELRENT = 37;
+
+uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+  return alignment <= 1 ? value : (value + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Appends fields in the output's byte order, noting values that do
+ *        not fit their width
+ */
+struct encoder
+{
+  std::vector<byte> &out;
+  bool msb;
+  bool overflow = false;
+
+  void put(uint64_t value, size_t width)
+  {
+    if (width < 8 && (value >> (8 * width)) != 0) overflow = true;
+    for (size_t ii = 0; ii < width; ii++) {
+      out.push_back(static_cast<byte>(value >> (8 * (msb ? width - ii - 1 : ii))));
+    }
+  }
+
+  /**
+   * @brief A signed value, only the low width bytes of which are written
+   */
+  void put_signed(int64_t value, size_t width)
+  {
+    if (width < 8) {
+      int64_t limit = int64_t{ 1 } << (8 * width - 1);
+      if (value < -limit || value >= limit) overflow = true;
+      value &= static_cast<int64_t>((uint64_t{ 1 } << (8 * width)) - 1);
+    }
+    bool saved = overflow;
+    put(static_cast<uint64_t>(value), width);
+    overflow = saved;
+  }
+
+  /**
+   * @brief Overwrite a field already in out
+   */
+  void set(size_t at, uint64_t value, size_t width)
+  {
+    for (size_t ii = 0; ii < width; ii++) {
+      out[at + ii] = static_cast<byte>(value >> (8 * (msb ? width - ii - 1 : ii)));
+    }
+  }
+};
+
+/**
+ * @brief How source ranges are moved, each is tried in turn until one works
+ *        between the two files
+ */
+enum copy_method {
+  CM_COPY_FILE_RANGE,// no copy at all on file systems that share extents
+  CM_SENDFILE,// through the page cache, e.g. across file systems on older kernels
+  CM_USER,// the caller writes from the mapping
+};
+
+/**
+ * @brief Move size bytes at offset of from to the file position of to
+ *
+ * @param done bytes moved, less than size when method fell back to CM_USER
+ * @return false on a write error
+ */
+bool kernel_copy(int from, uint64_t offset, int to, uint64_t size, copy_method &method, uint64_t &done)
+{
+  done = 0;
+  while (done < size && method != CM_USER) {
+    ssize_t count;
+    if (method == CM_COPY_FILE_RANGE) {
+      loff_t at = static_cast<loff_t>(offset + done);
+      count = ::copy_file_range(from, &at, to, nullptr, size - done, 0);
+    } else {
+      off_t at = static_cast<off_t>(offset + done);
+      count = ::sendfile(to, from, &at, size - done);
+    }
+    if (count < 0 && errno == EINTR) continue;
+    if (count < 0 && (errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP || errno == EINVAL)) {
+      method = static_cast<copy_method>(method + 1);
+      continue;
+    }
+    if (count <= 0) return false;
+    done += static_cast<uint64_t>(count);
+  }
+  return true;
+}
+
+int64_t sign_extend(uint64_t value, size_t width)
+{
+  if (width >= 8) return static_cast<int64_t>(value);
+  uint64_t sign = uint64_t{ 1 } << (8 * width - 1);
+  return static_cast<int64_t>((value ^ sign) - sign);
+}
+
+/**
+ * @brief Re-encodes the tables of a file in another class or byte order
+ */
+struct converter
+{
+  const ElfReader &elf;
+  size_t from;// class index into the field tables
+  size_t to;
+  bool msb;
+
+  size_t word(size_t cls) const { return cls == ELFCLASS64 ? 8 : 4; }
+
+  std::vector<byte> symbols(const Elf_Shdr &sh, bool &overflow) const
+  {
+    std::vector<byte> out;
+    encoder e{ out, msb };
+    uint64_t count = sh.sh_size / sh.sh_entsize;
+    out.reserve(count * (to == ELFCLASS64 ? 24 : 16));
+    for (uint64_t ii = 0; ii < count; ii++) {
+      uint64_t fields[6];
+      size_t at = sh.sh_offset + ii * sh.sh_entsize;
+      for (size_t ff = 0; ff < 6; ff++) {
+        size_t width = elf_symbol_table_fields[ff].sz[from];
+        fields[elf_symbol_field_order[from][ff]] = elf.read_value(at, width);
+        at += width;
+      }
+      for (size_t ff = 0; ff < 6; ff++) {
+        e.put(fields[elf_symbol_field_order[to][ff]], elf_symbol_table_fields[ff].sz[to]);
+      }
+    }
+    overflow = e.overflow;
+    return out;
+  }
+
+  std::vector<byte> relocations(const Elf_Shdr &sh, bool addends, bool &overflow) const
+  {
+    std::vector<byte> out;
+    encoder e{ out, msb };
+    size_t in = word(from);
+    size_t width = word(to);
+    uint64_t count = sh.sh_size / sh.sh_entsize;
+    for (uint64_t ii = 0; ii < count; ii++) {
+      size_t at = sh.sh_offset + ii * sh.sh_entsize;
+      uint64_t offset = elf.read_value(at, in);
+      uint64_t info = elf.read_value(at + in, in);
+      uint64_t symbol = from == ELFCLASS64 ? info >> 32 : info >> 8;
+      uint64_t type = from == ELFCLASS64 ? info & 0xffffffff : info & 0xff;
+      if (to == ELFCLASS32 && (symbol > 0xffffff || type > 0xff)) e.overflow = true;
+      e.put(offset, width);
+      e.put(to == ELFCLASS64 ? symbol << 32 | type : (symbol << 8 | type) & 0xffffffff, width);
+      if (addends) e.put_signed(sign_extend(elf.read_value(at + 2 * in, in), in), width);
+    }
+    overflow = e.overflow;
+    return out;
+  }
+
+  /**
+   * @brief Relative relocations, addresses and bitmaps of the words after
+   *        them, decoded and packed again for the word size of the output
+   */
+  std::vector<byte> relr(const Elf_Shdr &sh, bool &overflow) const
+  {
+    size_t in = word(from);
+    std::vector<uint64_t> addresses;
+    uint64_t base = 0;
+    for (uint64_t at = sh.sh_offset; at + in <= sh.sh_offset + sh.sh_size; at += in) {
+      uint64_t entry = elf.read_value(at, in);
+      if ((entry & 1) == 0) {
+        addresses.push_back(entry);
+        base = entry + in;
+        continue;
+      }
+      for (size_t bit = 1; bit < 8 * in; bit++) {
+        if ((entry >> bit & 1) != 0) addresses.push_back(base + (bit - 1) * in);
+      }
+      base += (8 * in - 1) * in;
+    }
+    std::vector<byte> out;
+    encoder e{ out, msb };
+    size_t width = word(to);
+    size_t bits = 8 * width;
+    for (size_t ii = 0; ii < addresses.size();) {
+      e.put(addresses[ii], width);
+      base = addresses[ii++] + width;
+      while (ii < addresses.size()) {
+        uint64_t bitmap = 0;
+        for (; ii < addresses.size() && addresses[ii] >= base; ii++) {
+          uint64_t distance = addresses[ii] - base;
+          if (distance % width != 0 || distance / width >= bits - 1) break;
+          bitmap |= uint64_t{ 1 } << (distance / width + 1);
+        }
+        if (bitmap == 0) break;
+        e.put(bitmap | 1, width);
+        base += (bits - 1) * width;
+      }
+    }
+    overflow = e.overflow;
+    return out;
+  }
+
+  std::vector<byte> dynamic(const Elf_Shdr &sh, bool &overflow) const
+  {
+    std::vector<byte> out;
+    encoder e{ out, msb };
+    size_t in = word(from);
+    uint64_t relr_size = 0;
+    for (auto &table : elf.section_headers) {
+      bool ignored = false;
+      if (table.sh_type == SHT_RELR && (table.sh_flags & SHF_ALLOC) != 0) relr_size += relr(table, ignored).size();
+    }
+    for (uint64_t at = sh.sh_offset; at + 2 * in <= sh.sh_offset + sh.sh_size; at += 2 * in) {
+      int64_t tag = sign_extend(elf.read_value(at, in), in);
+      uint64_t value = elf.read_value(at + in, in);
+      // relocations are made of words, so they are twice or half the size
+      // they were; a symbol has 32-bit fields too and is 16 or 24 bytes,
+      // and packed relative relocations take what packing them again took
+      if (tag == DT_PLTRELSZ || tag == DT_RELASZ || tag == DT_RELAENT || tag == DT_RELSZ || tag == DT_RELENT) value = value / in * word(to);
+      if (tag == DT_SYMENT) value = to == ELFCLASS64 ? 24 : 16;
+      if (tag == DT_RELRENT) value = word(to);
+      if (tag == DT_RELRSZ) value = relr_size;
+      e.put_signed(tag, word(to));
+      e.put(value, word(to));
+    }
+    overflow = e.overflow;
+    return out;
+  }
+
+  /**
+   * @brief Tables of fixed width words, the same in both classes
+   */
+  std::vector<byte> words(const Elf_Shdr &sh, size_t width) const
+  {
+    std::vector<byte> out;
+    encoder e{ out, msb };
+    for (uint64_t at = sh.sh_offset; at + width <= sh.sh_offset + sh.sh_size; at += width) {
+      e.put(elf.read_value(at, width), width);
+    }
+    return out;
+  }
+
+  /**
+   * @brief A GNU hash table, 32-bit words around a Bloom filter of words of
+   *        the class
+   *
+   * The filter bits depend on the word size, in another class they are set
+   * again from the names of the symbols the table covers, or all of them if
+   * the names cannot be read, which only makes lookups slower.
+   */
+  std::vector<byte> gnu_hash(const Elf_Shdr &sh) const
+  {
+    size_t in = word(from);
+    uint64_t bloom_size = sh.sh_size >= 16 ? elf.read_value(sh.sh_offset + 8, 4) : 0;
+    if (sh.sh_size < 16 || bloom_size > (sh.sh_size - 16) / in) return words(sh, 4);
+    std::vector<byte> out;
+    encoder e{ out, msb };
+    for (uint64_t at = 0; at < 16; at += 4) e.put(elf.read_value(sh.sh_offset + at, 4), 4);
+    std::vector<uint64_t> bloom(bloom_size);
+    if (from == to) {
+      for (uint64_t ii = 0; ii < bloom_size; ii++) bloom[ii] = elf.read_value(sh.sh_offset + 16 + ii * in, in);
+    } else if (!bloom.empty()) {
+      uint64_t first = elf.read_value(sh.sh_offset + 4, 4);
+      uint64_t shift = elf.read_value(sh.sh_offset + 12, 4);
+      size_t bits = 8 * word(to);
+      size_t count = elf.section_headers.size();
+      auto symbols = sh.sh_link < count ? &elf.section_headers[sh.sh_link] : nullptr;
+      auto names = symbols != nullptr && symbols->sh_link < count ? &elf.section_headers[symbols->sh_link] : nullptr;
+      auto table = symbols != nullptr && symbols->sh_entsize >= 4 ? elf.get_bytes(symbols->sh_offset, symbols->sh_size) : nullptr;
+      auto strings = names != nullptr ? reinterpret_cast<const char *>(elf.get_bytes(names->sh_offset, names->sh_size)) : nullptr;
+      if (table == nullptr || strings == nullptr) {
+        std::fill(bloom.begin(), bloom.end(), bits == 64 ? ~uint64_t{ 0 } : 0xffffffff);
+      } else {
+        for (uint64_t ii = first; ii < symbols->sh_size / symbols->sh_entsize; ii++) {
+          uint64_t name = elf.read_value(symbols->sh_offset + ii * symbols->sh_entsize, 4);
+          uint32_t hash = 5381;
+          for (uint64_t at = name; at < names->sh_size && strings[at] != '\0'; at++) hash = hash * 33 + static_cast<unsigned char>(strings[at]);
+          uint64_t second = shift < 32 ? hash >> shift : 0;
+          bloom[hash / bits % bloom_size] |= uint64_t{ 1 } << (hash % bits) | uint64_t{ 1 } << (second % bits);
+        }
+      }
+    }
+    for (auto value : bloom) e.put(value, word(to));
+    for (uint64_t at = 16 + bloom_size * in; at + 4 <= sh.sh_size; at += 4) e.put(elf.read_value(sh.sh_offset + at, 4), 4);
+    return out;
+  }
+
+  /**
+   * @brief Version definitions or needs, chains of records of 2 and 4 byte
+   *        fields the same in both classes
+   *
+   * @param record field widths of the outer record, the offsets of the
+   *        inner chain and of the next record are the last two
+   * @param count which field of the record counts the inner records
+   * @param inner field widths of the inner records, the offset of the next
+   *        one is last
+   */
+  std::vector<byte> versions(const Elf_Shdr &sh, const std::vector<size_t> &record, size_t count, const std::vector<size_t> &inner) const
+  {
+    auto raw = elf.get_bytes(sh.sh_offset, sh.sh_size);
+    std::vector<byte> out(raw, raw + sh.sh_size);
+    encoder e{ out, msb };
+    // rewrites the fields of one record, giving their values
+    auto swap = [&](uint64_t at, const std::vector<size_t> &widths, std::vector<uint64_t> &values) {
+      values.clear();
+      for (auto width : widths) {
+        if (at + width > sh.sh_size) return false;
+        values.push_back(elf.read_value(sh.sh_offset + at, width));
+        e.set(at, values.back(), width);
+        at += width;
+      }
+      return true;
+    };
+    std::vector<uint64_t> outer_values;
+    std::vector<uint64_t> inner_values;
+    // sh_info is the number of records, and bounds a chain that loops
+    uint64_t at = 0;
+    for (uint64_t ii = 0; ii < sh.sh_info && swap(at, record, outer_values); ii++) {
+      uint64_t aux = at + outer_values[record.size() - 2];
+      for (uint64_t jj = 0; jj < outer_values[count] && swap(aux, inner, inner_values) && inner_values.back() != 0; jj++) {
+        aux += inner_values.back();
+      }
+      if (outer_values.back() == 0) break;
+      at += outer_values.back();
+    }
+    return out;
+  }
+
+  /**
+   * @brief Note headers in the output's byte order, names and descriptors
+   *        as they are but for those whose fields are words too: the GNU
+   *        ABI tag and program properties, and SystemTap probes
+   *
+   * GNU properties stay padded as in the input's class, they are in the
+   * loaded image.  The addresses of a probe are words of the class.
+   */
+  std::vector<byte> notes(const Elf_Shdr &sh, bool &overflow) const
+  {
+    auto raw = elf.get_bytes(sh.sh_offset, sh.sh_size);
+    std::vector<byte> out;
+    out.reserve(sh.sh_size);
+    encoder e{ out, msb };
+    size_t in = word(from);
+    uint64_t align = sh.sh_addralign == 8 ? 8 : 4;
+    uint64_t at = 0;
+    while (at + 12 <= sh.sh_size) {
+      uint64_t namesz = elf.read_value(sh.sh_offset + at, 4);
+      uint64_t descsz = elf.read_value(sh.sh_offset + at + 4, 4);
+      uint64_t type = elf.read_value(sh.sh_offset + at + 8, 4);
+      uint64_t desc = align_up(at + 12 + namesz, align);
+      if (desc > sh.sh_size || descsz > sh.sh_size - desc) break;
+      size_t header = out.size();
+      e.put(namesz, 4);
+      e.put(descsz, 4);
+      e.put(type, 4);
+      out.insert(out.end(), raw + at + 12, raw + desc);
+      size_t start = out.size();
+      // the descriptor field at offset of the input in the output's order
+      auto swap = [&](uint64_t offset, size_t width) { e.set(start + offset, elf.read_value(sh.sh_offset + desc + offset, width), width); };
+      std::string_view name(reinterpret_cast<const char *>(raw + at + 12), namesz);
+      if (name == std::string_view("stapsdt", 8) && type == 3 && descsz >= 3 * in) {
+        // pc, base and semaphore addresses, then the probe's strings
+        for (uint64_t offset = 0; offset < 3 * in; offset += in) e.put(elf.read_value(sh.sh_offset + desc + offset, in), word(to));
+        out.insert(out.end(), raw + desc + 3 * in, raw + desc + descsz);
+        e.set(header + 4, out.size() - start, 4);
+      } else {
+        out.insert(out.end(), raw + desc, raw + desc + descsz);
+      }
+      if (name == std::string_view("GNU", 4) && type == NT_GNU_ABI_TAG) {
+        for (uint64_t offset = 0; offset + 4 <= descsz; offset += 4) swap(offset, 4);
+      } else if (name == std::string_view("GNU", 4) && type == NT_GNU_PROPERTY_TYPE_0) {
+        // pr_type, pr_datasz and the data, which is a 4 or 8 byte value
+        for (uint64_t property = 0; property + 8 <= descsz;) {
+          uint64_t size = elf.read_value(sh.sh_offset + desc + property + 4, 4);
+          swap(property, 4);
+          swap(property + 4, 4);
+          if ((size == 4 || size == 8) && property + 8 + size <= descsz) swap(property + 8, size);
+          property = align_up(property + 8 + size, in);
+        }
+      }
+      at = align_up(desc + descsz, align);
+      if (at <= sh.sh_size) out.resize(align_up(out.size(), align));
+    }
+    // a note cut short, or padding
+    if (at < sh.sh_size) out.insert(out.end(), raw + at, raw + sh.sh_size);
+    overflow = e.overflow;
+    return out;
+  }
+};
+
+uint64_t load(const byte *p, size_t width, bool msb)
+{
+  uint64_t value = 0;
+  for (size_t ii = 0; ii < width; ii++) {
+    value |= static_cast<uint64_t>(p[ii]) << (8 * (msb ? width - ii - 1 : ii));
+  }
+  return value;
+}
+
+/**
+ * @brief What is in a model's section, in the model's class and byte order
+ *
+ * @return nullptr for SC_EMPTY and SC_NAMES
+ */
+const byte *contents_of(const output_section &section, const ElfReader &source)
+{
+  if (section.contents == SC_BYTES) return section.bytes.data();
+  if (section.contents == SC_SOURCE) return source.get_bytes(section.source_offset, section.header.sh_size);
+  return nullptr;
+}
+
+bool write_all(int fd, const byte *data, uint64_t size)
+{
+  while (size > 0) {
+    auto count = ::write(fd, data, size);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    data += count;
+    size -= static_cast<uint64_t>(count);
+  }
+  return true;
+}
+
+constexpr uint64_t DROPPED = ~uint64_t{ 0 };
+
+/**
+ * @brief Renumber the section indexes of a symbol table, dropping the
+ *        symbols of removed sections, and the relocations and groups that
+ *        refer to its symbols
+ *
+ * Nothing is re-encoded if no symbol changes, the table stays a copy.
+ */
+bool renumber_symbols(elf_model &model, const ElfReader &source, size_t table, const std::vector<uint64_t> &index, const std::vector<bool> &remove, std::string &error)
+{
+  auto &symbols = model.sections[table];
+  const byte *data = contents_of(symbols, source);
+  size_t cls = model.is64 ? ELFCLASS64 : ELFCLASS32;
+  size_t entry = model.is64 ? 24 : 16;
+  if (data == nullptr) return true;
+  if (symbols.header.sh_entsize != entry) {
+    error = "'" + symbols.header.name + "' has entries of an unknown size";
+    return false;
+  }
+  uint64_t count = symbols.header.sh_size / entry;
+  output_section *extended = nullptr;
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &s = model.sections[ii];
+    if (!remove[ii] && s.header.sh_type == SHT_SYMTAB_SHNDX && s.header.sh_link == table) extended = &s;
+  }
+  const byte *extended_data = extended != nullptr ? contents_of(*extended, source) : nullptr;
+  if (extended_data != nullptr && extended->header.sh_size < count * 4) extended_data = nullptr;
+
+  std::vector<uint64_t> numbers(count, DROPPED);
+  std::vector<byte> out;
+  std::vector<byte> extended_out;
+  encoder e{ out, model.msb };
+  encoder x{ extended_out, model.msb };
+  out.reserve(count * entry);
+  bool changed = false;
+  uint64_t kept = 0;
+  uint64_t locals = 0;
+  for (uint64_t ii = 0; ii < count; ii++) {
+    uint64_t fields[6];
+    const byte *at = data + ii * entry;
+    for (size_t ff = 0; ff < 6; ff++) {
+      size_t width = elf_symbol_table_fields[ff].sz[cls];
+      fields[elf_symbol_field_order[cls][ff]] = load(at, width, model.msb);
+      at += width;
+    }
+    uint64_t shndx = fields[5];
+    bool in_section = shndx != SHN_UNDEF && shndx < SHN_LORESERVE;
+    if (shndx == SHN_XINDEX && extended_data != nullptr) {
+      shndx = load(extended_data + ii * 4, 4, model.msb);
+      in_section = true;
+    }
+    if (in_section && shndx < remove.size() && remove[shndx] && ii != 0) {
+      changed = true;
+      continue;
+    }
+    uint64_t renumbered = in_section && shndx < index.size() ? index[shndx] : shndx;
+    changed = changed || renumbered != shndx;
+    fields[5] = in_section && renumbered >= SHN_LORESERVE ? SHN_XINDEX : in_section ? renumbered : fields[5];
+    if (in_section && renumbered >= SHN_LORESERVE && extended_data == nullptr) {
+      error = "'" + symbols.header.name + "' needs a SHT_SYMTAB_SHNDX table";
+      return false;
+    }
+    for (size_t ff = 0; ff < 6; ff++) {
+      e.put(fields[elf_symbol_field_order[cls][ff]], elf_symbol_table_fields[ff].sz[cls]);
+    }
+    x.put(in_section && renumbered >= SHN_LORESERVE ? renumbered : 0, 4);
+    if (ii < symbols.header.sh_info) locals++;
+    numbers[ii] = kept++;
+  }
+  if (!changed) return true;
+  if (symbols.header.sh_type == SHT_DYNSYM && kept != count) {
+    // the hash tables and versions are indexed by symbol
+    error = "'" + symbols.header.name + "' has symbols in a removed section";
+    return false;
+  }
+  symbols.contents = SC_BYTES;
+  symbols.bytes = std::move(out);
+  symbols.header.sh_info = locals;
+  if (extended_data != nullptr) {
+    extended->contents = SC_BYTES;
+    extended->bytes = std::move(extended_out);
+  }
+  if (kept == count) return true;
+
+  size_t word = model.is64 ? 8 : 4;
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &s = model.sections[ii];
+    if (remove[ii] || s.header.sh_link != table) continue;
+    if (s.header.sh_type == SHT_GROUP) {
+      // the signature symbol
+      if (s.header.sh_info >= count || numbers[s.header.sh_info] == DROPPED) {
+        error = "'" + s.header.name + "' is named by a symbol in a removed section";
+        return false;
+      }
+      s.header.sh_info = numbers[s.header.sh_info];
+      continue;
+    }
+    if (s.header.sh_type != SHT_REL && s.header.sh_type != SHT_RELA) continue;
+    const byte *relocations = contents_of(s, source);
+    size_t size = (s.header.sh_type == SHT_RELA ? 3 : 2) * word;
+    if (relocations == nullptr) continue;
+    if (s.header.sh_entsize != size) {
+      error = "'" + s.header.name + "' has entries of an unknown size";
+      return false;
+    }
+    std::vector<byte> bytes(relocations, relocations + s.header.sh_size);
+    encoder r{ bytes, model.msb };
+    for (uint64_t at = 0; at + size <= bytes.size(); at += size) {
+      uint64_t info = load(bytes.data() + at + word, word, model.msb);
+      uint64_t symbol = model.is64 ? info >> 32 : info >> 8;
+      if (symbol >= count || numbers[symbol] == DROPPED) {
+        error = "'" + s.header.name + "' refers to a symbol in a removed section";
+        return false;
+      }
+      info = model.is64 ? numbers[symbol] << 32 | (info & 0xffffffff) : numbers[symbol] << 8 | (info & 0xff);
+      r.set(at + word, info, word);
+    }
+    s.contents = SC_BYTES;
+    s.bytes = std::move(bytes);
+  }
+  return true;
+}
+
+/**
+ * @brief Renumber the member sections of a group, dropping removed ones
+ */
+void renumber_group(output_section &group, const ElfReader &source, const std::vector<uint64_t> &index, const std::vector<bool> &remove, bool msb)
+{
+  const byte *data = contents_of(group, source);
+  if (data == nullptr || group.header.sh_size < 4) return;
+  std::vector<byte> out;
+  encoder e{ out, msb };
+  bool changed = false;
+  e.put(load(data, 4, msb), 4);// GRP_COMDAT
+  for (uint64_t at = 4; at + 4 <= group.header.sh_size; at += 4) {
+    uint64_t member = load(data + at, 4, msb);
+    if (member < remove.size() && remove[member]) {
+      changed = true;
+      continue;
+    }
+    uint64_t renumbered = member < index.size() ? index[member] : member;
+    changed = changed || renumbered != member;
+    e.put(renumbered, 4);
+  }
+  if (!changed) return;
+  group.contents = SC_BYTES;
+  group.bytes = std::move(out);
+}
+
+}// namespace
+
+
+bool model_of(const ElfReader &elf, bool is64, bool msb, elf_model &model, std::string &error)
+{
+  if (!elf.is_valid()) {
+    error = elf_error_to_string(elf.get_validation().error);
+    return false;
+  }
+  if (elf.section_headers.size() != elf.get_section_header_count()) {
+    error = "the section headers were not read";
+    return false;
+  }
+  model = elf_model{};
+  model.is64 = is64;
+  model.msb = msb;
+  model.osabi = elf.get_osabi();
+  model.abiversion = elf.get_abiversion();
+  model.header = elf.header;
+  model.segments = elf.program_headers;
+  size_t from = elf.is_64bit() ? ELFCLASS64 : ELFCLASS32;
+  size_t to = is64 ? ELFCLASS64 : ELFCLASS32;
+  bool same = from == to && msb == (elf.get_data_encoding() == ELFDATA2MSB);
+  for (auto &p : model.segments) {
+    if (p.p_filesz > 0 && p.p_offset < elf.filesize) model.preserved.emplace_back(p.p_offset, std::min(p.p_filesz, elf.filesize - p.p_offset));
+    // the one segment that describes something the writer lays out
+    if (p.p_type == PT_PHDR && !same) p.p_filesz = p.p_memsz = model.segments.size() * (is64 ? 56 : 32);
+  }
+
+  converter convert{ elf, from, to, msb };
+  size_t word = is64 ? 8 : 4;
+  for (auto &sh : elf.section_headers) {
+    output_section section;
+    section.header = sh;
+    if (sh.index == 0) {
+      // extended numbering is the writer's business
+      section.header = Elf_Shdr{};
+      model.sections.push_back(std::move(section));
+      continue;
+    }
+    section.fixed = !model.segments.empty() && (sh.sh_flags & SHF_ALLOC) != 0;
+    if (sh.index == elf.get_section_names_index()) {
+      section.contents = SC_NAMES;
+      section.fixed = false;// it is built again and can change size
+    } else if (sh.sh_type == SHT_NOBITS || sh.sh_size == 0) {
+      section.contents = SC_EMPTY;
+    } else if (same) {
+      section.contents = SC_SOURCE;
+      section.source_offset = sh.sh_offset;
+    } else {
+      // the validator only bounds the tables the reader decodes
+      if (elf.get_bytes(sh.sh_offset, sh.sh_size) == nullptr) {
+        error = "'" + sh.name + "' is outside the file";
+        return false;
+      }
+      bool overflow = false;
+      section.contents = SC_BYTES;
+      auto &header = section.header;
+      size_t in = elf.is_64bit() ? 8 : 4;
+      if ((sh.sh_type == SHT_SYMTAB || sh.sh_type == SHT_DYNSYM) && sh.sh_entsize >= (from == ELFCLASS64 ? 24 : 16)) {
+        section.bytes = convert.symbols(sh, overflow);
+        header.sh_entsize = is64 ? 24 : 16;
+        header.sh_addralign = word;
+      } else if ((sh.sh_type == SHT_REL || sh.sh_type == SHT_RELA) && sh.sh_entsize >= (sh.sh_type == SHT_RELA ? 3 : 2) * in) {
+        section.bytes = convert.relocations(sh, sh.sh_type == SHT_RELA, overflow);
+        header.sh_entsize = (sh.sh_type == SHT_RELA ? 3 : 2) * word;
+        header.sh_addralign = word;
+      } else if (sh.sh_type == SHT_RELR) {
+        section.bytes = convert.relr(sh, overflow);
+        header.sh_entsize = word;
+        header.sh_addralign = word;
+      } else if (sh.sh_type == SHT_DYNAMIC) {
+        section.bytes = convert.dynamic(sh, overflow);
+        header.sh_entsize = 2 * word;
+        header.sh_addralign = word;
+      } else if (sh.sh_type == SHT_HASH || sh.sh_type == SHT_GROUP || sh.sh_type == SHT_SYMTAB_SHNDX) {
+        section.bytes = convert.words(sh, 4);
+      } else if (sh.sh_type == SHT_GNU_HASH) {
+        section.bytes = convert.gnu_hash(sh);
+      } else if (sh.sh_type == SHT_GNU_VERSYM) {
+        section.bytes = convert.words(sh, 2);
+      } else if (sh.sh_type == SHT_GNU_VERDEF) {
+        section.bytes = convert.versions(sh, { 2, 2, 2, 2, 4, 4, 4 }, 3, { 4, 4 });
+      } else if (sh.sh_type == SHT_GNU_VERNEED) {
+        section.bytes = convert.versions(sh, { 2, 2, 4, 4, 4 }, 1, { 4, 2, 2, 4, 4 });
+      } else if (sh.sh_type == SHT_NOTE) {
+        section.bytes = convert.notes(sh, overflow);
+      } else {
+        // code and data, nothing to say what is in them
+        section.contents = SC_SOURCE;
+        section.source_offset = sh.sh_offset;
+      }
+      if (overflow) {
+        error = "'" + sh.name + "' has values too large for ELF32";
+        return false;
+      }
+    }
+    model.sections.push_back(std::move(section));
+  }
+  return true;
+}
+
+bool is_debug_section(const Elf_Shdr &section)
+{
+  if ((section.sh_flags & SHF_ALLOC) != 0) return false;
+  std::string_view name = section.name;
+  return name.substr(0, 7) == ".debug_" || name.substr(0, 8) == ".zdebug_" || name.substr(0, 5) == ".stab" || name == ".gdb_index";
+}
+
+bool remove_sections(elf_model &model, const ElfReader &source, std::vector<bool> remove, std::string &error)
+{
+  size_t count = model.sections.size();
+  remove.resize(count, false);
+  for (size_t ii = 0; ii < count; ii++) {
+    auto &h = model.sections[ii].header;
+    if (remove[ii] && (ii == 0 || model.sections[ii].contents == SC_NAMES)) {
+      error = "'" + h.name + "' can't be removed";
+      return false;
+    }
+    // relocations of a removed section go with it
+    if ((h.sh_type == SHT_REL || h.sh_type == SHT_RELA) && h.sh_info != 0 && h.sh_info < count && remove[h.sh_info]) remove[ii] = true;
+  }
+  std::vector<uint64_t> index(count, SHN_UNDEF);
+  uint64_t kept = 0;
+  for (size_t ii = 0; ii < count; ii++) {
+    if (!remove[ii]) index[ii] = kept++;
+  }
+  if (kept == count) return true;
+
+  // symbols first, they look their sections up by the old numbers
+  for (size_t ii = 1; ii < count; ii++) {
+    auto type = model.sections[ii].header.sh_type;
+    if (remove[ii] || (type != SHT_SYMTAB && type != SHT_DYNSYM)) continue;
+    if (!renumber_symbols(model, source, ii, index, remove, error)) return false;
+  }
+  for (size_t ii = 1; ii < count; ii++) {
+    auto &s = model.sections[ii];
+    auto &h = s.header;
+    if (remove[ii]) continue;
+    bool info_link = h.sh_type == SHT_REL || h.sh_type == SHT_RELA || (h.sh_flags & SHF_INFO_LINK) != 0;
+    for (auto link : { &h.sh_link, info_link ? &h.sh_info : nullptr }) {
+      if (link == nullptr || *link == 0 || *link >= count) continue;
+      if (remove[*link]) {
+        error = "'" + h.name + "' needs '" + model.sections[*link].header.name + "'";
+        return false;
+      }
+      *link = index[*link];
+    }
+    if (h.sh_type == SHT_GROUP) renumber_group(s, source, index, remove, model.msb);
+  }
+  std::vector<output_section> sections;
+  sections.reserve(kept);
+  for (size_t ii = 0; ii < count; ii++) {
+    if (!remove[ii]) sections.push_back(std::move(model.sections[ii]));
+  }
+  model.sections = std::move(sections);
+  return true;
+}
+
+void keep_only_debug(elf_model &model)
+{
+  // a symbol table's strings, and relocations of what is kept
+  std::vector<bool> keep(model.sections.size(), false);
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &h = model.sections[ii].header;
+    keep[ii] = keep[ii] || is_debug_section(h) || h.sh_type == SHT_NOTE || h.sh_type == SHT_SYMTAB || model.sections[ii].contents == SC_NAMES;
+    if (h.sh_type == SHT_SYMTAB && h.sh_link < keep.size()) keep[h.sh_link] = true;
+  }
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &h = model.sections[ii].header;
+    if ((h.sh_type == SHT_REL || h.sh_type == SHT_RELA) && h.sh_info < keep.size() && is_debug_section(model.sections[h.sh_info].header)) keep[ii] = true;
+  }
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &s = model.sections[ii];
+    s.fixed = false;
+    if (keep[ii] || s.contents == SC_EMPTY) continue;
+    s.contents = SC_EMPTY;
+    s.header.sh_type = SHT_NOBITS;
+    s.bytes.clear();
+  }
+  model.segments.clear();
+  model.preserved.clear();
+}
+
+void add_debuglink(elf_model &model, const std::string &debug_file, uint32_t crc)
+{
+  auto slash = debug_file.rfind('/');
+  std::string name = slash == std::string::npos ? debug_file : debug_file.substr(slash + 1);
+  output_section link;
+  link.header.name = ".gnu_debuglink";
+  link.header.sh_type = SHT_PROGBITS;
+  link.header.sh_addralign = 4;
+  link.contents = SC_BYTES;
+  link.bytes.assign(name.begin(), name.end());
+  link.bytes.resize(align_up(name.size() + 1, 4), 0);
+  encoder e{ link.bytes, model.msb };
+  e.put(crc, 4);
+  for (auto &s : model.sections) {
+    if (s.header.name != link.header.name) continue;
+    s.contents = SC_BYTES;
+    s.bytes = std::move(link.bytes);
+    return;
+  }
+  model.sections.push_back(std::move(link));
+}
+
+bool matches_model(const ElfReader &written, const elf_model &model, std::string &error)
+{
+  if (written.is_64bit() != model.is64 || (written.get_data_encoding() == ELFDATA2MSB) != model.msb) {
+    error = "the class or byte order is not the one written";
+    return false;
+  }
+  if (written.section_headers.size() != model.sections.size() || written.program_headers.size() != model.segments.size()) {
+    error = "the section or segment count is not the one written";
+    return false;
+  }
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &want = model.sections[ii].header;
+    auto &got = written.section_headers[ii];
+    if (got.name != want.name || got.sh_type != want.sh_type || got.sh_flags != want.sh_flags || got.sh_offset != want.sh_offset || got.sh_size != want.sh_size || got.sh_link != want.sh_link || got.sh_info != want.sh_info) {
+      error = "section " + std::to_string(ii) + " '" + got.name + "' does not read back as written";
+      return false;
+    }
+  }
+  for (size_t ii = 0; ii < model.segments.size(); ii++) {
+    auto &want = model.segments[ii];
+    auto &got = written.program_headers[ii];
+    if (got.p_type != want.p_type || got.p_offset != want.p_offset || got.p_filesz != want.p_filesz || got.p_vaddr != want.p_vaddr) {
+      error = "segment " + std::to_string(ii) + " does not read back as written";
+      return false;
+    }
+  }
+  // the loader goes by the entry sizes in the dynamic section, not by the
+  // section headers, so they have to agree
+  size_t in = written.is_64bit() ? 8 : 4;
+  for (auto &sh : written.section_headers) {
+    if (sh.sh_type != SHT_DYNAMIC || written.get_bytes(sh.sh_offset, sh.sh_size) == nullptr) continue;
+    for (uint64_t at = sh.sh_offset; at + 2 * in <= sh.sh_offset + sh.sh_size; at += 2 * in) {
+      auto tag = sign_extend(written.read_value(at, in), in);
+      uint64_t value = written.read_value(at + in, in);
+      if (tag == 0) break;
+      uint64_t type = tag == DT_SYMENT ? uint64_t{ SHT_DYNSYM } : tag == DT_RELAENT ? uint64_t{ SHT_RELA } : tag == DT_RELENT ? uint64_t{ SHT_REL } : tag == DT_RELRENT ? SHT_RELR : uint64_t{ SHT_NULL };
+      if (type == SHT_NULL) continue;
+      for (auto &table : written.section_headers) {
+        if (table.sh_type != type || (table.sh_flags & SHF_ALLOC) == 0 || table.sh_entsize == value) continue;
+        error = "the dynamic section gives '" + table.name + "' entries of " + std::to_string(value) + " bytes, not " + std::to_string(table.sh_entsize);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool extract_section(const ElfReader &source, const Elf_Shdr &section, const std::string &filename, uint64_t &copied, std::string &error)
+{
+  copied = 0;
+  if (section.sh_type == SHT_NOBITS || source.get_bytes(section.sh_offset, section.sh_size) == nullptr) {
+    error = "'" + section.name + "' has no contents in the file";
+    return false;
+  }
+  // renamed into place, filename may be the file the source maps
+  auto temporary = filename + ".tmp";
+  int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    error = "unable to create '" + filename + "'";
+    return false;
+  }
+  auto mapped = source.get_mapped_file();
+  auto method = mapped != nullptr ? CM_COPY_FILE_RANGE : CM_USER;
+  bool ok = method == CM_USER || kernel_copy(mapped->descriptor(), section.sh_offset, fd, section.sh_size, method, copied);
+  ok = ok && write_all(fd, source.get_bytes(section.sh_offset + copied, section.sh_size - copied), section.sh_size - copied);
+  if (::close(fd) != 0 || !ok || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    error = "unable to write '" + filename + "'";
+    return false;
+  }
+  return true;
+}
+
+ElfWriter::ElfWriter(elf_model model, const ElfReader &source) : model(std::move(model)), source(source), laid_out(false), file_size(0), copied(0)
+{
+}
+
+const elf_model &ElfWriter::get_model() const
+{
+  return model;
+}
+
+const std::string &ElfWriter::get_error() const
+{
+  return error;
+}
+
+uint64_t ElfWriter::get_file_size() const
+{
+  return file_size;
+}
+
+uint64_t ElfWriter::get_copied_bytes() const
+{
+  return copied;
+}
+
+bool ElfWriter::layout()
+{
+  if (laid_out) return error.empty();
+  laid_out = true;
+  return place_sections() && (encode_headers(), paint());
+}
+
+/**
+ * @brief Name offsets, sizes and the offset of every section, then of the
+ *        section header table
+ */
+bool ElfWriter::place_sections()
+{
+  auto &h = model.header;
+  uint64_t word = model.is64 ? 8 : 4;
+  h.e_ehsize = model.is64 ? 64 : 52;
+  h.e_phentsize = model.segments.empty() ? 0 : model.is64 ? 56 : 32;
+  h.e_shentsize = model.is64 ? 64 : 40;
+  h.e_phnum = model.segments.size();
+  if (h.e_phnum == 0) h.e_phoff = 0;
+  else if (h.e_phoff < h.e_ehsize) h.e_phoff = align_up(h.e_ehsize, word);
+
+  uint64_t names_index = 0;
+  for (size_t ii = 0; ii < model.sections.size(); ii++) {
+    auto &s = model.sections[ii];
+    if (s.contents == SC_NAMES) names_index = ii;
+    if (s.contents == SC_BYTES) s.header.sh_size = s.bytes.size();
+  }
+  names.assign(1, 0);
+  if (names_index != 0) {
+    // longest first in order of the reversed names, so ".rela.text" is
+    // written before ".text" and ".text" can point into it
+    std::vector<const std::string *> sorted;
+    for (size_t ii = 1; ii < model.sections.size(); ii++) {
+      if (!model.sections[ii].header.name.empty()) sorted.push_back(&model.sections[ii].header.name);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const std::string *a, const std::string *b) { return std::lexicographical_compare(b->rbegin(), b->rend(), a->rbegin(), a->rend()); });
+    std::unordered_map<std::string_view, uint64_t> offsets;
+    offsets.reserve(sorted.size());
+    std::string_view last;
+    uint64_t last_offset = 0;
+    for (auto name : sorted) {
+      auto found = offsets.emplace(*name, 0);
+      if (!found.second) continue;
+      if (last.size() >= name->size() && last.compare(last.size() - name->size(), name->size(), *name) == 0) {
+        found.first->second = last_offset + last.size() - name->size();
+        continue;
+      }
+      found.first->second = last_offset = names.size();
+      names.insert(names.end(), name->begin(), name->end());
+      names.push_back(0);
+      last = *name;
+    }
+    for (auto &s : model.sections) {
+      s.header.sh_name = s.header.name.empty() ? 0 : offsets.find(s.header.name)->second;
+    }
+    model.sections[names_index].header.sh_size = names.size();
+  }
+
+  // everything that stays where it is, the rest goes after it
+  uint64_t end = std::max<uint64_t>(h.e_ehsize, h.e_phoff + h.e_phnum * h.e_phentsize);
+  for (auto &range : model.preserved) {
+    if (range.first + range.second > source.filesize || range.first + range.second < range.first) {
+      error = "a preserved range is outside the source file";
+      return false;
+    }
+    end = std::max(end, range.first + range.second);
+  }
+  for (auto &s : model.sections) {
+    if (s.contents == SC_SOURCE && (s.source_offset + s.header.sh_size > source.filesize || s.source_offset + s.header.sh_size < s.source_offset)) {
+      error = "'" + s.header.name + "' is outside the source file";
+      return false;
+    }
+    if (s.fixed && s.contents != SC_EMPTY) end = std::max(end, s.header.sh_offset + s.header.sh_size);
+  }
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &s = model.sections[ii];
+    if (s.fixed) continue;
+    // no more aligned than it was in the source, a corrupt sh_addralign
+    // would otherwise pad the file out to any size
+    uint64_t alignment = s.header.sh_addralign;
+    uint64_t was = s.header.sh_offset;
+    if (was != 0 && s.contents != SC_EMPTY) alignment = std::min(alignment, was & (~was + 1));
+    s.header.sh_offset = align_up(end, alignment);
+    if (s.contents != SC_EMPTY) end = s.header.sh_offset + s.header.sh_size;
+  }
+
+  uint64_t count = model.sections.size();
+  h.e_shoff = count > 0 ? align_up(end, word) : 0;
+  h.e_shnum = count < SHN_LORESERVE ? count : 0;
+  h.e_shstrndx = names_index < SHN_LORESERVE ? names_index : SHN_XINDEX;
+  if (count > 0) {
+    // what does not fit in the ELF header goes in section 0
+    auto &zero = model.sections[0].header;
+    zero.sh_size = count >= SHN_LORESERVE ? count : 0;
+    zero.sh_link = names_index >= SHN_LORESERVE ? names_index : 0;
+    zero.sh_info = h.e_phnum >= PN_XNUM ? h.e_phnum : 0;
+  }
+  if (count == 0 && h.e_phnum >= PN_XNUM) {
+    error = "more than 65534 segments need a section 0";
+    return false;
+  }
+  file_size = count > 0 ? h.e_shoff + count * h.e_shentsize : end;
+  return true;
+}
+
+/**
+ * @brief The ELF header, the program headers and the section headers one
+ *        after the other in headers
+ */
+void ElfWriter::encode_headers()
+{
+  auto &h = model.header;
+  size_t cls = model.is64 ? ELFCLASS64 : ELFCLASS32;
+  headers.clear();
+  headers.reserve(h.e_ehsize + h.e_phnum * h.e_phentsize + model.sections.size() * h.e_shentsize);
+  encoder e{ headers, model.msb };
+  for (byte b : { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3 }) {
+    e.put(b, 1);
+  }
+  e.put(cls, 1);
+  e.put(model.msb ? ELFDATA2MSB : ELFDATA2LSB, 1);
+  e.put(EV_CURRENT, 1);
+  e.put(model.osabi, 1);
+  e.put(model.abiversion, 1);
+  headers.resize(EI_NIDENT, 0);
+  uint64_t fields[] = { h.e_type, h.e_machine, h.e_version, h.e_entry, h.e_phoff, h.e_shoff, h.e_flags, h.e_ehsize, h.e_phentsize, std::min<uint64_t>(h.e_phnum, PN_XNUM), h.e_shentsize, h.e_shnum, h.e_shstrndx };
+  for (size_t ii = 0; ii < elf_header_fields.size(); ii++) {
+    e.put(fields[ii], elf_header_fields[ii].sz[cls]);
+  }
+
+  for (auto &p : model.segments) {
+    uint64_t values[] = { p.p_type, p.p_flags, p.p_offset, p.p_vaddr, p.p_paddr, p.p_filesz, p.p_memsz, p.p_align };
+    for (size_t ii = 0; ii < elf_program_header_fields.size(); ii++) {
+      e.put(values[elf_program_header_field_order[cls][ii]], elf_program_header_fields[ii].sz[cls]);
+    }
+  }
+
+  for (auto &s : model.sections) {
+    auto &sh = s.header;
+    uint64_t values[] = { sh.sh_name, sh.sh_type, sh.sh_flags, sh.sh_addr, sh.sh_offset, sh.sh_size, sh.sh_link, sh.sh_info, sh.sh_addralign, sh.sh_entsize };
+    for (size_t ii = 0; ii < elf_section_header_fields.size(); ii++) {
+      e.put(values[ii], elf_section_header_fields[ii].sz[cls]);
+    }
+  }
+}
+
+/**
+ * @brief Lay the headers, then the sections, then the preserved ranges over
+ *        each other, each only where nothing is yet
+ */
+bool ElfWriter::paint()
+{
+  struct claim
+  {
+    piece part;
+    const char *header;// what it is, or nullptr for the section named
+    const std::string *name;
+  };
+  auto what = [](const claim &c) { return c.header != nullptr ? std::string(c.header) : "'" + *c.name + "'"; };
+  auto &h = model.header;
+  std::vector<claim> encoded;
+  std::vector<claim> copies;
+  encoded.push_back({ { 0, h.e_ehsize, headers.data(), 0 }, "the ELF header", nullptr });
+  if (h.e_phnum > 0) encoded.push_back({ { h.e_phoff, h.e_phnum * h.e_phentsize, headers.data() + h.e_ehsize, 0 }, "the program headers", nullptr });
+  if (!model.sections.empty()) encoded.push_back({ { h.e_shoff, model.sections.size() * h.e_shentsize, headers.data() + h.e_ehsize + h.e_phnum * h.e_phentsize, 0 }, "the section headers", nullptr });
+  for (auto &s : model.sections) {
+    auto &sh = s.header;
+    if (sh.sh_size == 0) continue;
+    if (s.contents == SC_BYTES) encoded.push_back({ { sh.sh_offset, sh.sh_size, s.bytes.data(), 0 }, nullptr, &sh.name });
+    if (s.contents == SC_NAMES) encoded.push_back({ { sh.sh_offset, sh.sh_size, names.data(), 0 }, nullptr, &sh.name });
+    if (s.contents == SC_SOURCE) copies.push_back({ { sh.sh_offset, sh.sh_size, nullptr, s.source_offset }, nullptr, &sh.name });
+  }
+  auto by_offset = [](const claim &a, const claim &b) { return a.part.offset < b.part.offset; };
+  std::sort(encoded.begin(), encoded.end(), by_offset);
+  std::sort(copies.begin(), copies.end(), by_offset);
+  for (size_t ii = 1; ii < encoded.size(); ii++) {
+    auto &before = encoded[ii - 1].part;
+    if (before.offset + before.size > encoded[ii].part.offset) {
+      error = what(encoded[ii - 1]) + " overlaps " + what(encoded[ii]);
+      return false;
+    }
+  }
+  // a section that is copied must not lose bytes to encoded output
+  for (auto &c : copies) {
+    auto it = std::upper_bound(encoded.begin(), encoded.end(), c, by_offset);
+    if (it != encoded.begin() && std::prev(it)->part.offset + std::prev(it)->part.size > c.part.offset) it = std::prev(it);
+    if (it != encoded.end() && it->part.offset < c.part.offset + c.part.size) {
+      error = what(*it) + " overlaps " + what(c);
+      return false;
+    }
+  }
+
+  std::map<uint64_t, piece> painted;
+  auto add = [&painted](const piece &p) {
+    uint64_t end = p.offset + p.size;
+    auto it = painted.upper_bound(p.offset);
+    if (it != painted.begin() && std::prev(it)->second.offset + std::prev(it)->second.size > p.offset) it = std::prev(it);
+    std::vector<piece> gaps;
+    uint64_t cursor = p.offset;
+    auto gap = [&](uint64_t from, uint64_t to) {
+      uint64_t skip = from - p.offset;
+      gaps.push_back({ from, to - from, p.data != nullptr ? p.data + skip : nullptr, p.source_offset + skip });
+    };
+    for (; it != painted.end() && it->second.offset < end; ++it) {
+      if (it->second.offset > cursor) gap(cursor, it->second.offset);
+      cursor = std::max(cursor, it->second.offset + it->second.size);
+    }
+    if (cursor < end) gap(cursor, end);
+    for (auto &g : gaps) {
+      painted.emplace(g.offset, g);
+    }
+  };
+  for (auto &c : encoded) {
+    add(c.part);
+  }
+  for (auto &c : copies) {
+    add(c.part);
+  }
+  for (auto &range : model.preserved) {
+    add({ range.first, range.second, nullptr, range.first });
+  }
+  pieces.clear();
+  for (auto &p : painted) {
+    auto &next = p.second;
+    if (next.offset + next.size > file_size) file_size = next.offset + next.size;
+    // one copy_file_range() or iovec for what lines up on both sides
+    if (!pieces.empty()) {
+      auto &last = pieces.back();
+      bool follows = last.offset + last.size == next.offset;
+      if (follows && last.data == nullptr && next.data == nullptr && last.source_offset + last.size == next.source_offset) {
+        last.size += next.size;
+        continue;
+      }
+      if (follows && last.data != nullptr && last.data + last.size == next.data) {
+        last.size += next.size;
+        continue;
+      }
+    }
+    pieces.push_back(next);
+  }
+  return true;
+}
+
+bool ElfWriter::write(const std::string &filename)
+{
+  if (!layout()) return false;
+  copied = 0;
+  auto mapped = source.get_mapped_file();
+  mode_t mode = 0644;
+  struct stat info;
+  if (mapped != nullptr && ::fstat(mapped->descriptor(), &info) == 0) mode = info.st_mode & 0777;
+  auto temporary = filename + ".tmp";
+  int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+  if (fd < 0) {
+    error = "unable to create '" + filename + "'";
+    return false;
+  }
+
+  static const byte zeros[1 << 16] = {};
+  std::vector<iovec> pending;
+  auto flush = [&]() {
+    size_t first = 0;
+    while (first < pending.size()) {
+      auto count = ::writev(fd, pending.data() + first, static_cast<int>(std::min<size_t>(pending.size() - first, IOV_MAX)));
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return false;
+      // step over what was written, partial writes leave an iovec half done
+      auto done = static_cast<size_t>(count);
+      while (first < pending.size() && done >= pending[first].iov_len) {
+        done -= pending[first++].iov_len;
+      }
+      if (done > 0) {
+        pending[first].iov_base = static_cast<byte *>(pending[first].iov_base) + done;
+        pending[first].iov_len -= done;
+      }
+    }
+    pending.clear();
+    return true;
+  };
+  auto queue = [&](const byte *data, uint64_t size) {
+    pending.push_back({ const_cast<byte *>(data), size });
+    return pending.size() < IOV_MAX || flush();
+  };
+  auto fill = [&](uint64_t size) {
+    for (; size > 0;) {
+      uint64_t part = std::min<uint64_t>(size, sizeof(zeros));
+      if (!queue(zeros, part)) return false;
+      size -= part;
+    }
+    return true;
+  };
+
+  auto method = mapped != nullptr ? CM_COPY_FILE_RANGE : CM_USER;
+  bool ok = true;
+  uint64_t position = 0;
+  for (auto &p : pieces) {
+    ok = ok && fill(p.offset - position);
+    position = p.offset + p.size;
+    if (!ok) break;
+    if (p.data != nullptr) {
+      ok = queue(p.data, p.size);
+      continue;
+    }
+    uint64_t done = 0;
+    if (method != CM_USER) {
+      ok = flush() && kernel_copy(mapped->descriptor(), p.source_offset, fd, p.size, method, done);
+      copied += done;
+    }
+    // from the mapping, or the bytes of a reader that was not given a file
+    if (ok && done < p.size) ok = queue(source.get_bytes(p.source_offset + done, p.size - done), p.size - done);
+  }
+  ok = ok && fill(file_size - position) && flush();
+  if (::close(fd) != 0 || !ok || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    error = "unable to write '" + filename + "'";
+    return false;
+  }
+  return true;
+}
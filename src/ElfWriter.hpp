@@ -0,0 +1,185 @@
+#ifndef ELFWRITER_HPP
+#define ELFWRITER_HPP
+
+#include "ElfReader.hpp"
+#include "Elf_Ehdr.hpp"
+#include "Elf_Phdr.hpp"
+#include "Elf_Shdr.hpp"
+#include "elf_common.hpp"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Where the contents of an output section come from
+ */
+enum section_contents {
+  SC_EMPTY,// SHT_NOBITS and empty sections, nothing in the file
+  SC_SOURCE,// sh_size bytes of the source file at source_offset, copied by the kernel
+  SC_BYTES,// already encoded in the output's class and byte order
+  SC_NAMES,// the section name table, built from Elf_Shdr::name by the writer
+};
+
+struct output_section
+{
+  Elf_Shdr header{};// sh_name and sh_offset are worked out, sh_size too for SC_BYTES and SC_NAMES.  sh_offset starts as the source offset, alignment past what it had is not kept
+  section_contents contents = SC_EMPTY;
+  uint64_t source_offset = 0;
+  bool fixed = false;// stays at header.sh_offset, for sections inside segments
+  std::vector<byte> bytes;
+};
+
+/**
+ * @brief What ElfWriter writes: the ELF header fields that are not about
+ *        layout, the sections and the segments
+ */
+struct elf_model
+{
+  bool is64 = true;
+  bool msb = false;
+  byte osabi = 0;
+  byte abiversion = 0;
+  Elf_Ehdr header{};// e_type, e_machine, e_version, e_entry and e_flags, and e_phoff when it is not 0
+  std::vector<output_section> sections;// [0] is the null section, sh_link and sh_info are indexes into this
+  std::vector<Elf_Phdr> segments;// written as they are, offsets are in the output
+  std::vector<std::pair<uint64_t, uint64_t>> preserved;// offset and size ranges of the source kept at the same offset, the loaded segments
+};
+
+/**
+ * @brief Model of a parsed file, to write it again or to edit first
+ *
+ * Sections in segments keep their offsets and the segments' bytes are
+ * preserved, everything else is packed after them.  Given a different class
+ * or byte order the symbol, relocation, packed relocation, dynamic, hash, GNU
+ * hash, group, version and note tables are re-encoded; other contents are
+ * copied as they are.
+ *
+ * @param error why the file can't be converted, e.g. a value too large for
+ *        ELF32
+ * @return false with error set
+ */
+bool model_of(const ElfReader &elf, bool is64, bool msb, elf_model &model, std::string &error);
+
+/**
+ * @brief .debug_*, .zdebug_*, .stab* and .gdb_index sections that are not
+ *        loaded
+ */
+bool is_debug_section(const Elf_Shdr &section);
+
+/**
+ * @brief Take sections out of a model along with what only they need
+ *
+ * Relocations of a removed section go too.  Section indexes in sh_link,
+ * sh_info, symbols and groups are renumbered, and symbols defined in a
+ * removed section are dropped with the relocations and groups renumbered to
+ * match.  Tables that don't change stay copies of the source.
+ *
+ * @param remove a flag per model section
+ * @return false with error set if something kept needs a removed section,
+ *         the model is then only partly changed
+ */
+bool remove_sections(elf_model &model, const ElfReader &source, std::vector<bool> remove, std::string &error);
+
+/**
+ * @brief Make a model the separate debug file of the file it came from
+ *
+ * Every section keeps its header and index, only the debug sections, notes,
+ * the symbol table and the strings and relocations that go with them keep
+ * their contents, the rest become SHT_NOBITS.  The program headers are
+ * dropped, nothing in the file is loaded.
+ */
+void keep_only_debug(elf_model &model);
+
+/**
+ * @brief Add or replace the .gnu_debuglink section naming a debug file
+ *
+ * @param crc crc32() of the whole debug file
+ */
+void add_debuglink(elf_model &model, const std::string &debug_file, uint32_t crc);
+
+/**
+ * @brief Check a written file read back as its model: the class and byte
+ *        order, and every section and segment where it was put
+ */
+bool matches_model(const ElfReader &written, const elf_model &model, std::string &error);
+
+/**
+ * @brief Write the contents of one section to a file of their own, moved by
+ *        the kernel and renamed into place like ElfWriter::write() does
+ *
+ * @param copied bytes moved by the kernel
+ */
+bool extract_section(const ElfReader &source, const Elf_Shdr &section, const std::string &filename, uint64_t &copied, std::string &error);
+
+/**
+ * @brief Write an elf_model as an ELF32 or ELF64 file in either byte order.
+ *
+ * The layout is worked out once, then the file is written front to back:
+ * headers and encoded tables are gathered with writev() and source ranges
+ * are moved with copy_file_range(), so section payloads never pass through
+ * user space.  Where the kernel can't copy between the two files sendfile()
+ * is tried, then the range is written straight from the source mapping.
+ *
+ * Sections, headers and preserved ranges are painted over each other in
+ * that order of precedence, bytes nothing covers are zero.  Encoded output
+ * that would overlap other encoded output is an error.
+ */
+class ElfWriter
+{
+public:
+  /**
+   * @param source where SC_SOURCE sections and preserved ranges are read
+   *        from, it has to outlive the writer
+   */
+  ElfWriter(elf_model model, const ElfReader &source);
+
+  /**
+   * @brief Work out every offset, write() calls it when it has not been
+   *
+   * @return false with get_error() set if the model does not fit together
+   */
+  bool layout();
+
+  /**
+   * @brief Write the file under a temporary name in the same directory and
+   *        rename it into place, so filename may be the file being read
+   */
+  bool write(const std::string &filename);
+
+  /**
+   * @brief The model with the offsets, sizes and name offsets filled in
+   */
+  const elf_model &get_model() const;
+  const std::string &get_error() const;
+  uint64_t get_file_size() const;
+
+  /**
+   * @brief Bytes moved by copy_file_range() in the last write(), the rest
+   *        went through writev() or write()
+   */
+  uint64_t get_copied_bytes() const;
+
+private:
+  struct piece
+  {
+    uint64_t offset;
+    uint64_t size;
+    const byte *data;// nullptr for a range of the source
+    uint64_t source_offset;
+  };
+
+  elf_model model;
+  const ElfReader &source;
+  std::string error;
+  bool laid_out;
+  uint64_t file_size;
+  uint64_t copied;
+  std::vector<byte> headers;// ELF header, program headers and section headers
+  std::vector<byte> names;
+  std::vector<piece> pieces;
+
+  bool place_sections();
+  void encode_headers();
+  bool paint();
+};
+
+#endif /* ELFWRITER_HPP */
@@ -0,0 +1,21 @@
+#include "Elf_Note.hpp"
+#include "elf.hpp"
+
+bool Elf_Note::is_core() const
+{
+  return name == "CORE" || name == "LINUX";
+}
+
+bool Elf_Note::is_gnu() const
+{
+  return name == "GNU";
+}
+
+
+std::ostream &operator<<(std::ostream &out, Elf_Note const &note)
+{
+  out << "Owner: " << note.name << " ";
+  out << "Type: " << elf_note_type_to_string(note.name, note.n_type) << " (" << std::hex << "0x" << note.n_type << std::dec << ") ";
+  out << "Descriptor size: " << std::hex << "0x" << note.n_descsz << std::dec;
+  return out;
+}
@@ -0,0 +1,27 @@
+#ifndef ELF_NOTE_HPP
+#define ELF_NOTE_HPP
+
+#include "elf_common.hpp"
+#include <iostream>
+
+/**
+ * @brief One entry from a PT_NOTE segment or SHT_NOTE section.
+ *
+ * The descriptor is not copied, we only record where it lives in the file so
+ * large notes (e.g. NT_FILE in a core) cost nothing until they are decoded.
+ */
+struct Elf_Note
+{
+  ELF_ULONG n_namesz;
+  ELF_ULONG n_descsz;
+  ELF_ULONG n_type;
+  std::string name;
+  ELF_ULONG desc_offset;// file offset of the descriptor
+
+  bool is_core() const;
+  bool is_gnu() const;
+};
+
+std::ostream &operator<<(std::ostream &out, Elf_Note const &note);
+
+#endif /* ELF_NOTE_HPP */
@@ -1,18 +1,25 @@
 #include "Elf_Phdr.hpp"
 #include "elf.hpp"
 
-std::ostream &operator<<(std::ostream &out, Elf_Phdr const &header)
+void write_text(OutputBuffer &out, Elf_Phdr const &header)
 {
-  out << "Type: " << elf_program_type_to_string(header.p_type) << std::endl;
-  out << "Offset: " << std::hex << "0x" << header.p_offset << std::dec << std::endl;
-  out << "Virtual Address: " << std::hex << "0x" << header.p_vaddr << std::dec << std::endl;
-  out << "Physical Address: " << std::hex << "0x" << header.p_paddr << std::dec << std::endl;
-  out << "File size: " << std::hex << "0x" << header.p_filesz << std::dec << std::endl;
-  out << "Memory size: " << std::hex << "0x" << header.p_memsz << std::dec << std::endl;
-  out << "Flags: " << std::hex << "0x" << header.p_flags << std::dec << std::endl;
+  out.put("Type: ").put(elf_program_type_to_string(header.p_type)).put('\n');
+  out.put("Offset: 0x").hex(header.p_offset).put('\n');
+  out.put("Virtual Address: 0x").hex(header.p_vaddr).put('\n');
+  out.put("Physical Address: 0x").hex(header.p_paddr).put('\n');
+  out.put("File size: 0x").hex(header.p_filesz).put('\n');
+  out.put("Memory size: 0x").hex(header.p_memsz).put('\n');
+  out.put("Flags: 0x").hex(header.p_flags).put('\n');
   if (header.p_flags > 0) {
-    out << elf_program_flag_to_string(header.p_flags) << std::endl;
+    write_program_flags(out, header.p_flags);
+    out.put('\n');
   }
-  out << "Alignment: " << std::hex << "0x" << header.p_align << std::dec << std::endl;
+  out.put("Alignment: 0x").hex(header.p_align).put('\n');
+}
+
+std::ostream &operator<<(std::ostream &out, Elf_Phdr const &header)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, header);
   return out;
 }
@@ -1,6 +1,7 @@
 #ifndef ELF_PHDR_HPP
 #define ELF_PHDR_HPP
 
+#include "OutputBuffer.hpp"
 #include "elf.hpp"
 
 struct Elf_Phdr
@@ -18,6 +19,7 @@ struct Elf_Phdr
 };
 
 std::ostream &operator<<(std::ostream &out, Elf_Phdr const &header);
+void write_text(OutputBuffer &out, Elf_Phdr const &header);
 
 
 #endif /* ELF_PHDR_HPP */
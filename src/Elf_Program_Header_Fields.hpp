@@ -1,6 +1,7 @@
 #ifndef ELF_PROGRAM_HEADER_FIELDS_HPP
 #define ELF_PROGRAM_HEADER_FIELDS_HPP
 
+#include <cstdint>
 #include <cstdlib>
 #include <array>
 
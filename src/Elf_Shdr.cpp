@@ -90,60 +90,68 @@ uint64_t Elf_Shdr::get_index_of_symbol_table() const
 }
 
 
-std::ostream &operator<<(std::ostream &out, Elf_Shdr const &header)
-{
-  out << "[" << header.index << "] " << e_section_types_to_string(header.sh_type) << " Name: " << header.name << "\n";
-  out << "  "
-      << "flags:" << std::hex << "0x" << header.sh_addr << std::dec << " ";
-  out << (header.is_writable() ? "WRITE " : "");
-  out << (header.is_allocated() ? "ALLOC " : "");
-  out << (header.is_executable() ? "EXEC " : "");
-  out << (header.is_merged() ? "MERGE " : "");
-  out << (header.is_strings() ? "STRINGS " : "");
-  out << (header.is_info_link() ? "INFO " : "");
-  out << (header.is_link_order() ? "LINK " : "");
-  out << (header.is_os_nonconforming() ? "OS_NONCONFORMING" : "");
-  out << (header.is_grouped() ? "GROUPED " : "");
-  out << (header.is_tls() ? "THREAD " : "");
-  out << (header.is_compressed() ? "COMPRESS " : "");
-  out << (header.has_os_flags() ? "OS_MASK " : "");
-  out << (header.has_cpu_flags() ? "CPU_MASK " : "");
-  out << "\n";
-  out << "  ";
-  out << "mem_addr:" << std::hex << "0x" << header.sh_addr << std::dec << " ";
-  out << "offset:" << std::hex << "0x" << header.sh_offset << std::dec << " ";
-  out << "size:" << std::hex << "0x" << header.sh_size << std::dec << " ";
-  out << "\n";
-  out << "  ";
-  out << "link:" << std::hex << "0x" << header.sh_link << std::dec << " ";
-  out << "info:" << std::hex << "0x" << header.sh_info << std::dec << "\n";
+void write_text(OutputBuffer &out, Elf_Shdr const &header)
+{
+  out.put('[').dec(header.index).put("] ").put(e_section_types_to_string(header.sh_type)).put(" Name: ").put(header.name).put('\n');
+  out.put("  ")
+    .put("flags:0x")
+    .hex(header.sh_addr)
+    .put(' ');
+  out.put(header.is_writable() ? "WRITE " : "");
+  out.put(header.is_allocated() ? "ALLOC " : "");
+  out.put(header.is_executable() ? "EXEC " : "");
+  out.put(header.is_merged() ? "MERGE " : "");
+  out.put(header.is_strings() ? "STRINGS " : "");
+  out.put(header.is_info_link() ? "INFO " : "");
+  out.put(header.is_link_order() ? "LINK " : "");
+  out.put(header.is_os_nonconforming() ? "OS_NONCONFORMING" : "");
+  out.put(header.is_grouped() ? "GROUPED " : "");
+  out.put(header.is_tls() ? "THREAD " : "");
+  out.put(header.is_compressed() ? "COMPRESS " : "");
+  out.put(header.has_os_flags() ? "OS_MASK " : "");
+  out.put(header.has_cpu_flags() ? "CPU_MASK " : "");
+  out.put('\n');
+  out.put("  ");
+  out.put("mem_addr:0x").hex(header.sh_addr).put(' ');
+  out.put("offset:0x").hex(header.sh_offset).put(' ');
+  out.put("size:0x").hex(header.sh_size).put(' ');
+  out.put('\n');
+  out.put("  ");
+  out.put("link:0x").hex(header.sh_link).put(' ');
+  out.put("info:0x").hex(header.sh_info).put('\n');
   if (header.get_associated_string_table() != 0) {
-    out << "  ";
-    out << "  ";
-    out << "String table: " << header.get_associated_string_table() << std::endl;
+    out.put("  ");
+    out.put("  ");
+    out.put("String table: ").dec(header.get_associated_string_table()).put('\n');
   }
   if (header.get_associated_symbol_table() != 0) {
-    out << "  ";
-    out << "  ";
-    out << "Symbol table: " << header.get_associated_symbol_table() << std::endl;
+    out.put("  ");
+    out.put("  ");
+    out.put("Symbol table: ").dec(header.get_associated_symbol_table()).put('\n');
   }
   if (header.get_index_for_relocation() != 0) {
-    out << "  ";
-    out << "  ";
-    out << "Table index that relocation applies to: " << header.get_index_for_relocation() << std::endl;
+    out.put("  ");
+    out.put("  ");
+    out.put("Table index that relocation applies to: ").dec(header.get_index_for_relocation()).put('\n');
   }
   if (header.get_index_last_local_symbol() != 0) {
-    out << "  ";
-    out << "  ";
-    out << "Table index of last local symbol+1: " << header.get_index_last_local_symbol() << std::endl;
+    out.put("  ");
+    out.put("  ");
+    out.put("Table index of last local symbol+1: ").dec(header.get_index_last_local_symbol()).put('\n');
   }
   if (header.get_index_of_symbol_table() != 0) {
-    out << "  ";
-    out << "  ";
-    out << "Table index of an entry in the associated symbol table: " << header.get_index_of_symbol_table() << std::endl;
+    out.put("  ");
+    out.put("  ");
+    out.put("Table index of an entry in the associated symbol table: ").dec(header.get_index_of_symbol_table()).put('\n');
   }
-  out << "  ";
-  out << "addralign:" << std::hex << "0x" << header.sh_addralign << std::dec << " ";
-  out << "entry size:" << std::hex << "0x" << header.sh_entsize << std::dec << " ";
+  out.put("  ");
+  out.put("addralign:0x").hex(header.sh_addralign).put(' ');
+  out.put("entry size:0x").hex(header.sh_entsize).put(' ');
+}
+
+std::ostream &operator<<(std::ostream &out, Elf_Shdr const &header)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, header);
   return out;
 }
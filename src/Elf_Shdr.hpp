@@ -1,6 +1,7 @@
 #ifndef ELF_SHDR_HPP
 #define ELF_SHDR_HPP
 
+#include "OutputBuffer.hpp"
 #include "elf_common.hpp"
 #include <iostream>
 
@@ -65,5 +66,6 @@ struct Elf_Shdr
 };
 
 std::ostream &operator<<(std::ostream &out, Elf_Shdr const &header);
+void write_text(OutputBuffer &out, Elf_Shdr const &header);
 
 #endif /* ELF_SHDR_HPP */
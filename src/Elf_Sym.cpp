@@ -7,29 +7,35 @@ bool Elf_Sym::is_in_symtab_shndx() const
 }
 
 
-std::ostream &operator<<(std::ostream &out, Elf_Sym const &header)
+void write_text(OutputBuffer &out, Elf_Sym const &header)
 {
-  out << "[" << header.name << "] value:";
-  out << std::hex << "0x" << header.st_value << std::dec << " ";
+  out.put('[').put(header.name).put("] value:");
+  out.put("0x").hex(header.st_value).put(' ');
   if (header.st_shndx == SHN_COMMON) {
-    out << "ALIGNMENT_CONSTRAINT ";
+    out.put("ALIGNMENT_CONSTRAINT ");
   }
   if (header.file_type == ET_REL) {
-    out << "DEFINED_SYMBOL_OFFSET ";
+    out.put("DEFINED_SYMBOL_OFFSET ");
   }
   if (header.file_type == ET_EXEC || header.file_type == ET_DYN) {
-    out << "VIRTUAL_ADDRESS ";
+    out.put("VIRTUAL_ADDRESS ");
   }
-  out << "\n";
-  out << "       ";
-  out << "size: " << std::hex << "0x" << header.st_size << std::dec << "\n";
-  out << "       ";
-  out << "info: " << std::hex << "0x" << static_cast<uint64_t>(header.st_info) << std::dec << " ";
-  out << "Bind: " << elf_sym_binding_to_string(ELF64_ST_BIND(header.st_info)) << " ";
-  out << "Type: " << elf_sym_type_to_string(ELF64_ST_TYPE(header.st_info)) << "\n";
-  out << "       ";
-  out << "visibility: " << elf_sym_visibility_to_string(header.st_other) << " (" << std::hex << "0x" << static_cast<uint64_t>(header.st_other) << std::dec << ")\n";
-  out << "       ";
-  out << "section: " << header.st_shndx << " " << elf_special_section_types_to_string(header.st_shndx) << " SHN_XINDEX: " << (header.is_in_symtab_shndx() == true ? "true" : "false");
+  out.put('\n');
+  out.put("       ");
+  out.put("size: 0x").hex(header.st_size).put('\n');
+  out.put("       ");
+  out.put("info: 0x").hex(header.st_info).put(' ');
+  out.put("Bind: ").put(elf_sym_binding_to_string(ELF64_ST_BIND(header.st_info))).put(' ');
+  out.put("Type: ").put(elf_sym_type_to_string(ELF64_ST_TYPE(header.st_info))).put('\n');
+  out.put("       ");
+  out.put("visibility: ").put(elf_sym_visibility_to_string(header.st_other)).put(" (0x").hex(header.st_other).put(")\n");
+  out.put("       ");
+  out.put("section: ").dec(header.st_shndx).put(' ').put(elf_special_section_types_to_string(header.st_shndx)).put(" SHN_XINDEX: ").put(header.is_in_symtab_shndx() == true ? "true" : "false");
+}
+
+std::ostream &operator<<(std::ostream &out, Elf_Sym const &header)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, header);
   return out;
 }
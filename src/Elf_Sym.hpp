@@ -1,7 +1,9 @@
 #ifndef ELF_SYM_HPP
 #define ELF_SYM_HPP
 
+#include "OutputBuffer.hpp"
 #include "elf_common.hpp"
+#include <string_view>
 
 struct elf_symbol_table_fields_t
 {
@@ -18,12 +20,14 @@ struct Elf_Sym
   unsigned char st_info;
   unsigned char st_other;
   ELF_ULONG st_shndx;
-  std::string name;
+  ELF_ULONG index;// in the symbol table, also when a filter dropped the entries before it
+  std::string_view name;// into the file, or the ParseCache entry it came from
   ELF_ULONG file_type;
 
   bool is_in_symtab_shndx() const;
 };
 
 std::ostream &operator<<(std::ostream &out, Elf_Sym const &header);
+void write_text(OutputBuffer &out, Elf_Sym const &header);
 
 #endif /* ELF_SYM_HPP */
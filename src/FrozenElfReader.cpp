@@ -0,0 +1,146 @@
+#include "FrozenElfReader.hpp"
+
+
+FrozenElfReader::FrozenElfReader(std::unique_ptr<const ElfReader> elf) : elf(std::move(elf)), symbols(collect_symbols(*this->elf)), discarded(0)
+{
+  for (auto &o : orders) {
+    o.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+FrozenElfReader::FrozenElfReader(const std::string &filename, ParseOptions options) : FrozenElfReader(std::make_unique<const ElfReader>(filename, options))
+{
+}
+
+FrozenElfReader::~FrozenElfReader()
+{
+  for (auto &o : orders) {
+    delete o.load(std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief The order, built and published by whichever thread needs it first
+ *
+ * The release on a successful exchange pairs with the acquire loads, a thread
+ * that sees the pointer sees the finished vector behind it.
+ */
+const std::vector<uint32_t> &FrozenElfReader::order(order_kind kind) const
+{
+  auto published = orders[kind].load(std::memory_order_acquire);
+  if (published != nullptr) return *published;
+
+  std::unique_ptr<const std::vector<uint32_t>> built;
+  switch (kind) {
+  case OK_NAME:
+    built = std::make_unique<const std::vector<uint32_t>>(build_name_order(symbols));
+    break;
+  case OK_ADDRESS:
+    built = std::make_unique<const std::vector<uint32_t>>(build_address_order(*elf, symbols));
+    break;
+  case OK_SECTION:
+    built = std::make_unique<const std::vector<uint32_t>>(build_section_order(*elf));
+    break;
+  default:
+    built = std::make_unique<const std::vector<uint32_t>>(build_segment_order(*elf));
+    break;
+  }
+  if (orders[kind].compare_exchange_strong(published, built.get(), std::memory_order_acq_rel, std::memory_order_acquire)) {
+    return *built.release();
+  }
+  // another thread published first, published now holds its order
+  discarded.fetch_add(1, std::memory_order_relaxed);
+  return *published;
+}
+
+const ElfReader &FrozenElfReader::get_reader() const
+{
+  return *elf;
+}
+
+uint64_t FrozenElfReader::get_discarded_count() const
+{
+  return discarded.load(std::memory_order_relaxed);
+}
+
+uint64_t FrozenElfReader::get_file_size() const
+{
+  return elf->filesize;
+}
+
+const Elf_Ehdr &FrozenElfReader::get_header() const
+{
+  return elf->header;
+}
+
+size_t FrozenElfReader::section_count() const
+{
+  return elf->section_headers.size();
+}
+
+section_view FrozenElfReader::section(size_t index) const
+{
+  auto &sh = elf->section_headers[index];
+  return { index, sh.name, sh.sh_type, sh.sh_flags, sh.sh_addr, sh.sh_offset, sh.sh_size, sh.sh_link, sh.sh_info, sh.sh_addralign, sh.sh_entsize };
+}
+
+size_t FrozenElfReader::segment_count() const
+{
+  return elf->program_headers.size();
+}
+
+Elf_Phdr FrozenElfReader::segment(size_t index) const
+{
+  return elf->program_headers[index];
+}
+
+size_t FrozenElfReader::symbol_count() const
+{
+  return symbols.size();
+}
+
+symbol_view FrozenElfReader::symbol(size_t index) const
+{
+  auto &sym = *symbols[index].second;
+  return { index, symbols[index].first, sym.name, sym.st_value, sym.st_size, sym.st_info, sym.st_other, sym.st_shndx };
+}
+
+size_t FrozenElfReader::name_order_count() const
+{
+  return order(OK_NAME).size();
+}
+
+size_t FrozenElfReader::name_order(size_t position) const
+{
+  return order(OK_NAME)[position];
+}
+
+size_t FrozenElfReader::address_order_count() const
+{
+  return order(OK_ADDRESS).size();
+}
+
+size_t FrozenElfReader::address_order(size_t position) const
+{
+  return order(OK_ADDRESS)[position];
+}
+
+size_t FrozenElfReader::section_order_count() const
+{
+  return order(OK_SECTION).size();
+}
+
+size_t FrozenElfReader::section_order(size_t position) const
+{
+  return order(OK_SECTION)[position];
+}
+
+size_t FrozenElfReader::segment_order_count() const
+{
+  return order(OK_SEGMENT).size();
+}
+
+size_t FrozenElfReader::segment_order(size_t position) const
+{
+  return order(OK_SEGMENT)[position];
+}
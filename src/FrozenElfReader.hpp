@@ -0,0 +1,77 @@
+#ifndef FROZENELFREADER_HPP
+#define FROZENELFREADER_HPP
+
+#include "ElfQuery.hpp"
+#include "ElfReader.hpp"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief An ElfQuery that many threads can share without locking.
+ *
+ * It takes the parse over and only hands it out as const, so nothing can
+ * change once it is frozen.  The lookup orders are built by the first query
+ * that needs them, not on construction, so a file that is only asked for its
+ * header never sorts its symbols.  An order is published with a single
+ * compare and swap: threads that race on an order that is not there yet each
+ * build it, one of them wins and the others throw theirs away and use the
+ * winner's.  No thread ever waits on another and after publication every
+ * query is a plain load.
+ */
+class FrozenElfReader : public ElfQuery
+{
+public:
+  explicit FrozenElfReader(std::unique_ptr<const ElfReader> elf);
+  FrozenElfReader(const std::string &filename, ParseOptions options);
+  ~FrozenElfReader() override;
+  FrozenElfReader(const FrozenElfReader &) = delete;
+  FrozenElfReader &operator=(const FrozenElfReader &) = delete;
+
+  const ElfReader &get_reader() const;
+
+  uint64_t get_file_size() const override;
+  const Elf_Ehdr &get_header() const override;
+  size_t section_count() const override;
+  section_view section(size_t index) const override;
+  size_t segment_count() const override;
+  Elf_Phdr segment(size_t index) const override;
+  size_t symbol_count() const override;
+  symbol_view symbol(size_t index) const override;
+
+  /**
+   * @brief How many orders were built and thrown away after losing a race
+   */
+  uint64_t get_discarded_count() const;
+
+protected:
+  size_t name_order_count() const override;
+  size_t name_order(size_t position) const override;
+  size_t address_order_count() const override;
+  size_t address_order(size_t position) const override;
+  size_t section_order_count() const override;
+  size_t section_order(size_t position) const override;
+  size_t segment_order_count() const override;
+  size_t segment_order(size_t position) const override;
+
+private:
+  enum order_kind
+  {
+    OK_NAME,
+    OK_ADDRESS,
+    OK_SECTION,
+    OK_SEGMENT,
+    OK_COUNT
+  };
+
+  std::unique_ptr<const ElfReader> elf;
+  const symbol_entries symbols;
+  mutable std::atomic<const std::vector<uint32_t> *> orders[OK_COUNT];
+  mutable std::atomic<uint64_t> discarded;
+
+  const std::vector<uint32_t> &order(order_kind kind) const;
+};
+
+#endif /* FROZENELFREADER_HPP */
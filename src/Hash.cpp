@@ -0,0 +1,80 @@
+#include "Hash.hpp"
+#include <cstring>
+
+namespace {
+
+/**
+ * @brief Mix 32 bytes into the four lanes
+ */
+inline void lane_round(uint64_t lanes[4], const byte *block)
+{
+  for (size_t lane = 0; lane < 4; lane++) {
+    uint64_t value;
+    std::memcpy(&value, block + 8 * lane, sizeof(value));
+    lanes[lane] = rotate_left(lanes[lane] + value * HASH_PRIME_2, 31) * HASH_PRIME_1;
+  }
+}
+
+struct crc_tables
+{
+  uint32_t slice[8][256];
+
+  constexpr crc_tables() : slice()
+  {
+    for (uint32_t ii = 0; ii < 256; ii++) {
+      uint32_t crc = ii;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+      }
+      slice[0][ii] = crc;
+    }
+    // slice[n][b] is b followed by n zero bytes
+    for (uint32_t ii = 0; ii < 256; ii++) {
+      for (size_t n = 1; n < 8; n++) {
+        slice[n][ii] = (slice[n - 1][ii] >> 8) ^ slice[0][slice[n - 1][ii] & 0xff];
+      }
+    }
+  }
+};
+
+constexpr crc_tables CRC_TABLES;
+
+}// namespace
+
+
+uint64_t lane_hash(const byte *data, size_t size, uint64_t seed)
+{
+  uint64_t lanes[4] = { seed + HASH_PRIME_1 + HASH_PRIME_2, seed + HASH_PRIME_2, seed, seed - HASH_PRIME_1 };
+  size_t ii = 0;
+  for (; ii + 32 <= size; ii += 32) {
+    lane_round(lanes, data + ii);
+  }
+  if (ii < size) {
+    byte tail[32] = {};
+    std::memcpy(tail, data + ii, size - ii);
+    lane_round(lanes, tail);
+  }
+  uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) + rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+  hash ^= size * HASH_PRIME_3;
+  hash ^= hash >> 33;
+  hash *= HASH_PRIME_2;
+  hash ^= hash >> 29;
+  hash *= HASH_PRIME_3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+uint32_t crc32(const byte *data, size_t size, uint32_t crc)
+{
+  auto &t = CRC_TABLES.slice;
+  crc = ~crc;
+  size_t ii = 0;
+  for (; ii + 8 <= size; ii += 8) {
+    uint32_t low = crc ^ (static_cast<uint32_t>(data[ii]) | static_cast<uint32_t>(data[ii + 1]) << 8 | static_cast<uint32_t>(data[ii + 2]) << 16 | static_cast<uint32_t>(data[ii + 3]) << 24);
+    crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24] ^ t[3][data[ii + 4]] ^ t[2][data[ii + 5]] ^ t[1][data[ii + 6]] ^ t[0][data[ii + 7]];
+  }
+  for (; ii < size; ii++) {
+    crc = (crc >> 8) ^ t[0][(crc ^ data[ii]) & 0xff];
+  }
+  return ~crc;
+}
@@ -0,0 +1,42 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include "elf_common.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+constexpr uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ULL;
+
+inline uint64_t rotate_left(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+/**
+ * @brief 64-bit hash of a byte range, four independent lanes
+ *
+ * Each step mixes 32 bytes into four lanes that do not depend on each other,
+ * so the loop runs on all the multipliers at once and can be vectorized by
+ * the compiler.  Not a cryptographic hash.
+ */
+uint64_t lane_hash(const byte *data, size_t size, uint64_t seed = 0);
+
+inline uint64_t lane_hash(std::string_view text, uint64_t seed = 0)
+{
+  return lane_hash(reinterpret_cast<const byte *>(text.data()), text.size(), seed);
+}
+
+/**
+ * @brief CRC-32 as zlib computes it, the checksum in .gnu_debuglink
+ *
+ * Slicing by eight: eight table lookups per 8 bytes that do not depend on
+ * each other, rather than a lookup chained on the last for every byte.
+ *
+ * @param crc the CRC of the data before, to checksum a file in pieces
+ */
+uint32_t crc32(const byte *data, size_t size, uint32_t crc = 0);
+
+#endif /* HASH_HPP */
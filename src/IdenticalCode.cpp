@@ -0,0 +1,244 @@
+#include "IdenticalCode.hpp"
+#include "Hash.hpp"
+#include "SymbolTable.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+constexpr size_t HASH_CHUNK = 1024;// functions handed to a thread at a time
+
+}// namespace
+
+
+IdenticalCode::IdenticalCode(const ElfReader &elf, IdenticalCodeOptions options) : exact_wasted(0), near_wasted(0), elf(elf), options(options)
+{
+  if (this->options.threads == 0) this->options.threads = 1;
+  collect_functions();
+  collect_relocations();
+  hash_functions();
+  group_functions();
+}
+
+void IdenticalCode::collect_functions()
+{
+  for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+    auto table = elf.get_symbol_table(ii);
+    if (table == nullptr) continue;
+    for (auto &sym : table->entries) {
+      if (ELF64_ST_TYPE(sym.st_info) != STT_FUNC || sym.st_size < options.min_size) continue;
+      if (sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE || sym.st_shndx >= elf.section_headers.size()) continue;
+      auto &sh = elf.section_headers[sym.st_shndx];
+      if (sh.sh_type == SHT_NOBITS) continue;
+      // relocatable files keep section offsets in st_value
+      ELF_ULONG offset = sym.st_value;
+      if (elf.header.e_type != ET_REL) {
+        if (sym.st_value < sh.sh_addr) continue;
+        offset = sym.st_value - sh.sh_addr;
+      }
+      if (offset > sh.sh_size || sym.st_size > sh.sh_size - offset) continue;
+      if (elf.get_bytes(sh.sh_offset + offset, sym.st_size) == nullptr) continue;
+      functions.push_back({ { std::string(sym.name) }, sym.st_shndx, sym.st_value, sh.sh_offset + offset, sym.st_size, 0, 0 });
+    }
+  }
+
+  // aliases are one body, not duplicates of each other
+  std::sort(functions.begin(), functions.end(), [](const code_function &a, const code_function &b) {
+    if (a.file_offset != b.file_offset) return a.file_offset < b.file_offset;
+    return a.size < b.size;
+  });
+  size_t kept = 0;
+  for (size_t ii = 0; ii < functions.size(); ii++) {
+    if (kept > 0 && functions[kept - 1].file_offset == functions[ii].file_offset && functions[kept - 1].size == functions[ii].size) {
+      functions[kept - 1].names.push_back(std::move(functions[ii].names.front()));
+      continue;
+    }
+    if (kept != ii) functions[kept] = std::move(functions[ii]);
+    kept++;
+  }
+  functions.resize(kept);
+}
+
+void IdenticalCode::collect_relocations()
+{
+  relocations.resize(elf.section_headers.size());
+  size_t word = elf.is_64bit() ? 8 : 4;
+  for (auto &sh : elf.section_headers) {
+    if (sh.sh_type != SHT_REL && sh.sh_type != SHT_RELA) continue;
+    if (sh.sh_info == 0 || sh.sh_info >= elf.section_headers.size()) continue;
+    auto &target = elf.section_headers[sh.sh_info];
+    ELF_ULONG entry_size = sh.sh_entsize != 0 ? sh.sh_entsize : (sh.sh_type == SHT_RELA ? 3 : 2) * word;
+    if (entry_size < 2 * word || elf.get_bytes(sh.sh_offset, sh.sh_size) == nullptr) continue;
+    auto &ranges = relocations[sh.sh_info];
+    for (ELF_ULONG cursor = 0; cursor + entry_size <= sh.sh_size; cursor += entry_size) {
+      ELF_ULONG r_offset = elf.read_value(sh.sh_offset + cursor, word);
+      ELF_ULONG r_info = elf.read_value(sh.sh_offset + cursor + word, word);
+      ELF_ULONG addend = sh.sh_type == SHT_RELA ? elf.read_value(sh.sh_offset + cursor + 2 * word, word) : 0;
+      ELF_ULONG type = elf.is_64bit() ? (r_info & 0xffffffff) : (r_info & 0xff);
+      // absolute 64-bit relocations, everything else in code is 32 bits or less
+      bool wide = (elf.header.e_machine == EM_X86_64 && type == 1) || (elf.header.e_machine == EM_AARCH64 && type == 257);
+      if (elf.header.e_type != ET_REL) {
+        if (r_offset < target.sh_addr) continue;
+        r_offset -= target.sh_addr;
+      }
+      ranges.push_back({ target.sh_offset + r_offset, wide ? ELF_ULONG{ 8 } : ELF_ULONG{ 4 }, r_info * HASH_PRIME_1 ^ addend });
+    }
+    std::sort(ranges.begin(), ranges.end());
+  }
+}
+
+void IdenticalCode::hash_functions()
+{
+  std::atomic<size_t> next(0);
+  auto work = [this, &next]() {
+    for (size_t begin = next.fetch_add(HASH_CHUNK); begin < functions.size(); begin = next.fetch_add(HASH_CHUNK)) {
+      hash_range(begin, std::min(begin + HASH_CHUNK, functions.size()));
+    }
+  };
+  size_t count = std::min(options.threads, functions.size() / HASH_CHUNK + 1);
+  std::vector<std::thread> pool;
+  for (size_t ii = 1; ii < count; ii++) {
+    pool.emplace_back(work);
+  }
+  work();
+  for (auto &t : pool) {
+    t.join();
+  }
+}
+
+void IdenticalCode::hash_range(size_t begin, size_t end)
+{
+  bool relative_branches = elf.header.e_type != ET_REL && (elf.header.e_machine == EM_X86_64 || elf.header.e_machine == EM_386);
+  std::vector<byte> scratch;
+  for (size_t ii = begin; ii < end; ii++) {
+    auto &f = functions[ii];
+    const byte *body = elf.get_bytes(f.file_offset, f.size);
+    f.exact_hash = lane_hash(body, f.size);
+
+    scratch.assign(body, body + f.size);
+    auto &ranges = relocations[f.section];
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), relocation{ f.file_offset, 0, 0 });
+    for (; it != ranges.end() && it->file_offset < f.file_offset + f.size; ++it) {
+      ELF_ULONG start = it->file_offset - f.file_offset;
+      ELF_ULONG length = std::min(it->width, f.size - start);
+      std::memset(scratch.data() + start, 0, length);
+      f.exact_hash = rotate_left(f.exact_hash ^ (it->target + start * HASH_PRIME_2), 27) * HASH_PRIME_1;
+    }
+    if (relative_branches) {
+      // not decoded, a 0xe8 or 0xe9 inside another instruction is masked too
+      // but it is masked the same way in an identical body
+      for (size_t jj = 0; jj + 5 <= scratch.size(); jj++) {
+        if (scratch[jj] == 0xe8 || scratch[jj] == 0xe9) {
+          std::memset(scratch.data() + jj + 1, 0, 4);
+          jj += 4;
+        }
+      }
+    }
+    f.near_hash = lane_hash(scratch.data(), scratch.size(), HASH_PRIME_3);
+  }
+}
+
+void IdenticalCode::group_functions()
+{
+  std::vector<size_t> order(functions.size());
+  for (size_t ii = 0; ii < order.size(); ii++) {
+    order[ii] = ii;
+  }
+
+  // exact: equal size and hash, confirmed byte for byte
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    if (functions[a].size != functions[b].size) return functions[a].size < functions[b].size;
+    if (functions[a].exact_hash != functions[b].exact_hash) return functions[a].exact_hash < functions[b].exact_hash;
+    return a < b;
+  });
+  for (size_t run = 0; run < order.size();) {
+    size_t run_end = run + 1;
+    auto &first = functions[order[run]];
+    while (run_end < order.size() && functions[order[run_end]].size == first.size && functions[order[run_end]].exact_hash == first.exact_hash) {
+      run_end++;
+    }
+    if (run_end - run > 1) {
+      std::vector<code_group> classes;
+      // the relocations are only covered by the hash, a collision there
+      // could merge bodies that relocate differently, it is not worth more
+      for (size_t ii = run; ii < run_end; ii++) {
+        auto &f = functions[order[ii]];
+        auto body = elf.get_bytes(f.file_offset, f.size);
+        auto match = std::find_if(classes.begin(), classes.end(), [&](const code_group &g) {
+          return std::memcmp(elf.get_bytes(functions[g.members.front()].file_offset, f.size), body, f.size) == 0;
+        });
+        if (match == classes.end()) {
+          classes.push_back({ true, f.size, { order[ii] }, 0 });
+        } else {
+          match->members.push_back(order[ii]);
+        }
+      }
+      for (auto &g : classes) {
+        if (g.members.size() < 2) continue;
+        g.wasted = g.size * (g.members.size() - 1);
+        exact_wasted += g.wasted;
+        groups.push_back(std::move(g));
+      }
+    }
+    run = run_end;
+  }
+
+  // near: equal masked bytes but more than one distinct body
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    if (functions[a].size != functions[b].size) return functions[a].size < functions[b].size;
+    if (functions[a].near_hash != functions[b].near_hash) return functions[a].near_hash < functions[b].near_hash;
+    return functions[a].exact_hash < functions[b].exact_hash;
+  });
+  for (size_t run = 0; run < order.size();) {
+    size_t run_end = run + 1;
+    size_t distinct = 1;
+    auto &first = functions[order[run]];
+    while (run_end < order.size() && functions[order[run_end]].size == first.size && functions[order[run_end]].near_hash == first.near_hash) {
+      if (functions[order[run_end]].exact_hash != functions[order[run_end - 1]].exact_hash) distinct++;
+      run_end++;
+    }
+    if (distinct > 1) {
+      code_group g{ false, first.size, std::vector<size_t>(order.begin() + run, order.begin() + run_end), first.size * (distinct - 1) };
+      near_wasted += g.wasted;
+      groups.push_back(std::move(g));
+    }
+    run = run_end;
+  }
+
+  std::sort(groups.begin(), groups.end(), [](const code_group &a, const code_group &b) {
+    if (a.wasted != b.wasted) return a.wasted > b.wasted;
+    return a.exact && !b.exact;
+  });
+}
+
+
+void write_text(OutputBuffer &out, const IdenticalCode &code, size_t limit)
+{
+  size_t shown = std::min(limit, code.groups.size());
+  for (size_t ii = 0; ii < shown; ii++) {
+    auto &g = code.groups[ii];
+    out.put(g.exact ? "identical " : "near identical ").dec(g.members.size()).put(" x ").dec(g.size).put(" bytes, ").dec(g.wasted).put(" wasted\n");
+    for (auto index : g.members) {
+      auto &f = code.functions[index];
+      out.put("    0x").hex(f.address, 8).put(' ');
+      for (size_t jj = 0; jj < f.names.size(); jj++) {
+        if (jj > 0) out.put(", ");
+        out.put(f.names[jj]);
+      }
+      out.put('\n');
+    }
+  }
+  size_t exact = std::count_if(code.groups.begin(), code.groups.end(), [](const code_group &g) { return g.exact; });
+  out.dec(code.functions.size()).put(" functions, ");
+  out.dec(exact).put(" identical groups wasting ").dec(code.exact_wasted).put(" bytes, ");
+  out.dec(code.groups.size() - exact).put(" near identical groups wasting ").dec(code.near_wasted).put(" more\n");
+}
+
+std::ostream &operator<<(std::ostream &out, const IdenticalCode &code)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, code);
+  return out;
+}
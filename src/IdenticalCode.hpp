@@ -0,0 +1,93 @@
+#ifndef IDENTICALCODE_HPP
+#define IDENTICALCODE_HPP
+
+#include "ElfReader.hpp"
+#include "OutputBuffer.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One function body, aliases at the same address share an entry
+ */
+struct code_function
+{
+  std::vector<std::string> names;
+  size_t section;
+  ELF_ULONG address;
+  ELF_ULONG file_offset;
+  ELF_ULONG size;
+  uint64_t exact_hash;// of the bytes as they are and what they are relocated against
+  uint64_t near_hash;// with relocated operands zeroed
+};
+
+/**
+ * @brief Functions that would fold into one
+ *
+ * exact groups are byte for byte identical, near groups only differ in the
+ * operands that relocations or relative calls and jumps fill in, they fold
+ * when the targets are identical too.
+ */
+struct code_group
+{
+  bool exact;
+  ELF_ULONG size;
+  std::vector<size_t> members;// indexes into IdenticalCode::functions
+  ELF_ULONG wasted;// exact: all but one member, near: all but one distinct body
+};
+
+struct IdenticalCodeOptions
+{
+  size_t threads = 1;
+  ELF_ULONG min_size = 16;// smaller functions are not worth a report
+};
+
+/**
+ * @brief Finds STT_FUNC bodies that identical code folding would merge.
+ *
+ * Bodies are read from the file through st_shndx and st_value and hashed on
+ * a pool of threads, then sorted on (size, hash) so equal bodies end up next
+ * to each other.  Exact groups are confirmed with memcmp.
+ *
+ * In relocatable files the exact hash also covers the relocations, two bodies
+ * with equal bytes that call different functions are only near identical.
+ * For the near hash the bytes covered by SHT_REL/SHT_RELA entries are zeroed.  Linked x86 files have no relocations left for code,
+ * there the rel32 operand of call and jmp (0xe8, 0xe9) is zeroed instead.
+ */
+class IdenticalCode
+{
+public:
+  IdenticalCode(const ElfReader &elf, IdenticalCodeOptions options = IdenticalCodeOptions{});
+
+  std::vector<code_function> functions;
+  std::vector<code_group> groups;// largest waste first
+  ELF_ULONG exact_wasted;
+  ELF_ULONG near_wasted;// on top of exact_wasted
+
+private:
+  const ElfReader &elf;
+  IdenticalCodeOptions options;
+  struct relocation
+  {
+    ELF_ULONG file_offset;
+    ELF_ULONG width;
+    uint64_t target;// r_info and addend, equal for equal targets
+
+    bool operator<(const relocation &other) const
+    {
+      return file_offset < other.file_offset;
+    }
+  };
+  std::vector<std::vector<relocation>> relocations;// of each section, sorted
+
+  void collect_functions();
+  void collect_relocations();
+  void hash_functions();
+  void hash_range(size_t begin, size_t end);
+  void group_functions();
+};
+
+void write_text(OutputBuffer &out, const IdenticalCode &code, size_t limit = 20);
+std::ostream &operator<<(std::ostream &out, const IdenticalCode &code);
+
+#endif /* IDENTICALCODE_HPP */
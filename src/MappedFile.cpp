@@ -0,0 +1,92 @@
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+MappedFile::MappedFile(const std::string &filename, bool writable) : fd(-1), address(nullptr), length(0), writable(writable)
+{
+  fd = ::open(filename.c_str(), (writable ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+  if (fd < 0) return;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    ::close(fd);
+    fd = -1;
+    return;
+  }
+  length = static_cast<size_t>(st.st_size);
+  if (length == 0) return;
+  void *p = writable ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED) {
+    ::close(fd);
+    fd = -1;
+    length = 0;
+    return;
+  }
+  address = static_cast<const byte *>(p);
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept : fd(other.fd), address(other.address), length(other.length), writable(other.writable)
+{
+  other.fd = -1;
+  other.address = nullptr;
+  other.length = 0;
+}
+
+MappedFile::~MappedFile()
+{
+  if (address != nullptr) {
+    munmap(const_cast<byte *>(address), length);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+bool MappedFile::is_open() const noexcept
+{
+  return fd >= 0;
+}
+
+const byte *MappedFile::data() const noexcept
+{
+  return address;
+}
+
+size_t MappedFile::size() const noexcept
+{
+  return length;
+}
+
+int MappedFile::descriptor() const noexcept
+{
+  return fd;
+}
+
+byte *MappedFile::writable_data() const noexcept
+{
+  return writable ? const_cast<byte *>(address) : nullptr;
+}
+
+bool MappedFile::sync(size_t offset, size_t count) const
+{
+  if (!writable || address == nullptr || offset >= length || count == 0) return true;
+  // msync() wants a page aligned start
+  auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t start = offset / page * page;
+  count = std::min(count, length - offset) + (offset - start);
+  return msync(const_cast<byte *>(address) + start, count, MS_SYNC) == 0;
+}
+
+size_t MappedFile::read_at(size_t offset, byte *buffer, size_t count) const
+{
+  size_t done = 0;
+  while (done < count) {
+    ssize_t n = pread(fd, buffer + done, count - done, static_cast<off_t>(offset + done));
+    if (n <= 0) break;
+    done += static_cast<size_t>(n);
+  }
+  return done;
+}
@@ -0,0 +1,68 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include "elf_common.hpp"
+#include <string>
+
+/**
+ * @brief Memory mapping of a whole file.
+ *
+ * Pages are only brought in when they are touched, so mapping a file that is
+ * tens of GB costs nothing until we look at the bytes.  The descriptor is
+ * kept open so callers can also use pread() on it.
+ *
+ * Mappings are read-only unless asked for writable, those are MAP_SHARED so
+ * stores go to the file.
+ */
+class MappedFile
+{
+public:
+  explicit MappedFile(const std::string &filename, bool writable = false);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+
+  bool is_open() const noexcept;
+  const byte *data() const noexcept;
+  size_t size() const noexcept;
+  int descriptor() const noexcept;
+
+  /**
+   * @brief The mapping to store into, nullptr unless opened writable
+   */
+  byte *writable_data() const noexcept;
+
+  /**
+   * @brief Write the pages holding a range back to the file with msync()
+   */
+  bool sync(size_t offset, size_t count) const;
+
+  /**
+   * @brief Copy bytes from the file without touching the mapping
+   *
+   * @return size_t number of bytes copied, short at the end of the file
+   */
+  size_t read_at(size_t offset, byte *buffer, size_t count) const;
+
+private:
+  int fd;
+  const byte *address;
+  size_t length;
+  bool writable;
+};
+
+/**
+ * @brief Decode a little endian integer of width bytes, for the file formats
+ *        that are read through a mapping
+ */
+inline uint64_t load_le(const byte *p, size_t width)
+{
+  uint64_t value = 0;
+  for (size_t ii = 0; ii < width; ii++) {
+    value |= static_cast<uint64_t>(p[ii]) << (8 * ii);
+  }
+  return value;
+}
+
+#endif /* MAPPEDFILE_HPP */
@@ -0,0 +1,62 @@
+#include "OutputBuffer.hpp"
+#include <cerrno>
+#include <unistd.h>
+
+
+OutputBuffer::OutputBuffer(int fd, size_t capacity, std::mutex *lock) : buffer(new char[capacity]), capacity(capacity), used(0), fd(fd), stream(nullptr), lock(lock)
+{
+}
+
+OutputBuffer::OutputBuffer(std::ostream &out, size_t capacity) : buffer(new char[capacity]), capacity(capacity), used(0), fd(-1), stream(&out), lock(nullptr)
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+  flush();
+}
+
+void OutputBuffer::flush()
+{
+  if (used == 0) return;
+  if (stream != nullptr) {
+    stream->write(buffer.get(), static_cast<std::streamsize>(used));
+    used = 0;
+    return;
+  }
+  std::unique_lock<std::mutex> guard;
+  if (lock != nullptr) guard = std::unique_lock<std::mutex>(*lock);
+  size_t done = 0;
+  while (done < used) {
+    ssize_t n = ::write(fd, buffer.get() + done, used - done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      break;// nowhere to report it, drop the output like a closed ostream would
+    }
+    done += static_cast<size_t>(n);
+  }
+  used = 0;
+}
+
+void OutputBuffer::ensure(size_t count)
+{
+  if (count <= capacity - used) return;
+  flush();
+  if (count > capacity) {
+    // a single record bigger than the whole buffer, grow rather than split it
+    buffer.reset(new char[count]);
+    capacity = count;
+  }
+}
+
+OutputBuffer &OutputBuffer::put_large(std::string_view text)
+{
+  while (!text.empty()) {
+    if (used == capacity) flush();
+    size_t count = std::min(capacity - used, text.size());
+    std::copy(text.begin(), text.begin() + count, buffer.get() + used);
+    used += count;
+    text.remove_prefix(count);
+  }
+  return *this;
+}
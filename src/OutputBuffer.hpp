@@ -0,0 +1,118 @@
+#ifndef OUTPUTBUFFER_HPP
+#define OUTPUTBUFFER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string_view>
+
+/**
+ * @brief Text output without iostream formatting.
+ *
+ * Everything is appended to one large reusable buffer and numbers are
+ * converted by hand, so printing a table does no allocation, no locale work
+ * and no flag juggling.  The buffer is handed over with a few large write(2)
+ * calls, or to an ostream when we are called from an operator<<.
+ */
+class OutputBuffer
+{
+public:
+  /**
+   * @brief Write to a descriptor
+   * 
+   * Buffers of several threads can share one descriptor by sharing a lock, each
+   * flush is then written as one unit.
+   */
+  explicit OutputBuffer(int fd, size_t capacity = 1 << 20, std::mutex *lock = nullptr);
+  explicit OutputBuffer(std::ostream &out, size_t capacity = 1 << 16);
+  ~OutputBuffer();
+  OutputBuffer(const OutputBuffer &) = delete;
+  OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+  OutputBuffer &put(char c)
+  {
+    if (used == capacity) flush();
+    buffer[used++] = c;
+    return *this;
+  }
+
+  OutputBuffer &put(std::string_view text)
+  {
+    if (text.size() > capacity - used) return put_large(text);
+    std::copy(text.begin(), text.end(), buffer.get() + used);
+    used += text.size();
+    return *this;
+  }
+
+  OutputBuffer &dec(uint64_t value)
+  {
+    char digits[20];
+    size_t n = sizeof(digits);
+    do {
+      digits[--n] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    return put(std::string_view(digits + n, sizeof(digits) - n));
+  }
+
+  OutputBuffer &dec_signed(int64_t value)
+  {
+    if (value < 0) {
+      put('-');
+      return dec(0 - static_cast<uint64_t>(value));
+    }
+    return dec(static_cast<uint64_t>(value));
+  }
+
+  /**
+   * @brief Lower case hex without a prefix, zero padded up to width digits
+   */
+  OutputBuffer &hex(uint64_t value, size_t width = 0)
+  {
+    static constexpr char hex_digits[] = "0123456789abcdef";
+    char digits[16];
+    size_t n = sizeof(digits);
+    do {
+      digits[--n] = hex_digits[value & 0xf];
+      value >>= 4;
+    } while (value != 0);
+    for (size_t count = sizeof(digits) - n; count < width; count++)
+      put('0');
+    return put(std::string_view(digits + n, sizeof(digits) - n));
+  }
+
+  /**
+   * @brief Little endian binary integer of width bytes, for file formats
+   */
+  OutputBuffer &le(uint64_t value, size_t width)
+  {
+    char bytes[8];
+    for (size_t ii = 0; ii < width; ii++) {
+      bytes[ii] = static_cast<char>((value >> (8 * ii)) & 0xff);
+    }
+    return put(std::string_view(bytes, width));
+  }
+
+  /**
+   * @brief Make room so the next count bytes are not split by a flush
+   * 
+   * Used to keep records whole when several buffers share a descriptor.
+   */
+  void ensure(size_t count);
+
+  void flush();
+
+private:
+  std::unique_ptr<char[]> buffer;
+  size_t capacity;
+  size_t used;
+  int fd;
+  std::ostream *stream;
+  std::mutex *lock;
+
+  OutputBuffer &put_large(std::string_view text);
+};
+
+#endif /* OUTPUTBUFFER_HPP */
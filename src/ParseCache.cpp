@@ -0,0 +1,425 @@
+#include "ParseCache.hpp"
+#include "Hash.hpp"
+#include "OutputBuffer.hpp"
+#include "SymbolTable.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t CACHE_VERSION = 1;
+constexpr size_t HEADER_SIZE = 136;
+constexpr size_t SECTION_SIZE = 88;
+constexpr size_t SEGMENT_SIZE = 64;
+constexpr size_t NOTE_SIZE = 40;
+constexpr size_t TABLE_SIZE = 24;
+constexpr size_t SYMBOL_SIZE = 40;
+
+uint64_t mtime_of(const struct stat &st)
+{
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+/**
+ * @brief Hash of the raw ELF header, section and program header tables
+ *
+ * Different files can carry the same build-id, e.g. builds that only differ
+ * in a debug link.  A build-id match only counts when the tables match too.
+ */
+uint64_t layout_hash(const ElfReader &elf)
+{
+  auto &h = elf.header;
+  uint64_t hash = 0;
+  auto add = [&](ELF_ULONG offset, ELF_ULONG size) {
+    auto bytes = elf.get_bytes(offset, size);
+    if (bytes != nullptr) hash = lane_hash(bytes, size, hash);
+  };
+  add(0, h.e_ehsize);
+  if (h.e_shoff != 0) add(h.e_shoff, h.e_shentsize * elf.get_section_header_count());
+  if (h.e_phoff != 0) add(h.e_phoff, h.e_phentsize * h.e_phnum);
+  return hash;
+}
+
+/**
+ * @brief Checked view of a mapped entry
+ */
+struct entry_view
+{
+  const byte *data;
+  uint64_t size;
+  uint64_t strings;
+  uint64_t strings_size;
+
+  /**
+   * @brief count records of width bytes at the offset stored at field
+   */
+  const byte *table(size_t field, uint64_t count, size_t width) const
+  {
+    uint64_t offset = load_le(data + field, 8);
+    if (offset > size || count > (size - offset) / width) return nullptr;
+    return data + offset;
+  }
+
+  bool string(const byte *record, std::string_view &out) const
+  {
+    uint64_t offset = load_le(record, 4);
+    uint64_t length = load_le(record + 4, 4);
+    if (offset > strings_size || length > strings_size - offset) return false;
+    out = std::string_view(reinterpret_cast<const char *>(data + strings + offset), length);
+    return true;
+  }
+
+  bool string(const byte *record, std::string &out) const
+  {
+    std::string_view view;
+    if (!string(record, view)) return false;
+    out = view;
+    return true;
+  }
+};
+
+}// namespace
+
+
+ParseCache::ParseCache(const std::string &directory) : directory(directory), open(false), hits(0), build_id_hits(0), misses(0), stale(0), stores(0), temporary_counter(0)
+{
+  std::error_code ec;
+  std::filesystem::create_directories(directory + "/build-id", ec);
+  open = std::filesystem::is_directory(directory + "/build-id", ec);
+}
+
+bool ParseCache::is_open() const
+{
+  return open;
+}
+
+cache_stats ParseCache::get_stats() const
+{
+  return { hits, build_id_hits, misses, stale, stores };
+}
+
+uint32_t ParseCache::phases(const ParseOptions &options)
+{
+  uint32_t result = 0;
+  if (options.section_headers) result |= CP_SECTIONS;
+  if (options.section_headers && options.symbol_tables) result |= CP_SYMBOLS;
+  if (options.section_headers && options.dynamic_symbols) result |= CP_DYNAMIC_SYMBOLS;
+  if (options.program_headers) result |= CP_SEGMENTS;
+  if (options.notes) result |= CP_NOTES;
+  return result;
+}
+
+std::string ParseCache::entry_path(uint64_t device, uint64_t inode) const
+{
+  char name[48];
+  std::snprintf(name, sizeof(name), "/%llx-%llx.epc", static_cast<unsigned long long>(device), static_cast<unsigned long long>(inode));
+  return directory + name;
+}
+
+std::string ParseCache::build_id_path(const std::string &build_id) const
+{
+  return directory + "/build-id/" + build_id + ".epc";
+}
+
+bool ParseCache::load(ElfReader &elf)
+{
+  struct stat st;
+  if (!open || fstat(elf.mapping->descriptor(), &st) != 0) {
+    misses++;
+    return false;
+  }
+  uint64_t size = static_cast<uint64_t>(st.st_size);
+  if (restore(elf, entry_path(st.st_dev, st.st_ino), st.st_dev, st.st_ino, size, mtime_of(st), false)) {
+    hits++;
+    return true;
+  }
+  auto build_id = elf.get_build_id();
+  if (!build_id.empty() && restore(elf, build_id_path(build_id), st.st_dev, st.st_ino, size, mtime_of(st), true)) {
+    build_id_hits++;
+    return true;
+  }
+  misses++;
+  return false;
+}
+
+/**
+ * @brief Fill the reader from one entry, nothing is changed unless the entry
+ *        is usable
+ */
+bool ParseCache::restore(ElfReader &elf, const std::string &path, uint64_t device, uint64_t inode, uint64_t size, uint64_t mtime, bool by_build_id)
+{
+  auto mapping = std::make_shared<MappedFile>(path);
+  if (!mapping->is_open() || mapping->size() < HEADER_SIZE) return false;
+  auto data = mapping->data();
+  if (std::string_view(reinterpret_cast<const char *>(data), 4) != "EPCE" || load_le(data + 4, 4) != CACHE_VERSION) {
+    std::remove(path.c_str());
+    return false;
+  }
+  entry_view entry{ data, mapping->size(), load_le(data + 112, 8), load_le(data + 120, 8) };
+  if (entry.strings > entry.size || entry.strings_size > entry.size - entry.strings) {
+    std::remove(path.c_str());
+    return false;
+  }
+  uint64_t build_id_length = load_le(data + 44, 4);
+  if (build_id_length > entry.strings_size) return false;
+  auto build_id = std::string(reinterpret_cast<const char *>(data + entry.strings), build_id_length);
+  bool same_inode = load_le(data + 8, 8) == device && load_le(data + 16, 8) == inode;
+  if (by_build_id && same_inode) {
+    // made from this very file before it changed, e.g. edited in place
+    // without a new build-id, when the inode entry is already gone
+    stale++;
+    std::remove(path.c_str());
+    return false;
+  }
+  if (by_build_id) {
+    // same build-id, size and tables is the same file under another name
+    if (load_le(data + 24, 8) != size || build_id != elf.get_build_id() || load_le(data + 128, 8) != layout_hash(elf)) return false;
+  } else if (!same_inode || load_le(data + 24, 8) != size || load_le(data + 32, 8) != mtime) {
+    stale++;
+    // the build-id name links to this entry too, and would hand it out again
+    struct stat entry_st, link_st;
+    auto link = build_id_path(build_id);
+    if (!build_id.empty() && fstat(mapping->descriptor(), &entry_st) == 0 && stat(link.c_str(), &link_st) == 0 && entry_st.st_dev == link_st.st_dev && entry_st.st_ino == link_st.st_ino) {
+      std::remove(link.c_str());
+    }
+    std::remove(path.c_str());
+    return false;
+  }
+  auto required = phases(elf.options);
+  if ((static_cast<uint32_t>(load_le(data + 40, 4)) & required) != required) return false;
+
+  uint64_t section_count = load_le(data + 48, 4);
+  uint64_t segment_count = load_le(data + 52, 4);
+  uint64_t note_count = load_le(data + 56, 4);
+  uint64_t table_count = load_le(data + 60, 4);
+  uint64_t symbol_count = load_le(data + 64, 8);
+  auto sections = entry.table(72, section_count, SECTION_SIZE);
+  auto segments = entry.table(80, segment_count, SEGMENT_SIZE);
+  auto notes = entry.table(88, note_count, NOTE_SIZE);
+  auto tables = entry.table(96, table_count, TABLE_SIZE);
+  auto symbols = entry.table(104, symbol_count, SYMBOL_SIZE);
+  if (sections == nullptr || segments == nullptr || notes == nullptr || tables == nullptr || symbols == nullptr) return false;
+
+  std::vector<Elf_Shdr> section_headers;
+  std::vector<Elf_Phdr> program_headers;
+  std::vector<Elf_Note> note_entries;
+  std::vector<std::unique_ptr<SectionTableInfo>> section_table_info;
+  if (required & CP_SECTIONS) {
+    for (uint64_t ii = 0; ii < section_count; ii++) {
+      auto r = sections + SECTION_SIZE * ii;
+      Elf_Shdr sh;
+      sh.sh_name = load_le(r, 8);
+      sh.sh_type = load_le(r + 8, 8);
+      sh.sh_flags = load_le(r + 16, 8);
+      sh.sh_addr = load_le(r + 24, 8);
+      sh.sh_offset = load_le(r + 32, 8);
+      sh.sh_size = load_le(r + 40, 8);
+      sh.sh_link = load_le(r + 48, 8);
+      sh.sh_info = load_le(r + 56, 8);
+      sh.sh_addralign = load_le(r + 64, 8);
+      sh.sh_entsize = load_le(r + 72, 8);
+      if (!entry.string(r + 80, sh.name)) return false;
+      sh.index = ii;
+      section_headers.push_back(std::move(sh));
+    }
+  }
+  if (required & CP_SEGMENTS) {
+    for (uint64_t ii = 0; ii < segment_count; ii++) {
+      auto r = segments + SEGMENT_SIZE * ii;
+      Elf_Phdr p;
+      p.p_type = load_le(r, 8);
+      p.p_offset = load_le(r + 8, 8);
+      p.p_vaddr = load_le(r + 16, 8);
+      p.p_paddr = load_le(r + 24, 8);
+      p.p_filesz = load_le(r + 32, 8);
+      p.p_memsz = load_le(r + 40, 8);
+      p.p_flags = load_le(r + 48, 8);
+      p.p_align = load_le(r + 56, 8);
+      program_headers.push_back(p);
+    }
+  }
+  if (required & CP_NOTES) {
+    for (uint64_t ii = 0; ii < note_count; ii++) {
+      auto r = notes + NOTE_SIZE * ii;
+      Elf_Note note;
+      note.n_namesz = load_le(r, 8);
+      note.n_descsz = load_le(r + 8, 8);
+      note.n_type = load_le(r + 16, 8);
+      note.desc_offset = load_le(r + 24, 8);
+      if (!entry.string(r + 32, note.name)) return false;
+      note_entries.push_back(std::move(note));
+    }
+  }
+
+  auto &options = elf.options;
+  if ((required & CP_SECTIONS) && (options.symbol_tables || options.dynamic_symbols || options.string_tables)) {
+    uint64_t table = 0;
+    for (auto &sh : section_headers) {
+      bool symtab = sh.sh_type == SHT_SYMTAB && options.symbol_tables;
+      bool dynsym = sh.sh_type == SHT_DYNSYM && options.dynamic_symbols;
+      if (sh.sh_type == SHT_STRTAB && options.string_tables) {
+        section_table_info.push_back(nullptr);// read from the file below
+        continue;
+      }
+      if (!symtab && !dynsym) {
+        section_table_info.push_back(std::make_unique<SectionTableInfo>());
+        continue;
+      }
+      auto sti = std::make_unique<SymbolTable>();
+      // the tables are stored in section order
+      while (table < table_count && load_le(tables + TABLE_SIZE * table, 4) < sh.index)
+        table++;
+      if (table < table_count && load_le(tables + TABLE_SIZE * table, 4) == sh.index) {
+        auto r = tables + TABLE_SIZE * table;
+        uint64_t first = load_le(r + 8, 8);
+        uint64_t count = load_le(r + 16, 8);
+        if (first > symbol_count || count > symbol_count - first) return false;
+        sti->count = count;
+        sti->entries.reserve(count);
+        for (uint64_t ii = first; ii < first + count; ii++) {
+          auto s = symbols + SYMBOL_SIZE * ii;
+          Elf_Sym sym;
+          if (!entry.string(s + 24, sym.name)) return false;
+          if (!options.symbol_filter.empty() && sym.name.find(options.symbol_filter) == std::string_view::npos) continue;
+          sym.st_value = load_le(s, 8);
+          sym.st_size = load_le(s + 8, 8);
+          sym.st_name = load_le(s + 16, 4);
+          sym.st_shndx = load_le(s + 20, 4);
+          sym.st_info = s[32];
+          sym.st_other = s[33];
+          sym.index = ii - first;
+          sym.file_type = elf.header.e_type;
+          sti->entries.push_back(std::move(sym));
+        }
+      }
+      section_table_info.push_back(std::move(sti));
+    }
+  }
+
+  elf.section_headers = std::move(section_headers);
+  elf.program_headers = std::move(program_headers);
+  elf.notes = std::move(note_entries);
+  elf.cache_entry = std::move(mapping);
+  elf.section_table_info.clear();
+  // string tables are not cached, they are read straight out of the file in
+  // section order so the progress messages come out as they would otherwise
+  for (size_t ii = 0; ii < section_table_info.size(); ii++) {
+    if (section_table_info[ii] == nullptr) {
+      elf.read_string_table(elf.section_headers[ii]);
+      continue;
+    }
+    if (options.verbose && dynamic_cast<const SymbolTable *>(section_table_info[ii].get()) != nullptr) {
+      std::cout << "Reading symbol table '" << elf.section_headers[ii].name << "'\n";
+    }
+    elf.section_table_info.push_back(std::move(section_table_info[ii]));
+  }
+  return true;
+}
+
+void ParseCache::store(const ElfReader &elf)
+{
+  struct stat st;
+  if (!open || !elf.options.symbol_filter.empty() || fstat(elf.mapping->descriptor(), &st) != 0) return;
+  auto build_id = elf.get_build_id();
+
+  std::vector<size_t> tables;
+  uint64_t symbol_count = 0;
+  for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+    auto table = elf.get_symbol_table(ii);
+    if (table == nullptr) continue;
+    tables.push_back(ii);
+    symbol_count += table->entries.size();
+  }
+  uint64_t sections_offset = HEADER_SIZE;
+  uint64_t segments_offset = sections_offset + SECTION_SIZE * elf.section_headers.size();
+  uint64_t notes_offset = segments_offset + SEGMENT_SIZE * elf.program_headers.size();
+  uint64_t tables_offset = notes_offset + NOTE_SIZE * elf.notes.size();
+  uint64_t symbols_offset = tables_offset + TABLE_SIZE * tables.size();
+  uint64_t strings_offset = symbols_offset + SYMBOL_SIZE * symbol_count;
+  uint64_t strings_size = build_id.size();
+  for (auto &sh : elf.section_headers)
+    strings_size += sh.name.size();
+  for (auto &note : elf.notes)
+    strings_size += note.name.size();
+  for (auto index : tables) {
+    for (auto &sym : elf.get_symbol_table(index)->entries)
+      strings_size += sym.name.size();
+  }
+  // offsets in the records are 32 bits
+  if (strings_size > UINT32_MAX) return;
+
+  auto temporary = directory + "/.tmp-" + std::to_string(getpid()) + "-" + std::to_string(temporary_counter++);
+  int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) return;
+  {
+    OutputBuffer out(fd);
+    out.put("EPCE").le(CACHE_VERSION, 4).le(st.st_dev, 8).le(st.st_ino, 8).le(st.st_size, 8).le(mtime_of(st), 8);
+    // the program headers are always read for the build-id
+    out.le(phases(elf.options) | CP_SEGMENTS, 4).le(build_id.size(), 4).le(elf.section_headers.size(), 4).le(elf.program_headers.size(), 4);
+    out.le(elf.notes.size(), 4).le(tables.size(), 4).le(symbol_count, 8);
+    out.le(sections_offset, 8).le(segments_offset, 8).le(notes_offset, 8).le(tables_offset, 8).le(symbols_offset, 8);
+    out.le(strings_offset, 8).le(strings_size, 8).le(layout_hash(elf), 8);
+    uint64_t cursor = build_id.size();
+    for (auto &sh : elf.section_headers) {
+      out.le(sh.sh_name, 8).le(sh.sh_type, 8).le(sh.sh_flags, 8).le(sh.sh_addr, 8).le(sh.sh_offset, 8);
+      out.le(sh.sh_size, 8).le(sh.sh_link, 8).le(sh.sh_info, 8).le(sh.sh_addralign, 8).le(sh.sh_entsize, 8);
+      out.le(cursor, 4).le(sh.name.size(), 4);
+      cursor += sh.name.size();
+    }
+    for (auto &p : elf.program_headers) {
+      out.le(p.p_type, 8).le(p.p_offset, 8).le(p.p_vaddr, 8).le(p.p_paddr, 8);
+      out.le(p.p_filesz, 8).le(p.p_memsz, 8).le(p.p_flags, 8).le(p.p_align, 8);
+    }
+    for (auto &note : elf.notes) {
+      out.le(note.n_namesz, 8).le(note.n_descsz, 8).le(note.n_type, 8).le(note.desc_offset, 8);
+      out.le(cursor, 4).le(note.name.size(), 4);
+      cursor += note.name.size();
+    }
+    uint64_t first = 0;
+    for (auto index : tables) {
+      auto count = elf.get_symbol_table(index)->entries.size();
+      out.le(index, 4).le(0, 4).le(first, 8).le(count, 8);
+      first += count;
+    }
+    for (auto index : tables) {
+      for (auto &sym : elf.get_symbol_table(index)->entries) {
+        out.le(sym.st_value, 8).le(sym.st_size, 8).le(sym.st_name, 4).le(sym.st_shndx, 4);
+        out.le(cursor, 4).le(sym.name.size(), 4).le(sym.st_info, 1).le(sym.st_other, 1).le(0, 6);
+        cursor += sym.name.size();
+      }
+    }
+    out.put(build_id);
+    for (auto &sh : elf.section_headers)
+      out.put(sh.name);
+    for (auto &note : elf.notes)
+      out.put(note.name);
+    for (auto index : tables) {
+      for (auto &sym : elf.get_symbol_table(index)->entries)
+        out.put(sym.name);
+    }
+  }
+  auto path = entry_path(st.st_dev, st.st_ino);
+  if (::close(fd) != 0 || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    return;
+  }
+  if (!build_id.empty()) {
+    // entries are only ever replaced, never written in place, so both names
+    // can share the file
+    auto link_name = temporary + ".link";
+    if (::link(path.c_str(), link_name.c_str()) == 0 && std::rename(link_name.c_str(), build_id_path(build_id).c_str()) != 0) {
+      std::remove(link_name.c_str());
+    }
+  }
+  stores++;
+}
+
+
+void write_text(OutputBuffer &out, const cache_stats &stats)
+{
+  out.put("cache: ").dec(stats.hits).put(" hits, ").dec(stats.build_id_hits).put(" by build-id, ");
+  out.dec(stats.misses).put(" misses, ").dec(stats.stale).put(" stale, ").dec(stats.stores).put(" stored\n");
+}
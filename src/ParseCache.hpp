@@ -0,0 +1,118 @@
+#ifndef PARSECACHE_HPP
+#define PARSECACHE_HPP
+
+#include "ElfReader.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Bits of a cache entry's phases, which parts of the parse it holds
+ */
+enum cache_phase : uint32_t {
+  CP_SECTIONS = 1 << 0,
+  CP_SYMBOLS = 1 << 1,// .symtab
+  CP_DYNAMIC_SYMBOLS = 1 << 2,// .dynsym
+  CP_SEGMENTS = 1 << 3,
+  CP_NOTES = 1 << 4,
+};
+
+/**
+ * @brief Counters of a ParseCache, a snapshot
+ */
+struct cache_stats
+{
+  uint64_t hits;// found by device and inode
+  uint64_t build_id_hits;// found by build-id, e.g. a copy of a cached file
+  uint64_t misses;
+  uint64_t stale;// found but the file changed since, removed
+  uint64_t stores;
+};
+
+/**
+ * @brief On-disk cache of what ElfReader parsed from a file.
+ *
+ * Holds the section headers and their names, the program headers, the notes
+ * and the .symtab and .dynsym entries.  Each file gets one entry named after
+ * its device and inode, a second name under build-id/ is a hard link to the
+ * same entry.  A file found by build-id must also have the same size and the
+ * same raw header tables.  An entry records the size and mtime of the file it was made
+ * from, an entry whose file changed is stale and is removed.
+ *
+ * All integers are little endian, the tables are flat arrays of fixed size
+ * records read straight out of the mapped entry.
+ *
+ *   header    "EPCE", u32 version (1), u64 device, u64 inode, u64 size,
+ *             u64 mtime in nanoseconds, u32 phases (cache_phase bits),
+ *             u32 build-id length, u32 section count, u32 segment count,
+ *             u32 note count, u32 symbol table count, u64 symbol count, then
+ *             u64 offsets of the section, segment, note, symbol table, symbol
+ *             and string tables, u64 string table size and u64 lane_hash
+ *             of the raw ELF header, section and program header tables
+ *   sections  88 bytes: sh_name to sh_entsize as u64, u32 name offset,
+ *             u32 name length
+ *   segments  64 bytes: p_type, p_offset, p_vaddr, p_paddr, p_filesz,
+ *             p_memsz, p_flags, p_align as u64
+ *   notes     40 bytes: n_namesz, n_descsz, n_type, descriptor offset as u64,
+ *             u32 name offset, u32 name length
+ *   tables    24 bytes: u32 section index, u32 unused, u64 first symbol,
+ *             u64 symbol count
+ *   symbols   40 bytes: u64 st_value, u64 st_size, u32 st_name, u32 st_shndx,
+ *             u32 name offset, u32 name length, u8 st_info, u8 st_other,
+ *             6 unused
+ *   strings   the build-id in hex first, then the names, not terminated
+ *
+ * A hit decodes the records into the reader's tables, so it costs a pass over
+ * the symbols rather than a page fault, but nothing is allocated per entry:
+ * the reader keeps the entry mapped and the symbol names are views into its
+ * strings.  String tables are split from the file as in a parse.
+ *
+ * The cache is used by ElfReader when ParseOptions::cache is set.  Entries are
+ * written to a temporary name and renamed, so one cache can be shared by
+ * several threads and processes.
+ */
+class ParseCache
+{
+public:
+  explicit ParseCache(const std::string &directory);
+
+  /**
+   * @brief false if the directory could not be created
+   */
+  bool is_open() const;
+  cache_stats get_stats() const;
+
+  /**
+   * @brief Fill in everything the reader's options ask for from the cache
+   *
+   * Called by ElfReader after the ELF header, program headers and notes are
+   * read, the notes give the build-id.
+   *
+   * @return false on a miss, the reader then parses the file
+   */
+  bool load(ElfReader &elf);
+
+  /**
+   * @brief Save what the reader parsed, called after a miss
+   */
+  void store(const ElfReader &elf);
+
+private:
+  std::string directory;
+  bool open;
+  std::atomic<uint64_t> hits;
+  std::atomic<uint64_t> build_id_hits;
+  std::atomic<uint64_t> misses;
+  std::atomic<uint64_t> stale;
+  std::atomic<uint64_t> stores;
+  std::atomic<uint64_t> temporary_counter;
+
+  static uint32_t phases(const ParseOptions &options);
+  std::string entry_path(uint64_t device, uint64_t inode) const;
+  std::string build_id_path(const std::string &build_id) const;
+  bool restore(ElfReader &elf, const std::string &path, uint64_t device, uint64_t inode, uint64_t size, uint64_t mtime, bool by_build_id);
+};
+
+void write_text(OutputBuffer &out, const cache_stats &stats);
+
+#endif /* PARSECACHE_HPP */
@@ -0,0 +1,216 @@
+#include "ParseStats.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+const char *parse_phase_to_string(parse_phase phase)
+{
+  switch (phase) {
+  case PP_OPEN:
+    return "open";
+  case PP_VALIDATE:
+    return "validate";
+  case PP_ELF_HEADER:
+    return "elf header";
+  case PP_SECTION_HEADERS:
+    return "section headers";
+  case PP_SECTION_NAMES:
+    return "section names";
+  case PP_SECTION_TABLES:
+    return "section tables";
+  case PP_PROGRAM_HEADERS:
+    return "program headers";
+  case PP_NOTES:
+    return "notes";
+  case PP_CACHE:
+    return "cache";
+  case PP_COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+void parse_stats::add(const parse_stats &other)
+{
+#if ELF_ENABLE_STATS
+  for (size_t ii = 0; ii < PP_COUNT; ii++) {
+    phases[ii].nanoseconds += other.phases[ii].nanoseconds;
+    phases[ii].calls += other.phases[ii].calls;
+    phases[ii].bytes += other.phases[ii].bytes;
+    phases[ii].entries += other.phases[ii].entries;
+    phases[ii].allocations += other.phases[ii].allocations;
+    phases[ii].allocated_bytes += other.phases[ii].allocated_bytes;
+    phases[ii].counters.add(other.phases[ii].counters);
+  }
+#else
+  (void)other;
+#endif
+}
+
+bool read_allocation_budget(const std::string &path, std::vector<allocation_budget> &budget)
+{
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::vector<std::string> tokens;
+    for (std::string word; words >> word;) {
+      tokens.push_back(word);
+    }
+    if (tokens.empty()) continue;
+    if (tokens.size() < 3) return false;
+    // phase names have spaces in them, the two limits are last
+    std::string name = tokens[0];
+    for (size_t ii = 1; ii + 2 < tokens.size(); ii++) {
+      name += " " + tokens[ii];
+    }
+    auto phase = PP_COUNT;
+    for (size_t ii = 0; ii < PP_COUNT; ii++) {
+      if (name == parse_phase_to_string(static_cast<parse_phase>(ii))) phase = static_cast<parse_phase>(ii);
+    }
+    if (phase == PP_COUNT && name != "total") return false;
+    char *end = nullptr;
+    uint64_t allocations = std::strtoull(tokens[tokens.size() - 2].c_str(), &end, 10);
+    if (*end != '\0') return false;
+    uint64_t bytes = std::strtoull(tokens.back().c_str(), &end, 10);
+    if (*end != '\0') return false;
+    budget.push_back({ phase, allocations, bytes });
+  }
+  return true;
+}
+
+bool check_allocation_budget(OutputBuffer &out, const parse_stats &stats, const std::vector<allocation_budget> &budget)
+{
+  if (!parse_stats::enabled) {
+    out.put("budget: can't be checked, build with -DELF_ENABLE_STATS=ON\n");
+    return false;
+  }
+  bool within = true;
+  for (auto &b : budget) {
+    phase_stats used{};
+    for (size_t ii = 0; ii < PP_COUNT; ii++) {
+      if (b.phase != PP_COUNT && b.phase != ii) continue;
+      auto s = stats.get(static_cast<parse_phase>(ii));
+      used.allocations += s.allocations;
+      used.allocated_bytes += s.allocated_bytes;
+    }
+    bool over = used.allocations > b.allocations || used.allocated_bytes > b.bytes;
+    within = within && !over;
+    out.put("budget: ").put(b.phase == PP_COUNT ? "total" : parse_phase_to_string(b.phase)).put(' ');
+    out.dec(used.allocations).put(" of ").dec(b.allocations).put(" allocations, ");
+    out.dec(used.allocated_bytes).put(" of ").dec(b.bytes).put(" bytes").put(over ? "  OVER\n" : "\n");
+  }
+  return within;
+}
+
+void write_text(OutputBuffer &out, const parse_stats &stats)
+{
+  if (!parse_stats::enabled) {
+    out.put("stats: not available, build with -DELF_ENABLE_STATS=ON\n");
+    return;
+  }
+  auto column = [&out](const std::string &digits, size_t width) {
+    if (digits.size() < width) out.put(std::string(width - digits.size(), ' '));
+    out.put(digits);
+  };
+  auto line = [&](std::string_view name, const phase_stats &s) {
+    out.put(name);
+    if (name.size() < 16) out.put(std::string(16 - name.size(), ' '));
+    column(std::to_string(s.calls), 10);
+    // microseconds to one decimal place
+    column(std::to_string(s.nanoseconds / 1000) + "." + std::to_string(s.nanoseconds / 100 % 10), 12);
+    column(std::to_string(s.bytes), 14);
+    column(std::to_string(s.entries), 12);
+    column(std::to_string(s.allocations), 12);
+    column(std::to_string(s.allocated_bytes), 14);
+    out.put('\n');
+  };
+  out.put("phase                calls     time us         bytes     entries      allocs   alloc bytes\n");
+  phase_stats total{};
+  for (size_t ii = 0; ii < PP_COUNT; ii++) {
+    auto s = stats.get(static_cast<parse_phase>(ii));
+    if (s.calls == 0) continue;
+    line(parse_phase_to_string(static_cast<parse_phase>(ii)), s);
+    total.nanoseconds += s.nanoseconds;
+    total.calls += s.calls;
+    total.bytes += s.bytes;
+    total.entries += s.entries;
+    total.allocations += s.allocations;
+    total.allocated_bytes += s.allocated_bytes;
+  }
+  line("total", total);
+}
+
+void write_text(OutputBuffer &out, const perf_sample &sample)
+{
+  auto column = [&out](const std::string &digits, size_t width) {
+    if (digits.size() < width) out.put(std::string(width - digits.size(), ' '));
+    out.put(digits);
+  };
+  for (size_t ii = 0; ii < PC_COUNT; ii++) {
+    column(sample.has(static_cast<perf_counter>(ii)) ? std::to_string(sample.values[ii]) : "n/a", 14);
+  }
+  if (sample.has(PC_CYCLES) && sample.has(PC_INSTRUCTIONS) && sample.values[PC_CYCLES] != 0) {
+    // two decimal places without floating point
+    uint64_t hundredths = (sample.values[PC_INSTRUCTIONS] * 100 + sample.values[PC_CYCLES] / 2) / sample.values[PC_CYCLES];
+    auto tail = std::to_string(hundredths % 100);
+    column(std::to_string(hundredths / 100) + "." + (tail.size() < 2 ? "0" : "") + tail, 8);
+  } else {
+    column("n/a", 8);
+  }
+}
+
+void write_text_counters(OutputBuffer &out, const parse_stats &stats)
+{
+  if (!parse_stats::enabled) {
+    out.put("perf: no phases, build with -DELF_ENABLE_STATS=ON\n");
+    return;
+  }
+  out.put("phase                   cycles  instructions  cache misses branch misses   page faults     IPC\n");
+  perf_sample total{};
+  for (size_t ii = 0; ii < PP_COUNT; ii++) {
+    auto s = stats.get(static_cast<parse_phase>(ii));
+    if (s.calls == 0) continue;
+    std::string_view name = parse_phase_to_string(static_cast<parse_phase>(ii));
+    out.put(name).put(std::string(16 - name.size(), ' '));
+    write_text(out, s.counters);
+    out.put('\n');
+    total.add(s.counters);
+  }
+  out.put("total           ");
+  write_text(out, total);
+  out.put('\n');
+}
+
+#if ELF_ENABLE_STATS
+thread_local allocation_counter thread_allocations = {};
+
+// Replacing these two is enough, the array, nothrow and sized forms of the
+// standard library call them.  Aligned allocations are not counted.
+void *operator new(std::size_t size)
+{
+  thread_allocations.count++;
+  thread_allocations.bytes += size;
+  if (size == 0) size = 1;
+  for (;;) {
+    if (void *p = std::malloc(size)) return p;
+    auto handler = std::get_new_handler();
+    if (handler == nullptr) throw std::bad_alloc();
+    handler();
+  }
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
+#endif
@@ -0,0 +1,193 @@
+#ifndef PARSESTATS_HPP
+#define PARSESTATS_HPP
+
+#include "OutputBuffer.hpp"
+#include "PerfCounters.hpp"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// cmake -DELF_ENABLE_STATS=ON, without it the timers and counters below are
+// empty and every call to them compiles away
+#ifndef ELF_ENABLE_STATS
+#define ELF_ENABLE_STATS 0
+#endif
+
+/**
+ * @brief The parts of a parse that are timed and counted
+ */
+enum parse_phase {
+  PP_OPEN,// opening and mapping the file, ElfReader::open() only
+  PP_VALIDATE,
+  PP_ELF_HEADER,
+  PP_SECTION_HEADERS,
+  PP_SECTION_NAMES,
+  PP_SECTION_TABLES,// symbol and string tables
+  PP_PROGRAM_HEADERS,
+  PP_NOTES,
+  PP_CACHE,// ParseCache lookups and stores
+  PP_COUNT
+};
+
+const char *parse_phase_to_string(parse_phase phase);
+
+/**
+ * @brief What one phase cost, summed over every time it ran
+ */
+struct phase_stats
+{
+  uint64_t nanoseconds;
+  uint64_t calls;
+  uint64_t bytes;// of the file read by the phase
+  uint64_t entries;// headers, names, symbols or notes decoded
+  uint64_t allocations;// operator new calls made on the thread during the phase
+  uint64_t allocated_bytes;
+  perf_sample counters;// only with PerfCounters::enable()
+};
+
+/**
+ * @brief Per phase timings and counters of one or more parses.
+ *
+ * Only kept when built with ELF_ENABLE_STATS, otherwise the struct is empty
+ * and get() gives zeros.  Allocations are counted by a replacement operator
+ * new that is only linked in with ELF_ENABLE_STATS.
+ */
+struct parse_stats
+{
+  static constexpr bool enabled = ELF_ENABLE_STATS != 0;
+
+#if ELF_ENABLE_STATS
+  phase_stats phases[PP_COUNT] = {};
+#endif
+
+  phase_stats get(parse_phase phase) const
+  {
+#if ELF_ENABLE_STATS
+    return phases[phase];
+#else
+    (void)phase;
+    return phase_stats{};
+#endif
+  }
+
+  /**
+   * @brief Record what a phase read, at the end of each call of it
+   */
+  void count(parse_phase phase, uint64_t bytes, uint64_t entries)
+  {
+#if ELF_ENABLE_STATS
+    phases[phase].bytes += bytes;
+    phases[phase].entries += entries;
+#else
+    (void)phase;
+    (void)bytes;
+    (void)entries;
+#endif
+  }
+
+  void add(const parse_stats &other);
+};
+
+#if ELF_ENABLE_STATS
+/**
+ * @brief Allocations made on this thread so far, kept by the operator new in
+ *        ParseStats.cpp
+ */
+struct allocation_counter
+{
+  uint64_t count;
+  uint64_t bytes;
+};
+extern thread_local allocation_counter thread_allocations;
+#endif
+
+/**
+ * @brief Adds the time and allocations from construction to stop() or
+ *        destruction to one phase
+ *
+ * Timers of different phases must not overlap, the inner one would be
+ * counted twice.
+ */
+class PhaseTimer
+{
+public:
+#if ELF_ENABLE_STATS
+  PhaseTimer(parse_stats &stats, parse_phase phase)
+    : target(&stats.phases[phase]), perf(PerfCounters::for_thread()), counted(perf != nullptr ? perf->read() : perf_sample{}), allocations(thread_allocations), started(std::chrono::steady_clock::now())
+  {
+  }
+  ~PhaseTimer() { stop(); }
+
+  void stop()
+  {
+    if (target == nullptr) return;
+    target->nanoseconds += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count());
+    target->calls++;
+    target->allocations += thread_allocations.count - allocations.count;
+    target->allocated_bytes += thread_allocations.bytes - allocations.bytes;
+    if (perf != nullptr) target->counters.add(perf->read().since(counted));
+    target = nullptr;
+  }
+#else
+  PhaseTimer(parse_stats &, parse_phase) {}
+  void stop() {}
+#endif
+  PhaseTimer(const PhaseTimer &) = delete;
+  PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+#if ELF_ENABLE_STATS
+  phase_stats *target;
+  PerfCounters *perf;
+  perf_sample counted;
+  allocation_counter allocations;
+  std::chrono::steady_clock::time_point started;// last, the counters are read outside the time
+#endif
+};
+
+/**
+ * @brief Most allocations and bytes a phase may use, see
+ *        check_allocation_budget()
+ */
+struct allocation_budget
+{
+  parse_phase phase;// PP_COUNT for all the phases together
+  uint64_t allocations;
+  uint64_t bytes;
+};
+
+/**
+ * @brief Read a budget file, a line per phase with the name --stats prints
+ *        for it ("total" for all of them), the allocations and the bytes,
+ *        e.g. "section tables 40000 5500000".  # starts a comment.
+ *
+ * @return false if the file can't be read or a line is not understood
+ */
+bool read_allocation_budget(const std::string &path, std::vector<allocation_budget> &budget);
+
+/**
+ * @brief Print the allocations of each budgeted phase against its limit
+ *
+ * @return false if a phase went over, or the build has no stats to check
+ */
+bool check_allocation_budget(OutputBuffer &out, const parse_stats &stats, const std::vector<allocation_budget> &budget);
+
+/**
+ * @brief One line per phase that ran and a total, or a note that the build
+ *        has no stats
+ */
+void write_text(OutputBuffer &out, const parse_stats &stats);
+
+/**
+ * @brief The perf counters of each phase, with instructions per cycle
+ */
+void write_text_counters(OutputBuffer &out, const parse_stats &stats);
+
+/**
+ * @brief Counter values and instructions per cycle on one line, n/a for
+ *        the ones that were not available
+ */
+void write_text(OutputBuffer &out, const perf_sample &sample);
+
+#endif /* PARSESTATS_HPP */
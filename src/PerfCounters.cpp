@@ -0,0 +1,140 @@
+#include "PerfCounters.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<bool> profiling{ false };
+
+struct event
+{
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr event EVENTS[PC_COUNT] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+  { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+};
+
+int open_event(const event &e)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = e.type;
+  attr.config = e.config;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // this thread on any CPU
+  return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+}// namespace
+
+const char *perf_counter_to_string(perf_counter counter)
+{
+  switch (counter) {
+  case PC_CYCLES:
+    return "cycles";
+  case PC_INSTRUCTIONS:
+    return "instructions";
+  case PC_CACHE_MISSES:
+    return "cache misses";
+  case PC_BRANCH_MISSES:
+    return "branch misses";
+  case PC_PAGE_FAULTS:
+    return "page faults";
+  case PC_COUNT:
+    break;
+  }
+  return "unknown";
+}
+
+void perf_sample::add(const perf_sample &other)
+{
+  for (size_t ii = 0; ii < PC_COUNT; ii++) {
+    values[ii] += other.values[ii];
+  }
+  available |= other.available;
+}
+
+perf_sample perf_sample::since(const perf_sample &start) const
+{
+  perf_sample result{};
+  result.available = available & start.available;
+  for (size_t ii = 0; ii < PC_COUNT; ii++) {
+    // a multiplexed counter is an estimate and can step backwards
+    if (result.has(static_cast<perf_counter>(ii)) && values[ii] > start.values[ii]) result.values[ii] = values[ii] - start.values[ii];
+  }
+  return result;
+}
+
+PerfCounters::PerfCounters()
+{
+  for (size_t ii = 0; ii < PC_COUNT; ii++) {
+    fds[ii] = open_event(EVENTS[ii]);
+    if (fds[ii] >= 0) continue;
+    int reason = errno;
+    if (!error.empty()) error += ", ";
+    error += std::string(perf_counter_to_string(static_cast<perf_counter>(ii))) + ": " + std::strerror(reason);
+    if (reason == EACCES || reason == EPERM) error += " (kernel.perf_event_paranoid)";
+  }
+}
+
+PerfCounters::~PerfCounters()
+{
+  for (auto fd : fds) {
+    if (fd >= 0) ::close(fd);
+  }
+}
+
+bool PerfCounters::is_open() const
+{
+  for (auto fd : fds) {
+    if (fd >= 0) return true;
+  }
+  return false;
+}
+
+const std::string &PerfCounters::get_error() const
+{
+  return error;
+}
+
+perf_sample PerfCounters::read() const
+{
+  perf_sample sample{};
+  for (size_t ii = 0; ii < PC_COUNT; ii++) {
+    if (fds[ii] < 0) continue;
+    uint64_t values[3];// value, time enabled, time running
+    if (::read(fds[ii], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0) continue;
+    if (values[2] < values[1]) {
+      // the counter only ran part of the time, scale it up
+      values[0] = static_cast<uint64_t>(static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]));
+    }
+    sample.values[ii] = values[0];
+    sample.available |= 1u << ii;
+  }
+  return sample;
+}
+
+void PerfCounters::enable()
+{
+  profiling = true;
+}
+
+PerfCounters *PerfCounters::for_thread()
+{
+  if (!profiling.load(std::memory_order_relaxed)) return nullptr;
+  thread_local PerfCounters counters;
+  return counters.is_open() ? &counters : nullptr;
+}
@@ -0,0 +1,89 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The hardware and software events PerfCounters reads
+ */
+enum perf_counter {
+  PC_CYCLES,
+  PC_INSTRUCTIONS,
+  PC_CACHE_MISSES,// last level cache
+  PC_BRANCH_MISSES,
+  PC_PAGE_FAULTS,
+  PC_COUNT
+};
+
+const char *perf_counter_to_string(perf_counter counter);
+
+/**
+ * @brief Counter values, or the difference between two readings
+ */
+struct perf_sample
+{
+  uint64_t values[PC_COUNT];
+  uint32_t available;// bit per perf_counter, values of the others are 0
+
+  bool has(perf_counter counter) const { return (available & (1u << counter)) != 0; }
+  void add(const perf_sample &other);
+
+  /**
+   * @brief What was counted between an earlier reading and this one
+   */
+  perf_sample since(const perf_sample &start) const;
+};
+
+/**
+ * @brief Cycles, instructions, cache misses, branch misses and page faults
+ *        of the calling thread, from perf_event_open.
+ *
+ * Only user space is counted, which perf_event_paranoid 2 (the usual
+ * default) allows.  Each event is opened on its own, so in a VM without a
+ * PMU the hardware events are missing and the page faults are still there;
+ * read() marks what it has in perf_sample::available.  Values are scaled
+ * when the kernel multiplexes the counters.
+ *
+ * A reading is one read() per event, a few microseconds, so wrap whole
+ * phases or files rather than single entries.
+ */
+class PerfCounters
+{
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  /**
+   * @brief At least one event could be opened
+   */
+  bool is_open() const;
+
+  /**
+   * @brief Why events are missing, e.g. "cycles: No such file or directory",
+   *        empty when everything was opened
+   */
+  const std::string &get_error() const;
+  perf_sample read() const;
+
+  /**
+   * @brief Count on every thread that asks for_thread() from now on
+   */
+  static void enable();
+
+  /**
+   * @brief The counters of the calling thread, opened on first use
+   *
+   * @return PerfCounters* nullptr unless enable() was called and some event
+   *         could be opened
+   */
+  static PerfCounters *for_thread();
+
+private:
+  int fds[PC_COUNT];
+  std::string error;
+};
+
+#endif /* PERFCOUNTERS_HPP */
@@ -0,0 +1,398 @@
+#include "RecordWriter.hpp"
+#include "SymbolTable.hpp"
+#include "elf.hpp"
+
+namespace {
+
+constexpr uint64_t bit(record_field field)
+{
+  return 1ULL << field;
+}
+
+constexpr uint64_t file_fields = bit(RF_FILE) | bit(RF_FILE_ID);
+
+// fields that exist for each record_kind
+constexpr std::array<uint64_t, static_cast<size_t>(record_kind::END_OF_RECORD_KINDS)> valid_fields{ {
+  file_fields | bit(RF_CLASS) | bit(RF_DATA) | bit(RF_OSABI) | bit(RF_TYPE) | bit(RF_MACHINE) | bit(RF_ENTRY) | bit(RF_PHOFF) | bit(RF_SHOFF) | bit(RF_FLAGS) | bit(RF_PHNUM) | bit(RF_SHNUM) | bit(RF_SHSTRNDX),
+  file_fields | bit(RF_INDEX) | bit(RF_NAME) | bit(RF_TYPE) | bit(RF_FLAGS) | bit(RF_ADDR) | bit(RF_OFFSET) | bit(RF_SIZE) | bit(RF_LINK) | bit(RF_INFO) | bit(RF_ALIGN) | bit(RF_ENTSIZE),
+  file_fields | bit(RF_TABLE) | bit(RF_INDEX) | bit(RF_NAME) | bit(RF_VALUE) | bit(RF_SIZE) | bit(RF_BIND) | bit(RF_TYPE) | bit(RF_VISIBILITY) | bit(RF_SHNDX),
+  file_fields | bit(RF_INDEX) | bit(RF_TYPE) | bit(RF_FLAGS) | bit(RF_OFFSET) | bit(RF_ADDR) | bit(RF_PADDR) | bit(RF_SIZE) | bit(RF_MEMSZ) | bit(RF_ALIGN),
+} };
+
+constexpr std::array<std::string_view, END_OF_RECORD_FIELDS> field_names{ {
+  "file",
+  "file_id",
+  "class",
+  "data",
+  "osabi",
+  "type",
+  "machine",
+  "entry",
+  "phoff",
+  "shoff",
+  "flags",
+  "phnum",
+  "shnum",
+  "shstrndx",
+  "index",
+  "name",
+  "addr",
+  "offset",
+  "size",
+  "link",
+  "info",
+  "align",
+  "entsize",
+  "paddr",
+  "memsz",
+  "table",
+  "value",
+  "bind",
+  "visibility",
+  "shndx",
+} };
+
+constexpr std::array<std::string_view, static_cast<size_t>(record_kind::END_OF_RECORD_KINDS)> kind_names{ {
+  "header",
+  "section",
+  "symbol",
+  "segment",
+} };
+
+void append_dec(std::string &target, uint64_t value)
+{
+  char digits[20];
+  size_t n = sizeof(digits);
+  do {
+    digits[--n] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  target.append(digits + n, sizeof(digits) - n);
+}
+
+void append_json_string(std::string &target, std::string_view value)
+{
+  static constexpr char hex_digits[] = "0123456789abcdef";
+  target += '"';
+  for (char c : value) {
+    auto u = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      target += '\\';
+      target += c;
+    } else if (u < 0x20) {
+      target += "\\u00";
+      target += hex_digits[u >> 4];
+      target += hex_digits[u & 0xf];
+    } else {
+      target += c;
+    }
+  }
+  target += '"';
+}
+
+}// namespace
+
+
+std::string_view record_kind_to_string(record_kind kind)
+{
+  return kind_names[static_cast<size_t>(kind)];
+}
+
+std::string_view record_field_to_string(record_field field)
+{
+  return field_names[field];
+}
+
+
+FieldSet::FieldSet() : masks(valid_fields)
+{
+}
+
+bool FieldSet::parse(std::string_view list)
+{
+  masks.fill(0);
+  bool matched_all = true;
+  while (!list.empty()) {
+    auto comma = list.find(',');
+    auto token = list.substr(0, comma);
+    list = (comma == std::string_view::npos) ? std::string_view{} : list.substr(comma + 1);
+    if (token.empty()) continue;
+    auto dot = token.find('.');
+    auto kind_name = (dot == std::string_view::npos) ? std::string_view{} : token.substr(0, dot);
+    auto field_name = (dot == std::string_view::npos) ? token : token.substr(dot + 1);
+    bool matched = false;
+    for (size_t kk = 0; kk < kind_names.size(); kk++) {
+      if (dot == std::string_view::npos && token == kind_names[kk]) {
+        masks[kk] = valid_fields[kk];
+        matched = true;
+        continue;
+      }
+      if (dot != std::string_view::npos && kind_name != kind_names[kk]) continue;
+      for (size_t ff = 0; ff < field_names.size(); ff++) {
+        uint64_t wanted = 1ULL << ff;
+        if (field_names[ff] == field_name && (valid_fields[kk] & wanted) != 0) {
+          masks[kk] |= wanted;
+          matched = true;
+        }
+      }
+    }
+    matched_all = matched_all && matched;
+  }
+  for (auto &mask : masks) {
+    if (mask != 0) mask |= file_fields;
+  }
+  return matched_all;
+}
+
+bool FieldSet::has(record_kind kind) const
+{
+  return masks[static_cast<size_t>(kind)] != 0;
+}
+
+bool FieldSet::has(record_kind kind, record_field field) const
+{
+  return (masks[static_cast<size_t>(kind)] & bit(field)) != 0;
+}
+
+
+RecordWriter::RecordWriter(OutputBuffer &out, const FieldSet &fields) : out(out), fields(fields), current_file_id(0)
+{
+}
+
+void RecordWriter::write(const ElfReader &elf, const std::string &filename, size_t file_id)
+{
+  current_file = filename;
+  current_file_id = file_id;
+  if (fields.has(record_kind::header)) {
+    write_header(elf);
+  }
+  if (fields.has(record_kind::section)) {
+    for (auto &sh : elf.section_headers) {
+      write_section(sh);
+    }
+  }
+  if (fields.has(record_kind::symbol)) {
+    for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+      auto table = elf.get_symbol_table(ii);
+      if (table == nullptr) continue;
+      for (auto &sym : table->entries) {
+        write_symbol(sym, ii);
+      }
+    }
+  }
+  if (fields.has(record_kind::segment)) {
+    size_t index = 0;
+    for (auto &p : elf.program_headers) {
+      write_segment(p, index++);
+    }
+  }
+}
+
+void RecordWriter::begin(record_kind kind)
+{
+  begin_record(kind);
+  if (fields.has(kind, RF_FILE)) field(RF_FILE, current_file);
+  if (fields.has(kind, RF_FILE_ID)) field(RF_FILE_ID, current_file_id);
+}
+
+void RecordWriter::write_header(const ElfReader &elf)
+{
+  const auto kind = record_kind::header;
+  auto want = [this, kind](record_field f) { return fields.has(kind, f); };
+  begin(kind);
+  if (want(RF_CLASS)) field(RF_CLASS, elf.get_class());
+  if (want(RF_DATA)) field(RF_DATA, elf.get_data_encoding());
+  if (want(RF_OSABI)) field(RF_OSABI, elf.get_osabi());
+  if (want(RF_TYPE)) {
+    if (describe_enums()) {
+      field(RF_TYPE, e_type_to_string(elf.header.e_type));
+    } else {
+      field(RF_TYPE, elf.header.e_type);
+    }
+  }
+  if (want(RF_MACHINE)) {
+    if (describe_enums()) {
+      field(RF_MACHINE, e_machines_to_string(elf.header.e_machine));
+    } else {
+      field(RF_MACHINE, elf.header.e_machine);
+    }
+  }
+  if (want(RF_ENTRY)) field(RF_ENTRY, elf.header.e_entry);
+  if (want(RF_PHOFF)) field(RF_PHOFF, elf.header.e_phoff);
+  if (want(RF_SHOFF)) field(RF_SHOFF, elf.header.e_shoff);
+  if (want(RF_FLAGS)) field(RF_FLAGS, elf.header.e_flags);
+  if (want(RF_PHNUM)) field(RF_PHNUM, elf.header.e_phnum);
+  if (want(RF_SHNUM)) field(RF_SHNUM, elf.header.e_shnum);
+  if (want(RF_SHSTRNDX)) field(RF_SHSTRNDX, elf.header.e_shstrndx);
+  end_record();
+}
+
+void RecordWriter::write_section(const Elf_Shdr &sh)
+{
+  const auto kind = record_kind::section;
+  auto want = [this, kind](record_field f) { return fields.has(kind, f); };
+  begin(kind);
+  if (want(RF_INDEX)) field(RF_INDEX, sh.index);
+  if (want(RF_NAME)) field(RF_NAME, sh.name);
+  if (want(RF_TYPE)) {
+    if (describe_enums()) {
+      field(RF_TYPE, e_section_types_to_string(sh.sh_type));
+    } else {
+      field(RF_TYPE, sh.sh_type);
+    }
+  }
+  if (want(RF_FLAGS)) field(RF_FLAGS, sh.sh_flags);
+  if (want(RF_ADDR)) field(RF_ADDR, sh.sh_addr);
+  if (want(RF_OFFSET)) field(RF_OFFSET, sh.sh_offset);
+  if (want(RF_SIZE)) field(RF_SIZE, sh.sh_size);
+  if (want(RF_LINK)) field(RF_LINK, sh.sh_link);
+  if (want(RF_INFO)) field(RF_INFO, sh.sh_info);
+  if (want(RF_ALIGN)) field(RF_ALIGN, sh.sh_addralign);
+  if (want(RF_ENTSIZE)) field(RF_ENTSIZE, sh.sh_entsize);
+  end_record();
+}
+
+void RecordWriter::write_symbol(const Elf_Sym &sym, size_t table)
+{
+  const auto kind = record_kind::symbol;
+  auto want = [this, kind](record_field f) { return fields.has(kind, f); };
+  begin(kind);
+  if (want(RF_TABLE)) field(RF_TABLE, table);
+  if (want(RF_INDEX)) field(RF_INDEX, sym.index);
+  if (want(RF_NAME)) field(RF_NAME, sym.name);
+  if (want(RF_VALUE)) field(RF_VALUE, sym.st_value);
+  if (want(RF_SIZE)) field(RF_SIZE, sym.st_size);
+  if (describe_enums()) {
+    if (want(RF_BIND)) field(RF_BIND, elf_sym_binding_to_string(ELF64_ST_BIND(sym.st_info)));
+    if (want(RF_TYPE)) field(RF_TYPE, elf_sym_type_to_string(ELF64_ST_TYPE(sym.st_info)));
+    if (want(RF_VISIBILITY)) field(RF_VISIBILITY, elf_sym_visibility_to_string(sym.st_other));
+  } else {
+    if (want(RF_BIND)) field(RF_BIND, ELF64_ST_BIND(sym.st_info));
+    if (want(RF_TYPE)) field(RF_TYPE, ELF64_ST_TYPE(sym.st_info));
+    if (want(RF_VISIBILITY)) field(RF_VISIBILITY, sym.st_other);
+  }
+  if (want(RF_SHNDX)) field(RF_SHNDX, sym.st_shndx);
+  end_record();
+}
+
+void RecordWriter::write_segment(const Elf_Phdr &p, size_t index)
+{
+  const auto kind = record_kind::segment;
+  auto want = [this, kind](record_field f) { return fields.has(kind, f); };
+  begin(kind);
+  if (want(RF_INDEX)) field(RF_INDEX, index);
+  if (want(RF_TYPE)) {
+    if (describe_enums()) {
+      field(RF_TYPE, elf_program_type_to_string(p.p_type));
+    } else {
+      field(RF_TYPE, p.p_type);
+    }
+  }
+  if (want(RF_FLAGS)) field(RF_FLAGS, p.p_flags);
+  if (want(RF_OFFSET)) field(RF_OFFSET, p.p_offset);
+  if (want(RF_ADDR)) field(RF_ADDR, p.p_vaddr);
+  if (want(RF_PADDR)) field(RF_PADDR, p.p_paddr);
+  if (want(RF_SIZE)) field(RF_SIZE, p.p_filesz);
+  if (want(RF_MEMSZ)) field(RF_MEMSZ, p.p_memsz);
+  if (want(RF_ALIGN)) field(RF_ALIGN, p.p_align);
+  end_record();
+}
+
+
+JsonLinesWriter::JsonLinesWriter(OutputBuffer &out, const FieldSet &fields) : RecordWriter(out, fields)
+{
+}
+
+bool JsonLinesWriter::describe_enums() const
+{
+  return true;
+}
+
+void JsonLinesWriter::begin_record(record_kind kind)
+{
+  record.clear();
+  record += "{\"kind\":\"";
+  record += record_kind_to_string(kind);
+  record += '"';
+}
+
+void JsonLinesWriter::field(record_field field, uint64_t value)
+{
+  record += ",\"";
+  record += field_names[field];
+  record += "\":";
+  append_dec(record, value);
+}
+
+void JsonLinesWriter::field(record_field field, std::string_view value)
+{
+  record += ",\"";
+  record += field_names[field];
+  record += "\":";
+  append_json_string(record, value);
+}
+
+void JsonLinesWriter::end_record()
+{
+  record += "}\n";
+  out.ensure(record.size());
+  out.put(record);
+}
+
+
+BinaryRecordWriter::BinaryRecordWriter(OutputBuffer &out, const FieldSet &fields) : RecordWriter(out, fields)
+{
+}
+
+void BinaryRecordWriter::write_stream_header(OutputBuffer &out)
+{
+  out.put("ELFR").put('\x01');
+}
+
+bool BinaryRecordWriter::describe_enums() const
+{
+  return false;
+}
+
+void BinaryRecordWriter::begin_record(record_kind kind)
+{
+  record.clear();
+  record += static_cast<char>(kind);
+}
+
+void BinaryRecordWriter::field(record_field field, uint64_t value)
+{
+  record += static_cast<char>(field);
+  put_varint(record, value);
+}
+
+void BinaryRecordWriter::field(record_field field, std::string_view value)
+{
+  record += static_cast<char>(field);
+  put_varint(record, value.size());
+  record += value;
+}
+
+void BinaryRecordWriter::end_record()
+{
+  char length[10];
+  size_t n = 0;
+  uint64_t value = record.size();
+  do {
+    byte b = value & 0x7f;
+    value >>= 7;
+    length[n++] = static_cast<char>(value != 0 ? (b | 0x80) : b);
+  } while (value != 0);
+  out.ensure(n + record.size());
+  out.put(std::string_view(length, n));
+  out.put(record);
+}
+
+void BinaryRecordWriter::put_varint(std::string &target, uint64_t value)
+{
+  do {
+    byte b = value & 0x7f;
+    value >>= 7;
+    target += static_cast<char>(value != 0 ? (b | 0x80) : b);
+  } while (value != 0);
+}
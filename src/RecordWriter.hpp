@@ -0,0 +1,184 @@
+#ifndef RECORDWRITER_HPP
+#define RECORDWRITER_HPP
+
+#include "ElfReader.hpp"
+#include "OutputBuffer.hpp"
+#include <array>
+#include <string>
+#include <string_view>
+
+enum class record_kind {
+  header,
+  section,
+  symbol,
+  segment,
+  END_OF_RECORD_KINDS
+};
+
+/**
+ * @brief Fields of each record kind.
+ *
+ * The value is the field id in the binary stream and the bit in a FieldSet,
+ * so existing values must never be renumbered.
+ */
+enum record_field {
+  // every record
+  RF_FILE = 0,
+  RF_FILE_ID = 1,
+  // header
+  RF_CLASS = 2,
+  RF_DATA = 3,
+  RF_OSABI = 4,
+  RF_TYPE = 5,
+  RF_MACHINE = 6,
+  RF_ENTRY = 7,
+  RF_PHOFF = 8,
+  RF_SHOFF = 9,
+  RF_FLAGS = 10,
+  RF_PHNUM = 11,
+  RF_SHNUM = 12,
+  RF_SHSTRNDX = 13,
+  // section, segment and symbol
+  RF_INDEX = 14,
+  RF_NAME = 15,
+  RF_ADDR = 16,
+  RF_OFFSET = 17,
+  RF_SIZE = 18,
+  RF_LINK = 19,
+  RF_INFO = 20,
+  RF_ALIGN = 21,
+  RF_ENTSIZE = 22,
+  RF_PADDR = 23,
+  RF_MEMSZ = 24,
+  RF_TABLE = 25,
+  RF_VALUE = 26,
+  RF_BIND = 27,
+  RF_VISIBILITY = 28,
+  RF_SHNDX = 29,
+  END_OF_RECORD_FIELDS
+};
+
+std::string_view record_kind_to_string(record_kind kind);
+std::string_view record_field_to_string(record_field field);
+
+/**
+ * @brief Which fields of which record kinds to produce
+ *
+ * Fields that are not selected are never computed, a kind without fields is
+ * skipped completely.
+ */
+class FieldSet
+{
+public:
+  /**
+   * @brief Everything
+   */
+  FieldSet();
+
+  /**
+   * @brief Parse a comma separated list
+   *
+   * "symbol" selects a whole kind, "symbol.name" one field of a kind and
+   * "name" that field in every kind which has it.  The file fields are kept
+   * whenever anything of a kind is selected.
+   *
+   * @return false if an entry did not match anything
+   */
+  bool parse(std::string_view list);
+
+  bool has(record_kind kind) const;
+  bool has(record_kind kind, record_field field) const;
+
+private:
+  std::array<uint64_t, static_cast<size_t>(record_kind::END_OF_RECORD_KINDS)> masks;
+};
+
+/**
+ * @brief Streams one record per header, section, symbol and segment.
+ *
+ * Each record is assembled in a scratch buffer that is reused for the whole
+ * run and then handed to the OutputBuffer in one piece, so buffers of several
+ * threads can share a descriptor without records being interleaved.
+ */
+class RecordWriter
+{
+public:
+  RecordWriter(OutputBuffer &out, const FieldSet &fields);
+  virtual ~RecordWriter() = default;
+
+  void write(const ElfReader &elf, const std::string &filename, size_t file_id);
+
+protected:
+  OutputBuffer &out;
+  std::string record;
+
+  /**
+   * @brief Whether enumerations should be written by name
+   *
+   * Names cost a lookup per field, the binary stream only wants the value.
+   */
+  virtual bool describe_enums() const = 0;
+  virtual void begin_record(record_kind kind) = 0;
+  virtual void field(record_field field, uint64_t value) = 0;
+  virtual void field(record_field field, std::string_view value) = 0;
+  virtual void end_record() = 0;
+
+private:
+  const FieldSet &fields;
+  std::string_view current_file;
+  size_t current_file_id;
+
+  void begin(record_kind kind);
+  void write_header(const ElfReader &elf);
+  void write_section(const Elf_Shdr &sh);
+  void write_symbol(const Elf_Sym &sym, size_t table);
+  void write_segment(const Elf_Phdr &p, size_t index);
+};
+
+/**
+ * @brief One JSON object per line
+ */
+class JsonLinesWriter : public RecordWriter
+{
+public:
+  JsonLinesWriter(OutputBuffer &out, const FieldSet &fields);
+
+protected:
+  bool describe_enums() const override;
+  void begin_record(record_kind kind) override;
+  void field(record_field field, uint64_t value) override;
+  void field(record_field field, std::string_view value) override;
+  void end_record() override;
+};
+
+/**
+ * @brief Compact length prefixed records
+ *
+ * The stream starts with the 4 bytes "ELFR" and a version byte (1).  Every
+ * record is a LEB128 length followed by that many bytes: the record_kind as a
+ * byte, then (record_field byte, value) pairs.  Numbers are LEB128 encoded,
+ * strings are a LEB128 length followed by the bytes.  RF_FILE and RF_NAME are
+ * the only string fields, enumerations are written as their numeric value.
+ */
+class BinaryRecordWriter : public RecordWriter
+{
+public:
+  BinaryRecordWriter(OutputBuffer &out, const FieldSet &fields);
+
+  /**
+   * @brief Write the stream header, once per output
+   */
+  static void write_stream_header(OutputBuffer &out);
+
+protected:
+  bool describe_enums() const override;
+  void begin_record(record_kind kind) override;
+  void field(record_field field, uint64_t value) override;
+  void field(record_field field, std::string_view value) override;
+  void end_record() override;
+
+private:
+  void put_varint(std::string &target, uint64_t value);
+};
+
+#endif /* RECORDWRITER_HPP */
@@ -2,7 +2,13 @@
 
 void SectionTableInfo::print(std::ostream &out) const noexcept
 {
-  out << "  ** Empty section table detail **";
+  OutputBuffer buffer(out);
+  write(buffer);
+}
+
+void SectionTableInfo::write(OutputBuffer &out) const noexcept
+{
+  out.put("  ** Empty section table detail **");
 }
 
 std::ostream &operator<<(std::ostream &out, SectionTableInfo const &section)
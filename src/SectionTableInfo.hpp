@@ -1,12 +1,14 @@
 #ifndef SECTIONTABLEINFO_HPP
 #define SECTIONTABLEINFO_HPP
 
+#include "OutputBuffer.hpp"
 #include <iostream>
 
 class SectionTableInfo
 {
 public:
-  virtual void print(std::ostream &out) const noexcept;
+  void print(std::ostream &out) const noexcept;
+  virtual void write(OutputBuffer &out) const noexcept;
   virtual ~SectionTableInfo() = default;
 };
 
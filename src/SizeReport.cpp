@@ -0,0 +1,295 @@
+#include "SizeReport.hpp"
+#include "SymbolTable.hpp"
+#include "elf.hpp"
+#include <algorithm>
+#include <iterator>
+
+
+uint64_t RangeMap::add(uint64_t start, uint64_t size)
+{
+  if (size == 0) return 0;
+  uint64_t end = (size > UINT64_MAX - start) ? UINT64_MAX : start + size;
+  uint64_t total = 0;
+  auto next = ranges.upper_bound(start);
+  auto prev = (next == ranges.begin()) ? ranges.end() : std::prev(next);
+  uint64_t cursor = start;
+  if (prev != ranges.end() && prev->second > cursor) cursor = prev->second;
+  // ranges never touch, so every gap up to the next range is unclaimed
+  while (cursor < end) {
+    uint64_t gap_end = (next == ranges.end()) ? end : std::min(end, next->first);
+    total += gap_end - cursor;
+    if (prev != ranges.end() && prev->second == cursor) {
+      prev->second = gap_end;
+    } else {
+      prev = ranges.emplace_hint(next, cursor, gap_end);
+    }
+    if (next != ranges.end() && next->first == prev->second) {
+      prev->second = next->second;
+      next = ranges.erase(next);
+    }
+    cursor = prev->second;
+  }
+  return total;
+}
+
+
+SizeReport::SizeReport(const ElfReader &elf, size_source source) : vm_total(0), file_total(0), elf(elf)
+{
+  // relocatable files have no addresses, give their sections some
+  ELF_ULONG next_address = 0;
+  for (auto &sh : elf.section_headers) {
+    if (elf.header.e_type != ET_REL) {
+      section_base.push_back(sh.sh_addr);
+    } else if ((sh.sh_flags & SHF_ALLOC) != 0) {
+      ELF_ULONG align = sh.sh_addralign > 1 ? sh.sh_addralign : 1;
+      next_address = (next_address + align - 1) / align * align;
+      section_base.push_back(next_address);
+      next_address += sh.sh_size;
+    } else {
+      section_base.push_back(0);
+    }
+  }
+
+  switch (source) {
+  case size_source::sections:
+    add_sections(true);
+    break;
+  case size_source::segments:
+    add_segments(true);
+    break;
+  case size_source::symbols:
+    add_symbols(false);
+    break;
+  case size_source::compile_units:
+    add_symbols(true);
+    break;
+  }
+  if (source != size_source::sections) add_sections(false);
+  add_headers();
+  if (source != size_source::segments) add_segments(false);
+  claim(row("[unmapped]"), 0, 0, 0, elf.filesize);
+
+  for (auto &r : rows) {
+    vm_total += r.vm_size;
+    file_total += r.file_size;
+  }
+  rows.erase(std::remove_if(rows.begin(), rows.end(), [](const size_row &r) { return r.vm_size == 0 && r.file_size == 0; }), rows.end());
+  std::sort(rows.begin(), rows.end(), [](const size_row &a, const size_row &b) {
+    auto a_size = std::max(a.vm_size, a.file_size);
+    auto b_size = std::max(b.vm_size, b.file_size);
+    if (a_size != b_size) return a_size > b_size;
+    return a.name < b.name;
+  });
+  row_index.clear();
+}
+
+size_t SizeReport::row(std::string_view name)
+{
+  auto key = std::string(name);
+  auto it = row_index.find(key);
+  if (it != row_index.end()) return it->second;
+  rows.push_back({ key, 0, 0 });
+  row_index.emplace(std::move(key), rows.size() - 1);
+  return rows.size() - 1;
+}
+
+void SizeReport::claim(size_t index, ELF_ULONG address, ELF_ULONG file_offset, ELF_ULONG vm_size, ELF_ULONG file_size)
+{
+  rows[index].vm_size += vm.add(address, vm_size);
+  rows[index].file_size += file.add(file_offset, file_size);
+}
+
+void SizeReport::add_sections(bool labelled)
+{
+  for (auto &sh : elf.section_headers) {
+    if (sh.index == 0) continue;
+    std::string name = sh.name.empty() ? "#" + std::to_string(sh.index) : sh.name;
+    if (!labelled) name = "[section " + name + "]";
+    ELF_ULONG vm_size = (sh.sh_flags & SHF_ALLOC) != 0 ? sh.sh_size : 0;
+    ELF_ULONG file_size = sh.sh_type == SHT_NOBITS ? 0 : sh.sh_size;
+    claim(row(name), section_base[sh.index], sh.sh_offset, vm_size, file_size);
+  }
+}
+
+void SizeReport::add_segments(bool labelled)
+{
+  size_t counter = 0;
+  for (auto &p : elf.program_headers) {
+    if (p.p_type != PT_LOAD) continue;
+    std::string name = "LOAD #" + std::to_string(counter++) + " [";
+    if (p.p_flags & PF_R) name += 'R';
+    if (p.p_flags & PF_W) name += 'W';
+    if (p.p_flags & PF_X) name += 'X';
+    name += ']';
+    if (!labelled) name = "[" + name + "]";
+    claim(row(name), p.p_vaddr, p.p_offset, p.p_memsz, p.p_filesz);
+  }
+}
+
+void SizeReport::add_headers()
+{
+  // the headers are usually loaded with the first segment
+  auto address_of = [this](ELF_ULONG offset, ELF_ULONG size, ELF_ULONG &address) {
+    for (auto &p : elf.program_headers) {
+      if (p.p_type == PT_LOAD && offset >= p.p_offset && offset + size <= p.p_offset + p.p_filesz) {
+        address = p.p_vaddr + (offset - p.p_offset);
+        return true;
+      }
+    }
+    return false;
+  };
+  auto header = [&](std::string_view name, ELF_ULONG offset, ELF_ULONG size) {
+    ELF_ULONG address = 0;
+    bool mapped = address_of(offset, size, address);
+    claim(row(name), address, offset, mapped ? size : 0, size);
+  };
+  header("[ELF header]", 0, elf.header.e_ehsize);
+  if (elf.header.e_phoff != 0) {
+    header("[program headers]", elf.header.e_phoff, static_cast<ELF_ULONG>(elf.header.e_phentsize) * elf.program_headers.size());
+  }
+  if (elf.header.e_shoff != 0) {
+    header("[section headers]", elf.header.e_shoff, static_cast<ELF_ULONG>(elf.header.e_shentsize) * elf.section_headers.size());
+  }
+}
+
+/**
+ * @brief Where a defined symbol lives in memory and in the file
+ *
+ * @return false for symbols that do not occupy bytes of a section
+ */
+bool SizeReport::symbol_location(const Elf_Sym &sym, ELF_ULONG &address, ELF_ULONG &file_offset, ELF_ULONG &file_size) const
+{
+  auto type = ELF64_ST_TYPE(sym.st_info);
+  if (type == STT_SECTION || type == STT_FILE || type == STT_TLS) return false;
+  if (sym.st_size == 0 || sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE) return false;
+  if (sym.st_shndx >= elf.section_headers.size()) return false;
+  auto &sh = elf.section_headers[sym.st_shndx];
+  ELF_ULONG offset;
+  if (elf.header.e_type == ET_REL) {
+    offset = sym.st_value;
+  } else {
+    if (sym.st_value < sh.sh_addr) return false;
+    offset = sym.st_value - sh.sh_addr;
+  }
+  if (offset >= sh.sh_size) return false;
+  address = section_base[sym.st_shndx] + offset;
+  file_offset = sh.sh_offset + offset;
+  file_size = sh.sh_type == SHT_NOBITS ? 0 : std::min(sym.st_size, sh.sh_size - offset);
+  return true;
+}
+
+void SizeReport::add_symbols(bool compile_units)
+{
+  struct span
+  {
+    ELF_ULONG start;
+    ELF_ULONG end;
+    size_t row;
+    ELF_ULONG section;
+  };
+  std::vector<span> spans;
+  std::vector<const Elf_Sym *> globals;
+
+  for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+    auto table = elf.get_symbol_table(ii);
+    if (table == nullptr) continue;
+    size_t unit = SIZE_MAX;
+    for (auto &sym : table->entries) {
+      bool local = ELF64_ST_BIND(sym.st_info) == STB_LOCAL;
+      if (compile_units && ELF64_ST_TYPE(sym.st_info) == STT_FILE) {
+        unit = row(sym.name);
+        continue;
+      }
+      ELF_ULONG address, file_offset, file_size;
+      if (!symbol_location(sym, address, file_offset, file_size)) continue;
+      ELF_ULONG vm_size = (elf.section_headers[sym.st_shndx].sh_flags & SHF_ALLOC) != 0 ? sym.st_size : 0;
+      if (!compile_units) {
+        claim(row(sym.name), address, file_offset, vm_size, file_size);
+      } else if (!local) {
+        globals.push_back(&sym);
+      } else if (unit != SIZE_MAX) {
+        claim(unit, address, file_offset, vm_size, file_size);
+        if (!spans.empty() && spans.back().row == unit && spans.back().section == sym.st_shndx) {
+          spans.back().start = std::min(spans.back().start, address);
+          spans.back().end = std::max(spans.back().end, address + sym.st_size);
+        } else {
+          spans.push_back({ address, address + sym.st_size, unit, sym.st_shndx });
+        }
+      }
+    }
+  }
+  if (!compile_units) return;
+
+  // a global belongs to the unit whose local symbols surround it, the rest
+  // are left to the enclosing section
+  std::sort(spans.begin(), spans.end(), [](const span &a, const span &b) { return a.start < b.start; });
+  for (auto sym : globals) {
+    ELF_ULONG address, file_offset, file_size;
+    symbol_location(*sym, address, file_offset, file_size);
+    auto it = std::upper_bound(spans.begin(), spans.end(), address, [](ELF_ULONG a, const span &s) { return a < s.start; });
+    if (it == spans.begin()) continue;
+    --it;
+    if (address >= it->end) continue;
+    ELF_ULONG vm_size = (elf.section_headers[sym->st_shndx].sh_flags & SHF_ALLOC) != 0 ? sym->st_size : 0;
+    claim(it->row, address, file_offset, vm_size, file_size);
+  }
+}
+
+
+std::string_view size_source_to_string(size_source source)
+{
+  switch (source) {
+  case size_source::sections:
+    return "sections";
+  case size_source::segments:
+    return "segments";
+  case size_source::symbols:
+    return "symbols";
+  case size_source::compile_units:
+    return "compile units";
+  default:
+    return "unknown";
+  }
+}
+
+void write_text(OutputBuffer &out, const SizeReport &report, size_t limit)
+{
+  auto column = [&out](uint64_t value, uint64_t total) {
+    auto digits = std::to_string(value);
+    if (digits.size() < 10) out.put(std::string(10 - digits.size(), ' '));
+    out.put(digits);
+    // one decimal place without floating point
+    uint64_t tenths = total == 0 ? 0 : (value * 1000 + total / 2) / total;
+    auto percent = std::to_string(tenths / 10) + "." + std::to_string(tenths % 10) + "%";
+    out.put(std::string(8 - std::min<size_t>(percent.size(), 7), ' ')).put(percent);
+  };
+  auto line = [&](std::string_view name, uint64_t vm_size, uint64_t file_size) {
+    column(vm_size, report.vm_total);
+    out.put(' ');
+    column(file_size, report.file_total);
+    out.put("  ").put(name).put('\n');
+  };
+  out.put("           VM SIZE            FILE SIZE\n");
+  out.put("  ------------------  ------------------\n");
+  size_t shown = std::min(limit, report.rows.size());
+  for (size_t ii = 0; ii < shown; ii++) {
+    line(report.rows[ii].name, report.rows[ii].vm_size, report.rows[ii].file_size);
+  }
+  if (shown < report.rows.size()) {
+    uint64_t vm_size = 0;
+    uint64_t file_size = 0;
+    for (size_t ii = shown; ii < report.rows.size(); ii++) {
+      vm_size += report.rows[ii].vm_size;
+      file_size += report.rows[ii].file_size;
+    }
+    line("[" + std::to_string(report.rows.size() - shown) + " others]", vm_size, file_size);
+  }
+  line("TOTAL", report.vm_total, report.file_total);
+}
+
+std::ostream &operator<<(std::ostream &out, const SizeReport &report)
+{
+  OutputBuffer buffer(out);
+  write_text(buffer, report);
+  return out;
+}
@@ -0,0 +1,95 @@
+#ifndef SIZEREPORT_HPP
+#define SIZEREPORT_HPP
+
+#include "ElfReader.hpp"
+#include "OutputBuffer.hpp"
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Set of disjoint [start, end) ranges, the first claim on a byte wins
+ */
+class RangeMap
+{
+public:
+  /**
+   * @brief Claim [start, start + size), skipping anything already claimed
+   *
+   * @return uint64_t number of bytes that were newly claimed
+   */
+  uint64_t add(uint64_t start, uint64_t size);
+
+private:
+  std::map<uint64_t, uint64_t> ranges;// start to end, touching ranges are joined
+};
+
+enum class size_source {
+  sections,
+  segments,
+  symbols,
+  compile_units,
+};
+
+struct size_row
+{
+  std::string name;
+  uint64_t vm_size;
+  uint64_t file_size;
+};
+
+/**
+ * @brief Where the bytes of a file go, by section, segment, symbol or
+ *        compilation unit.
+ *
+ * File offsets and virtual addresses are attributed separately, each through
+ * its own RangeMap so overlapping ranges are counted exactly once.  The items
+ * of the chosen source claim their ranges first, whatever is left over is
+ * claimed by the enclosing sections ("[section .text]"), then by the ELF
+ * headers and the PT_LOAD segments, and the rest of the file is "[unmapped]".
+ * The totals are therefore the file size and the memory size of the PT_LOAD
+ * segments whatever the source.
+ *
+ * Compilation units come from STT_FILE symbols: the local symbols after one
+ * belong to it, and a global symbol belongs to the unit whose local symbols
+ * span its address.  Relocatable files have no addresses, their SHF_ALLOC
+ * sections are laid out one after another instead.
+ */
+class SizeReport
+{
+public:
+  SizeReport(const ElfReader &elf, size_source source);
+
+  std::vector<size_row> rows;// sorted largest first
+  uint64_t vm_total;
+  uint64_t file_total;
+
+private:
+  const ElfReader &elf;
+  RangeMap vm;
+  RangeMap file;
+  std::unordered_map<std::string, size_t> row_index;
+  std::vector<ELF_ULONG> section_base;// address of each section
+
+  size_t row(std::string_view name);
+  void claim(size_t row, ELF_ULONG address, ELF_ULONG file_offset, ELF_ULONG vm_size, ELF_ULONG file_size);
+  void add_sections(bool labelled);
+  void add_segments(bool labelled);
+  void add_symbols(bool compile_units);
+  void add_headers();
+  bool symbol_location(const Elf_Sym &sym, ELF_ULONG &address, ELF_ULONG &file_offset, ELF_ULONG &file_size) const;
+};
+
+std::string_view size_source_to_string(size_source source);
+
+/**
+ * @brief Print the report, limit rows and the rest summed up in one line
+ */
+void write_text(OutputBuffer &out, const SizeReport &report, size_t limit = 20);
+std::ostream &operator<<(std::ostream &out, const SizeReport &report);
+
+#endif /* SIZEREPORT_HPP */
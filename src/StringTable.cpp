@@ -1,10 +1,10 @@
 #include "StringTable.hpp"
 
 
-void StringTable::print(std::ostream &out) const noexcept
+void StringTable::write(OutputBuffer &out) const noexcept
 {
-  out << "\n   [StringTable] Entries: " << entries.size() << std::endl;
-  for (auto entry : entries) {
-    out << "     " << entry << std::endl;
+  out.put("\n   [StringTable] Entries: ").dec(entries.size()).put('\n');
+  for (auto &entry : entries) {
+    out.put("     ").put(entry).put('\n');
   }
 }
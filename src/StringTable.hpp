@@ -2,14 +2,15 @@
 #define STRINGTABLE_HPP
 
 #include "SectionTableInfo.hpp"
+#include <string_view>
 #include <vector>
 
 class StringTable : public SectionTableInfo
 {
 public:
-  std::vector<std::string> entries;
+  std::vector<std::string_view> entries;// into the file
 
-  virtual void print(std::ostream &out) const noexcept override;
+  virtual void write(OutputBuffer &out) const noexcept override;
 };
 
 
@@ -0,0 +1,596 @@
+#include "SymbolIndex.hpp"
+#include "Hash.hpp"
+#include "OutputBuffer.hpp"
+#include "SymbolTable.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t INDEX_VERSION = 1;
+constexpr size_t HEADER_SIZE = 64;
+constexpr size_t FILE_ENTRY_SIZE = 48;
+constexpr size_t TERM_ENTRY_SIZE = 32;
+constexpr size_t POSTING_SIZE = 8;
+constexpr size_t BLOOM_BITS_PER_SYMBOL = 10;
+constexpr size_t BLOOM_PROBES = 4;
+constexpr uint32_t FILE_REMOVED = 1;
+
+/**
+ * @brief Words of a bloom filter for count symbols, a power of two
+ */
+uint64_t bloom_words(uint64_t count)
+{
+  uint64_t words = 1;
+  while (words * 64 < count * BLOOM_BITS_PER_SYMBOL)
+    words <<= 1;
+  return words;
+}
+
+/**
+ * @brief Calls probe with each bit of a name hash, double hashing
+ */
+template<typename Probe>
+void bloom_bits(uint64_t hash, uint64_t words, Probe probe)
+{
+  uint64_t step = rotate_left(hash, 32) | 1;
+  for (size_t ii = 0; ii < BLOOM_PROBES; ii++) {
+    probe((hash + ii * step) & (words * 64 - 1));
+  }
+}
+
+bool is_segment_name(const std::string &name)
+{
+  return name.size() > 12 && name.compare(0, 8, "segment-") == 0 && name.compare(name.size() - 4, 4, ".idx") == 0;
+}
+
+uint64_t modification_time(const std::string &path)
+{
+  struct stat st;
+  if (::stat(path.c_str(), &st) != 0) return 0;
+  return static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+}// namespace
+
+
+SymbolIndexWriter::SymbolIndexWriter(const std::string &directory, size_t files_per_segment, bool append) : directory(directory), files_per_segment(files_per_segment), open(false), first_segment(0), segment_count(0), posting_count(0)
+{
+  namespace fs = std::filesystem;
+  if (this->files_per_segment == 0) this->files_per_segment = 1;
+  std::error_code ec;
+  fs::create_directories(directory, ec);
+  if (!fs::is_directory(directory, ec)) return;
+  for (auto &entry : fs::directory_iterator(directory, ec)) {
+    auto name = entry.path().filename().string();
+    if (!is_segment_name(name)) continue;
+    if (append) {
+      first_segment = std::max(first_segment, static_cast<size_t>(std::strtoull(name.c_str() + 8, nullptr, 10)) + 1);
+    } else {
+      // a rebuild replaces the whole index
+      fs::remove(entry.path(), ec);
+      if (ec) return;
+    }
+  }
+  open = true;
+}
+
+SymbolIndexWriter::~SymbolIndexWriter()
+{
+  close();
+}
+
+bool SymbolIndexWriter::is_open() const
+{
+  return open;
+}
+
+void SymbolIndexWriter::add(const std::string &path, const ElfReader &elf)
+{
+  struct symbol
+  {
+    std::string_view name;
+    uint8_t binding;
+    uint8_t type;
+    bool defined;
+  };
+  std::vector<symbol> symbols;
+  for (size_t ii = 0; ii < elf.section_headers.size(); ii++) {
+    auto table = elf.get_symbol_table(ii);
+    if (table == nullptr) continue;
+    for (auto &sym : table->entries) {
+      auto binding = ELF64_ST_BIND(sym.st_info);
+      auto type = ELF64_ST_TYPE(sym.st_info);
+      if (binding == STB_LOCAL || type == STT_SECTION || type == STT_FILE) continue;
+      std::string_view name = sym.name;
+      name = name.substr(0, name.find('@'));
+      if (name.empty()) continue;
+      symbols.push_back({ name, static_cast<uint8_t>(binding), static_cast<uint8_t>(type), sym.st_shndx != SHN_UNDEF });
+    }
+  }
+  // .symtab and .dynsym of a linked file mostly repeat each other
+  std::stable_sort(symbols.begin(), symbols.end(), [](const symbol &a, const symbol &b) {
+    if (a.name != b.name) return a.name < b.name;
+    return a.defined > b.defined;
+  });
+  symbols.erase(std::unique(symbols.begin(), symbols.end(), [](const symbol &a, const symbol &b) { return a.name == b.name && a.defined == b.defined; }), symbols.end());
+
+  auto mtime = modification_time(path);
+
+  std::lock_guard<std::mutex> guard(lock);
+  auto file = static_cast<uint32_t>(files.size());
+  files.push_back({ path, elf.filesize, mtime, false });
+  for (auto &s : symbols) {
+    postings.push_back({ term_id(s.name), file, s.binding, s.type, s.defined });
+  }
+  if (files.size() >= files_per_segment) write_segment();
+}
+
+/**
+ * @brief Number of a name in the pending segment, called with the lock held
+ */
+uint32_t SymbolIndexWriter::term_id(std::string_view name)
+{
+  auto it = terms.find(std::string(name));
+  if (it == terms.end()) {
+    it = terms.emplace(std::string(name), static_cast<uint32_t>(term_names.size())).first;
+    term_names.push_back(&it->first);
+    term_hashes.push_back(lane_hash(name));
+  }
+  return it->second;
+}
+
+void SymbolIndexWriter::remove(const std::string &path)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  files.push_back({ path, 0, 0, true });
+  if (files.size() >= files_per_segment) write_segment();
+}
+
+void SymbolIndexWriter::close()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if (!files.empty()) write_segment();
+}
+
+size_t SymbolIndexWriter::compact()
+{
+  close();
+  std::lock_guard<std::mutex> guard(lock);
+  for (;;) {
+    SymbolIndexReader reader(directory);
+    auto &segments = reader.segments;
+    size_t count = segments.size();
+    if (!open || count < 2) return count;
+    // the newest segments, merged like the digits of a binary counter
+    size_t first = count - 1;
+    uint64_t gathered = segments[first].file_count;
+    while (first > 0 && segments[first - 1].file_count <= 2 * gathered && gathered + segments[first - 1].file_count <= files_per_segment) {
+      first--;
+      gathered += segments[first].file_count;
+    }
+    if (first < count - 1) {
+      if (!merge(reader, first, count - 1)) return count;
+      continue;
+    }
+    // only segments the newest one replaces paths of can have gained dead
+    // entries, the others are not looked at
+    auto &newest = segments.back();
+    bool rewritten = false;
+    for (size_t si = 0; si + 1 < count && !rewritten; si++) {
+      auto &s = segments[si];
+      uint32_t index;
+      bool touched = false;
+      for (uint32_t ii = 0; ii < newest.file_count && !touched; ii++) {
+        touched = reader.find_file(s, reader.file_path(newest, ii), index);
+      }
+      if (!touched) continue;
+      uint64_t dead = 0;
+      for (uint32_t ii = 0; ii < s.file_count; ii++) {
+        if (reader.superseded(si, reader.file_path(s, ii))) dead++;
+      }
+      if (2 * dead <= s.file_count) continue;
+      if (!merge(reader, si, si)) return count;
+      rewritten = true;
+    }
+    if (!rewritten) return count;
+  }
+}
+
+/**
+ * @brief Replace segments first to last with one holding what is still live
+ *        in them, called with the lock held and nothing pending
+ *
+ * The result takes the name of the first, so the segments after it still
+ * win until they are removed, oldest first, and every step is a consistent
+ * index.
+ */
+bool SymbolIndexWriter::merge(const SymbolIndexReader &reader, size_t first, size_t last)
+{
+  auto &segments = reader.segments;
+  auto older_has = [&](std::string_view path) {
+    uint32_t index;
+    for (size_t si = 0; si < first; si++) {
+      if (reader.find_file(segments[si], path, index)) return true;
+    }
+    return false;
+  };
+  // the newest entry of each path, unless a later segment has one too
+  std::vector<std::vector<uint32_t>> renumber(last - first + 1);
+  for (size_t si = first; si <= last; si++) {
+    auto &s = segments[si];
+    auto &numbers = renumber[si - first];
+    numbers.assign(s.file_count, UINT32_MAX);
+    for (uint32_t ii = 0; ii < s.file_count; ii++) {
+      auto path = reader.file_path(s, ii);
+      if (reader.superseded(si, path)) continue;
+      bool removed = reader.is_removed(s, ii);
+      if (removed && !older_has(path)) continue;
+      auto file = reader.make_file(s, ii);
+      numbers[ii] = static_cast<uint32_t>(files.size());
+      files.push_back({ std::string(path), file.size, file.mtime, removed });
+    }
+  }
+  for (size_t si = first; si <= last; si++) {
+    auto &s = segments[si];
+    auto &numbers = renumber[si - first];
+    for (uint32_t ti = 0; ti < s.term_count; ti++) {
+      auto term = s.terms + TERM_ENTRY_SIZE * ti;
+      uint64_t offset = load_le(term + 8, 8);
+      uint64_t length = load_le(term + 16, 4);
+      uint64_t count = load_le(term + 20, 4);
+      uint64_t posting = load_le(term + 24, 8);
+      if (offset > s.strings_size || length > s.strings_size - offset || posting > s.posting_count || count > s.posting_count - posting) continue;
+      auto name = std::string_view(reinterpret_cast<const char *>(s.strings) + offset, length);
+      for (uint64_t ii = posting; ii < posting + count; ii++) {
+        auto p = s.postings + POSTING_SIZE * ii;
+        auto file = static_cast<uint32_t>(load_le(p, 4));
+        if (file >= s.file_count || numbers[file] == UINT32_MAX) continue;
+        postings.push_back({ term_id(name), numbers[file], p[4], p[5], p[6] });
+      }
+    }
+  }
+  // nothing live is left when every entry was replaced later
+  size_t kept = files.empty() ? first : first + 1;
+  if (files.empty()) {
+    terms.clear();
+    term_names.clear();
+    term_hashes.clear();
+  } else {
+    write_segment_file(segments[first].path);
+    if (!open) return false;
+  }
+  for (size_t si = kept; si <= last; si++) {
+    std::remove(segments[si].path.c_str());
+  }
+  return true;
+}
+
+size_t SymbolIndexWriter::get_segment_count() const
+{
+  return segment_count;
+}
+
+uint64_t SymbolIndexWriter::get_posting_count() const
+{
+  return posting_count;
+}
+
+/**
+ * @brief Write what was collected as the next segment, called with the lock
+ *        held
+ */
+void SymbolIndexWriter::write_segment()
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "segment-%06zu.idx", first_segment + segment_count);
+  segment_count++;
+  posting_count += postings.size();
+  write_segment_file(directory + "/" + name);
+}
+
+/**
+ * @brief Sort what was collected into a segment file and clear it
+ */
+void SymbolIndexWriter::write_segment_file(const std::string &filename)
+{
+  std::vector<uint32_t> file_order(files.size());
+  for (uint32_t ii = 0; ii < file_order.size(); ii++)
+    file_order[ii] = ii;
+  std::sort(file_order.begin(), file_order.end(), [this](uint32_t a, uint32_t b) { return files[a].path < files[b].path; });
+  std::vector<uint32_t> file_rank(files.size());
+  for (uint32_t ii = 0; ii < file_order.size(); ii++)
+    file_rank[file_order[ii]] = ii;
+
+  std::vector<uint32_t> term_order(term_names.size());
+  for (uint32_t ii = 0; ii < term_order.size(); ii++)
+    term_order[ii] = ii;
+  std::sort(term_order.begin(), term_order.end(), [this](uint32_t a, uint32_t b) {
+    if (term_hashes[a] != term_hashes[b]) return term_hashes[a] < term_hashes[b];
+    return *term_names[a] < *term_names[b];
+  });
+  std::vector<uint32_t> term_rank(term_names.size());
+  for (uint32_t ii = 0; ii < term_order.size(); ii++)
+    term_rank[term_order[ii]] = ii;
+
+  for (auto &p : postings) {
+    p.term = term_rank[p.term];
+    p.file = file_rank[p.file];
+  }
+  std::sort(postings.begin(), postings.end(), [](const pending_posting &a, const pending_posting &b) {
+    if (a.term != b.term) return a.term < b.term;
+    return a.file < b.file;
+  });
+
+  std::vector<uint32_t> symbol_counts(files.size());
+  for (auto &p : postings)
+    symbol_counts[p.file]++;
+  std::vector<uint64_t> bloom_first(files.size());
+  uint64_t bloom_total = 0;
+  for (size_t ii = 0; ii < files.size(); ii++) {
+    bloom_first[ii] = bloom_total;
+    bloom_total += bloom_words(symbol_counts[ii]);
+  }
+  std::vector<uint64_t> blooms(bloom_total);
+  for (auto &p : postings) {
+    auto words = bloom_words(symbol_counts[p.file]);
+    auto filter = blooms.data() + bloom_first[p.file];
+    bloom_bits(term_hashes[term_order[p.term]], words, [filter](uint64_t bit) { filter[bit / 64] |= uint64_t{ 1 } << (bit % 64); });
+  }
+
+  uint64_t files_offset = HEADER_SIZE;
+  uint64_t terms_offset = files_offset + FILE_ENTRY_SIZE * files.size();
+  uint64_t postings_offset = terms_offset + TERM_ENTRY_SIZE * term_names.size();
+  uint64_t blooms_offset = postings_offset + POSTING_SIZE * postings.size();
+  uint64_t strings_offset = blooms_offset + 8 * bloom_total;
+
+  auto temporary = filename + ".tmp";
+  int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    open = false;
+  } else {
+    {
+      OutputBuffer out(fd);
+      out.put("ESIX").le(INDEX_VERSION, 4).le(files.size(), 4).le(term_names.size(), 4).le(postings.size(), 8);
+      out.le(files_offset, 8).le(terms_offset, 8).le(postings_offset, 8).le(blooms_offset, 8).le(strings_offset, 8);
+      uint64_t string_cursor = 0;
+      for (uint32_t ii = 0; ii < files.size(); ii++) {
+        auto &f = files[file_order[ii]];
+        out.le(string_cursor, 8).le(f.path.size(), 4).le(symbol_counts[ii], 4);
+        out.le(bloom_first[ii], 8).le(bloom_words(symbol_counts[ii]), 4).le(f.removed ? FILE_REMOVED : 0, 4);
+        out.le(f.size, 8).le(f.mtime, 8);
+        string_cursor += f.path.size();
+      }
+      size_t posting = 0;
+      for (uint32_t ii = 0; ii < term_order.size(); ii++) {
+        auto &name = *term_names[term_order[ii]];
+        size_t first = posting;
+        while (posting < postings.size() && postings[posting].term == ii)
+          posting++;
+        out.le(term_hashes[term_order[ii]], 8).le(string_cursor, 8).le(name.size(), 4).le(posting - first, 4).le(first, 8);
+        string_cursor += name.size();
+      }
+      for (auto &p : postings) {
+        out.le(p.file, 4).le(p.binding, 1).le(p.type, 1).le(p.defined, 1).le(0, 1);
+      }
+      for (auto word : blooms) {
+        out.le(word, 8);
+      }
+      for (auto index : file_order) {
+        out.put(files[index].path);
+      }
+      for (auto index : term_order) {
+        out.put(*term_names[index]);
+      }
+    }
+    // readers only ever see whole segments
+    if (::close(fd) != 0 || std::rename(temporary.c_str(), filename.c_str()) != 0) open = false;
+  }
+
+  files.clear();
+  postings.clear();
+  terms.clear();
+  term_names.clear();
+  term_hashes.clear();
+}
+
+
+SymbolIndexReader::SymbolIndexReader(const std::string &directory)
+{
+  namespace fs = std::filesystem;
+  std::vector<std::string> names;
+  std::error_code ec;
+  for (auto &entry : fs::directory_iterator(directory, ec)) {
+    auto name = entry.path().filename().string();
+    if (is_segment_name(name)) names.push_back(entry.path().string());
+  }
+  // the zero padded numbers sort in the order the segments were written
+  std::sort(names.begin(), names.end());
+  for (auto &name : names) {
+    segment s;
+    s.path = name;
+    s.mapping = std::make_unique<MappedFile>(name);
+    auto data = s.mapping->data();
+    uint64_t size = s.mapping->size();
+    if (size < HEADER_SIZE || std::string_view(reinterpret_cast<const char *>(data), 4) != "ESIX" || load_le(data + 4, 4) != INDEX_VERSION) continue;
+    s.file_count = static_cast<uint32_t>(load_le(data + 8, 4));
+    s.term_count = static_cast<uint32_t>(load_le(data + 12, 4));
+    s.posting_count = load_le(data + 16, 8);
+    uint64_t files_offset = load_le(data + 24, 8);
+    uint64_t terms_offset = load_le(data + 32, 8);
+    uint64_t postings_offset = load_le(data + 40, 8);
+    uint64_t blooms_offset = load_le(data + 48, 8);
+    uint64_t strings_offset = load_le(data + 56, 8);
+    // the tables follow each other, a truncated or damaged file is skipped
+    if (files_offset != HEADER_SIZE || terms_offset != files_offset + FILE_ENTRY_SIZE * s.file_count || postings_offset != terms_offset + TERM_ENTRY_SIZE * s.term_count) continue;
+    if (s.posting_count > size / POSTING_SIZE || blooms_offset != postings_offset + POSTING_SIZE * s.posting_count) continue;
+    if (strings_offset < blooms_offset || strings_offset > size || (strings_offset - blooms_offset) % 8 != 0) continue;
+    s.files = data + files_offset;
+    s.terms = data + terms_offset;
+    s.postings = data + postings_offset;
+    s.blooms = data + blooms_offset;
+    s.bloom_words = (strings_offset - blooms_offset) / 8;
+    s.strings = data + strings_offset;
+    s.strings_size = size - strings_offset;
+    segments.push_back(std::move(s));
+  }
+}
+
+bool SymbolIndexReader::is_open() const
+{
+  return !segments.empty();
+}
+
+std::string_view SymbolIndexReader::file_path(const segment &s, uint32_t index) const
+{
+  auto entry = s.files + FILE_ENTRY_SIZE * index;
+  uint64_t offset = load_le(entry, 8);
+  uint64_t length = load_le(entry + 8, 4);
+  if (offset > s.strings_size || length > s.strings_size - offset) return {};
+  return std::string_view(reinterpret_cast<const char *>(s.strings) + offset, length);
+}
+
+bool SymbolIndexReader::is_removed(const segment &s, uint32_t index) const
+{
+  return (load_le(s.files + FILE_ENTRY_SIZE * index + 28, 4) & FILE_REMOVED) != 0;
+}
+
+index_file SymbolIndexReader::make_file(const segment &s, uint32_t index) const
+{
+  auto entry = s.files + FILE_ENTRY_SIZE * index;
+  return { file_path(s, index), load_le(entry + 32, 8), load_le(entry + 40, 8) };
+}
+
+bool SymbolIndexReader::find_file(const segment &s, std::string_view path, uint32_t &index) const
+{
+  uint32_t low = 0;
+  uint32_t high = s.file_count;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (file_path(s, middle) < path) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == s.file_count || file_path(s, low) != path) return false;
+  index = low;
+  return true;
+}
+
+bool SymbolIndexReader::superseded(size_t segment_index, std::string_view path) const
+{
+  uint32_t index;
+  for (size_t ii = segment_index + 1; ii < segments.size(); ii++) {
+    if (find_file(segments[ii], path, index)) return true;
+  }
+  return false;
+}
+
+std::vector<index_posting> SymbolIndexReader::find(std::string_view name) const
+{
+  std::vector<index_posting> found;
+  uint64_t hash = lane_hash(name);
+  for (size_t si = 0; si < segments.size(); si++) {
+    auto &s = segments[si];
+    uint32_t low = 0;
+    uint32_t high = s.term_count;
+    while (low < high) {
+      uint32_t middle = low + (high - low) / 2;
+      if (load_le(s.terms + TERM_ENTRY_SIZE * middle, 8) < hash) {
+        low = middle + 1;
+      } else {
+        high = middle;
+      }
+    }
+    for (; low < s.term_count; low++) {
+      auto term = s.terms + TERM_ENTRY_SIZE * low;
+      if (load_le(term, 8) != hash) break;
+      uint64_t offset = load_le(term + 8, 8);
+      uint64_t length = load_le(term + 16, 4);
+      if (offset > s.strings_size || length > s.strings_size - offset) continue;
+      if (std::string_view(reinterpret_cast<const char *>(s.strings) + offset, length) != name) continue;
+      uint64_t count = load_le(term + 20, 4);
+      uint64_t first = load_le(term + 24, 8);
+      if (first > s.posting_count || count > s.posting_count - first) continue;
+      for (uint64_t ii = first; ii < first + count; ii++) {
+        auto p = s.postings + POSTING_SIZE * ii;
+        auto file = static_cast<uint32_t>(load_le(p, 4));
+        if (file >= s.file_count) continue;
+        auto path = file_path(s, file);
+        if (superseded(si, path)) continue;
+        found.push_back({ path, p[4], p[5], p[6] != 0 });
+      }
+      break;
+    }
+  }
+  std::stable_sort(found.begin(), found.end(), [](const index_posting &a, const index_posting &b) { return a.path < b.path; });
+  return found;
+}
+
+bool SymbolIndexReader::may_contain(std::string_view path, std::string_view name) const
+{
+  // only the newest copy of a file counts
+  for (size_t si = segments.size(); si-- > 0;) {
+    auto &s = segments[si];
+    uint32_t index;
+    if (!find_file(s, path, index)) continue;
+    if (is_removed(s, index)) return false;
+    auto entry = s.files + FILE_ENTRY_SIZE * index;
+    uint64_t first = load_le(entry + 16, 8);
+    uint64_t words = load_le(entry + 24, 4);
+    if (words == 0 || (words & (words - 1)) != 0 || first > s.bloom_words || words > s.bloom_words - first) return true;
+    bool present = true;
+    auto filter = s.blooms + 8 * first;
+    bloom_bits(lane_hash(name), words, [&](uint64_t bit) {
+      if ((filter[bit / 8] & (1u << (bit % 8))) == 0) present = false;
+    });
+    return present;
+  }
+  return false;
+}
+
+size_t SymbolIndexReader::get_segment_count() const
+{
+  return segments.size();
+}
+
+size_t SymbolIndexReader::get_file_count() const
+{
+  size_t count = 0;
+  for (size_t si = 0; si < segments.size(); si++) {
+    for (uint32_t ii = 0; ii < segments[si].file_count; ii++) {
+      if (!is_removed(segments[si], ii) && !superseded(si, file_path(segments[si], ii))) count++;
+    }
+  }
+  return count;
+}
+
+std::optional<index_file> SymbolIndexReader::get_file(std::string_view path) const
+{
+  for (size_t si = segments.size(); si-- > 0;) {
+    uint32_t index;
+    if (!find_file(segments[si], path, index)) continue;
+    if (is_removed(segments[si], index)) return std::nullopt;
+    return make_file(segments[si], index);
+  }
+  return std::nullopt;
+}
+
+std::vector<index_file> SymbolIndexReader::get_files() const
+{
+  std::vector<index_file> found;
+  for (size_t si = 0; si < segments.size(); si++) {
+    for (uint32_t ii = 0; ii < segments[si].file_count; ii++) {
+      if (is_removed(segments[si], ii) || superseded(si, file_path(segments[si], ii))) continue;
+      found.push_back(make_file(segments[si], ii));
+    }
+  }
+  std::sort(found.begin(), found.end(), [](const index_file &a, const index_file &b) { return a.path < b.path; });
+  return found;
+}
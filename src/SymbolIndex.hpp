@@ -0,0 +1,216 @@
+#ifndef SYMBOLINDEX_HPP
+#define SYMBOLINDEX_HPP
+
+#include "ElfReader.hpp"
+#include "MappedFile.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class SymbolIndexReader;
+
+/**
+ * @brief One file that defines or uses a symbol
+ */
+struct index_posting
+{
+  std::string_view path;// points into the index, valid while the reader is
+  uint8_t binding;// STB_*
+  uint8_t type;// STT_*
+  bool defined;// false for undefined references
+};
+
+/**
+ * @brief A file as it was when it was indexed
+ */
+struct index_file
+{
+  std::string_view path;// points into the index, valid while the reader is
+  uint64_t size;
+  uint64_t mtime;// nanoseconds
+};
+
+/**
+ * @brief Builds an inverted index from symbol name to the files that define
+ *        or use it.
+ *
+ * The index is a directory of segment files (segment-000000.idx, ...), each
+ * covering up to files_per_segment files so memory use stays bounded however
+ * many files are indexed.  A writer opened to append adds segments after the
+ * existing ones, a path in a newer segment replaces it in the older ones, so
+ * files that changed are updated by indexing them again.  All integers are
+ * little endian.
+ *
+ *   header    "ESIX", u32 version (1), u32 file count, u32 term count,
+ *             u64 posting count, then u64 offsets of the file, term,
+ *             posting, bloom and string tables
+ *   files     48 bytes each, sorted by path: u64 path offset, u32 path length,
+ *             u32 symbol count, u64 first bloom word, u32 bloom words,
+ *             u32 flags (1: removed), u64 file size, u64 mtime in nanoseconds
+ *   terms     32 bytes each, sorted by (hash, name): u64 lane_hash of the
+ *             name, u64 name offset, u32 name length, u32 posting count,
+ *             u64 first posting
+ *   postings  8 bytes each, sorted by file: u32 file index, u8 binding,
+ *             u8 type, u8 defined, u8 unused
+ *   blooms    u64 words, one filter per file over its symbol name hashes
+ *   strings   paths and names, not terminated
+ *
+ * Only global, weak and unique symbols are indexed, from .symtab and
+ * .dynsym, with any "@version" suffix removed.  add() may be called from
+ * several threads, names are read outside the lock and interned under it.
+ */
+class SymbolIndexWriter
+{
+public:
+  SymbolIndexWriter(const std::string &directory, size_t files_per_segment = 65536, bool append = false);
+  ~SymbolIndexWriter();
+  SymbolIndexWriter(const SymbolIndexWriter &) = delete;
+  SymbolIndexWriter &operator=(const SymbolIndexWriter &) = delete;
+
+  /**
+   * @brief false if the directory could not be created or cleared
+   */
+  bool is_open() const;
+  void add(const std::string &path, const ElfReader &elf);
+
+  /**
+   * @brief Record that path is gone, it is dropped from the older segments
+   */
+  void remove(const std::string &path);
+
+  /**
+   * @brief Write out the last partial segment, the writer can still be added to
+   */
+  void close();
+
+  /**
+   * @brief Merge and rewrite segments so the index does not grow with the
+   *        number of batches appended to it
+   *
+   * The newest segments are merged while each is no more than twice the size
+   * of the ones after it and the result stays within files_per_segment, so
+   * there are O(log n) segments and a file is rewritten O(log n) times.  A
+   * segment holding a path of the newest segment is rewritten on its own
+   * once more than half of its entries are superseded.  Superseded entries
+   * are dropped, and so are removals once no older segment has the path.
+   * Segments are replaced by rename and removed oldest first, a reader never
+   * sees a path older than it is.  Calls close() first.
+   *
+   * @return the number of segments left
+   */
+  size_t compact();
+
+  size_t get_segment_count() const;
+  uint64_t get_posting_count() const;
+
+private:
+  struct pending_file
+  {
+    std::string path;
+    uint64_t size;
+    uint64_t mtime;
+    bool removed;
+  };
+  struct pending_posting
+  {
+    uint32_t term;
+    uint32_t file;
+    uint8_t binding;
+    uint8_t type;
+    uint8_t defined;
+  };
+
+  std::string directory;
+  size_t files_per_segment;
+  bool open;
+  size_t first_segment;// number of the first segment this writer writes
+  size_t segment_count;
+  uint64_t posting_count;
+  std::mutex lock;
+  std::unordered_map<std::string, uint32_t> terms;
+  std::vector<const std::string *> term_names;// keys of terms, by id
+  std::vector<uint64_t> term_hashes;
+  std::vector<pending_file> files;
+  std::vector<pending_posting> postings;
+
+  uint32_t term_id(std::string_view name);
+  void write_segment();
+  void write_segment_file(const std::string &filename);
+  bool merge(const SymbolIndexReader &reader, size_t first, size_t last);
+};
+
+/**
+ * @brief Answers symbol queries from the segment files, without opening any
+ *        of the indexed ELF files.
+ *
+ * Segments are mapped, a lookup is a binary search on the name hash in each
+ * segment.  When a path is in more than one segment the newest segment wins.
+ */
+class SymbolIndexReader
+{
+public:
+  explicit SymbolIndexReader(const std::string &directory);
+
+  /**
+   * @brief false if there is no readable segment in the directory
+   */
+  bool is_open() const;
+
+  /**
+   * @brief Every file that defines or uses name, sorted by path
+   */
+  std::vector<index_posting> find(std::string_view name) const;
+
+  /**
+   * @brief Checks the file's bloom filter, false means the file certainly
+   *        does not have the symbol
+   */
+  bool may_contain(std::string_view path, std::string_view name) const;
+
+  size_t get_segment_count() const;
+  size_t get_file_count() const;
+
+  /**
+   * @brief The newest entry of path, nullopt if it is not indexed or was removed
+   */
+  std::optional<index_file> get_file(std::string_view path) const;
+
+  /**
+   * @brief Every indexed file, sorted by path
+   */
+  std::vector<index_file> get_files() const;
+
+private:
+  friend class SymbolIndexWriter;// compact() reads segments whole
+
+  struct segment
+  {
+    std::string path;
+    std::unique_ptr<MappedFile> mapping;
+    uint32_t file_count;
+    uint32_t term_count;
+    uint64_t posting_count;
+    const byte *files;
+    const byte *terms;
+    const byte *postings;
+    const byte *blooms;
+    uint64_t bloom_words;
+    const byte *strings;
+    uint64_t strings_size;
+  };
+
+  std::vector<segment> segments;// oldest first
+
+  bool find_file(const segment &s, std::string_view path, uint32_t &index) const;
+  bool superseded(size_t segment_index, std::string_view path) const;
+  std::string_view file_path(const segment &s, uint32_t index) const;
+  bool is_removed(const segment &s, uint32_t index) const;
+  index_file make_file(const segment &s, uint32_t index) const;
+};
+
+#endif /* SYMBOLINDEX_HPP */
@@ -0,0 +1,436 @@
+#include "SymbolServer.hpp"
+#include "SymbolTable.hpp"
+#include "elf.hpp"
+#include "machines.hpp"
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+constexpr size_t MAX_REQUEST = 1 << 16;// a longer line closes the connection
+constexpr time_t SEND_TIMEOUT = 10;// seconds a response may wait for the client to read
+
+bool socket_address(const std::string &path, sockaddr_un &address)
+{
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) return false;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+bool send_all(int fd, std::string_view data)
+{
+  while (!data.empty()) {
+    auto sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) continue;
+    if (sent <= 0) return false;
+    data.remove_prefix(static_cast<size_t>(sent));
+  }
+  return true;
+}
+
+/**
+ * @brief Take the next line out of buffer, reading more from fd as needed
+ */
+bool receive_line(int fd, std::string &buffer, std::string &line)
+{
+  size_t scanned = 0;
+  for (;;) {
+    auto end = buffer.find('\n', scanned);
+    if (end != std::string::npos) {
+      line.assign(buffer, 0, end);
+      buffer.erase(0, end + 1);
+      return true;
+    }
+    if (buffer.size() > MAX_REQUEST) return false;
+    scanned = buffer.size();
+    char chunk[4096];
+    auto count = ::recv(fd, chunk, sizeof(chunk), 0);
+    if (count < 0 && errno == EINTR) continue;
+    if (count <= 0) return false;
+    buffer.append(chunk, static_cast<size_t>(count));
+  }
+}
+
+std::string hex(uint64_t value)
+{
+  char digits[24];
+  std::snprintf(digits, sizeof(digits), "0x%llx", static_cast<unsigned long long>(value));
+  return digits;
+}
+
+}// namespace
+
+
+cached_reader::cached_reader(const std::string &path, ElfReader &&elf) : path(path), query(std::make_unique<const ElfReader>(std::move(elf))), device(0), inode(0), size(0), mtime(0)
+{
+  struct stat st;
+  if (::stat(path.c_str(), &st) == 0) {
+    device = st.st_dev;
+    inode = st.st_ino;
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+  }
+  auto &reader = query.get_reader();
+  cost = sizeof(*this) + path.size() + reader.filesize;
+  for (auto &sh : reader.section_headers)
+    cost += sizeof(sh) + sh.name.size();
+  cost += sizeof(Elf_Phdr) * reader.program_headers.size();
+  for (size_t ii = 0; ii < reader.section_headers.size(); ii++) {
+    auto table = reader.get_symbol_table(ii);
+    if (table == nullptr) continue;
+    for (auto &sym : table->entries) {
+      // the entry and the index orders, the name is a view into the mapping
+      cost += sizeof(sym) + 24;
+    }
+  }
+}
+
+
+ReaderCache::ReaderCache(size_t max_entries, uint64_t memory_budget, ParseOptions options) : max_entries(max_entries), memory_budget(memory_budget), options(options), memory(0), hits(0), misses(0), evictions(0)
+{
+  if (this->max_entries == 0) this->max_entries = 1;
+}
+
+std::shared_ptr<const cached_reader> ReaderCache::get(const std::string &path)
+{
+  struct stat st;
+  bool found = ::stat(path.c_str(), &st) == 0;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = by_path.find(path);
+    if (it != by_path.end()) {
+      auto entry = *it->second;
+      bool unchanged = false;
+      if (found) {
+        uint64_t mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+        unchanged = entry->device == st.st_dev && entry->inode == st.st_ino && entry->size == static_cast<uint64_t>(st.st_size) && entry->mtime == mtime;
+      }
+      if (unchanged) {
+        hits++;
+        entries.splice(entries.begin(), entries, it->second);
+        return entry;
+      }
+      // the file changed since it was parsed
+      memory -= entry->cost;
+      entries.erase(it->second);
+      by_path.erase(it);
+    }
+    misses++;
+  }
+  if (!found) return nullptr;
+
+  // a file that is not ELF costs a stat and the validator, nothing else
+  auto elf = ElfReader::open(path, options);
+  if (!elf) return nullptr;
+  auto entry = std::make_shared<const cached_reader>(path, std::move(*elf));
+
+  std::lock_guard<std::mutex> guard(lock);
+  auto it = by_path.find(path);
+  if (it != by_path.end()) {
+    // parsed by another request at the same time, keep the one in the cache
+    entries.splice(entries.begin(), entries, it->second);
+    return *it->second;
+  }
+  entries.push_front(entry);
+  by_path.emplace(path, entries.begin());
+  memory += entry->cost;
+  evict();
+  return entry;
+}
+
+/**
+ * @brief Drop the least recently used entries, called with the lock held
+ *
+ * The newest entry stays even when it alone is over the budget.
+ */
+void ReaderCache::evict()
+{
+  while (entries.size() > 1 && (entries.size() > max_entries || memory > memory_budget)) {
+    auto &victim = entries.back();
+    memory -= victim->cost;
+    by_path.erase(victim->path);
+    entries.pop_back();
+    evictions++;
+  }
+}
+
+reader_cache_stats ReaderCache::get_stats() const
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return { hits, misses, evictions, entries.size(), memory };
+}
+
+
+SymbolServer::SymbolServer(const std::string &socket_path, ReaderCache &cache, size_t threads) : socket_path(socket_path), cache(cache), threads(threads == 0 ? 1 : threads), listen_fd(-1), epoll_fd(-1), wake_fd(-1), stopping(false)
+{
+  sockaddr_un address;
+  if (!socket_address(socket_path, address)) return;
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) return;
+  // a socket left behind by an earlier server
+  ::unlink(socket_path.c_str());
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(fd, 128) != 0) {
+    ::close(fd);
+    return;
+  }
+  epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+  wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  // the two are told apart from connections by their data.ptr
+  epoll_event listen_event{};
+  listen_event.events = EPOLLIN;
+  listen_event.data.ptr = &listen_fd;
+  epoll_event wake_event{};
+  wake_event.events = EPOLLIN;
+  wake_event.data.ptr = &wake_fd;
+  if (epoll_fd < 0 || wake_fd < 0 || ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &listen_event) != 0 || ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &wake_event) != 0) {
+    ::close(fd);
+    ::unlink(socket_path.c_str());
+    return;
+  }
+  listen_fd = fd;
+}
+
+SymbolServer::~SymbolServer()
+{
+  for (auto &c : connections) {
+    ::close(c.first);
+  }
+  if (epoll_fd >= 0) ::close(epoll_fd);
+  if (wake_fd >= 0) ::close(wake_fd);
+  if (listen_fd >= 0) {
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+  }
+}
+
+bool SymbolServer::is_open() const
+{
+  return listen_fd >= 0;
+}
+
+void SymbolServer::run()
+{
+  std::vector<std::thread> pool;
+  for (size_t ii = 0; ii < threads; ii++) {
+    pool.emplace_back(&SymbolServer::work, this);
+  }
+  epoll_event events[64];
+  while (!stopping) {
+    int count = ::epoll_wait(epoll_fd, events, 64, -1);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (int ii = 0; ii < count; ii++) {
+      if (events[ii].data.ptr == &wake_fd) continue;
+      if (events[ii].data.ptr == &listen_fd) {
+        accept_all();
+        continue;
+      }
+      // EPOLLONESHOT keeps it out of epoll until a pool thread is done with it
+      std::lock_guard<std::mutex> guard(lock);
+      ready.push_back(static_cast<connection *>(events[ii].data.ptr));
+      ready_signal.notify_one();
+    }
+  }
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+    ready_signal.notify_all();
+  }
+  for (auto &t : pool) {
+    t.join();
+  }
+  for (auto &c : connections) {
+    ::close(c.first);
+  }
+  connections.clear();
+  ready.clear();
+}
+
+void SymbolServer::stop()
+{
+  stopping = true;
+  // wakes epoll_wait(), write() is async-signal-safe
+  uint64_t one = 1;
+  if (wake_fd >= 0) (void)!::write(wake_fd, &one, sizeof(one));
+}
+
+void SymbolServer::accept_all()
+{
+  for (;;) {
+    int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      return;// EAGAIN, nothing more waiting
+    }
+    // a client that stops reading its responses loses the connection instead
+    // of holding a pool thread
+    timeval timeout{ SEND_TIMEOUT, 0 };
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    auto c = std::make_unique<connection>();
+    c->fd = fd;
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = c.get();
+    std::lock_guard<std::mutex> guard(lock);
+    connections.emplace(fd, std::move(c));
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+      connections.erase(fd);
+      ::close(fd);
+    }
+  }
+}
+
+void SymbolServer::work()
+{
+  for (;;) {
+    connection *c = nullptr;
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      ready_signal.wait(guard, [this] { return stopping || !ready.empty(); });
+      if (stopping) return;
+      c = ready.front();
+      ready.pop_front();
+    }
+    if (!serve(*c)) {
+      close_connection(*c);
+      continue;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = c;
+    if (::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, c->fd, &event) != 0) close_connection(*c);
+  }
+}
+
+bool SymbolServer::serve(connection &c)
+{
+  // one read per turn, whatever is left is reported by epoll again so busy
+  // connections take turns
+  char chunk[4096];
+  auto count = ::recv(c.fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+  if (count < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  if (count == 0) return false;
+  c.buffer.append(chunk, static_cast<size_t>(count));
+  std::string responses;
+  size_t start = 0;
+  for (auto end = c.buffer.find('\n'); end != std::string::npos; end = c.buffer.find('\n', start)) {
+    responses += handle(std::string_view(c.buffer).substr(start, end - start));
+    responses += '\n';
+    start = end + 1;
+  }
+  c.buffer.erase(0, start);
+  if (c.buffer.size() > MAX_REQUEST) return false;
+  return responses.empty() || send_all(c.fd, responses);
+}
+
+void SymbolServer::close_connection(connection &c)
+{
+  // closing takes it out of epoll, and under the lock its descriptor can't
+  // be handed to a new connection before the entry is gone
+  std::lock_guard<std::mutex> guard(lock);
+  int fd = c.fd;
+  connections.erase(fd);
+  ::close(fd);
+}
+
+std::string SymbolServer::handle(std::string_view request)
+{
+  auto space = request.find(' ');
+  auto command = request.substr(0, space);
+  if (command == "stats") {
+    auto stats = cache.get_stats();
+    return "ok hits=" + std::to_string(stats.hits) + " misses=" + std::to_string(stats.misses) + " evictions=" + std::to_string(stats.evictions) + " entries=" + std::to_string(stats.entries) + " memory=" + std::to_string(stats.memory);
+  }
+  if (command != "header" && command != "symbol" && command != "address" && command != "section") {
+    return "error unknown request '" + std::string(command) + "'";
+  }
+  if (space == std::string_view::npos) return "error expected a path";
+  auto rest = request.substr(space + 1);
+  std::string_view argument;
+  if (command != "header") {
+    // paths may have spaces, the argument cannot
+    auto last = rest.rfind(' ');
+    if (last == std::string_view::npos) return "error expected a path and an argument";
+    argument = rest.substr(last + 1);
+    rest = rest.substr(0, last);
+  }
+  auto reader = cache.get(std::string(rest));
+  if (reader == nullptr) return "error '" + std::string(rest) + "' is not a valid ELF file";
+  auto &query = reader->query;
+
+  auto section_name = [&query](ELF_ULONG shndx) -> std::string {
+    if (shndx == SHN_UNDEF) return "UND";
+    if (shndx == SHN_ABS) return "ABS";
+    if (shndx >= query.section_count()) return std::to_string(shndx);
+    return std::string(query.section(shndx).name);
+  };
+
+  if (command == "header") {
+    auto &h = query.get_header();
+    return "ok type=" + std::string(e_type_to_string(h.e_type)) + " machine=" + std::string(e_machines_to_string(h.e_machine)) + " entry=" + hex(h.e_entry) + " sections=" + std::to_string(query.section_count()) + " segments=" + std::to_string(query.segment_count()) + " symbols=" + std::to_string(query.symbol_count());
+  }
+  if (command == "symbol") {
+    auto found = query.find_symbol(argument);
+    if (found.empty()) return "error no symbol '" + std::string(argument) + "'";
+    // a definition is more use than a reference
+    auto best = found.front();
+    for (auto &sym : found) {
+      if (sym.shndx != SHN_UNDEF) {
+        best = sym;
+        break;
+      }
+    }
+    return "ok " + std::string(best.name) + " " + hex(best.value) + " " + std::to_string(best.size) + " " + std::string(elf_sym_type_to_string(ELF64_ST_TYPE(best.info))) + " " + std::string(elf_sym_binding_to_string(ELF64_ST_BIND(best.info))) + " " + section_name(best.shndx);
+  }
+  ELF_ULONG address = std::strtoull(std::string(argument).c_str(), nullptr, 0);
+  auto section = query.section_for_address(address);
+  if (command == "section") {
+    if (!section) return "error no section at " + hex(address);
+    return "ok " + std::string(section->name) + " " + hex(section->address) + " " + std::to_string(section->size);
+  }
+  auto sym = query.symbol_for_address(address);
+  if (!sym) return "error no symbol at " + hex(address);
+  return "ok " + std::string(sym->name) + "+" + hex(address - sym->value) + " " + (section ? std::string(section->name) : section_name(sym->shndx));
+}
+
+
+SymbolClient::SymbolClient(const std::string &socket_path) : fd(-1)
+{
+  sockaddr_un address;
+  if (!socket_address(socket_path, address)) return;
+  fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return;
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+SymbolClient::~SymbolClient()
+{
+  if (fd >= 0) ::close(fd);
+}
+
+bool SymbolClient::is_open() const
+{
+  return fd >= 0;
+}
+
+bool SymbolClient::request(std::string_view line, std::string &response)
+{
+  if (fd < 0) return false;
+  std::string message(line);
+  message += '\n';
+  return send_all(fd, message) && receive_line(fd, buffer, response);
+}
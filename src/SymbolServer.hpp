@@ -0,0 +1,180 @@
+#ifndef SYMBOLSERVER_HPP
+#define SYMBOLSERVER_HPP
+
+#include "ElfReader.hpp"
+#include "FrozenElfReader.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A parsed file, shared by the requests using it
+ */
+struct cached_reader
+{
+  cached_reader(const std::string &path, ElfReader &&elf);
+
+  std::string path;
+  FrozenElfReader query;
+  uint64_t device;
+  uint64_t inode;
+  uint64_t size;
+  uint64_t mtime;
+  uint64_t cost;// estimate of the memory it holds, see ReaderCache
+};
+
+struct reader_cache_stats
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t entries;
+  uint64_t memory;
+};
+
+/**
+ * @brief Least recently used cache of parsed files, bounded by entry count and
+ *        by memory.
+ *
+ * The cost of an entry is the decoded tables and indexes it holds on the heap
+ * plus the size of the file, whose pages end up resident as it is used.
+ * Entries are shared_ptrs, one that is evicted while a request still uses it
+ * is freed when the request is done.  A file that changed on disk since it
+ * was parsed is parsed again.  Files are parsed outside the lock.
+ */
+class ReaderCache
+{
+public:
+  ReaderCache(size_t max_entries, uint64_t memory_budget, ParseOptions options = ParseOptions{});
+
+  /**
+   * @brief The parsed file, nullptr if it is not an ELF file
+   */
+  std::shared_ptr<const cached_reader> get(const std::string &path);
+  reader_cache_stats get_stats() const;
+
+private:
+  using entry_list = std::list<std::shared_ptr<const cached_reader>>;
+
+  size_t max_entries;
+  uint64_t memory_budget;
+  ParseOptions options;
+  mutable std::mutex lock;
+  entry_list entries;// most recently used first
+  std::unordered_map<std::string, entry_list::iterator> by_path;
+  uint64_t memory;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+
+  void evict();
+};
+
+/**
+ * @brief Answers lookups over a Unix domain socket.
+ *
+ * Requests and responses are single lines of text, a connection can send any
+ * number of requests and gets the responses in order.
+ *
+ *   header <path>            ok type=ET_DYN machine=EM_X86_64 entry=0x...
+ *   symbol <path> <name>     ok <name> 0x<value> <size> <type> <binding> <section>
+ *   address <path> <addr>    ok <symbol>+0x<offset> <section>
+ *   section <path> <addr>    ok <section> 0x<address> <size>
+ *   stats                    ok hits=... misses=... evictions=... entries=... memory=...
+ *
+ * Anything else, or a lookup that finds nothing, is answered with
+ * "error <reason>".  The thread calling run() accepts connections and waits
+ * on all of them with epoll, a connection with bytes to read is queued for
+ * the pool, whose threads answer the complete lines it has and hand it back.
+ * An idle connection holds no thread, however many there are.
+ */
+class SymbolServer
+{
+public:
+  SymbolServer(const std::string &socket_path, ReaderCache &cache, size_t threads);
+  ~SymbolServer();
+  SymbolServer(const SymbolServer &) = delete;
+  SymbolServer &operator=(const SymbolServer &) = delete;
+
+  bool is_open() const;
+
+  /**
+   * @brief Serve until stop() is called
+   */
+  void run();
+
+  /**
+   * @brief Make run() return, safe to call from a signal handler
+   */
+  void stop();
+
+  /**
+   * @brief The response to one request line, without the newline
+   */
+  std::string handle(std::string_view request);
+
+private:
+  struct connection
+  {
+    int fd;
+    std::string buffer;// received bytes after the last complete line
+  };
+
+  std::string socket_path;
+  ReaderCache &cache;
+  size_t threads;
+  int listen_fd;
+  int epoll_fd;
+  int wake_fd;// eventfd stop() writes to
+  std::atomic<bool> stopping;
+  std::mutex lock;
+  std::condition_variable ready_signal;
+  std::deque<connection *> ready;// readable, waiting for a pool thread
+  std::unordered_map<int, std::unique_ptr<connection>> connections;
+
+  void accept_all();
+  void work();
+
+  /**
+   * @brief Read what the connection has and answer its complete lines
+   *
+   * @return false when it is closed or broken
+   */
+  bool serve(connection &c);
+  void close_connection(connection &c);
+};
+
+/**
+ * @brief One connection to a SymbolServer
+ */
+class SymbolClient
+{
+public:
+  explicit SymbolClient(const std::string &socket_path);
+  ~SymbolClient();
+  SymbolClient(const SymbolClient &) = delete;
+  SymbolClient &operator=(const SymbolClient &) = delete;
+
+  bool is_open() const;
+
+  /**
+   * @brief Send one request line and wait for its response
+   *
+   * @return false if the connection failed
+   */
+  bool request(std::string_view line, std::string &response);
+
+private:
+  int fd;
+  std::string buffer;// received bytes after the last response
+};
+
+#endif /* SYMBOLSERVER_HPP */
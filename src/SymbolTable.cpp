@@ -1,9 +1,13 @@
 #include "SymbolTable.hpp"
 
-void SymbolTable::print(std::ostream &out) const noexcept
+void SymbolTable::write(OutputBuffer &out) const noexcept
 {
-  out << "\n   [SymbolTable] Entries: " << entries.size() << std::endl;
-  for (auto entry : entries) {
-    out << "     " << entry << std::endl;
+  out.put("\n   [SymbolTable] Entries: ").dec(count);
+  if (entries.size() != count) out.put(", ").dec(entries.size()).put(" matching");
+  out.put('\n');
+  for (auto &entry : entries) {
+    out.put("     ");
+    write_text(out, entry);
+    out.put('\n');
   }
 }
@@ -13,7 +13,8 @@ class SymbolTable : public SectionTableInfo
 {
 public:
   std::vector<Elf_Sym> entries;
-  virtual void print(std::ostream &out) const noexcept override;
+  size_t count = 0;// symbols in the section, entries holds fewer with a symbol filter
+  virtual void write(OutputBuffer &out) const noexcept override;
 };
 
 
@@ -18,6 +18,14 @@
 #include <unistd.h>
 #include <vector>
 
+// the generated tables are searched by value and by name, check both orders agree
+static_assert(e_machines_from_string("EM_X86_64") == EM_X86_64);
+static_assert(e_machines_to_string(EM_AARCH64) == "EM_AARCH64");
+static_assert(e_section_types_from_string("SHT_SYMTAB") == SHT_SYMTAB);
+static_assert(e_section_types_to_string(SHT_HIUSER) == "SHT_HIUSER");
+static_assert(e_sh_flags_from_string("SHF_TLS") == SHF_TLS);
+static_assert(!e_sh_flags_from_string("SHF_NONE"));
+
 
 data_types_t data_types[] = {
   { "ELF32_ADDR", 4, 4 },// unsigned program address
@@ -66,7 +74,7 @@ special_sections_32_t special_sections_32[] = {
   { ".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR }// executable instructions of a program
 };
 
-std::string e_type_to_string(uint64_t value)
+std::string_view e_type_to_string(uint64_t value)
 {
   switch (value) {
   case static_cast<uint64_t>(ET_NONE):
@@ -96,7 +104,7 @@ void write_elf_ident(container_ref bytes)
   bytes.push_back(ELFMAG3);
 }
 
-std::string elf_special_section_types_to_string(uint64_t value)
+std::string_view elf_special_section_types_to_string(uint64_t value)
 {
   switch (value) {
   case static_cast<uint64_t>(SHN_UNDEF):
@@ -123,7 +131,7 @@ std::string elf_special_section_types_to_string(uint64_t value)
 
 
 
-std::string elf_sym_binding_to_string(uint64_t value)
+std::string_view elf_sym_binding_to_string(uint64_t value)
 {
   switch (value) {
   case static_cast<uint64_t>(STB_LOCAL):
@@ -145,7 +153,7 @@ std::string elf_sym_binding_to_string(uint64_t value)
   }
 }
 
-std::string elf_sym_type_to_string(uint64_t value)
+std::string_view elf_sym_type_to_string(uint64_t value)
 {
   switch (value) {
   case static_cast<uint64_t>(STT_NOTYPE):
@@ -176,7 +184,7 @@ std::string elf_sym_type_to_string(uint64_t value)
   }
 }
 
-std::string elf_sym_visibility_to_string(uint64_t value)
+std::string_view elf_sym_visibility_to_string(uint64_t value)
 {
   switch (value) {
   case static_cast<uint64_t>(STV_DEFAULT):
@@ -199,7 +207,7 @@ std::string elf_sym_visibility_to_string(uint64_t value)
 
 
 
-std::string elf_program_type_to_string(ELF_ULONG type)
+std::string_view elf_program_type_to_string(ELF_ULONG type)
 {
   switch (type) {
   case PT_NULL:
@@ -257,3 +265,104 @@ std::string elf_program_flag_to_string(ELF_ULONG type)
   return flags;
 }
 
+/**
+ * @brief Same text as elf_program_flag_to_string without building a string
+ */
+void write_program_flags(OutputBuffer &out, ELF_ULONG type)
+{
+  bool first = true;
+  auto flag = [&](ELF_ULONG mask, std::string_view name) {
+    if ((type & mask) != mask) return;
+    if (!first) out.put(' ');
+    out.put(name);
+    first = false;
+  };
+  flag(PF_R, "READ");
+  flag(PF_W, "WRITE");
+  flag(PF_X, "EXECUTE");
+  flag(PF_MASKOS, "OS_MASK");
+  flag(PF_MASKPROC, "CPU_MASK");
+}
+
+std::string_view elf_note_type_to_string(std::string_view name, ELF_ULONG type)
+{
+  if (name == "CORE" || name == "LINUX") {
+    switch (type) {
+    case NT_PRSTATUS:
+      return "NT_PRSTATUS";
+    case NT_PRFPREG:
+      return "NT_PRFPREG";
+    case NT_PRPSINFO:
+      return "NT_PRPSINFO";
+    case NT_AUXV:
+      return "NT_AUXV";
+    case NT_SIGINFO:
+      return "NT_SIGINFO";
+    case NT_FILE:
+      return "NT_FILE";
+    default:
+      return "unknown";
+    }
+  }
+  if (name == "GNU") {
+    switch (type) {
+    case NT_GNU_ABI_TAG:
+      return "NT_GNU_ABI_TAG";
+    case NT_GNU_BUILD_ID:
+      return "NT_GNU_BUILD_ID";
+    case NT_GNU_PROPERTY_TYPE_0:
+      return "NT_GNU_PROPERTY_TYPE_0";
+    default:
+      return "unknown";
+    }
+  }
+  return "unknown";
+}
+
+std::string_view elf_auxv_type_to_string(ELF_ULONG type)
+{
+  switch (type) {
+  case AT_NULL:
+    return "AT_NULL";
+  case AT_PHDR:
+    return "AT_PHDR";
+  case AT_PHENT:
+    return "AT_PHENT";
+  case AT_PHNUM:
+    return "AT_PHNUM";
+  case AT_PAGESZ:
+    return "AT_PAGESZ";
+  case AT_BASE:
+    return "AT_BASE";
+  case AT_FLAGS:
+    return "AT_FLAGS";
+  case AT_ENTRY:
+    return "AT_ENTRY";
+  case AT_UID:
+    return "AT_UID";
+  case AT_EUID:
+    return "AT_EUID";
+  case AT_GID:
+    return "AT_GID";
+  case AT_EGID:
+    return "AT_EGID";
+  case AT_PLATFORM:
+    return "AT_PLATFORM";
+  case AT_HWCAP:
+    return "AT_HWCAP";
+  case AT_CLKTCK:
+    return "AT_CLKTCK";
+  case AT_SECURE:
+    return "AT_SECURE";
+  case AT_RANDOM:
+    return "AT_RANDOM";
+  case AT_HWCAP2:
+    return "AT_HWCAP2";
+  case AT_EXECFN:
+    return "AT_EXECFN";
+  case AT_SYSINFO_EHDR:
+    return "AT_SYSINFO_EHDR";
+  default:
+    return "unknown";
+  }
+}
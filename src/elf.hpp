@@ -4,11 +4,13 @@
 #include "Elf_Program_Header_Fields.hpp"
 #include "Elf_Section_Header_Fields.hpp"
 #include "Elf_Sym.hpp"
+#include "OutputBuffer.hpp"
 #include "elf32.hpp"
 #include "elf64.hpp"
 #include "elf_common.hpp"
 #include <array>
 #include <iostream>
+#include <string_view>
 
 constexpr std::array<struct elf_program_header_fields_t, 8> elf_program_header_fields{ { { 0, { 0, sizeof(Elf32_Word), sizeof(Elf64_Word) } },
   { 1, { 0, sizeof(Elf32_Off), sizeof(Elf64_Word) } },
@@ -38,6 +40,14 @@ constexpr std::array<struct elf_symbol_table_fields_t, 6> elf_symbol_table_field
   { 4, { 0, sizeof(UNSIGNED_CHAR), sizeof(Elf64_Addr) } },
   { 5, { 0, sizeof(Elf32_Half), sizeof(Elf64_Xword) } } } };
 
+// Which field is at each position of elf_symbol_table_fields, by class,
+// numbering them name, value, size, info, other, shndx
+constexpr size_t elf_symbol_field_order[3][6] = { { 0, 1, 2, 3, 4, 5 }, { 0, 1, 2, 3, 4, 5 }, { 0, 3, 4, 5, 1, 2 } };
+
+// The same for elf_program_header_fields, numbering them type, flags, offset,
+// vaddr, paddr, filesz, memsz, align
+constexpr size_t elf_program_header_field_order[3][8] = { { 0, 2, 3, 4, 5, 6, 1, 7 }, { 0, 2, 3, 4, 5, 6, 1, 7 }, { 0, 1, 2, 3, 4, 5, 6, 7 } };
+
 
 // Sections can have names without a prefixed '.' these are application specific
 // Sections can appear more than once with same name
@@ -48,16 +58,19 @@ extern special_sections_32_t special_sections_32[];
 extern data_types_t data_types[];
 
 
-std::string e_type_to_string(uint64_t value);
-std::string elf_sym_binding_to_string(uint64_t value);
-std::string elf_special_section_types_to_string(uint64_t value);
-std::string elf_special_section_types_to_string(uint64_t value);
+std::string_view e_type_to_string(uint64_t value);
+std::string_view elf_sym_binding_to_string(uint64_t value);
+std::string_view elf_special_section_types_to_string(uint64_t value);
+std::string_view elf_special_section_types_to_string(uint64_t value);
 std::string elf_program_flag_to_string(ELF_ULONG type);
 void write_elf_ident(container_ref bytes);
-std::string elf_sym_type_to_string(uint64_t value);
-std::string elf_sym_visibility_to_string(uint64_t value);
-std::string elf_program_type_to_string(ELF_ULONG type);
+std::string_view elf_sym_type_to_string(uint64_t value);
+std::string_view elf_sym_visibility_to_string(uint64_t value);
+std::string_view elf_program_type_to_string(ELF_ULONG type);
 std::string elf_program_flag_to_string(ELF_ULONG type);
+void write_program_flags(OutputBuffer &out, ELF_ULONG type);
+std::string_view elf_note_type_to_string(std::string_view name, ELF_ULONG type);
+std::string_view elf_auxv_type_to_string(ELF_ULONG type);
 
 
 #endif /* ELF_HPP */
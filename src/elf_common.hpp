@@ -123,6 +123,42 @@ constexpr ELF_ULONG PT_LOPROC = 0x70000000;
 constexpr ELF_ULONG PT_HIPROC = 0x7fffffff;
 
 
+// extended numbering, the real e_phnum is in sh_info of section header 0
+constexpr ELF_ULONG PN_XNUM = 0xffff;
+
+// note types, the meaning depends on the owner name of the note
+constexpr ELF_ULONG NT_PRSTATUS = 1;// "CORE" process status, one per thread
+constexpr ELF_ULONG NT_PRFPREG = 2;// "CORE" floating point registers
+constexpr ELF_ULONG NT_PRPSINFO = 3;// "CORE" process information
+constexpr ELF_ULONG NT_AUXV = 6;// "CORE" auxiliary vector
+constexpr ELF_ULONG NT_SIGINFO = 0x53494749;// "CORE" siginfo of the fatal signal
+constexpr ELF_ULONG NT_FILE = 0x46494c45;// "CORE" mapped files
+constexpr ELF_ULONG NT_GNU_ABI_TAG = 1;// "GNU" ABI information
+constexpr ELF_ULONG NT_GNU_BUILD_ID = 3;// "GNU" unique build id
+constexpr ELF_ULONG NT_GNU_PROPERTY_TYPE_0 = 5;// "GNU" program properties
+
+// auxiliary vector entry types, found in the NT_AUXV note of a core file
+constexpr ELF_ULONG AT_NULL = 0;
+constexpr ELF_ULONG AT_PHDR = 3;// program headers of the executable
+constexpr ELF_ULONG AT_PHENT = 4;
+constexpr ELF_ULONG AT_PHNUM = 5;
+constexpr ELF_ULONG AT_PAGESZ = 6;
+constexpr ELF_ULONG AT_BASE = 7;// base address of the interpreter
+constexpr ELF_ULONG AT_FLAGS = 8;
+constexpr ELF_ULONG AT_ENTRY = 9;// entry point of the executable
+constexpr ELF_ULONG AT_UID = 11;
+constexpr ELF_ULONG AT_EUID = 12;
+constexpr ELF_ULONG AT_GID = 13;
+constexpr ELF_ULONG AT_EGID = 14;
+constexpr ELF_ULONG AT_PLATFORM = 15;
+constexpr ELF_ULONG AT_HWCAP = 16;
+constexpr ELF_ULONG AT_CLKTCK = 17;
+constexpr ELF_ULONG AT_SECURE = 23;
+constexpr ELF_ULONG AT_RANDOM = 25;
+constexpr ELF_ULONG AT_HWCAP2 = 26;
+constexpr ELF_ULONG AT_EXECFN = 31;
+constexpr ELF_ULONG AT_SYSINFO_EHDR = 33;// address of the vdso
+
 constexpr ELF_ULONG PF_X = 0x1;// Execute
 constexpr ELF_ULONG PF_W = 0x2;// Write
 constexpr ELF_ULONG PF_R = 0x4;// Read
@@ -1,9 +1,12 @@
 #ifndef E_MACHINES_HPP
 #define E_MACHINES_HPP
 
-// This file is automatically generated, do not edit.
+// This file is automatically generated by tools/write_enums.py, do not edit.
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
 
 enum e_machines {
     EM_NONE                                 = 0,         // No machine
@@ -22,7 +25,7 @@ enum e_machines {
     e_machines_reserved_13                  = 13,        // Reserved for future use
     e_machines_reserved_14                  = 14,        // Reserved for future use
     EM_PARISC                               = 15,        // Hewlett-Packard PA-RISC
-    e_machines_reserved_0                   = 16,        // Reserved for future use
+    e_machines_reserved_16                  = 16,        // Reserved for future use
     EM_VPP500                               = 17,        // Fujitsu VPP500
     EM_SPARC32PLUS                          = 18,        // Enhanced instruction set SPARC
     EM_960                                  = 19,        // Intel 80960
@@ -188,9 +191,9 @@ enum e_machines {
     EM_SLE9X                                = 179,       // Infineon Technologies SLE9X core
     EM_L10M                                 = 180,       // Intel L10M
     EM_K10M                                 = 181,       // Intel K10M
-    e_machines_reserved_1                   = 182,       // Reserved for future Intel use
+    e_machines_reserved_182                 = 182,       // Reserved for future Intel use
     EM_AARCH64                              = 183,       // ARM 64-bit architecture (AARCH64)
-    e_machines_reserved_2                   = 184,       // Reserved for future ARM use
+    e_machines_reserved_184                 = 184,       // Reserved for future ARM use
     EM_AVR32                                = 185,       // Atmel Corporation 32-bit microprocessor family
     EM_STM8                                 = 186,       // STMicroeletronics STM8 8-bit microcontroller
     EM_TILE64                               = 187,       // Tilera TILE64 multicore architecture family
@@ -252,8 +255,539 @@ enum e_machines {
     EM_RISCV                                = 243        // RISC-V
 };
 
-std::string e_machines_to_string(int64_t value);
+namespace e_machines_table {
 
+struct entry
+{
+  int64_t value;
+  std::string_view name;
+};
+
+// indexed by value, unused values are empty
+inline constexpr std::string_view names[] = {
+  "EM_NONE",
+  "EM_M32",
+  "EM_SPARC",
+  "EM_386",
+  "EM_68K",
+  "EM_88K",
+  "EM_IAMCU",
+  "EM_860",
+  "EM_MIPS",
+  "EM_S370",
+  "EM_MIPS_RS3_LE",
+  "e_machines_reserved_11",
+  "e_machines_reserved_12",
+  "e_machines_reserved_13",
+  "e_machines_reserved_14",
+  "EM_PARISC",
+  "e_machines_reserved_16",
+  "EM_VPP500",
+  "EM_SPARC32PLUS",
+  "EM_960",
+  "EM_PPC",
+  "EM_PPC64",
+  "EM_S390",
+  "EM_SPU",
+  "e_machines_reserved_24",
+  "e_machines_reserved_25",
+  "e_machines_reserved_26",
+  "e_machines_reserved_27",
+  "e_machines_reserved_28",
+  "e_machines_reserved_29",
+  "e_machines_reserved_30",
+  "e_machines_reserved_31",
+  "e_machines_reserved_32",
+  "e_machines_reserved_33",
+  "e_machines_reserved_34",
+  "e_machines_reserved_35",
+  "EM_V800",
+  "EM_FR20",
+  "EM_RH32",
+  "EM_RCE",
+  "EM_ARM",
+  "EM_ALPHA",
+  "EM_SH",
+  "EM_SPARCV9",
+  "EM_TRICORE",
+  "EM_ARC",
+  "EM_H8_300",
+  "EM_H8_300H",
+  "EM_H8S",
+  "EM_H8_500",
+  "EM_IA_64",
+  "EM_MIPS_X",
+  "EM_COLDFIRE",
+  "EM_68HC12",
+  "EM_MMA",
+  "EM_PCP",
+  "EM_NCPU",
+  "EM_NDR1",
+  "EM_STARCORE",
+  "EM_ME16",
+  "EM_ST100",
+  "EM_TINYJ",
+  "EM_X86_64",
+  "EM_PDSP",
+  "EM_PDP10",
+  "EM_PDP11",
+  "EM_FX66",
+  "EM_ST9PLUS",
+  "EM_ST7",
+  "EM_68HC16",
+  "EM_68HC11",
+  "EM_68HC08",
+  "EM_68HC05",
+  "EM_SVX",
+  "EM_ST19",
+  "EM_VAX",
+  "EM_CRIS",
+  "EM_JAVELIN",
+  "EM_FIREPATH",
+  "EM_ZSP",
+  "EM_MMIX",
+  "EM_HUANY",
+  "EM_PRISM",
+  "EM_AVR",
+  "EM_FR30",
+  "EM_D10V",
+  "EM_D30V",
+  "EM_V850",
+  "EM_M32R",
+  "EM_MN10300",
+  "EM_MN10200",
+  "EM_PJ",
+  "EM_OPENRISC",
+  "EM_ARC_COMPACT",
+  "EM_XTENSA",
+  "EM_VIDEOCORE",
+  "EM_TMM_GPP",
+  "EM_NS32K",
+  "EM_TPC",
+  "EM_SNP1K",
+  "EM_ST200",
+  "EM_IP2K",
+  "EM_MAX",
+  "EM_CR",
+  "EM_F2MC16",
+  "EM_MSP430",
+  "EM_BLACKFIN",
+  "EM_SE_C33",
+  "EM_SEP",
+  "EM_ARCA",
+  "EM_UNICORE",
+  "EM_EXCESS",
+  "EM_DXP",
+  "EM_ALTERA_NIOS2",
+  "EM_CRX",
+  "EM_XGATE",
+  "EM_C166",
+  "EM_M16C",
+  "EM_DSPIC30F",
+  "EM_CE",
+  "EM_M32C",
+  "e_machines_reserved_121",
+  "e_machines_reserved_122",
+  "e_machines_reserved_123",
+  "e_machines_reserved_124",
+  "e_machines_reserved_125",
+  "e_machines_reserved_126",
+  "e_machines_reserved_127",
+  "e_machines_reserved_128",
+  "e_machines_reserved_129",
+  "e_machines_reserved_130",
+  "EM_TSK3000",
+  "EM_RS08",
+  "EM_SHARC",
+  "EM_ECOG2",
+  "EM_SCORE7",
+  "EM_DSP24",
+  "EM_VIDEOCORE3",
+  "EM_LATTICEMICO32",
+  "EM_SE_C17",
+  "EM_TI_C6000",
+  "EM_TI_C2000",
+  "EM_TI_C5500",
+  "EM_TI_ARP32",
+  "EM_TI_PRU",
+  "e_machines_reserved_145",
+  "e_machines_reserved_146",
+  "e_machines_reserved_147",
+  "e_machines_reserved_148",
+  "e_machines_reserved_149",
+  "e_machines_reserved_150",
+  "e_machines_reserved_151",
+  "e_machines_reserved_152",
+  "e_machines_reserved_153",
+  "e_machines_reserved_154",
+  "e_machines_reserved_155",
+  "e_machines_reserved_156",
+  "e_machines_reserved_157",
+  "e_machines_reserved_158",
+  "e_machines_reserved_159",
+  "EM_MMDSP_PLUS",
+  "EM_CYPRESS_M8C",
+  "EM_R32C",
+  "EM_TRIMEDIA",
+  "EM_QDSP6",
+  "EM_8051",
+  "EM_STXP7X",
+  "EM_NDS32",
+  "EM_ECOG1",
+  "EM_MAXQ30",
+  "EM_XIMO16",
+  "EM_MANIK",
+  "EM_CRAYNV2",
+  "EM_RX",
+  "EM_METAG",
+  "EM_MCST_ELBRUS",
+  "EM_ECOG16",
+  "EM_CR16",
+  "EM_ETPU",
+  "EM_SLE9X",
+  "EM_L10M",
+  "EM_K10M",
+  "e_machines_reserved_182",
+  "EM_AARCH64",
+  "e_machines_reserved_184",
+  "EM_AVR32",
+  "EM_STM8",
+  "EM_TILE64",
+  "EM_TILEPRO",
+  "EM_MICROBLAZE",
+  "EM_CUDA",
+  "EM_TILEGX",
+  "EM_CLOUDSHIELD",
+  "EM_COREA_1ST",
+  "EM_COREA_2ND",
+  "EM_ARC_COMPACT2",
+  "EM_OPEN8",
+  "EM_RL78",
+  "EM_VIDEOCORE5",
+  "EM_78KOR",
+  "EM_56800EX",
+  "EM_BA1",
+  "EM_BA2",
+  "EM_XCORE",
+  "EM_MCHP_PIC",
+  "EM_INTEL205",
+  "EM_INTEL206",
+  "EM_INTEL207",
+  "EM_INTEL208",
+  "EM_INTEL209",
+  "EM_KM32",
+  "EM_KMX32",
+  "EM_KMX16",
+  "EM_KMX8",
+  "EM_KVARC",
+  "EM_CDP",
+  "EM_COGE",
+  "EM_COOL",
+  "EM_NORC",
+  "EM_CSR_KALIMBA",
+  "EM_Z80",
+  "EM_VISIUM",
+  "EM_FT32",
+  "EM_MOXIE",
+  "EM_AMDGPU",
+  "e_machines_reserved_225",
+  "e_machines_reserved_226",
+  "e_machines_reserved_227",
+  "e_machines_reserved_228",
+  "e_machines_reserved_229",
+  "e_machines_reserved_230",
+  "e_machines_reserved_231",
+  "e_machines_reserved_232",
+  "e_machines_reserved_233",
+  "e_machines_reserved_234",
+  "e_machines_reserved_235",
+  "e_machines_reserved_236",
+  "e_machines_reserved_237",
+  "e_machines_reserved_238",
+  "e_machines_reserved_239",
+  "e_machines_reserved_240",
+  "e_machines_reserved_241",
+  "e_machines_reserved_242",
+  "EM_RISCV",
+};
+
+// sorted by name
+inline constexpr entry by_name[] = {
+  { 0x3, "EM_386" },
+  { 0xC8, "EM_56800EX" },
+  { 0x48, "EM_68HC05" },
+  { 0x47, "EM_68HC08" },
+  { 0x46, "EM_68HC11" },
+  { 0x35, "EM_68HC12" },
+  { 0x45, "EM_68HC16" },
+  { 0x4, "EM_68K" },
+  { 0xC7, "EM_78KOR" },
+  { 0xA5, "EM_8051" },
+  { 0x7, "EM_860" },
+  { 0x5, "EM_88K" },
+  { 0x13, "EM_960" },
+  { 0xB7, "EM_AARCH64" },
+  { 0x29, "EM_ALPHA" },
+  { 0x71, "EM_ALTERA_NIOS2" },
+  { 0xE0, "EM_AMDGPU" },
+  { 0x2D, "EM_ARC" },
+  { 0x6D, "EM_ARCA" },
+  { 0x5D, "EM_ARC_COMPACT" },
+  { 0xC3, "EM_ARC_COMPACT2" },
+  { 0x28, "EM_ARM" },
+  { 0x53, "EM_AVR" },
+  { 0xB9, "EM_AVR32" },
+  { 0xC9, "EM_BA1" },
+  { 0xCA, "EM_BA2" },
+  { 0x6A, "EM_BLACKFIN" },
+  { 0x74, "EM_C166" },
+  { 0xD7, "EM_CDP" },
+  { 0x77, "EM_CE" },
+  { 0xC0, "EM_CLOUDSHIELD" },
+  { 0xD8, "EM_COGE" },
+  { 0x34, "EM_COLDFIRE" },
+  { 0xD9, "EM_COOL" },
+  { 0xC1, "EM_COREA_1ST" },
+  { 0xC2, "EM_COREA_2ND" },
+  { 0x67, "EM_CR" },
+  { 0xB1, "EM_CR16" },
+  { 0xAC, "EM_CRAYNV2" },
+  { 0x4C, "EM_CRIS" },
+  { 0x72, "EM_CRX" },
+  { 0xDB, "EM_CSR_KALIMBA" },
+  { 0xBE, "EM_CUDA" },
+  { 0xA1, "EM_CYPRESS_M8C" },
+  { 0x55, "EM_D10V" },
+  { 0x56, "EM_D30V" },
+  { 0x88, "EM_DSP24" },
+  { 0x76, "EM_DSPIC30F" },
+  { 0x70, "EM_DXP" },
+  { 0xA8, "EM_ECOG1" },
+  { 0xB0, "EM_ECOG16" },
+  { 0x86, "EM_ECOG2" },
+  { 0xB2, "EM_ETPU" },
+  { 0x6F, "EM_EXCESS" },
+  { 0x68, "EM_F2MC16" },
+  { 0x4E, "EM_FIREPATH" },
+  { 0x25, "EM_FR20" },
+  { 0x54, "EM_FR30" },
+  { 0xDE, "EM_FT32" },
+  { 0x42, "EM_FX66" },
+  { 0x30, "EM_H8S" },
+  { 0x2E, "EM_H8_300" },
+  { 0x2F, "EM_H8_300H" },
+  { 0x31, "EM_H8_500" },
+  { 0x51, "EM_HUANY" },
+  { 0x6, "EM_IAMCU" },
+  { 0x32, "EM_IA_64" },
+  { 0xCD, "EM_INTEL205" },
+  { 0xCE, "EM_INTEL206" },
+  { 0xCF, "EM_INTEL207" },
+  { 0xD0, "EM_INTEL208" },
+  { 0xD1, "EM_INTEL209" },
+  { 0x65, "EM_IP2K" },
+  { 0x4D, "EM_JAVELIN" },
+  { 0xB5, "EM_K10M" },
+  { 0xD2, "EM_KM32" },
+  { 0xD4, "EM_KMX16" },
+  { 0xD3, "EM_KMX32" },
+  { 0xD5, "EM_KMX8" },
+  { 0xD6, "EM_KVARC" },
+  { 0xB4, "EM_L10M" },
+  { 0x8A, "EM_LATTICEMICO32" },
+  { 0x75, "EM_M16C" },
+  { 0x1, "EM_M32" },
+  { 0x78, "EM_M32C" },
+  { 0x58, "EM_M32R" },
+  { 0xAB, "EM_MANIK" },
+  { 0x66, "EM_MAX" },
+  { 0xA9, "EM_MAXQ30" },
+  { 0xCC, "EM_MCHP_PIC" },
+  { 0xAF, "EM_MCST_ELBRUS" },
+  { 0x3B, "EM_ME16" },
+  { 0xAE, "EM_METAG" },
+  { 0xBD, "EM_MICROBLAZE" },
+  { 0x8, "EM_MIPS" },
+  { 0xA, "EM_MIPS_RS3_LE" },
+  { 0x33, "EM_MIPS_X" },
+  { 0x36, "EM_MMA" },
+  { 0xA0, "EM_MMDSP_PLUS" },
+  { 0x50, "EM_MMIX" },
+  { 0x5A, "EM_MN10200" },
+  { 0x59, "EM_MN10300" },
+  { 0xDF, "EM_MOXIE" },
+  { 0x69, "EM_MSP430" },
+  { 0x38, "EM_NCPU" },
+  { 0x39, "EM_NDR1" },
+  { 0xA7, "EM_NDS32" },
+  { 0x0, "EM_NONE" },
+  { 0xDA, "EM_NORC" },
+  { 0x61, "EM_NS32K" },
+  { 0xC4, "EM_OPEN8" },
+  { 0x5C, "EM_OPENRISC" },
+  { 0xF, "EM_PARISC" },
+  { 0x37, "EM_PCP" },
+  { 0x40, "EM_PDP10" },
+  { 0x41, "EM_PDP11" },
+  { 0x3F, "EM_PDSP" },
+  { 0x5B, "EM_PJ" },
+  { 0x14, "EM_PPC" },
+  { 0x15, "EM_PPC64" },
+  { 0x52, "EM_PRISM" },
+  { 0xA4, "EM_QDSP6" },
+  { 0xA2, "EM_R32C" },
+  { 0x27, "EM_RCE" },
+  { 0x26, "EM_RH32" },
+  { 0xF3, "EM_RISCV" },
+  { 0xC5, "EM_RL78" },
+  { 0x84, "EM_RS08" },
+  { 0xAD, "EM_RX" },
+  { 0x9, "EM_S370" },
+  { 0x16, "EM_S390" },
+  { 0x87, "EM_SCORE7" },
+  { 0x6C, "EM_SEP" },
+  { 0x8B, "EM_SE_C17" },
+  { 0x6B, "EM_SE_C33" },
+  { 0x2A, "EM_SH" },
+  { 0x85, "EM_SHARC" },
+  { 0xB3, "EM_SLE9X" },
+  { 0x63, "EM_SNP1K" },
+  { 0x2, "EM_SPARC" },
+  { 0x12, "EM_SPARC32PLUS" },
+  { 0x2B, "EM_SPARCV9" },
+  { 0x17, "EM_SPU" },
+  { 0x3C, "EM_ST100" },
+  { 0x4A, "EM_ST19" },
+  { 0x64, "EM_ST200" },
+  { 0x44, "EM_ST7" },
+  { 0x43, "EM_ST9PLUS" },
+  { 0x3A, "EM_STARCORE" },
+  { 0xBA, "EM_STM8" },
+  { 0xA6, "EM_STXP7X" },
+  { 0x49, "EM_SVX" },
+  { 0xBB, "EM_TILE64" },
+  { 0xBF, "EM_TILEGX" },
+  { 0xBC, "EM_TILEPRO" },
+  { 0x3D, "EM_TINYJ" },
+  { 0x8F, "EM_TI_ARP32" },
+  { 0x8D, "EM_TI_C2000" },
+  { 0x8E, "EM_TI_C5500" },
+  { 0x8C, "EM_TI_C6000" },
+  { 0x90, "EM_TI_PRU" },
+  { 0x60, "EM_TMM_GPP" },
+  { 0x62, "EM_TPC" },
+  { 0x2C, "EM_TRICORE" },
+  { 0xA3, "EM_TRIMEDIA" },
+  { 0x83, "EM_TSK3000" },
+  { 0x6E, "EM_UNICORE" },
+  { 0x24, "EM_V800" },
+  { 0x57, "EM_V850" },
+  { 0x4B, "EM_VAX" },
+  { 0x5F, "EM_VIDEOCORE" },
+  { 0x89, "EM_VIDEOCORE3" },
+  { 0xC6, "EM_VIDEOCORE5" },
+  { 0xDD, "EM_VISIUM" },
+  { 0x11, "EM_VPP500" },
+  { 0x3E, "EM_X86_64" },
+  { 0xCB, "EM_XCORE" },
+  { 0x73, "EM_XGATE" },
+  { 0xAA, "EM_XIMO16" },
+  { 0x5E, "EM_XTENSA" },
+  { 0xDC, "EM_Z80" },
+  { 0x4F, "EM_ZSP" },
+  { 0xB, "e_machines_reserved_11" },
+  { 0xC, "e_machines_reserved_12" },
+  { 0x79, "e_machines_reserved_121" },
+  { 0x7A, "e_machines_reserved_122" },
+  { 0x7B, "e_machines_reserved_123" },
+  { 0x7C, "e_machines_reserved_124" },
+  { 0x7D, "e_machines_reserved_125" },
+  { 0x7E, "e_machines_reserved_126" },
+  { 0x7F, "e_machines_reserved_127" },
+  { 0x80, "e_machines_reserved_128" },
+  { 0x81, "e_machines_reserved_129" },
+  { 0xD, "e_machines_reserved_13" },
+  { 0x82, "e_machines_reserved_130" },
+  { 0xE, "e_machines_reserved_14" },
+  { 0x91, "e_machines_reserved_145" },
+  { 0x92, "e_machines_reserved_146" },
+  { 0x93, "e_machines_reserved_147" },
+  { 0x94, "e_machines_reserved_148" },
+  { 0x95, "e_machines_reserved_149" },
+  { 0x96, "e_machines_reserved_150" },
+  { 0x97, "e_machines_reserved_151" },
+  { 0x98, "e_machines_reserved_152" },
+  { 0x99, "e_machines_reserved_153" },
+  { 0x9A, "e_machines_reserved_154" },
+  { 0x9B, "e_machines_reserved_155" },
+  { 0x9C, "e_machines_reserved_156" },
+  { 0x9D, "e_machines_reserved_157" },
+  { 0x9E, "e_machines_reserved_158" },
+  { 0x9F, "e_machines_reserved_159" },
+  { 0x10, "e_machines_reserved_16" },
+  { 0xB6, "e_machines_reserved_182" },
+  { 0xB8, "e_machines_reserved_184" },
+  { 0xE1, "e_machines_reserved_225" },
+  { 0xE2, "e_machines_reserved_226" },
+  { 0xE3, "e_machines_reserved_227" },
+  { 0xE4, "e_machines_reserved_228" },
+  { 0xE5, "e_machines_reserved_229" },
+  { 0xE6, "e_machines_reserved_230" },
+  { 0xE7, "e_machines_reserved_231" },
+  { 0xE8, "e_machines_reserved_232" },
+  { 0xE9, "e_machines_reserved_233" },
+  { 0xEA, "e_machines_reserved_234" },
+  { 0xEB, "e_machines_reserved_235" },
+  { 0xEC, "e_machines_reserved_236" },
+  { 0xED, "e_machines_reserved_237" },
+  { 0xEE, "e_machines_reserved_238" },
+  { 0xEF, "e_machines_reserved_239" },
+  { 0x18, "e_machines_reserved_24" },
+  { 0xF0, "e_machines_reserved_240" },
+  { 0xF1, "e_machines_reserved_241" },
+  { 0xF2, "e_machines_reserved_242" },
+  { 0x19, "e_machines_reserved_25" },
+  { 0x1A, "e_machines_reserved_26" },
+  { 0x1B, "e_machines_reserved_27" },
+  { 0x1C, "e_machines_reserved_28" },
+  { 0x1D, "e_machines_reserved_29" },
+  { 0x1E, "e_machines_reserved_30" },
+  { 0x1F, "e_machines_reserved_31" },
+  { 0x20, "e_machines_reserved_32" },
+  { 0x21, "e_machines_reserved_33" },
+  { 0x22, "e_machines_reserved_34" },
+  { 0x23, "e_machines_reserved_35" },
+};
+
+}// namespace e_machines_table
+
+/**
+ * @brief Name of an enum value, "unknown" if it has none
+ */
+constexpr std::string_view e_machines_to_string(int64_t value)
+{
+  constexpr auto count = static_cast<int64_t>(sizeof(e_machines_table::names) / sizeof(e_machines_table::names[0]));
+  if (value < 0 || value >= count || e_machines_table::names[value].empty()) return "unknown";
+  return e_machines_table::names[value];
+}
 
+/**
+ * @brief Value of an enum by name, usable in constant expressions
+ */
+constexpr std::optional<e_machines> e_machines_from_string(std::string_view name)
+{
+  size_t low = 0;
+  size_t high = sizeof(e_machines_table::by_name) / sizeof(e_machines_table::by_name[0]);
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (e_machines_table::by_name[middle].name < name) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == sizeof(e_machines_table::by_name) / sizeof(e_machines_table::by_name[0]) || e_machines_table::by_name[low].name != name) return std::nullopt;
+  return static_cast<e_machines>(e_machines_table::by_name[low].value);
+}
 
 #endif // end of E_MACHINES_HPP
@@ -1,11 +1,1361 @@
 #include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <mutex>
+#include "BatchScanner.hpp"
+#include "ColumnarWriter.hpp"
+#include "CoreFile.hpp"
+#include "DirectoryWatcher.hpp"
+#include "ElfDiff.hpp"
+#include "ElfEditor.hpp"
+#include "ElfGenerator.hpp"
+#include "ElfQuery.hpp"
 #include "ElfReader.hpp"
+#include "ElfWriter.hpp"
+#include "ElfSnapshot.hpp"
+#include "FrozenElfReader.hpp"
+#include "Hash.hpp"
+#include "IdenticalCode.hpp"
+#include "ParseCache.hpp"
+#include "ParseStats.hpp"
+#include "RecordWriter.hpp"
+#include "SizeReport.hpp"
+#include "SymbolIndex.hpp"
+#include "SymbolServer.hpp"
+#include "elf.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <set>
+#include <sys/stat.h>
+#include <thread>
+#include <tuple>
 
-void read(std::string filename)
+/**
+ * @brief Command line split into --name=value options and everything else
+ */
+struct Arguments
+{
+  std::vector<std::pair<std::string, std::string>> options;
+  std::vector<std::string> positional;
+
+  Arguments(int argc, char *argv[])
+  {
+    for (int ii = 0; ii < argc; ii++) {
+      std::string arg = argv[ii];
+      if (arg.size() > 2 && arg.compare(0, 2, "--") == 0) {
+        auto equals = arg.find('=');
+        if (equals == std::string::npos) {
+          options.emplace_back(arg.substr(2), "");
+        } else {
+          options.emplace_back(arg.substr(2, equals - 2), arg.substr(equals + 1));
+        }
+      } else {
+        positional.push_back(arg);
+      }
+    }
+  }
+
+  bool has(const std::string &name) const
+  {
+    for (auto &o : options) {
+      if (o.first == name) return true;
+    }
+    return false;
+  }
+
+  std::string get(const std::string &name, const std::string &fallback = "") const
+  {
+    for (auto &o : options) {
+      if (o.first == name) return o.second;
+    }
+    return fallback;
+  }
+};
+
+/**
+ * @brief Parts of the text dump asked for with --headers, --sections,
+ *        --symbols[=filter] and --segments, everything when none are given
+ */
+struct Selection
+{
+  bool headers = true;
+  bool sections = true;
+  bool symbols = true;
+  bool segments = true;
+  bool everything = true;
+
+  explicit Selection(const Arguments &args)
+  {
+    if (!args.has("headers") && !args.has("sections") && !args.has("symbols") && !args.has("segments")) return;
+    everything = false;
+    headers = args.has("headers");
+    sections = args.has("sections");
+    symbols = args.has("symbols");
+    segments = args.has("segments");
+  }
+
+  /**
+   * @brief Only parse what will be printed
+   */
+  ParseOptions parse_options(const Arguments &args) const
+  {
+    ParseOptions options;
+    options.symbol_filter = args.get("symbols");
+    if (everything) return options;
+    options.section_headers = sections || symbols;
+    options.symbol_tables = symbols;
+    options.string_tables = false;
+    options.program_headers = segments;
+    options.notes = false;
+    return options;
+  }
+};
+
+/**
+ * @brief --cache=<dir> reuses earlier parses of unchanged files, --cache-stats
+ *        reports the hit and miss counts on stderr at the end
+ */
+struct CacheOption
+{
+  std::unique_ptr<ParseCache> cache;
+  bool report;
+
+  CacheOption(const Arguments &args, ParseOptions &options) : report(args.has("cache-stats"))
+  {
+    if (!args.has("cache")) return;
+    cache = std::make_unique<ParseCache>(args.get("cache"));
+    if (cache->is_open()) {
+      options.cache = cache.get();
+    } else {
+      std::cerr << "unable to use the cache in '" << args.get("cache") << "'" << std::endl;
+    }
+  }
+
+  ~CacheOption()
+  {
+    if (!report || cache == nullptr) return;
+    OutputBuffer out(STDERR_FILENO);
+    write_text(out, cache->get_stats());
+  }
+};
+
+/**
+ * @brief --stats prints the time, bytes, entries and allocations of each
+ *        parse phase on stderr, summed over every file.  --perf prints the
+ *        perf counters of each file and, with ELF_ENABLE_STATS, of each phase.
+ *        --alloc-budget=<file> checks the allocations against a budget.
+ */
+struct StatsOption
+{
+  parse_stats stats;
+  std::vector<std::pair<std::string, perf_sample>> files;
+  std::vector<allocation_budget> budget;
+  bool report;
+  bool perf;
+  bool budgeted;
+  bool budget_read;
+
+  explicit StatsOption(const Arguments &args) : report(args.has("stats")), perf(args.has("perf")), budgeted(args.has("alloc-budget")), budget_read(false)
+  {
+    if (budgeted) {
+      budget_read = read_allocation_budget(args.get("alloc-budget"), budget);
+      if (!budget_read) std::cerr << "unable to read the allocation budget in '" << args.get("alloc-budget") << "'" << std::endl;
+    }
+    if (!perf) return;
+    PerfCounters::enable();
+    PerfCounters probe;
+    // carry on without them, the report says n/a
+    if (!probe.get_error().empty()) {
+      std::cerr << "perf counters unavailable, " << probe.get_error() << std::endl;
+    }
+  }
+
+  /**
+   * @brief false if the parses went over the --alloc-budget, or it could
+   *        not be checked
+   */
+  bool within_budget() const
+  {
+    if (!budgeted) return true;
+    if (!budget_read) return false;
+    OutputBuffer out(STDERR_FILENO);
+    return check_allocation_budget(out, stats, budget);
+  }
+
+  void add(const BatchScanner &scanner)
+  {
+    stats = scanner.get_stats();
+    for (auto &p : scanner.get_profiles()) {
+      files.emplace_back(scanner.get_files()[p.file_id], p.counters);
+    }
+  }
+
+  ~StatsOption()
+  {
+    if (!report && !perf) return;
+    OutputBuffer out(STDERR_FILENO);
+    if (report) write_text(out, stats);
+    if (!perf) return;
+    out.put("        cycles  instructions  cache misses branch misses   page faults     IPC  file\n");
+    perf_sample total{};
+    for (auto &f : files) {
+      write_text(out, f.second);
+      out.put("  ").put(f.first).put('\n');
+      total.add(f.second);
+    }
+    write_text(out, total);
+    out.put("  total\n");
+    if (parse_stats::enabled) write_text_counters(out, stats);
+  }
+};
+
+/**
+ * @brief Why a file can't be used, for the error messages
+ */
+std::string invalid_file(const std::string &filename, const ElfReader &elf)
+{
+  auto validation = elf.get_validation();
+  if (validation.error == EE_NOT_ELF) return "'" + filename + "' is not an ELF file";
+  std::string message = "'" + filename + "': " + std::string(elf_error_to_string(validation.error));
+  if (validation.index != 0) message += " (" + std::to_string(validation.index) + ")";
+  return message;
+}
+
+void read(std::string filename, const Selection &selection, const ParseOptions &options, StatsOption &stats)
 {
   std::cout << "\n\nReading executable '" << filename << "'\n";
-  auto s = ElfReader(filename);
-  std::cout << s << std::endl;
+  auto perf = PerfCounters::for_thread();
+  auto before = perf != nullptr ? perf->read() : perf_sample{};
+  auto s = ElfReader(filename, options);
+  if (perf != nullptr) stats.files.emplace_back(filename, perf->read().since(before));
+  stats.stats.add(s.get_stats());
+  if (!s.is_valid()) {
+    std::cout << invalid_file(filename, s) << std::endl;
+    return;
+  }
+  // the progress messages above go through stdio, get them out before we
+  // start writing to the descriptor directly
+  std::cout.flush();
+  OutputBuffer out(STDOUT_FILENO);
+  if (selection.everything) {
+    write_text(out, s);
+  } else {
+    if (selection.headers) write_text_header(out, s);
+    if (selection.sections) write_text_sections(out, s);
+    if (selection.symbols) write_text_symbols(out, s);
+    if (selection.segments) write_text_segments(out, s);
+  }
+  out.put('\n');
+}
+
+void hex_dump(ELF_ULONG address, const byte *buffer, size_t size)
+{
+  for (size_t ii = 0; ii < size; ii += 16) {
+    std::cout << std::hex << std::setw(16) << std::setfill('0') << (address + ii) << " ";
+    for (size_t jj = ii; jj < ii + 16 && jj < size; jj++) {
+      std::cout << " " << std::setw(2) << static_cast<uint64_t>(buffer[jj]);
+    }
+    std::cout << std::dec << "\n";
+  }
+}
+
+/**
+ * @brief elf core <file> [address length]
+ *
+ * Summarise a core file, optionally dumping process memory at an address.
+ */
+int core(int argc, char *argv[])
+{
+  auto elf = ElfReader(argv[0]);
+  if (!elf.is_valid()) {
+    std::cout << invalid_file(argv[0], elf) << std::endl;
+    return 1;
+  }
+  if (elf.header.e_type != ET_CORE) {
+    std::cout << "'" << argv[0] << "' is not a core file" << std::endl;
+    return 1;
+  }
+  auto core = CoreFile(elf);
+  if (argc < 3) {
+    std::cout << core;
+    return 0;
+  }
+  ELF_ULONG address = std::strtoull(argv[1], nullptr, 0);
+  size_t size = std::strtoull(argv[2], nullptr, 0);
+  std::vector<byte> buffer(size);
+  size_t count = core.read_memory(address, buffer.data(), size);
+  hex_dump(address, buffer.data(), count);
+  if (count < size) {
+    std::cout << "only " << count << " of " << size << " bytes are mapped" << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief elf [--format=text|jsonl|binary] [--fields=list] [--jobs=N] <file|dir>...
+ *
+ * The record formats are produced by one RecordWriter per worker thread, all
+ * sharing stdout through a lock that is taken once per flushed buffer.
+ */
+int dump(const Arguments &args)
+{
+  auto format = args.get("format", "text");
+  if (format == "text") {
+    auto selection = Selection(args);
+    auto options = selection.parse_options(args);
+    auto cache = CacheOption(args, options);
+    auto stats = StatsOption(args);
+    for (auto &filename : args.positional) {
+      read(filename, selection, options, stats);
+    }
+    return stats.within_budget() ? 0 : 1;
+  }
+  if (format != "jsonl" && format != "binary") {
+    std::cout << "unknown format '" << format << "', expected text, jsonl or binary" << std::endl;
+    return 2;
+  }
+  FieldSet fields;
+  if (args.has("fields") && !fields.parse(args.get("fields"))) {
+    std::cout << "unknown field in '" << args.get("fields") << "'" << std::endl;
+    return 2;
+  }
+  // records never need string tables or notes, and a kind that is not
+  // selected need not be parsed either
+  ParseOptions options;
+  options.verbose = false;
+  options.section_headers = fields.has(record_kind::section) || fields.has(record_kind::symbol);
+  options.symbol_tables = fields.has(record_kind::symbol);
+  options.string_tables = false;
+  options.program_headers = fields.has(record_kind::segment);
+  options.notes = false;
+  options.symbol_filter = args.get("symbols");
+  auto cache = CacheOption(args, options);
+  auto stats = StatsOption(args);
+  auto scanner = BatchScanner(args.positional, std::strtoul(args.get("jobs", "1").c_str(), nullptr, 10), options);
+  std::mutex stdout_lock;
+  if (format == "binary") {
+    OutputBuffer header(STDOUT_FILENO, 16);
+    BinaryRecordWriter::write_stream_header(header);
+  }
+  std::vector<std::unique_ptr<OutputBuffer>> buffers;
+  std::vector<std::unique_ptr<RecordWriter>> writers;
+  for (size_t ii = 0; ii < scanner.get_thread_count(); ii++) {
+    buffers.push_back(std::make_unique<OutputBuffer>(STDOUT_FILENO, 1 << 20, &stdout_lock));
+    if (format == "jsonl") {
+      writers.push_back(std::make_unique<JsonLinesWriter>(*buffers.back(), fields));
+    } else {
+      writers.push_back(std::make_unique<BinaryRecordWriter>(*buffers.back(), fields));
+    }
+  }
+  scanner.run([&writers](size_t worker, size_t file_id, const std::string &path, const ElfReader &elf) {
+    writers[worker]->write(elf, path, file_id);
+  });
+  stats.add(scanner);
+  return stats.within_budget() ? 0 : 1;
+}
+
+/**
+ * @brief elf columnar <directory> [--jobs=N] [--row-group=N] <file|dir>...
+ */
+int columnar(const Arguments &args)
+{
+  if (args.positional.size() < 2) {
+    std::cout << "columnar requires an output directory and files to export" << std::endl;
+    return 2;
+  }
+  auto directory = args.positional[0];
+  std::vector<std::string> paths(args.positional.begin() + 1, args.positional.end());
+  ParseOptions options;
+  options.verbose = false;
+  options.string_tables = false;
+  options.notes = false;
+  auto cache = CacheOption(args, options);
+  auto stats = StatsOption(args);
+  auto scanner = BatchScanner(paths, std::strtoul(args.get("jobs", "1").c_str(), nullptr, 10), options);
+  auto exporter = ColumnarExport(directory, std::strtoul(args.get("row-group", "65536").c_str(), nullptr, 10));
+  if (!exporter.is_open()) {
+    std::cout << "unable to create the export in '" << directory << "'" << std::endl;
+    return 1;
+  }
+  scanner.run([&exporter](size_t, size_t file_id, const std::string &path, const ElfReader &elf) {
+    exporter.add(file_id, path, elf);
+  });
+  stats.add(scanner);
+  exporter.close();
+  std::cout << "exported " << scanner.get_files().size() - scanner.get_skipped_count() << " files, skipped " << scanner.get_skipped_count() << std::endl;
+  return stats.within_budget() ? 0 : 1;
+}
+
+/**
+ * @brief elf diff [--ignore-addresses] <before> <after>
+ *
+ * Exits with 1 when the files differ, like diff(1).
+ */
+int diff(const Arguments &args)
+{
+  if (args.positional.size() != 2) {
+    std::cout << "diff requires two files" << std::endl;
+    return 2;
+  }
+  ParseOptions options;
+  options.verbose = false;
+  options.string_tables = false;
+  options.notes = false;
+  auto before = ElfReader(args.positional[0], options);
+  auto after = ElfReader(args.positional[1], options);
+  for (auto &elf : { &before, &after }) {
+    if (!elf->is_valid()) {
+      std::cout << invalid_file(elf == &before ? args.positional[0] : args.positional[1], *elf) << std::endl;
+      return 2;
+    }
+  }
+  DiffOptions diff_options;
+  diff_options.ignore_addresses = args.has("ignore-addresses");
+  auto result = ElfDiff(before, after, diff_options);
+  OutputBuffer out(STDOUT_FILENO);
+  write_text(out, result);
+  return result.empty() ? 0 : 1;
+}
+
+/**
+ * @brief elf size [--source=sections|segments|symbols|units] [--limit=N]
+ *                 [--max-file-size=N] [--max-vm-size=N] <file>...
+ *
+ * Exits with 1 when a file is over one of the limits, for gating builds.
+ */
+int size(const Arguments &args)
+{
+  auto name = args.get("source", "sections");
+  size_source source;
+  if (name == "sections") {
+    source = size_source::sections;
+  } else if (name == "segments") {
+    source = size_source::segments;
+  } else if (name == "symbols") {
+    source = size_source::symbols;
+  } else if (name == "units") {
+    source = size_source::compile_units;
+  } else {
+    std::cout << "unknown source '" << name << "', expected sections, segments, symbols or units" << std::endl;
+    return 2;
+  }
+  ParseOptions options;
+  options.verbose = false;
+  options.symbol_tables = source == size_source::symbols || source == size_source::compile_units;
+  options.string_tables = false;
+  options.notes = false;
+  size_t limit = std::strtoull(args.get("limit", "20").c_str(), nullptr, 10);
+  uint64_t max_file_size = std::strtoull(args.get("max-file-size", "0").c_str(), nullptr, 0);
+  uint64_t max_vm_size = std::strtoull(args.get("max-vm-size", "0").c_str(), nullptr, 0);
+  int result = 0;
+  OutputBuffer out(STDOUT_FILENO);
+  for (auto &filename : args.positional) {
+    auto elf = ElfReader(filename, options);
+    if (!elf.is_valid()) {
+      out.put(invalid_file(filename, elf)).put('\n');
+      result = 2;
+      continue;
+    }
+    auto report = SizeReport(elf, source);
+    out.put(filename).put(" by ").put(size_source_to_string(source)).put('\n');
+    write_text(out, report, limit);
+    if (max_file_size != 0 && report.file_total > max_file_size) {
+      out.put("file size ").dec(report.file_total).put(" is over the limit of ").dec(max_file_size).put('\n');
+      result = std::max(result, 1);
+    }
+    if (max_vm_size != 0 && report.vm_total > max_vm_size) {
+      out.put("vm size ").dec(report.vm_total).put(" is over the limit of ").dec(max_vm_size).put('\n');
+      result = std::max(result, 1);
+    }
+    out.put('\n');
+  }
+  return result;
+}
+
+/**
+ * @brief elf icf [--jobs=N] [--limit=N] [--min-size=N] <file>...
+ */
+int icf(const Arguments &args)
+{
+  ParseOptions options;
+  options.verbose = false;
+  options.string_tables = false;
+  options.notes = false;
+  IdenticalCodeOptions code_options;
+  code_options.threads = std::strtoul(args.get("jobs", "1").c_str(), nullptr, 10);
+  code_options.min_size = std::strtoull(args.get("min-size", "16").c_str(), nullptr, 0);
+  size_t limit = std::strtoull(args.get("limit", "20").c_str(), nullptr, 10);
+  int result = 0;
+  OutputBuffer out(STDOUT_FILENO);
+  for (auto &filename : args.positional) {
+    auto elf = ElfReader(filename, options);
+    if (!elf.is_valid()) {
+      out.put(invalid_file(filename, elf)).put('\n');
+      result = 2;
+      continue;
+    }
+    out.put(filename).put('\n');
+    write_text(out, IdenticalCode(elf, code_options), limit);
+    out.put('\n');
+  }
+  return result;
+}
+
+bool has_elf_magic(const std::string &path)
+{
+  char magic[4] = {};
+  std::ifstream file(path, std::ios::binary);
+  file.read(magic, sizeof(magic));
+  return file && std::memcmp(magic, "\x7f" "ELF", 4) == 0;
+}
+
+/**
+ * @brief Files below the roots that are not in the index as they are on disk
+ *
+ * Only stats the files, the index has the size and mtime each was indexed
+ * with.  Indexed files under a root that no longer exist come back removed.
+ */
+std::vector<watch_event> stale_files(const SymbolIndexReader &reader, const std::vector<std::string> &roots)
+{
+  namespace fs = std::filesystem;
+  std::vector<watch_event> stale;
+  std::set<std::string> seen;
+  for (auto &root : roots) {
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied, ec); it != fs::recursive_directory_iterator(); it.increment(ec)) {
+      if (ec) break;
+      if (!it->is_regular_file(ec) || it->is_symlink(ec)) continue;
+      auto path = it->path().string();
+      seen.insert(path);
+      struct stat st;
+      if (::stat(path.c_str(), &st) != 0) continue;
+      uint64_t mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000 + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+      auto indexed = reader.get_file(path);
+      if (indexed && indexed->size == static_cast<uint64_t>(st.st_size) && indexed->mtime == mtime) continue;
+      // files that are not ELF are never indexed, don't parse them on every start
+      if (!indexed && !has_elf_magic(path)) continue;
+      stale.push_back({ path, false, false });
+    }
+  }
+  for (auto &file : reader.get_files()) {
+    std::string path(file.path);
+    if (seen.count(path) != 0) continue;
+    for (auto &root : roots) {
+      if (path.compare(0, root.size() + 1, root + "/") == 0) {
+        stale.push_back({ path, true, false });
+        break;
+      }
+    }
+  }
+  return stale;
+}
+
+/**
+ * @brief Bring the index up to date with one batch of changes
+ *
+ * Changed files are parsed again, files that are gone or no longer ELF are
+ * removed.  Everything goes into one new segment, which is then merged with
+ * the other recent ones.
+ *
+ * @return files indexed, files removed and the segments left
+ */
+std::tuple<size_t, size_t, size_t> update_index(SymbolIndexWriter &writer, const std::string &directory, const std::vector<watch_event> &batch, size_t jobs, const ParseOptions &options)
+{
+  auto reader = SymbolIndexReader(directory);
+  std::vector<std::string> changed;
+  std::vector<std::string> directories;
+  std::set<std::string> candidates;
+  for (auto &event : batch) {
+    if (event.directory) {
+      directories.push_back(event.path + "/");
+    } else {
+      candidates.insert(event.path);
+      if (!event.removed) changed.push_back(event.path);
+    }
+  }
+  // everything indexed below a removed directory
+  if (!directories.empty()) {
+    for (auto &file : reader.get_files()) {
+      for (auto &prefix : directories) {
+        if (file.path.compare(0, prefix.size(), prefix) == 0) candidates.insert(std::string(file.path));
+      }
+    }
+  }
+
+  std::mutex lock;
+  std::set<std::string> added;
+  auto scanner = BatchScanner(changed, jobs, options);
+  scanner.run([&](size_t, size_t, const std::string &path, const ElfReader &elf) {
+    writer.add(path, elf);
+    std::lock_guard<std::mutex> guard(lock);
+    added.insert(path);
+  });
+  size_t removed = 0;
+  for (auto &path : candidates) {
+    if (added.count(path) != 0 || !reader.get_file(path)) continue;
+    writer.remove(path);
+    removed++;
+  }
+  auto segments = writer.compact();
+  return { added.size(), removed, segments };
+}
+
+DirectoryWatcher *running_watcher = nullptr;
+
+void stop_watcher(int)
+{
+  if (running_watcher != nullptr) running_watcher->stop();
+}
+
+/**
+ * @brief elf index watch <directory> [--jobs=N] [--debounce=ms] [--batch=N] <dir>...
+ *
+ * Keeps the index of the directories current until SIGINT or SIGTERM.  On
+ * start the files changed since the index was written are found by size and
+ * mtime, from then on inotify reports them.  Each batch of changes is
+ * appended to the index as a new segment and the segments are compacted.
+ */
+int watch_index(const Arguments &args)
+{
+  auto directory = args.positional[1];
+  std::vector<std::string> roots;
+  for (size_t ii = 2; ii < args.positional.size(); ii++) {
+    roots.push_back(std::filesystem::absolute(args.positional[ii]).lexically_normal().string());
+    while (roots.back().size() > 1 && roots.back().back() == '/')
+      roots.back().pop_back();
+  }
+  auto jobs = std::strtoul(args.get("jobs", "1").c_str(), nullptr, 10);
+  auto debounce = std::chrono::milliseconds(std::strtoul(args.get("debounce", "200").c_str(), nullptr, 10));
+  auto batch_limit = std::max(1ul, std::strtoul(args.get("batch", "4096").c_str(), nullptr, 10));
+  ParseOptions options;
+  options.verbose = false;
+  options.dynamic_symbols = true;
+  options.string_tables = false;
+  options.program_headers = false;
+  options.notes = false;
+  auto cache = CacheOption(args, options);
+
+  // watch first, so nothing written while catching up is missed
+  DirectoryWatcher watcher(roots);
+  if (!watcher.is_open()) {
+    std::cout << "unable to watch the directories" << std::endl;
+    return 1;
+  }
+  auto writer = SymbolIndexWriter(directory, std::strtoul(args.get("segment-files", "65536").c_str(), nullptr, 10), true);
+  if (!writer.is_open()) {
+    std::cout << "unable to open the index in '" << directory << "'" << std::endl;
+    return 1;
+  }
+  running_watcher = &watcher;
+  std::signal(SIGINT, stop_watcher);
+  std::signal(SIGTERM, stop_watcher);
+
+  auto batch = stale_files(SymbolIndexReader(directory), roots);
+  std::cout << "watching " << watcher.get_watch_count() << " directories" << std::endl;
+  for (;;) {
+    if (!batch.empty()) {
+      auto start = std::chrono::steady_clock::now();
+      auto [indexed, removed, segments] = update_index(writer, directory, batch, jobs, options);
+      double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << batch.size() << " changes, indexed " << indexed << " files, removed " << removed << " in " << elapsed << "s, " << segments << " segments" << std::endl;
+      if (!writer.is_open()) {
+        std::cout << "unable to write the index in '" << directory << "'" << std::endl;
+        break;
+      }
+    }
+    batch = watcher.wait(debounce, batch_limit);
+    if (watcher.is_overflowed()) {
+      // events were lost, find the changes the slow way, and watch the
+      // directories that were created meanwhile before listing them
+      auto added = watcher.rescan();
+      std::cout << "event queue overflowed, rescanning, " << added << " new directories" << std::endl;
+      batch = stale_files(SymbolIndexReader(directory), roots);
+      continue;
+    }
+    if (batch.empty()) break;
+  }
+  running_watcher = nullptr;
+  return writer.is_open() ? 0 : 1;
+}
+
+/**
+ * @brief elf index build <directory> [--jobs=N] [--segment-files=N] <file|dir>...
+ *        elf index query <directory> [--defined|--undefined] [--file=path] <symbol>...
+ *        elf index watch <directory> [--jobs=N] [--debounce=ms] [--batch=N] <dir>...
+ *
+ * A query exits with 1 when none of the symbols were found, like grep(1).
+ */
+int symbol_index(const Arguments &args)
+{
+  if (args.positional.size() < 3 || (args.positional[0] != "build" && args.positional[0] != "query" && args.positional[0] != "watch")) {
+    std::cout << "index requires build, query or watch, a directory and files or symbols" << std::endl;
+    return 2;
+  }
+  if (args.positional[0] == "watch") return watch_index(args);
+  auto directory = args.positional[1];
+  std::vector<std::string> rest(args.positional.begin() + 2, args.positional.end());
+  if (args.positional[0] == "build") {
+    ParseOptions options;
+    options.verbose = false;
+    options.dynamic_symbols = true;
+    options.string_tables = false;
+    options.program_headers = false;
+    options.notes = false;
+    auto cache = CacheOption(args, options);
+    auto stats = StatsOption(args);
+    auto scanner = BatchScanner(rest, std::strtoul(args.get("jobs", "1").c_str(), nullptr, 10), options);
+    auto writer = SymbolIndexWriter(directory, std::strtoul(args.get("segment-files", "65536").c_str(), nullptr, 10));
+    if (!writer.is_open()) {
+      std::cout << "unable to create the index in '" << directory << "'" << std::endl;
+      return 1;
+    }
+    scanner.run([&writer](size_t, size_t, const std::string &path, const ElfReader &elf) {
+      writer.add(std::filesystem::absolute(path).lexically_normal().string(), elf);
+    });
+    stats.add(scanner);
+    writer.close();
+    if (!writer.is_open()) {
+      std::cout << "unable to write the index in '" << directory << "'" << std::endl;
+      return 1;
+    }
+    std::cout << "indexed " << scanner.get_files().size() - scanner.get_skipped_count() << " files, skipped " << scanner.get_skipped_count() << ", " << writer.get_posting_count() << " postings in " << writer.get_segment_count() << " segments" << std::endl;
+    return stats.within_budget() ? 0 : 1;
+  }
+
+  auto reader = SymbolIndexReader(directory);
+  if (!reader.is_open()) {
+    std::cout << "no index in '" << directory << "'" << std::endl;
+    return 2;
+  }
+  bool defined_only = args.has("defined");
+  bool undefined_only = args.has("undefined");
+  std::string file;
+  if (args.has("file")) file = std::filesystem::absolute(args.get("file")).lexically_normal().string();
+  int result = 1;
+  OutputBuffer out(STDOUT_FILENO);
+  for (auto &symbol : rest) {
+    // the bloom filter rules most files out without a lookup
+    if (!file.empty() && !reader.may_contain(file, symbol)) continue;
+    for (auto &hit : reader.find(symbol)) {
+      if ((defined_only && !hit.defined) || (undefined_only && hit.defined)) continue;
+      if (!file.empty() && hit.path != file) continue;
+      out.put(symbol).put('\t').put(hit.path).put('\t').put(hit.defined ? "defined" : "undefined");
+      out.put('\t').put(elf_sym_binding_to_string(hit.binding)).put('\t').put(elf_sym_type_to_string(hit.type)).put('\n');
+      result = 0;
+    }
+  }
+  return result;
+}
+
+void write_query_symbol(OutputBuffer &out, const ElfQuery &query, const symbol_view &sym)
+{
+  out.put(sym.name).put(" 0x").hex(sym.value).put(" size ").dec(sym.size).put(' ');
+  out.put(elf_sym_type_to_string(ELF64_ST_TYPE(sym.info))).put(' ').put(elf_sym_binding_to_string(ELF64_ST_BIND(sym.info)));
+  if (sym.shndx == SHN_UNDEF) {
+    out.put(" undefined");
+  } else if (sym.shndx == SHN_ABS) {
+    out.put(" absolute");
+  } else if (sym.shndx < query.section_count()) {
+    out.put(" in ").put(query.section(sym.shndx).name);
+  }
+  out.put('\n');
+}
+
+/**
+ * @brief elf snapshot write <file> <snapshot>
+ *        elf snapshot query <file|snapshot> [--symbol=name]... [--address=N]...
+ *
+ * A query answers the same from the ELF file or from its snapshot.
+ */
+int snapshot(const Arguments &args)
+{
+  if (args.positional.size() < 2 || (args.positional[0] != "write" && args.positional[0] != "query")) {
+    std::cout << "snapshot requires write or query and a file" << std::endl;
+    return 2;
+  }
+  if (args.positional[0] == "write" && args.positional.size() != 3) {
+    std::cout << "snapshot write requires a file and the snapshot to write" << std::endl;
+    return 2;
+  }
+  if (args.positional[0] == "query" && args.positional.size() != 2) {
+    std::cout << "snapshot query requires a file, the lookups are --symbol=name and --address=N" << std::endl;
+    return 2;
+  }
+  ParseOptions options;
+  options.verbose = false;
+  options.dynamic_symbols = true;
+  options.string_tables = false;
+  options.notes = false;
+  auto &filename = args.positional[1];
+  auto snapshot = std::make_unique<ElfSnapshot>(filename);
+  std::unique_ptr<ElfReader> elf;
+  std::unique_ptr<ElfIndex> index;
+  const ElfQuery *query = snapshot.get();
+  if (!snapshot->is_open()) {
+    elf = std::make_unique<ElfReader>(filename, options);
+    if (!elf->is_valid()) {
+      std::cout << invalid_file(filename, *elf) << ", and not a snapshot" << std::endl;
+      return 2;
+    }
+    index = std::make_unique<ElfIndex>(*elf);
+    query = index.get();
+  }
+
+  if (args.positional[0] == "write") {
+    if (!write_snapshot(*query, args.positional[2])) {
+      std::cout << "unable to write '" << args.positional[2] << "'" << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  int result = 0;
+  OutputBuffer out(STDOUT_FILENO);
+  for (auto &o : args.options) {
+    if (o.first == "symbol") {
+      auto found = query->find_symbol(o.second);
+      if (found.empty()) {
+        out.put(o.second).put(" not found\n");
+        result = 1;
+      }
+      for (auto &sym : found) {
+        write_query_symbol(out, *query, sym);
+      }
+    } else if (o.first == "address") {
+      ELF_ULONG address = std::strtoull(o.second.c_str(), nullptr, 0);
+      out.put("0x").hex(address);
+      auto segment = query->segment_for_address(address);
+      auto section = query->section_for_address(address);
+      auto sym = query->symbol_for_address(address);
+      if (!segment && !section && !sym) {
+        out.put(" is not mapped\n");
+        result = 1;
+        continue;
+      }
+      if (segment) out.put(" segment 0x").hex(segment->p_vaddr).put("-0x").hex(segment->p_vaddr + segment->p_memsz);
+      if (section) out.put(" section ").put(section->name);
+      if (sym) out.put(" symbol ").put(sym->name).put("+0x").hex(address - sym->value);
+      out.put('\n');
+    }
+  }
+  return result;
+}
+
+SymbolServer *running_server = nullptr;
+
+void stop_server(int)
+{
+  if (running_server != nullptr) running_server->stop();
+}
+
+/**
+ * @brief elf serve <socket> [--jobs=N] [--cache-entries=N] [--memory=MB]
+ *
+ * Serves until SIGINT or SIGTERM.
+ */
+int serve(const Arguments &args)
+{
+  if (args.positional.size() != 1) {
+    std::cout << "serve requires a socket path" << std::endl;
+    return 2;
+  }
+  ParseOptions options;
+  options.verbose = false;
+  options.dynamic_symbols = true;
+  options.string_tables = false;
+  options.notes = false;
+  auto jobs = std::strtoul(args.get("jobs", std::to_string(std::max(1u, std::thread::hardware_concurrency()))).c_str(), nullptr, 10);
+  auto entries = std::strtoul(args.get("cache-entries", "256").c_str(), nullptr, 10);
+  auto memory = std::strtoull(args.get("memory", "1024").c_str(), nullptr, 10) << 20;
+  ReaderCache cache(entries, memory, options);
+  SymbolServer server(args.positional[0], cache, jobs);
+  if (!server.is_open()) {
+    std::cout << "unable to listen on '" << args.positional[0] << "'" << std::endl;
+    return 1;
+  }
+  running_server = &server;
+  std::signal(SIGINT, stop_server);
+  std::signal(SIGTERM, stop_server);
+  server.run();
+  running_server = nullptr;
+  auto stats = cache.get_stats();
+  std::cerr << "hits " << stats.hits << ", misses " << stats.misses << ", evictions " << stats.evictions << std::endl;
+  return 0;
+}
+
+/**
+ * @brief elf client <socket> [--connections=N] [--repeat=N] [<request>...]
+ *
+ * Sends each request, or each line of stdin when none are given, and prints
+ * the responses.  With --repeat it is a load generator instead: every
+ * connection sends the requests round robin until it has sent N, and the
+ * throughput and latency are printed.
+ */
+int client(const Arguments &args)
+{
+  if (args.positional.empty()) {
+    std::cout << "client requires a socket path" << std::endl;
+    return 2;
+  }
+  auto socket_path = args.positional[0];
+  std::vector<std::string> requests(args.positional.begin() + 1, args.positional.end());
+  if (requests.empty()) {
+    std::string line;
+    while (std::getline(std::cin, line)) {
+      if (!line.empty()) requests.push_back(line);
+    }
+  }
+
+  if (!args.has("repeat")) {
+    SymbolClient connection(socket_path);
+    if (!connection.is_open()) {
+      std::cout << "unable to connect to '" << socket_path << "'" << std::endl;
+      return 1;
+    }
+    int result = 0;
+    std::string response;
+    for (auto &request : requests) {
+      if (!connection.request(request, response)) {
+        std::cout << "connection closed" << std::endl;
+        return 1;
+      }
+      if (response.compare(0, 2, "ok") != 0) result = 1;
+      std::cout << response << '\n';
+    }
+    return result;
+  }
+
+  if (requests.empty()) return 0;
+  auto connections = std::max(1ul, std::strtoul(args.get("connections", "1").c_str(), nullptr, 10));
+  auto repeat = std::strtoul(args.get("repeat").c_str(), nullptr, 10);
+  std::vector<std::vector<uint64_t>> latencies(connections);
+  std::atomic<uint64_t> errors{ 0 };
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> pool;
+  for (size_t ii = 0; ii < connections; ii++) {
+    pool.emplace_back([&, ii]() {
+      SymbolClient connection(socket_path);
+      if (!connection.is_open()) {
+        errors += repeat;
+        return;
+      }
+      auto &times = latencies[ii];
+      times.reserve(repeat);
+      std::string response;
+      for (size_t jj = 0; jj < repeat; jj++) {
+        auto before = std::chrono::steady_clock::now();
+        if (!connection.request(requests[(ii + jj) % requests.size()], response)) {
+          errors += repeat - jj;
+          return;
+        }
+        times.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - before).count());
+        if (response.compare(0, 2, "ok") != 0) errors++;
+      }
+    });
+  }
+  for (auto &t : pool) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::vector<uint64_t> all;
+  for (auto &times : latencies) {
+    all.insert(all.end(), times.begin(), times.end());
+  }
+  std::sort(all.begin(), all.end());
+  auto percentile = [&all](double p) { return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))] / 1000.0; };
+  std::cout << all.size() << " requests in " << elapsed << "s, " << static_cast<uint64_t>(all.size() / elapsed) << " requests/s, p50 " << percentile(0.5) << "us, p99 " << percentile(0.99) << "us, " << errors << " errors" << std::endl;
+  return errors == 0 ? 0 : 1;
+}
+
+/**
+ * @brief elf stress <file> [--threads=N] [--queries=N]
+ *
+ * Queries one FrozenElfReader from N threads at once, starting before any of
+ * its orders are built so the threads race to publish them.  Every answer is
+ * checked against a single threaded ElfIndex, it exits with 1 on a mismatch.
+ */
+int stress(const Arguments &args)
+{
+  if (args.positional.size() != 1) {
+    std::cout << "stress requires a file" << std::endl;
+    return 2;
+  }
+  ParseOptions options;
+  options.verbose = false;
+  options.dynamic_symbols = true;
+  options.string_tables = false;
+  options.notes = false;
+  auto threads = std::max(1ul, std::strtoul(args.get("threads", std::to_string(std::max(1u, std::thread::hardware_concurrency()))).c_str(), nullptr, 10));
+  auto queries = std::strtoul(args.get("queries", "1000000").c_str(), nullptr, 10);
+
+  auto start = std::chrono::steady_clock::now();
+  const FrozenElfReader shared(args.positional[0], options);
+  double parse_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  if (!shared.get_reader().is_valid()) {
+    std::cout << invalid_file(args.positional[0], shared.get_reader()) << std::endl;
+    return 1;
+  }
+
+  // the expected answers, from the same parse through the eager index
+  ElfIndex expected(shared.get_reader());
+  std::vector<std::string_view> names;
+  std::vector<ELF_ULONG> addresses;
+  for (size_t ii = 0; ii < expected.symbol_count() && names.size() < 4096; ii += 1 + expected.symbol_count() / 4096) {
+    auto sym = expected.symbol(ii);
+    if (!sym.name.empty()) names.push_back(sym.name);
+    addresses.push_back(sym.value + sym.size / 2);
+  }
+  if (names.empty()) names.push_back("");
+  if (addresses.empty()) addresses.push_back(0);
+  std::vector<size_t> name_answers;
+  std::vector<std::pair<ELF_ULONG, ELF_ULONG>> address_answers;
+  for (auto name : names) {
+    name_answers.push_back(expected.find_symbol(name).size());
+  }
+  for (auto address : addresses) {
+    auto sym = expected.symbol_for_address(address);
+    auto section = expected.section_for_address(address);
+    address_answers.emplace_back(sym ? sym->index : ~ELF_ULONG{ 0 }, section ? section->index : ~ELF_ULONG{ 0 });
+  }
+
+  std::atomic<bool> go{ false };
+  std::atomic<uint64_t> mismatches{ 0 };
+  std::vector<std::thread> pool;
+  for (size_t ii = 0; ii < threads; ii++) {
+    pool.emplace_back([&, ii]() {
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      uint64_t wrong = 0;
+      for (size_t jj = ii; jj < queries; jj += threads) {
+        if (jj % 2 == 0) {
+          auto kk = (jj / 2) % names.size();
+          if (shared.find_symbol(names[kk]).size() != name_answers[kk]) wrong++;
+        } else {
+          auto kk = (jj / 2) % addresses.size();
+          auto sym = shared.symbol_for_address(addresses[kk]);
+          auto section = shared.section_for_address(addresses[kk]);
+          std::pair<ELF_ULONG, ELF_ULONG> answer(sym ? sym->index : ~ELF_ULONG{ 0 }, section ? section->index : ~ELF_ULONG{ 0 });
+          if (answer != address_answers[kk]) wrong++;
+        }
+      }
+      mismatches += wrong;
+    });
+  }
+  start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &t : pool) {
+    t.join();
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "parsed in " << parse_time << "s, " << shared.symbol_count() << " symbols" << std::endl;
+  std::cout << queries << " queries on " << threads << " threads in " << elapsed << "s, " << static_cast<uint64_t>(queries / elapsed) << " queries/s" << std::endl;
+  std::cout << shared.get_discarded_count() << " orders built and discarded after a race, " << mismatches << " mismatches" << std::endl;
+  return mismatches == 0 ? 0 : 1;
+}
+
+/**
+ * @brief elf generate <file> [--class=32|64] [--msb] [--sections=N] [--symbols=N]
+ *        [--relocations=N] [--segments=N] [--name-length=N] [--seed=N]
+ */
+int generate(const Arguments &args)
+{
+  if (args.positional.size() != 1) {
+    std::cout << "generate requires the file to write" << std::endl;
+    return 2;
+  }
+  auto number = [&args](const std::string &name, uint64_t fallback) { return std::strtoull(args.get(name, std::to_string(fallback)).c_str(), nullptr, 10); };
+  generator_options options;
+  options.is64 = args.get("class", "64") != "32";
+  options.msb = args.has("msb");
+  options.sections = number("sections", options.sections);
+  options.symbols = number("symbols", options.symbols);
+  options.relocations = number("relocations", options.relocations);
+  options.segments = number("segments", options.segments);
+  options.name_length = number("name-length", options.name_length);
+  options.seed = number("seed", options.seed);
+
+  auto start = std::chrono::steady_clock::now();
+  if (!write_generated_elf(args.positional[0], options)) {
+    std::cout << "unable to write " << args.positional[0] << std::endl;
+    return 1;
+  }
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  auto layout = plan_elf(options);
+  std::cout << "wrote " << layout.file_size << " bytes in " << elapsed << "s, " << layout.section_count << " sections" << (layout.extended ? " (extended numbering), " : ", ") << options.symbols << " symbols, " << layout.string_table_size << " bytes of symbol names" << std::endl;
+  return 0;
+}
+
+/**
+ * @brief Options for opening a file only to write it again, section headers
+ *        and segments without the tables
+ */
+ParseOptions rewrite_options()
+{
+  ParseOptions options;
+  options.verbose = false;
+  options.symbol_tables = false;
+  options.string_tables = false;
+  options.notes = false;
+  return options;
+}
+
+/**
+ * @brief Write a model and read the file back to check it is the model
+ */
+bool write_checked(ElfWriter &writer, const std::string &filename)
+{
+  if (!writer.write(filename)) {
+    std::cout << writer.get_error() << std::endl;
+    return false;
+  }
+  auto written = ElfReader::open(filename, rewrite_options());
+  std::string error;
+  if (!written) {
+    error = elf_error_to_string(written.error().error);
+  } else if (matches_model(*written, writer.get_model(), error)) {
+    return true;
+  }
+  std::cout << filename << ": " << error << std::endl;
+  return false;
+}
+
+/**
+ * @brief elf rewrite <file> <out> [--class=32|64] [--msb|--lsb]
+ *
+ * Writes the file again through ElfWriter, in another class or byte order
+ * when asked, and checks the output parses.
+ */
+int rewrite(const Arguments &args)
+{
+  if (args.positional.size() != 2) {
+    std::cout << "rewrite requires the file to read and the file to write" << std::endl;
+    return 2;
+  }
+  auto elf = ElfReader::open(args.positional[0], rewrite_options());
+  if (!elf) {
+    std::cout << args.positional[0] << ": " << elf_error_to_string(elf.error().error) << std::endl;
+    return 1;
+  }
+  bool is64 = args.has("class") ? args.get("class") != "32" : elf->is_64bit();
+  bool msb = args.has("msb") || (!args.has("lsb") && elf->get_data_encoding() == ELFDATA2MSB);
+
+  auto start = std::chrono::steady_clock::now();
+  elf_model model;
+  std::string error;
+  if (!model_of(*elf, is64, msb, model, error)) {
+    std::cout << args.positional[0] << ": " << error << std::endl;
+    return 1;
+  }
+  ElfWriter writer(std::move(model), *elf);
+  if (!write_checked(writer, args.positional[1])) return 1;
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "wrote " << writer.get_file_size() << " bytes in " << elapsed << "s, " << writer.get_copied_bytes() << " copied by the kernel" << std::endl;
+  return 0;
+}
+
+/**
+ * @brief elf strip <file> <out> [--all] [--debug-file=<file>]
+ *
+ * Removes the debug sections, and with --all the symbol table too.
+ * --debug-file first writes the debug sections to a file of their own and
+ * the output then names it in .gnu_debuglink.  Both files are read back.
+ */
+int strip(const Arguments &args)
+{
+  if (args.positional.size() != 2) {
+    std::cout << "strip requires the file to read and the file to write" << std::endl;
+    return 2;
+  }
+  auto elf = ElfReader::open(args.positional[0], rewrite_options());
+  if (!elf) {
+    std::cout << args.positional[0] << ": " << elf_error_to_string(elf.error().error) << std::endl;
+    return 1;
+  }
+  auto start = std::chrono::steady_clock::now();
+  elf_model model;
+  std::string error;
+  if (!model_of(*elf, elf->is_64bit(), elf->get_data_encoding() == ELFDATA2MSB, model, error)) {
+    std::cout << args.positional[0] << ": " << error << std::endl;
+    return 1;
+  }
+
+  auto debug_file = args.get("debug-file");
+  if (!debug_file.empty()) {
+    elf_model debug = model;
+    keep_only_debug(debug);
+    ElfWriter writer(std::move(debug), *elf);
+    if (!write_checked(writer, debug_file)) return 1;
+    MappedFile written(debug_file);
+    if (!written.is_open()) {
+      std::cout << "unable to read " << debug_file << std::endl;
+      return 1;
+    }
+    add_debuglink(model, debug_file, crc32(written.data(), written.size()));
+    std::cout << "wrote " << writer.get_file_size() << " bytes of debug information to " << debug_file << ", " << writer.get_copied_bytes() << " copied by the kernel" << std::endl;
+  }
+
+  std::vector<bool> remove(model.sections.size(), false);
+  for (size_t ii = 1; ii < model.sections.size(); ii++) {
+    auto &h = model.sections[ii].header;
+    if (is_debug_section(h)) remove[ii] = true;
+    if (args.has("all") && h.sh_type == SHT_SYMTAB) {
+      remove[ii] = true;
+      if (h.sh_link < remove.size() && model.sections[h.sh_link].contents != SC_NAMES) remove[h.sh_link] = true;
+    }
+  }
+  size_t before = model.sections.size();
+  if (!remove_sections(model, *elf, remove, error)) {
+    std::cout << args.positional[0] << ": " << error << std::endl;
+    return 1;
+  }
+  size_t removed = before - model.sections.size();
+  ElfWriter writer(std::move(model), *elf);
+  if (!write_checked(writer, args.positional[1])) return 1;
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "wrote " << writer.get_file_size() << " bytes in " << elapsed << "s, " << removed << " sections removed, " << writer.get_copied_bytes() << " copied by the kernel" << std::endl;
+  return 0;
+}
+
+/**
+ * @brief elf extract-section <file> <section> <out>
+ */
+int extract(const Arguments &args)
+{
+  if (args.positional.size() != 3) {
+    std::cout << "extract-section requires the file, the section name and the file to write" << std::endl;
+    return 2;
+  }
+  auto elf = ElfReader::open(args.positional[0], rewrite_options());
+  if (!elf) {
+    std::cout << args.positional[0] << ": " << elf_error_to_string(elf.error().error) << std::endl;
+    return 1;
+  }
+  auto section = std::find_if(elf->section_headers.begin(), elf->section_headers.end(), [&args](const Elf_Shdr &sh) { return sh.name == args.positional[1]; });
+  if (section == elf->section_headers.end()) {
+    std::cout << args.positional[0] << ": no section named " << args.positional[1] << std::endl;
+    return 1;
+  }
+  uint64_t copied = 0;
+  std::string error;
+  if (!extract_section(*elf, *section, args.positional[2], copied, error)) {
+    std::cout << error << std::endl;
+    return 1;
+  }
+  std::error_code failed;
+  if (std::filesystem::file_size(args.positional[2], failed) != section->sh_size) {
+    std::cout << args.positional[2] << ": not the size of " << section->name << std::endl;
+    return 1;
+  }
+  std::cout << "wrote " << section->sh_size << " bytes, " << copied << " copied by the kernel" << std::endl;
+  return 0;
+}
+
+/**
+ * @brief elf edit <file> <edit>...
+ *
+ * Each edit is <field>=<value> for the ELF header, <section>:<field>=<value>,
+ * <segment index>:<field>=<value>, <symbol>:<field>=<value> or
+ * build-id=<hex>.  The file is changed where it is, nothing else is written,
+ * and only once every edit has been checked.
+ */
+int edit(const Arguments &args)
+{
+  if (args.positional.size() < 2) {
+    std::cout << "edit requires the file and at least one <field>=<value>" << std::endl;
+    return 2;
+  }
+  auto editor = ElfEditor::open(args.positional[0]);
+  if (!editor) {
+    std::cout << args.positional[0] << ": " << elf_error_to_string(editor.error().error) << std::endl;
+    return 1;
+  }
+  auto &elf = editor->get_reader();
+  // the editor keeps every edit until sync(), one that is wrong leaves the
+  // file as it was
+  for (size_t ii = 1; ii < args.positional.size(); ii++) {
+    auto &e = args.positional[ii];
+    auto equals = e.find('=');
+    if (equals == std::string::npos) {
+      std::cout << e << ": not <field>=<value>" << std::endl;
+      return 2;
+    }
+    // section and symbol names can have colons in them, the field can't
+    auto colon = e.rfind(':', equals);
+    std::string where = colon == std::string::npos ? "" : e.substr(0, colon);
+    std::string field = e.substr(colon == std::string::npos ? 0 : colon + 1, equals - (colon == std::string::npos ? 0 : colon + 1));
+    std::string text = e.substr(equals + 1);
+    bool done = false;
+    if (where.empty() && field == "build-id") {
+      std::vector<byte> id;
+      bool hex = !text.empty() && text.size() % 2 == 0 && std::all_of(text.begin(), text.end(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)) != 0; });
+      for (size_t jj = 0; hex && jj < text.size(); jj += 2) {
+        id.push_back(static_cast<byte>(std::stoul(text.substr(jj, 2), nullptr, 16)));
+      }
+      if (!hex) {
+        std::cout << e << ": the build id is not hex" << std::endl;
+        return 2;
+      }
+      done = editor->set_note("GNU", NT_GNU_BUILD_ID, id.data(), id.size());
+    } else {
+      char *end = nullptr;
+      errno = 0;
+      uint64_t value = std::strtoull(text.c_str(), &end, 0);
+      if (text.empty() || *end != '\0' || text[0] == '-') {
+        std::cout << e << ": " << text << " is not a number" << std::endl;
+        return 2;
+      }
+      if (errno == ERANGE) {
+        std::cout << e << ": " << text << " does not fit in 64 bits" << std::endl;
+        return 2;
+      }
+      if (auto f = header_field_from_string(field); f && where.empty()) {
+        done = editor->set_header(*f, value);
+      } else if (auto f = section_field_from_string(field); f) {
+        if (where.empty()) {
+          std::cout << e << ": not <section>:" << field << "=<value>" << std::endl;
+          return 2;
+        }
+        auto section = std::find_if(elf.section_headers.begin(), elf.section_headers.end(), [&where](const Elf_Shdr &sh) { return sh.name == where; });
+        if (section == elf.section_headers.end()) {
+          std::cout << args.positional[0] << ": no section named " << where << std::endl;
+          return 1;
+        }
+        done = editor->set_section(section - elf.section_headers.begin(), *f, value);
+      } else if (auto f = segment_field_from_string(field); f) {
+        char *last = nullptr;
+        uint64_t index = std::strtoull(where.c_str(), &last, 10);
+        if (where.empty() || *last != '\0') {
+          std::cout << e << ": " << where << " is not a segment index" << std::endl;
+          return 2;
+        }
+        done = editor->set_segment(index, *f, value);
+      } else if (auto f = symbol_field_from_string(field); f) {
+        if (where.empty()) {
+          std::cout << e << ": not <symbol>:" << field << "=<value>" << std::endl;
+          return 2;
+        }
+        done = editor->set_symbol(where, *f, value);
+      } else {
+        std::cout << e << ": unknown field " << field << std::endl;
+        return 2;
+      }
+    }
+    if (!done) {
+      std::cout << e << ": " << editor->get_error() << std::endl;
+      return 1;
+    }
+  }
+  if (!editor->sync()) {
+    std::cout << args.positional[0] << ": " << editor->get_error() << std::endl;
+    return 1;
+  }
+  std::cout << editor->get_field_count() << " fields, " << editor->get_written_bytes() << " bytes written in place" << std::endl;
+  return 0;
 }
 
 int main(int argc, char* argv[])
@@ -14,6 +1364,50 @@ int main(int argc, char* argv[])
     std::cout << "requires a filename as first argument" << std::endl;
     return 2;
   }
-  read(argv[argc-1]);
-  return 0;
-}
\ No newline at end of file
+  if ( argc > 2 && strcmp(argv[1], "core") == 0 ) {
+    return core(argc - 2, argv + 2);
+  }
+  if ( argc > 2 && strcmp(argv[1], "diff") == 0 ) {
+    return diff(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "size") == 0 ) {
+    return size(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "icf") == 0 ) {
+    return icf(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "snapshot") == 0 ) {
+    return snapshot(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "index") == 0 ) {
+    return symbol_index(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "columnar") == 0 ) {
+    return columnar(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "stress") == 0 ) {
+    return stress(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "serve") == 0 ) {
+    return serve(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "client") == 0 ) {
+    return client(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "generate") == 0 ) {
+    return generate(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "rewrite") == 0 ) {
+    return rewrite(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "strip") == 0 ) {
+    return strip(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "extract-section") == 0 ) {
+    return extract(Arguments(argc - 2, argv + 2));
+  }
+  if ( argc > 2 && strcmp(argv[1], "edit") == 0 ) {
+    return edit(Arguments(argc - 2, argv + 2));
+  }
+  return dump(Arguments(argc - 1, argv + 1));
+}
@@ -1,17 +1,19 @@
 #ifndef E_SH_FLAGS_HPP
 #define E_SH_FLAGS_HPP
 
-// This file is automatically generated, do not edit.
-
-#include <string>
+// This file is automatically generated by tools/write_enums.py, do not edit.
 
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
 
 enum e_sh_flags {
-    SHF_WRITE                               = 0x1,       // DAta that is writable during execution
+    SHF_WRITE                               = 0x1,       // data that is writable during execution
     SHF_ALLOC                               = 0x2,       // this section occupies memory during execution, excludes control sections
-    SHF_EXECINSTR                           = 0x4,       // Contains executable instructions
-    SHF_MERGE                               = 0x10,      // DAta is merged in this section to avoid duplication
-    SHF_STRINGS                             = 0x20,      // Contains null terminated strings, size of each character is in sh_entsize
+    SHF_EXECINSTR                           = 0x4,       // contains executable instructions
+    SHF_MERGE                               = 0x10,      // data is merged in this section to avoid duplication
+    SHF_STRINGS                             = 0x20,      // contains null terminated strings, size of each character is in sh_entsize
     SHF_INFO_LINK                           = 0x40,      // points to the section header table index
     SHF_LINK_ORDER                          = 0x80,      // points to a section that indicates section order
     SHF_OS_NONCONFORMING                    = 0x100,     // points to specific OS processing rules
@@ -22,8 +24,86 @@ enum e_sh_flags {
     SHF_MASKPROC                            = 0xF0000000 // masks off processor specific semantics
 };
 
-std::string e_sh_flags_to_string(int64_t value);
+namespace e_sh_flags_table {
+
+struct entry
+{
+  int64_t value;
+  std::string_view name;
+};
+
+// sorted by value
+inline constexpr entry by_value[] = {
+  { 0x1, "SHF_WRITE" },
+  { 0x2, "SHF_ALLOC" },
+  { 0x4, "SHF_EXECINSTR" },
+  { 0x10, "SHF_MERGE" },
+  { 0x20, "SHF_STRINGS" },
+  { 0x40, "SHF_INFO_LINK" },
+  { 0x80, "SHF_LINK_ORDER" },
+  { 0x100, "SHF_OS_NONCONFORMING" },
+  { 0x200, "SHF_GROUP" },
+  { 0x400, "SHF_TLS" },
+  { 0x800, "SHF_COMPRESSED" },
+  { 0xFF00000, "SHF_MASKOS" },
+  { 0xF0000000, "SHF_MASKPROC" },
+};
+
+// sorted by name
+inline constexpr entry by_name[] = {
+  { 0x2, "SHF_ALLOC" },
+  { 0x800, "SHF_COMPRESSED" },
+  { 0x4, "SHF_EXECINSTR" },
+  { 0x200, "SHF_GROUP" },
+  { 0x40, "SHF_INFO_LINK" },
+  { 0x80, "SHF_LINK_ORDER" },
+  { 0xFF00000, "SHF_MASKOS" },
+  { 0xF0000000, "SHF_MASKPROC" },
+  { 0x10, "SHF_MERGE" },
+  { 0x100, "SHF_OS_NONCONFORMING" },
+  { 0x20, "SHF_STRINGS" },
+  { 0x400, "SHF_TLS" },
+  { 0x1, "SHF_WRITE" },
+};
+
+}// namespace e_sh_flags_table
 
+/**
+ * @brief Name of an enum value, "unknown" if it has none
+ */
+constexpr std::string_view e_sh_flags_to_string(int64_t value)
+{
+  size_t low = 0;
+  size_t high = sizeof(e_sh_flags_table::by_value) / sizeof(e_sh_flags_table::by_value[0]);
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (e_sh_flags_table::by_value[middle].value < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == sizeof(e_sh_flags_table::by_value) / sizeof(e_sh_flags_table::by_value[0]) || e_sh_flags_table::by_value[low].value != value) return "unknown";
+  return e_sh_flags_table::by_value[low].name;
+}
 
+/**
+ * @brief Value of an enum by name, usable in constant expressions
+ */
+constexpr std::optional<e_sh_flags> e_sh_flags_from_string(std::string_view name)
+{
+  size_t low = 0;
+  size_t high = sizeof(e_sh_flags_table::by_name) / sizeof(e_sh_flags_table::by_name[0]);
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (e_sh_flags_table::by_name[middle].name < name) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == sizeof(e_sh_flags_table::by_name) / sizeof(e_sh_flags_table::by_name[0]) || e_sh_flags_table::by_name[low].name != name) return std::nullopt;
+  return static_cast<e_sh_flags>(e_sh_flags_table::by_name[low].value);
+}
 
 #endif // end of E_SH_FLAGS_HPP
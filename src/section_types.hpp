@@ -1,9 +1,12 @@
 #ifndef E_SECTION_TYPES_HPP
 #define E_SECTION_TYPES_HPP
 
-// This file is automatically generated, do not edit.
+// This file is automatically generated by tools/write_enums.py, do not edit.
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
 
 enum e_section_types {
     SHT_NULL                                = 0,         // Description not available
@@ -31,8 +34,106 @@ enum e_section_types {
     SHT_HIUSER                              = 0xFFFFFFFF // Description not available
 };
 
-std::string e_section_types_to_string(int64_t value);
+namespace e_section_types_table {
 
+struct entry
+{
+  int64_t value;
+  std::string_view name;
+};
+
+// sorted by value
+inline constexpr entry by_value[] = {
+  { 0x0, "SHT_NULL" },
+  { 0x1, "SHT_PROGBITS" },
+  { 0x2, "SHT_SYMTAB" },
+  { 0x3, "SHT_STRTAB" },
+  { 0x4, "SHT_RELA" },
+  { 0x5, "SHT_HASH" },
+  { 0x6, "SHT_DYNAMIC" },
+  { 0x7, "SHT_NOTE" },
+  { 0x8, "SHT_NOBITS" },
+  { 0x9, "SHT_REL" },
+  { 0xA, "SHT_SHLIB" },
+  { 0xB, "SHT_DYNSYM" },
+  { 0xE, "SHT_INIT_ARRAY" },
+  { 0xF, "SHT_FINI_ARRAY" },
+  { 0x10, "SHT_PREINIT_ARRAY" },
+  { 0x11, "SHT_GROUP" },
+  { 0x12, "SHT_SYMTAB_SHNDX" },
+  { 0x60000000, "SHT_LOOS" },
+  { 0x6FFFFFFF, "SHT_HIOS" },
+  { 0x70000000, "SHT_LOPROC" },
+  { 0x7FFFFFFF, "SHT_HIPROC" },
+  { 0x80000000, "SHT_LOUSER" },
+  { 0xFFFFFFFF, "SHT_HIUSER" },
+};
+
+// sorted by name
+inline constexpr entry by_name[] = {
+  { 0x6, "SHT_DYNAMIC" },
+  { 0xB, "SHT_DYNSYM" },
+  { 0xF, "SHT_FINI_ARRAY" },
+  { 0x11, "SHT_GROUP" },
+  { 0x5, "SHT_HASH" },
+  { 0x6FFFFFFF, "SHT_HIOS" },
+  { 0x7FFFFFFF, "SHT_HIPROC" },
+  { 0xFFFFFFFF, "SHT_HIUSER" },
+  { 0xE, "SHT_INIT_ARRAY" },
+  { 0x60000000, "SHT_LOOS" },
+  { 0x70000000, "SHT_LOPROC" },
+  { 0x80000000, "SHT_LOUSER" },
+  { 0x8, "SHT_NOBITS" },
+  { 0x7, "SHT_NOTE" },
+  { 0x0, "SHT_NULL" },
+  { 0x10, "SHT_PREINIT_ARRAY" },
+  { 0x1, "SHT_PROGBITS" },
+  { 0x9, "SHT_REL" },
+  { 0x4, "SHT_RELA" },
+  { 0xA, "SHT_SHLIB" },
+  { 0x3, "SHT_STRTAB" },
+  { 0x2, "SHT_SYMTAB" },
+  { 0x12, "SHT_SYMTAB_SHNDX" },
+};
+
+}// namespace e_section_types_table
+
+/**
+ * @brief Name of an enum value, "unknown" if it has none
+ */
+constexpr std::string_view e_section_types_to_string(int64_t value)
+{
+  size_t low = 0;
+  size_t high = sizeof(e_section_types_table::by_value) / sizeof(e_section_types_table::by_value[0]);
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (e_section_types_table::by_value[middle].value < value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == sizeof(e_section_types_table::by_value) / sizeof(e_section_types_table::by_value[0]) || e_section_types_table::by_value[low].value != value) return "unknown";
+  return e_section_types_table::by_value[low].name;
+}
 
+/**
+ * @brief Value of an enum by name, usable in constant expressions
+ */
+constexpr std::optional<e_section_types> e_section_types_from_string(std::string_view name)
+{
+  size_t low = 0;
+  size_t high = sizeof(e_section_types_table::by_name) / sizeof(e_section_types_table::by_name[0]);
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (e_section_types_table::by_name[middle].name < name) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  if (low == sizeof(e_section_types_table::by_name) / sizeof(e_section_types_table::by_name[0]) || e_section_types_table::by_name[low].name != name) return std::nullopt;
+  return static_cast<e_section_types>(e_section_types_table::by_name[low].value);
+}
 
 #endif // end of E_SECTION_TYPES_HPP
@@ -0,0 +1,47 @@
+#!/bin/sh
+# A file edited in place keeps its build-id, size and section tables, the
+# cache must still not hand out what it decoded before the edit.
+#
+# cache_after_edit.sh <elf> <work dir> <file with a build-id and main>
+set -eu
+elf=$1
+work=$2
+sample=$3
+
+rm -rf "$work"
+mkdir -p "$work"
+cp "$sample" "$work/file"
+fields="--format=jsonl --fields=symbol.name,symbol.value"
+
+check() {
+  expected=$("$elf" $fields "$work/file")
+  cached=$("$elf" --cache="$work/cache" $fields "$work/file")
+  if [ "$cached" != "$expected" ]; then
+    echo "$1: the cache gave"
+    echo "$cached"
+    echo "instead of"
+    echo "$expected"
+    exit 1
+  fi
+}
+
+check "first parse"
+check "cached"
+"$elf" edit "$work/file" main:st_value=0x1234 > /dev/null
+check "edited"
+check "edited, cached again"
+
+# with the inode entry gone only the build-id name is left to find it by
+rm -f "$work"/cache/*.epc
+"$elf" edit "$work/file" main:st_value=0x5678 > /dev/null
+check "edited, only the build-id entry left"
+
+# a copy is still found by build-id
+"$elf" --cache="$work/cache" $fields "$work/file" > /dev/null
+cp "$work/file" "$work/copy"
+stats=$("$elf" --cache="$work/cache" --cache-stats $fields "$work/copy" 2>&1 > /dev/null)
+case "$stats" in
+*" 1 by build-id"*) ;;
+*) echo "copy not found by build-id: $stats"; exit 1 ;;
+esac
+echo "cache after edit: ok"
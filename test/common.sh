@@ -0,0 +1,65 @@
+# Helpers for the scripts that write files with elf and read them back,
+# sourced after elf, work and readelf (empty without one) are set.
+
+rm -rf "$work"
+mkdir -p "$work"
+
+fail() {
+  echo "$*"
+  exit 1
+}
+
+# what does not depend on where the writer put things
+layout_free="header.type,header.machine,header.entry,header.flags,header.phnum,header.shnum,header.shstrndx,\
+section.index,section.name,section.type,section.flags,section.addr,section.link,section.info,\
+symbol.table,symbol.index,symbol.name,symbol.value,symbol.size,symbol.bind,symbol.type,symbol.visibility,symbol.shndx"
+# and what does not change with the byte order either
+same_class="$layout_free,section.size,section.align,section.entsize,\
+segment.index,segment.type,segment.flags,segment.offset,segment.addr,segment.paddr,segment.size,segment.memsz,segment.align"
+
+records() {
+  "$elf" --format=jsonl --fields="$1" "$2" | sed 's/"file":"[^"]*",//'
+}
+
+# the tables readelf decodes, without the offsets of their sections
+tables() {
+  [ -z "$readelf" ] && return
+  for option in --syms --relocs --dynamic --notes --version-info --section-groups; do
+    "$readelf" -W $option "$1" 2>&1 | sed 's/ at offset 0x[0-9a-f]*//'
+  done
+}
+
+same() {
+  if [ "$2" != "$3" ]; then
+    echo "$1:"
+    printf '%s\n' "$2" > "$work/expected"
+    printf '%s\n' "$3" > "$work/got"
+    diff "$work/expected" "$work/got" | head -20
+    exit 1
+  fi
+}
+
+# readelf has nothing to say about the file
+check() {
+  [ -z "$readelf" ] && return
+  "$readelf" -a -W "$1" > /dev/null 2> "$work/errors" || true
+  if [ -s "$work/errors" ]; then
+    fail "readelf on $1: $(head -3 "$work/errors")"
+  fi
+}
+
+# write the file in $@ and check it, the commands read it back themselves
+run() {
+  "$elf" "$@" > "$work/output" || fail "elf $*: $(cat "$work/output")"
+}
+
+# relocatable and executable files of both classes and byte orders, and one
+# with extended section numbering, in $work under the names in $generated
+generate() {
+  "$elf" generate "$work/relocatable64" --seed=1 --symbols=200 --relocations=50 > /dev/null
+  "$elf" generate "$work/executable64msb" --seed=2 --msb --segments=2 --symbols=200 --relocations=20 > /dev/null
+  "$elf" generate "$work/relocatable32msb" --seed=3 --class=32 --msb --symbols=200 --relocations=50 > /dev/null
+  "$elf" generate "$work/executable32" --seed=4 --class=32 --segments=3 --symbols=200 > /dev/null
+  "$elf" generate "$work/extended64" --seed=5 --sections=65300 --symbols=100 > /dev/null
+  generated="relocatable64 executable64msb relocatable32msb executable32 extended64"
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# What edit changes is read back by elf and, when there is one, readelf, and
+# through the parse cache, which must not hand out what it had before.  A
+# list of edits with a wrong one in it must leave the file as it was.
+#
+# edit.sh <elf> <work dir> <readelf, or ""> <file>...
+#
+# Besides the files given it runs on the files common.sh generates.
+set -eu
+elf=$1
+work=$2
+readelf=$3
+shift 3
+. "$(dirname "$0")/common.sh"
+
+edit_file() {
+  file=$1
+  name=$(basename "$file")
+  out="$work/$name"
+  expected=$(records "$same_class" "$file")
+
+  # the last symbol with a name, if there is one, edited in a copy the
+  # cache has seen
+  symbol=$(records symbol.name "$file" | sed -n 's/.*"name":"\([^"]\{1,\}\)".*/\1/p' | tail -1)
+  cp "$file" "$out.edited"
+  "$elf" --cache="$work/cache" --format=jsonl --fields="$same_class" "$out.edited" > /dev/null
+  run edit "$out.edited" e_flags=0x5 ${symbol:+"$symbol:st_value=0x1234"}
+  check "$out.edited"
+  edited=$(records "$same_class" "$out.edited")
+  cached=$("$elf" --cache="$work/cache" --format=jsonl --fields="$same_class" "$out.edited" | sed 's/"file":"[^"]*",//')
+  same "$name edited, read through the cache" "$edited" "$cached"
+  same "$name edited" "$(printf '%s\n' "$expected" | sed 's/\("kind":"header".*"flags":\)[0-9]*/\15/; s/\("name":"'"$symbol"'","value":\)[0-9]*/\14660/')" "$edited"
+
+  # refused, after edits that are fine: the file is not touched
+  cp "$file" "$out.refused"
+  for wrong in bogus=1 sh_flags=0x2 ":sh_flags=0x2" e_flags=0x1ffffffffffffffff e_flags=-1 e_flags=0x100000000 \
+      .no-such-section:sh_addr=0 "${symbol:-main}:st_info=0x100" "${symbol:-main}:st_value=0x1ffffffffffffffff"; do
+    if "$elf" edit "$out.refused" e_flags=0x9 ${symbol:+"$symbol:st_value=0x5678"} "$wrong" > "$work/output"; then
+      fail "$name: edit $wrong was not refused"
+    fi
+    cmp "$file" "$out.refused" || fail "$name: edit $wrong was refused, but the file changed: $(cat "$work/output")"
+  done
+  echo "$name: ok"
+}
+
+generate
+for file in "$@"; do
+  edit_file "$file"
+done
+for name in $generated; do
+  edit_file "$work/$name"
+done
@@ -0,0 +1,98 @@
+#!/bin/sh
+# elf index watch appends a segment for every batch and compacts them: after
+# files are added, rewritten and deleted, batch after batch, what the index
+# answers has to be what a fresh index build of the tree answers, and the
+# segments must not pile up.
+#
+# index_compaction.sh <elf> <work dir>
+set -eu
+elf=$1
+work=$2
+
+rm -rf "$work"
+mkdir -p "$work/tree/first"
+tree=$(cd "$work/tree" && pwd)
+watcher=
+
+fail() {
+  echo "$*"
+  [ -n "$watcher" ] && kill "$watcher" 2> /dev/null
+  exit 1
+}
+
+# every global name of a file, so files that are gone are asked about too
+generate() {
+  "$elf" generate "$1" --seed="$2" --symbols=40 > /dev/null
+  "$elf" --format=jsonl --fields=symbol.name,symbol.bind "$1" | sed -n 's/.*"name":"\([^"]\{1,\}\)","bind":"STB_GLOBAL".*/\1/p' >> "$work/names"
+}
+
+answers() {
+  "$elf" index query "$1" $(sort -u "$work/names") | sort || true
+}
+
+# the watcher gets the batch when the tree has been quiet for the debounce
+# time, wait until it has caught up
+caught_up() {
+  rm -rf "$work/fresh"
+  "$elf" index build "$work/fresh" "$tree" > /dev/null
+  expected=$(answers "$work/fresh")
+  for attempt in $(seq 100); do
+    got=$(answers "$work/index")
+    [ "$got" = "$expected" ] && return
+    kill -0 "$watcher" 2> /dev/null || fail "$1: the watcher exited: $(cat "$work/log")"
+    sleep 0.1
+  done
+  printf '%s\n' "$expected" > "$work/expected"
+  printf '%s\n' "$got" > "$work/got"
+  diff "$work/expected" "$work/got" | head -20
+  fail "$1: the index does not answer what a fresh build does"
+}
+
+: > "$work/names"
+seed=1
+for file in 1 2 3 4 5 6 7 8; do
+  generate "$tree/first/$file" $seed
+  seed=$((seed + 1))
+done
+"$elf" index build "$work/index" "$tree" > /dev/null
+
+"$elf" index watch "$work/index" "$tree" --debounce=50 > "$work/log" &
+watcher=$!
+for attempt in $(seq 100); do
+  grep -q '^watching' "$work/log" && break
+  sleep 0.1
+done
+
+batches=24
+for batch in $(seq $batches); do
+  # a new file, in a directory of its own every fourth batch
+  directory="$tree/first"
+  if [ $((batch % 4)) = 0 ]; then
+    directory="$tree/added$batch"
+    mkdir "$directory"
+  fi
+  generate "$directory/new$batch" $seed
+  seed=$((seed + 1))
+  # one rewritten, written elsewhere and moved in so it is never half read
+  file=$(ls "$tree/first" | sort | head -$((batch % 8 + 1)) | tail -1)
+  generate "$work/rewritten" $seed
+  seed=$((seed + 1))
+  mv "$work/rewritten" "$tree/first/$file"
+  # and every third batch one deleted
+  if [ $((batch % 3)) = 0 ]; then
+    rm -f "$tree/first/new$((batch - 2))"
+  fi
+  caught_up "batch $batch"
+done
+
+# a directory that goes away with everything in it
+rm -rf "$tree/added8"
+caught_up "directory removed"
+
+kill "$watcher"
+wait "$watcher" || true
+watcher=
+
+segments=$(ls "$work/index" | grep -c '^segment-' || true)
+[ "$segments" -le 6 ] || fail "$segments segments after $batches batches"
+echo "index compaction: ok, $segments segments"
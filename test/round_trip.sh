@@ -0,0 +1,72 @@
+#!/bin/sh
+# What rewrite writes is read back by elf and, when there is one, readelf,
+# and compared with the file it was written from: rewritten in the same
+# class, to the other byte order and back, and to the other class and back.
+#
+# round_trip.sh <elf> <work dir> <readelf, or ""> <file>...
+#
+# Besides the files given, which are run when they are executables, it runs
+# on the files common.sh generates.
+set -eu
+elf=$1
+work=$2
+readelf=$3
+shift 3
+. "$(dirname "$0")/common.sh"
+
+round_trip() {
+  file=$1
+  name=$(basename "$file")
+  out="$work/$name"
+  case $(records header.class "$file") in
+  *'"class":2'*) class=64 other_class=32 ;;
+  *) class=32 other_class=64 ;;
+  esac
+  case $(records header.data "$file") in
+  *'"data":2'*) order=--msb other_order=--lsb ;;
+  *) order=--lsb other_order=--msb ;;
+  esac
+  expected=$(records "$same_class" "$file")
+  expected_tables=$(tables "$file")
+
+  run rewrite "$file" "$out.same"
+  check "$out.same"
+  same "$name rewritten" "$expected" "$(records "$same_class" "$out.same")"
+  same "$name rewritten, readelf" "$expected_tables" "$(tables "$out.same")"
+
+  run rewrite $other_order "$file" "$out.order"
+  check "$out.order"
+  same "$name in the other byte order" "$expected" "$(records "$same_class" "$out.order")"
+  same "$name in the other byte order, readelf" "$expected_tables" "$(tables "$out.order")"
+  run rewrite $order "$out.order" "$out.order.back"
+  cmp "$out.same" "$out.order.back" || fail "$name: the other byte order and back is not what rewriting it gives"
+
+  # a file with segments only fits in the larger class if its program
+  # headers do, which is not the case for generated files
+  if "$elf" rewrite --class=$other_class "$file" "$out.class" > "$work/output"; then
+    check "$out.class"
+    same "$name in the other class" "$(records "$layout_free" "$file")" "$(records "$layout_free" "$out.class")"
+    run rewrite --class=$class "$out.class" "$out.class.back"
+    check "$out.class.back"
+    same "$name in the other class and back" "$(records "$same_class" "$out.same")" "$(records "$same_class" "$out.class.back")"
+    same "$name in the other class and back, readelf" "$expected_tables" "$(tables "$out.class.back")"
+  elif [ $class = 64 ] || [ -z "$(records segment.index "$file")" ]; then
+    fail "$name in the other class: $(cat "$work/output")"
+  fi
+
+  if [ -x "$file" ]; then
+    result=$("$file")
+    for written in "$out.same" "$out.order.back"; do
+      same "$written run" "$result" "$("$written")"
+    done
+  fi
+  echo "$name: ok"
+}
+
+generate
+for file in "$@"; do
+  round_trip "$file"
+done
+for name in $generated; do
+  round_trip "$work/$name"
+done
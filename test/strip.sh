@@ -0,0 +1,81 @@
+#!/bin/sh
+# What strip writes is read back by elf and, when there is one, readelf: the
+# symbols are unchanged, the debug sections are gone from the output and the
+# same in the debug file.  Writing over the input must leave what writing
+# elsewhere does, for strip, rewrite and extract-section.
+#
+# strip.sh <elf> <work dir> <readelf, or ""> <file>...
+#
+# Besides the files given, which are run when they are executables, it runs
+# on the files common.sh generates.
+set -eu
+elf=$1
+work=$2
+readelf=$3
+shift 3
+. "$(dirname "$0")/common.sh"
+
+strip_file() {
+  file=$1
+  name=$(basename "$file")
+  out="$work/$name"
+
+  run strip --debug-file="$out.debug" "$file" "$out.stripped"
+  check "$out.stripped"
+  check "$out.debug"
+  symbols="symbol.name,symbol.value,symbol.size,symbol.bind,symbol.type,symbol.visibility"
+  same "$name stripped, symbols" "$(records $symbols "$file")" "$(records $symbols "$out.stripped")"
+  debug=$(records section.name "$file" | sed -n 's/.*"name":"\(\.debug_[^"]*\)".*/\1/p')
+  for section in $debug; do
+    run extract-section "$file" "$section" "$work/expected"
+    run extract-section "$out.debug" "$section" "$work/got"
+    cmp "$work/expected" "$work/got" || fail "$name: $section is not the same in the debug file"
+  done
+  left=$(records section.name "$out.stripped" | grep -c '"\.debug_' || true)
+  [ "$left" = 0 ] || fail "$name stripped: $left debug sections left"
+  if [ -n "$debug" ]; then
+    records section.name "$out.stripped" | grep -q '"\.gnu_debuglink"' || fail "$name stripped: no .gnu_debuglink"
+  fi
+  # relocations need their symbols, a relocatable file is refused
+  all=
+  if "$elf" strip --all "$file" "$out.all" > "$work/output"; then
+    all="$out.all"
+    check "$out.all"
+    if records section.type "$out.all" | grep -q '"SHT_SYMTAB"'; then
+      fail "$name stripped of all symbols still has a symbol table"
+    fi
+  elif ! grep -q "needs '.symtab'" "$work/output"; then
+    fail "$name stripped of all symbols: $(cat "$work/output")"
+  fi
+
+  # the input is mapped while the output is written
+  cp "$file" "$out.in-place"
+  run strip "$out.in-place" "$out.in-place"
+  "$elf" strip "$file" "$out.elsewhere" > /dev/null
+  cmp "$out.elsewhere" "$out.in-place" || fail "$name: stripped in place is not what stripping it elsewhere gives"
+  cp "$file" "$out.in-place"
+  run rewrite --msb "$out.in-place" "$out.in-place"
+  "$elf" rewrite --msb "$file" "$out.elsewhere" > /dev/null
+  cmp "$out.elsewhere" "$out.in-place" || fail "$name: rewritten in place is not what rewriting it elsewhere gives"
+  cp "$file" "$out.in-place"
+  run extract-section "$out.in-place" .symtab "$out.in-place"
+  "$elf" extract-section "$file" .symtab "$out.elsewhere" > /dev/null
+  cmp "$out.elsewhere" "$out.in-place" || fail "$name: a section extracted over its file is not what extracting it elsewhere gives"
+  [ -z "$(ls "$work" | grep '\.tmp$' || true)" ] || fail "$name: temporary files left"
+
+  if [ -x "$file" ]; then
+    result=$("$file")
+    for written in "$out.stripped" $all; do
+      same "$written run" "$result" "$("$written")"
+    done
+  fi
+  echo "$name: ok"
+}
+
+generate
+for file in "$@"; do
+  strip_file "$file"
+done
+for name in $generated; do
+  strip_file "$work/$name"
+done
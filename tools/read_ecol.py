@@ -0,0 +1,54 @@
+#!/usr/bin/python3
+
+# Reads an .ecol file written by `elf columnar` and prints it as tab separated
+# rows, mainly to check exports by eye.  The format is described in
+# src/ColumnarWriter.hpp.
+
+import struct
+import sys
+
+WIDTHS = {1: ("<B", 1), 2: ("<I", 4), 3: ("<Q", 8)}
+DICTIONARY = 4
+
+def read_ecol(filename:str):
+    with open(filename, "rb") as fh:
+        data = fh.read()
+    if data[0:4] != b"ECOL":
+        raise ValueError("{} is not an ecol file".format(filename))
+    version, count = struct.unpack_from("<II", data, 4)
+    cursor = 12
+    columns = []
+    for _ in range(count):
+        kind, length = struct.unpack_from("<BH", data, cursor)
+        cursor += 3
+        columns.append((data[cursor:cursor+length].decode(), kind))
+        cursor += length
+    yield [name for name, _ in columns]
+    while data[cursor:cursor+4] == b"RGRP":
+        rows, = struct.unpack_from("<Q", data, cursor + 4)
+        cursor += 12
+        values = []
+        for name, kind in columns:
+            length, = struct.unpack_from("<Q", data, cursor)
+            cursor += 8
+            chunk = data[cursor:cursor+length]
+            cursor += length
+            if kind == DICTIONARY:
+                n, = struct.unpack_from("<I", chunk, 0)
+                offsets = struct.unpack_from("<{}I".format(n + 1), chunk, 4)
+                strings = 4 + 4 * (n + 1)
+                entries = [chunk[strings+offsets[i]:strings+offsets[i+1]].decode(errors="replace") for i in range(n)]
+                codes = struct.unpack_from("<{}I".format(rows), chunk, strings + offsets[n])
+                values.append([entries[c] for c in codes])
+            else:
+                fmt, width = WIDTHS[kind]
+                values.append([struct.unpack_from(fmt, chunk, i * width)[0] for i in range(rows)])
+        for row in zip(*values):
+            yield list(row)
+    if data[cursor:cursor+4] != b"ECND":
+        raise ValueError("{} is truncated".format(filename))
+
+
+if __name__ == "__main__":
+    for row in read_ecol(sys.argv[1]):
+        print("\t".join(str(v) for v in row))
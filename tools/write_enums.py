@@ -3,7 +3,7 @@
 import os
 import typing
 
-def write_struct(in_filename:str, out_filename:str, name:str, namespace:str ):
+def write_struct(in_filename:str, out_filename:str, name:str):
     with open(in_filename) as infh:
         contents = infh.readlines()
     
@@ -40,7 +40,7 @@ def write_struct(in_filename:str, out_filename:str, name:str, namespace:str ):
                 elif c == 'x' and buffer=="0":
                     hex_num=True
                     buffer += c
-                elif hex_num and c in "ABCDEFabcdef":
+                elif hex_num and buffer.startswith("0x") and c in "ABCDEFabcdef":
                     buffer += c.upper()
                 elif c.isalpha():
                     what = 2
@@ -54,67 +54,110 @@ def write_struct(in_filename:str, out_filename:str, name:str, namespace:str ):
             item.append(buffer)
             buffer = "Description not available"
         item.append(buffer)
-        print(item)
         c_struct.append(item)
     
-    c_code = "#ifndef {}_HPP\n#define {}_HPP\n\n".format(name.upper(), name.upper())
-    c_code += "// This file is automatically generated, do not edit.\n\n"
-    c_code += "#include <string>\n\n";
-    c_code += "namespace {} {{\n\n".format(namespace)
-    c_code += "enum {} {{\n".format(name);
-    counter = 0
-    reserved_counter=0;
     name_mapping = []
+    reserved_counter = 0
     for row in c_struct:
-        comma = ""
-        if counter < len(c_struct)-1:
-            comma = ","
-        if len(row) == 2:
-            enum_name = row[0]
-            if row[0].lower() == "reserved":
-                enum_name = name+"_"+enum_name+"_"+str(reserved_counter)
-                reserved_counter += 1
-            name_mapping.append([enum_name,row[1]])
-            c_code += "    {:<40s}= {:<10s}\n".format(enum_name,row[1]+comma);
-        elif len(row) == 3:
+        if len(row) == 2 or len(row) == 3:
             enum_name = row[0]
             if row[0].lower() == "reserved":
-                enum_name = name+"_"+enum_name+"_"+str(reserved_counter)
-                reserved_counter += 1
-            name_mapping.append([enum_name,row[1]])
-            c_code += "    {:<40s}= {:<10s} // {}\n".format(enum_name,row[1]+comma,row[2]);
+                # name reserved values after the value, like the ranges below
+                enum_name = name+"_"+enum_name+"_"+row[1]
+            comment = row[2] if len(row) == 3 else None
+            name_mapping.append([enum_name, row[1], comment])
         elif len(row) == 4:
             for a in range(int(row[1]), int(row[2])+1):
                 enum_name = row[0]+"_"+str(a)
                 if row[0].lower() == "reserved":
                     enum_name = name+"_"+enum_name
-                name_mapping.append([enum_name,a])
-                c_code += "    {:<40s}= {:<10s} // {}\n".format(enum_name,str(a)+comma,row[3]);
+                name_mapping.append([enum_name, str(a), row[3]])
         else:
             raise ValueError("invalid number of columns in row {}".format(row))
-        counter += 1
+
+    c_code = "#ifndef {}_HPP\n#define {}_HPP\n\n".format(name.upper(), name.upper())
+    c_code += "// This file is automatically generated by tools/write_enums.py, do not edit.\n\n"
+    c_code += "#include <cstddef>\n#include <cstdint>\n#include <optional>\n#include <string_view>\n\n"
+    c_code += "enum {} {{\n".format(name)
+    for counter, (enum_name, value, comment) in enumerate(name_mapping):
+        comma = "," if counter < len(name_mapping)-1 else ""
+        if comment is None:
+            c_code += "    {:<40s}= {}\n".format(enum_name, value+comma)
+        else:
+            c_code += "    {:<40s}= {:<10s} // {}\n".format(enum_name, value+comma, comment)
     c_code += "};\n\n"
 
-    # add a function for taking a int64_t value and returning a string of the enum
-    fn_code = "std::string {}_to_string(int64_t value)\n{{\n".format(name)
-    fn_code += "  switch(value) {\n"
-    for row in name_mapping:
-        fn_code += "    case {}:\n".format(row[1])
-        fn_code += "      return \"{}\";\n".format(row[0])
-    fn_code += "    default:\n"
-    fn_code += "      return \"unknown\";\n"
-    fn_code += "  }\n}\n"
+    values = [(int(value, 0), enum_name) for enum_name, value, _ in name_mapping]
+    if len(set(v for v, _ in values)) != len(values):
+        raise ValueError("duplicate values in {}".format(in_filename))
+    by_value = sorted(values)
+    by_name = sorted(values, key=lambda v: v[1])
+    # small non negative values are looked up directly, anything else is a
+    # binary search over the values
+    dense = by_value[0][0] >= 0 and by_value[-1][0] < 2 * len(by_value) + 16
+
+    c_code += "namespace {}_table {{\n\n".format(name)
+    c_code += "struct entry\n{\n  int64_t value;\n  std::string_view name;\n};\n\n"
+    if dense:
+        names = dict((v, n) for v, n in values)
+        c_code += "// indexed by value, unused values are empty\n"
+        c_code += "inline constexpr std::string_view names[] = {\n"
+        for v in range(0, by_value[-1][0]+1):
+            c_code += "  \"{}\",\n".format(names.get(v, ""))
+        c_code += "};\n\n"
+    else:
+        c_code += "// sorted by value\n"
+        c_code += "inline constexpr entry by_value[] = {\n"
+        for v, n in by_value:
+            c_code += "  {{ 0x{:X}, \"{}\" }},\n".format(v, n)
+        c_code += "};\n\n"
+    c_code += "// sorted by name\n"
+    c_code += "inline constexpr entry by_name[] = {\n"
+    for v, n in by_name:
+        c_code += "  {{ 0x{:X}, \"{}\" }},\n".format(v, n)
+    c_code += "};\n\n"
+    c_code += "}}// namespace {}_table\n\n".format(name)
+
+    c_code += "/**\n * @brief Name of an enum value, \"unknown\" if it has none\n */\n"
+    c_code += "constexpr std::string_view {}_to_string(int64_t value)\n{{\n".format(name)
+    if dense:
+        c_code += "  constexpr auto count = static_cast<int64_t>(sizeof({0}_table::names) / sizeof({0}_table::names[0]));\n".format(name)
+        c_code += "  if (value < 0 || value >= count || {}_table::names[value].empty()) return \"unknown\";\n".format(name)
+        c_code += "  return {}_table::names[value];\n".format(name)
+    else:
+        c_code += "  size_t low = 0;\n"
+        c_code += "  size_t high = sizeof({0}_table::by_value) / sizeof({0}_table::by_value[0]);\n".format(name)
+        c_code += "  while (low < high) {\n"
+        c_code += "    size_t middle = low + (high - low) / 2;\n"
+        c_code += "    if ({}_table::by_value[middle].value < value) {{\n".format(name)
+        c_code += "      low = middle + 1;\n    } else {\n      high = middle;\n    }\n  }\n"
+        c_code += "  if (low == sizeof({0}_table::by_value) / sizeof({0}_table::by_value[0]) || {0}_table::by_value[low].value != value) return \"unknown\";\n".format(name)
+        c_code += "  return {}_table::by_value[low].name;\n".format(name)
+    c_code += "}\n\n"
+
+    c_code += "/**\n * @brief Value of an enum by name, usable in constant expressions\n */\n"
+    c_code += "constexpr std::optional<{0}> {0}_from_string(std::string_view name)\n{{\n".format(name)
+    c_code += "  size_t low = 0;\n"
+    c_code += "  size_t high = sizeof({0}_table::by_name) / sizeof({0}_table::by_name[0]);\n".format(name)
+    c_code += "  while (low < high) {\n"
+    c_code += "    size_t middle = low + (high - low) / 2;\n"
+    c_code += "    if ({}_table::by_name[middle].name < name) {{\n".format(name)
+    c_code += "      low = middle + 1;\n    } else {\n      high = middle;\n    }\n  }\n"
+    c_code += "  if (low == sizeof({0}_table::by_name) / sizeof({0}_table::by_name[0]) || {0}_table::by_name[low].name != name) return std::nullopt;\n".format(name)
+    c_code += "  return static_cast<{}>({}_table::by_name[low].value);\n".format(name, name)
+    c_code += "}\n\n"
 
-    c_code += fn_code
-    c_code += "\n\n}} // end of namespace {}\n\n".format(namespace)
     c_code += "#endif // end of {}_HPP\n".format(name.upper())
     with open(out_filename, "w") as outfh:
-        outfh.write(c_code);
-    
+        outfh.write(c_code)
+
 
 
 if __name__ == "__main__":
-    write_struct("machines.txt", "machines.hpp", "e_machines","elf");
-    write_struct("section_attribute_flags.txt", "section_attribute_flags.hpp", "e_sh_flags","elf");
-    write_struct("section_types.txt", "section_types.hpp", "e_section_types", "elf");
+    root = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+    text = os.path.join(root, "text")
+    src = os.path.join(root, "src")
+    write_struct(os.path.join(text, "machines.txt"), os.path.join(src, "machines.hpp"), "e_machines")
+    write_struct(os.path.join(text, "section_attribute_flags.txt"), os.path.join(src, "section_attribute_flags.hpp"), "e_sh_flags")
+    write_struct(os.path.join(text, "section_types.txt"), os.path.join(src, "section_types.hpp"), "e_section_types")
     
\ No newline at end of file